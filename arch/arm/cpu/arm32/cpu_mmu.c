@@ -1697,7 +1697,24 @@ int __cpuinit arch_cpu_aspace_memory_rwinit(virtual_addr_t tmp_va)
 
 #endif
 
+virtual_size_t arch_cpu_aspace_best_page_size(virtual_addr_t page_va,
+					      physical_addr_t page_pa,
+					      virtual_size_t avail_sz)
+{
+	/* Only 1M sections are used for reserved mappings
+	 * because other l1 tables load them on-demand.
+	 */
+	if (!(page_va & (TTBL_L1TBL_SECTION_PAGE_SIZE - 1)) &&
+	    !(page_pa & (TTBL_L1TBL_SECTION_PAGE_SIZE - 1)) &&
+	    (TTBL_L1TBL_SECTION_PAGE_SIZE <= avail_sz)) {
+		return TTBL_L1TBL_SECTION_PAGE_SIZE;
+	}
+
+	return VMM_PAGE_SIZE;
+}
+
 int arch_cpu_aspace_map(virtual_addr_t page_va,
+			virtual_size_t page_sz,
 			physical_addr_t page_pa,
 			u32 mem_flags)
 {
@@ -1708,7 +1725,7 @@ int arch_cpu_aspace_map(virtual_addr_t page_va,
 	/* Initialize the page struct */
 	p.pa = page_pa;
 	p.va = page_va;
-	p.sz = VMM_PAGE_SIZE;
+	p.sz = page_sz;
 	p.dom = TTBL_L1TBL_TTE_DOM_RESERVED;
 
 #if defined(CONFIG_ARMV5)
@@ -1760,7 +1777,8 @@ int arch_cpu_aspace_map(virtual_addr_t page_va,
 	return cpu_mmu_map_reserved_page(&p);
 }
 
-int arch_cpu_aspace_unmap(virtual_addr_t page_va)
+int arch_cpu_aspace_unmap(virtual_addr_t page_va,
+			  virtual_size_t *page_sz)
 {
 	int rc;
 	struct cpu_page p;
@@ -1770,7 +1788,12 @@ int arch_cpu_aspace_unmap(virtual_addr_t page_va)
 		return rc;
 	}
 
-	return cpu_mmu_unmap_reserved_page(&p);
+	rc = cpu_mmu_unmap_reserved_page(&p);
+	if (!rc && page_sz) {
+		*page_sz = p.sz;
+	}
+
+	return rc;
 }
 
 int arch_cpu_aspace_va2pa(virtual_addr_t va, physical_addr_t *pa)
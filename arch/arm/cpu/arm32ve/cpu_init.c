@@ -26,6 +26,7 @@
 #include <vmm_params.h>
 #include <vmm_devtree.h>
 #include <arch_cpu.h>
+#include <cpu_vcpu_excep.h>
 
 extern u8 _code_start;
 extern u8 _code_end;
@@ -84,7 +85,7 @@ int __init arch_cpu_final_init(void)
 	/* All VMM API's are available here */
 	/* We can register a CPU specific resources here */
 
-	return VMM_OK;
+	return cpu_vcpu_excep_init();
 }
 
 void __init cpu_init(void)
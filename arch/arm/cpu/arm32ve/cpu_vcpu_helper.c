@@ -27,6 +27,7 @@
 #include <vmm_stdio.h>
 #include <vmm_scheduler.h>
 #include <arch_vcpu.h>
+#include <arch_atomic64.h>
 #include <arch_barrier.h>
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
@@ -41,6 +42,7 @@
 #include <generic_timer.h>
 #include <arm_features.h>
 #include <mmu_lpae.h>
+#include <emulate_cache.h>
 
 void cpu_vcpu_halt(struct vmm_vcpu *vcpu, arch_regs_t *regs)
 {
@@ -459,8 +461,21 @@ int arch_guest_init(struct vmm_guest *guest)
 			/* By default, assume PSCI v0.1 */
 			arm_guest_priv(guest)->psci_version = 1;
 		}
+
+		arm_guest_priv(guest)->inst_cache = NULL;
+		if (emulate_cache_init(guest)) {
+			mmu_lpae_ttbl_free(arm_guest_priv(guest)->ttbl);
+			vmm_free(guest->arch_priv);
+			guest->arch_priv = NULL;
+			return VMM_ENOMEM;
+		}
+	} else {
+		emulate_cache_flush(guest);
 	}
 
+	arch_atomic64_write(&arm_guest_priv(guest)->stage2_fault_count, 0);
+	arch_atomic64_write(&arm_guest_priv(guest)->stage2_prefault_count, 0);
+
 	return VMM_OK;
 }
 
@@ -472,6 +487,7 @@ int arch_guest_deinit(struct vmm_guest *guest)
 		if ((rc = mmu_lpae_ttbl_free(arm_guest_priv(guest)->ttbl))) {
 			return rc;
 		}
+		emulate_cache_deinit(guest);
 
 		vmm_free(guest->arch_priv);
 	}
@@ -1083,5 +1099,16 @@ void arch_vcpu_regs_dump(struct vmm_chardev *cdev, struct vmm_vcpu *vcpu)
 
 void arch_vcpu_stat_dump(struct vmm_chardev *cdev, struct vmm_vcpu *vcpu)
 {
-	/* For now no arch specific stats */
+	struct arm_guest_priv *gpriv;
+
+	if (!vcpu->is_normal || !vcpu->guest->arch_priv) {
+		return;
+	}
+	gpriv = arm_guest_priv(vcpu->guest);
+
+	vmm_cprintf(cdev, "Guest Stage2 Faults    : %"PRIu64"\n",
+		    arch_atomic64_read(&gpriv->stage2_fault_count));
+	vmm_cprintf(cdev, "Guest Stage2 Prefaults : %"PRIu64"\n",
+		    arch_atomic64_read(&gpriv->stage2_prefault_count));
+	emulate_cache_stat_dump(cdev, vcpu->guest);
 }
@@ -40,4 +40,7 @@ int cpu_vcpu_data_abort(struct vmm_vcpu *vcpu,
 			virtual_addr_t dfar,
 			physical_addr_t fipa);
 
+/** Initialize VCPU exception handling (Stage2 population) */
+int cpu_vcpu_excep_init(void);
+
 #endif /* _CPU_VCPU_EXCEP_H__ */
@@ -26,6 +26,8 @@
 #include <vmm_params.h>
 #include <vmm_devtree.h>
 #include <arch_cpu.h>
+#include <cpu_vcpu_excep.h>
+#include <cpu_locks.h>
 
 extern u8 _code_start;
 extern u8 _code_end;
@@ -58,6 +60,9 @@ int __init arch_cpu_early_init(void)
 	 * memory or boot time memory reservation here.
 	 */
 
+	/* Use best lock implementation supported by boot CPU */
+	cpu_locks_init();
+
 	node = vmm_devtree_getnode(VMM_DEVTREE_PATH_SEPARATOR_STRING
 				   VMM_DEVTREE_CHOSEN_NODE_NAME);
 	if (!node) {
@@ -83,7 +88,7 @@ int __init arch_cpu_final_init(void)
 {
 	/* All VMM API's are available here */
 	/* We can register a CPU specific resources here */
-	return VMM_OK;
+	return cpu_vcpu_excep_init();
 }
 
 void __init cpu_init(void)
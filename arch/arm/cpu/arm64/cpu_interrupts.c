@@ -181,7 +181,8 @@ void do_sync(arch_regs_t *regs, unsigned long mode)
 		fipa = (mrs(hpfar_el2) & HPFAR_FIPA_MASK) >> HPFAR_FIPA_SHIFT;
 		fipa = fipa << HPFAR_FIPA_PAGE_SHIFT;
 		fipa = fipa | (mrs(far_el2) & HPFAR_FIPA_PAGE_MASK);
-		rc = cpu_vcpu_data_abort(vcpu, regs, il, iss, fipa);
+		rc = cpu_vcpu_data_abort(vcpu, regs, il, iss,
+					 mrs(far_el2), fipa);
 		break;
 	case EC_CUREL_INST_ABORT:
 	case EC_CUREL_DATA_ABORT:
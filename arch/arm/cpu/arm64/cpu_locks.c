@@ -19,176 +19,337 @@
  * @file cpu_locks.c
  * @author Sukanto Ghosh (sukantoghosh@gmail.com)
  * @brief ARM64 specific synchronization mechanisms.
+ *
+ * Spinlocks are FIFO ticket locks and rwlocks are queued rwlocks which
+ * serialize contending readers and writers on an internal ticket lock.
+ * New readers back off while a writer is waiting so writers can't be
+ * starved, except readers in IRQ context which only wait for an active
+ * writer. Waiters sleep in WFE on the lock word and are woken by the
+ * exclusive monitor being cleared when the word is updated.
+ *
+ * ARMv8.1 LSE atomics are used for the contended read-modify-write
+ * operations when the boot CPU advertises them.
  */
 
 #include <vmm_error.h>
 #include <vmm_types.h>
 #include <vmm_smp.h>
 #include <vmm_compiler.h>
+#include <vmm_scheduler.h>
 #include <arch_barrier.h>
+#include <cpu_inline_asm.h>
+#include <cpu_locks.h>
 
-bool __lock arch_spin_lock_check(arch_spinlock_t *lock)
+#define TICKET_SHIFT			16
+
+#ifdef CONFIG_ARM64_LSE_ATOMICS
+static bool cpu_locks_lse __read_mostly = FALSE;
+#define __LSE_PREAMBLE			".arch_extension lse\n"
+#endif
+
+void __init cpu_locks_init(void)
 {
-	arch_smp_mb();
-	return (lock->lock == __ARCH_SPIN_UNLOCKED) ? FALSE : TRUE;
+#ifdef CONFIG_ARM64_LSE_ATOMICS
+	/* ID_AA64ISAR0_EL1.Atomic >= 2 means LSE atomics are available */
+	if (((mrs(id_aa64isar0_el1) >> 20) & 0xf) >= 2) {
+		cpu_locks_lse = TRUE;
+	}
+#endif
 }
 
-void __lock arch_spin_lock(arch_spinlock_t *lock)
+bool cpu_locks_lse_enabled(void)
+{
+#ifdef CONFIG_ARM64_LSE_ATOMICS
+	return cpu_locks_lse;
+#else
+	return FALSE;
+#endif
+}
+
+/* Atomically add to lock word and return old value (acquire) */
+static inline u32 __lock_fetch_add_acquire(volatile u32 *p, u32 val)
+{
+	u32 old, new, tmp;
+
+#ifdef CONFIG_ARM64_LSE_ATOMICS
+	if (cpu_locks_lse) {
+		asm volatile(
+		__LSE_PREAMBLE
+	"	ldadda	%w2, %w0, %1\n"
+		: "=&r" (old), "+Q" (*p)
+		: "r" (val)
+		: "memory");
+		return old;
+	}
+#endif
+
+	asm volatile(
+"	prfm	pstl1strm, %3\n"
+"1:	ldaxr	%w0, %3\n"
+"	add	%w1, %w0, %w4\n"
+"	stxr	%w2, %w1, %3\n"
+"	cbnz	%w2, 1b\n"
+	: "=&r" (old), "=&r" (new), "=&r" (tmp), "+Q" (*p)
+	: "r" (val)
+	: "memory");
+
+	return old;
+}
+
+/* Atomically add to lock word (release) */
+static inline void __lock_add_release(volatile u32 *p, u32 val)
+{
+	u32 new, tmp;
+
+#ifdef CONFIG_ARM64_LSE_ATOMICS
+	if (cpu_locks_lse) {
+		asm volatile(
+		__LSE_PREAMBLE
+	"	staddl	%w1, %0\n"
+		: "+Q" (*p)
+		: "r" (val)
+		: "memory");
+		return;
+	}
+#endif
+
+	asm volatile(
+"1:	ldxr	%w0, %2\n"
+"	add	%w0, %w0, %w3\n"
+"	stlxr	%w1, %w0, %2\n"
+"	cbnz	%w1, 1b\n"
+	: "=&r" (new), "=&r" (tmp), "+Q" (*p)
+	: "r" (val)
+	: "memory");
+}
+
+/* Atomically add to lock word without ordering */
+static inline void __lock_add(volatile u32 *p, u32 val)
 {
-	u32 cpu = vmm_smp_processor_id();
-	unsigned long tmp;
+	u32 new, tmp;
+
+#ifdef CONFIG_ARM64_LSE_ATOMICS
+	if (cpu_locks_lse) {
+		asm volatile(
+		__LSE_PREAMBLE
+	"	stadd	%w1, %0\n"
+		: "+Q" (*p)
+		: "r" (val)
+		: "memory");
+		return;
+	}
+#endif
+
+	asm volatile(
+"1:	ldxr	%w0, %2\n"
+"	add	%w0, %w0, %w3\n"
+"	stxr	%w1, %w0, %2\n"
+"	cbnz	%w1, 1b\n"
+	: "=&r" (new), "=&r" (tmp), "+Q" (*p)
+	: "r" (val)
+	: "memory");
+}
+
+/* Compare and swap lock word and return previous value (acquire) */
+static inline u32 __lock_cmpxchg_acquire(volatile u32 *p, u32 old, u32 new)
+{
+	u32 prev, tmp;
+
+#ifdef CONFIG_ARM64_LSE_ATOMICS
+	if (cpu_locks_lse) {
+		prev = old;
+		asm volatile(
+		__LSE_PREAMBLE
+	"	casa	%w0, %w2, %1\n"
+		: "+r" (prev), "+Q" (*p)
+		: "r" (new)
+		: "memory");
+		return prev;
+	}
+#endif
 
-	__asm__ __volatile__(
+	asm volatile(
+"1:	ldaxr	%w0, %2\n"
+"	cmp	%w0, %w3\n"
+"	b.ne	2f\n"
+"	stxr	%w1, %w4, %2\n"
+"	cbnz	%w1, 1b\n"
+"2:\n"
+	: "=&r" (prev), "=&r" (tmp), "+Q" (*p)
+	: "r" (old), "r" (new)
+	: "cc", "memory");
+
+	return prev;
+}
+
+/* Sleep until (lock word & mask) == val and return lock word (acquire) */
+static inline u32 __lock_wait(volatile u32 *p, u32 mask, u32 val)
+{
+	u32 cur, tmp;
+
+	asm volatile(
 "	sevl\n"
 "1:	wfe\n"
-"2:	ldaxr	%w0, %1\n"
-"	cmp	%w0, %w3\n"
+"	ldaxr	%w0, %2\n"
+"	and	%w1, %w0, %w3\n"
+"	cmp	%w1, %w4\n"
 "	b.ne	1b\n"
-"	stxr	%w0, %w2, %1\n"
-"	cbnz	%w0, 2b\n"
-	: "=&r" (tmp), "+Q" (lock->lock)
-	: "r" (cpu), "r" (__ARCH_SPIN_UNLOCKED)
+	: "=&r" (cur), "=&r" (tmp)
+	: "Q" (*p), "r" (mask), "r" (val)
 	: "cc", "memory");
+
+	return cur;
 }
 
-int arch_spin_trylock(arch_spinlock_t *lock)
+bool __lock arch_spin_lock_check(arch_spinlock_t *lock)
+{
+	u32 val = *((volatile u32 *)&lock->lock);
+
+	arch_smp_mb();
+	return ((val >> TICKET_SHIFT) == (val & 0xffff)) ? FALSE : TRUE;
+}
+
+void __lock arch_spin_lock(arch_spinlock_t *lock)
 {
-	u32 cpu = vmm_smp_processor_id();
-	unsigned int tmp;
+	u32 tmp;
+	u32 val = __lock_fetch_add_acquire(&lock->lock, 1 << TICKET_SHIFT);
 
+	/* Did we get the lock? */
+	if ((val >> TICKET_SHIFT) == (val & 0xffff)) {
+		return;
+	}
+
+	/* No: sleep until owner reaches our ticket */
 	asm volatile(
-"	ldaxr	%w0, %1\n"
-"	cmp	%w0, %w3\n"
-"	b.ne	1f\n"
-"	stxr	%w0, %w2, %1\n"
-"	b	2f\n"
-"1:	mov	%w0, #1\n"
-"2:\n"
-	: "=&r" (tmp), "+Q" (lock->lock)
-	: "r" (cpu), "r" (__ARCH_SPIN_UNLOCKED)
+"	sevl\n"
+"1:	wfe\n"
+"	ldaxrh	%w0, %1\n"
+"	cmp	%w0, %w2\n"
+"	b.ne	1b\n"
+	: "=&r" (tmp)
+	: "Q" (lock->tickets.owner), "r" (val >> TICKET_SHIFT)
 	: "cc", "memory");
+}
 
-	if (tmp == 0) {
-		return 1;
-	} else {
+int __lock arch_spin_trylock(arch_spinlock_t *lock)
+{
+	u32 val = *((volatile u32 *)&lock->lock);
+
+	if ((val >> TICKET_SHIFT) != (val & 0xffff)) {
 		return 0;
 	}
+
+	return (__lock_cmpxchg_acquire(&lock->lock, val,
+				       val + (1 << TICKET_SHIFT)) == val) ? 1 : 0;
 }
 
 void __lock arch_spin_unlock(arch_spinlock_t *lock)
 {
-	__asm__ __volatile__(
-"	stlr	%w1, %0\n"
-	: "=Q" (lock->lock) : "r" (__ARCH_SPIN_UNLOCKED)
+	/* Only lock owner updates owner ticket so plain store will do */
+	u32 owner = lock->tickets.owner + 1;
+
+	asm volatile(
+"	stlrh	%w1, %0\n"
+	: "=Q" (lock->tickets.owner)
+	: "r" (owner)
 	: "memory");
 }
 
 bool __lock arch_write_lock_check(arch_rwlock_t *lock)
 {
 	arch_smp_mb();
-	return (lock->lock & __ARCH_RW_LOCKED) ? TRUE : FALSE;
+	return ((lock->cnts & __ARCH_RW_WLOCKED) ==
+		__ARCH_RW_WLOCKED) ? TRUE : FALSE;
 }
 
-/*
- * To take a write lock we set bit 31 to 1
- */
 void __lock arch_write_lock(arch_rwlock_t *lock)
 {
-	unsigned int tmp;
+	/* Fast path: lock is free */
+	if (!__lock_cmpxchg_acquire(&lock->cnts, 0, __ARCH_RW_WLOCKED)) {
+		return;
+	}
 
-	__asm__ __volatile__(
-	"	sevl\n"
-	"1:	wfe\n"
-	"2:	ldaxr	%w0, [%1]\n"
-	"	cbnz	%w0, 1b\n"
-	"	stxr	%w0, %w2, [%1]\n"
-	"	cbnz	%w0, 2b\n"
-	: "=&r" (tmp)
-	: "r" (&lock->lock), "r" (__ARCH_RW_LOCKED)
-	: "memory");
+	/* Slow path: queue behind other waiters */
+	arch_spin_lock(&lock->wait_lock);
+
+	/* Tell readers that a writer is waiting */
+	__lock_add(&lock->cnts, __ARCH_RW_WWAITING);
+
+	/* Wait for readers to drain then take ownership */
+	while (1) {
+		__lock_wait(&lock->cnts, ~0U, __ARCH_RW_WWAITING);
+		if (__lock_cmpxchg_acquire(&lock->cnts,
+					   __ARCH_RW_WWAITING,
+					   __ARCH_RW_WLOCKED) ==
+						__ARCH_RW_WWAITING) {
+			break;
+		}
+	}
+
+	arch_spin_unlock(&lock->wait_lock);
 }
 
 int __lock arch_write_trylock(arch_rwlock_t *lock)
 {
-	unsigned int tmp;
-
-	asm volatile(
-	"	ldaxr	%w0, [%1]\n"
-	"	cbnz	%w0, 1f\n"
-	"	stxr	%w0, %w2, [%1]\n"
-	"1:\n"
-	: "=&r" (tmp)
-	: "r" (&lock->lock), "r" (__ARCH_RW_LOCKED)
-	: "memory");
-
-	if (tmp == 0) {
-		 return 1;
-	} else {
-		 return 0;
+	if (lock->cnts) {
+		return 0;
 	}
+
+	return (!__lock_cmpxchg_acquire(&lock->cnts, 0,
+					__ARCH_RW_WLOCKED)) ? 1 : 0;
 }
 
 void __lock arch_write_unlock(arch_rwlock_t *lock)
 {
-	asm volatile(
-	"	stlr	%w1, [%0]\n"
-	: : "r" (&lock->lock), "r" (0) : "memory");
+	__lock_add_release(&lock->cnts, -__ARCH_RW_WLOCKED);
 }
 
 bool __lock arch_read_lock_check(arch_rwlock_t *lock)
 {
 	arch_smp_mb();
-	return (lock->lock == __ARCH_RW_UNLOCKED) ? FALSE : TRUE;
+	return (lock->cnts & ~__ARCH_RW_WWAITING) ? TRUE : FALSE;
 }
 
 void __lock arch_read_lock(arch_rwlock_t *lock)
 {
-	unsigned int tmp, tmp2;
+	u32 cnts;
 
-	asm volatile(
-	"	sevl\n"
-	"1:	wfe\n"
-	"2:	ldaxr	%w0, [%2]\n"
-	"	add	%w0, %w0, #1\n"
-	"	tbnz	%w0, #31, 1b\n"
-	"	stxr	%w1, %w0, [%2]\n"
-	"	cbnz	%w1, 2b\n"
-	: "=&r" (tmp), "=&r" (tmp2)
-	: "r" (&lock->lock)
-	: "memory");
+	/* Fast path: no writer holding or waiting for the lock */
+	cnts = __lock_fetch_add_acquire(&lock->cnts, __ARCH_RW_RBIAS);
+	if (!(cnts & __ARCH_RW_WMASK)) {
+		return;
+	}
+
+	/* Reader in IRQ context might have interrupted a reader of
+	 * same lock so it only waits for active writer otherwise it
+	 * would deadlock against the waiting writer.
+	 */
+	if (vmm_scheduler_irq_context()) {
+		__lock_wait(&lock->cnts, __ARCH_RW_WLOCKED, 0);
+		return;
+	}
+
+	/* Slow path: back off and queue behind waiting writer */
+	__lock_add(&lock->cnts, -__ARCH_RW_RBIAS);
+	arch_spin_lock(&lock->wait_lock);
+	__lock_add(&lock->cnts, __ARCH_RW_RBIAS);
+	__lock_wait(&lock->cnts, __ARCH_RW_WLOCKED, 0);
+	arch_spin_unlock(&lock->wait_lock);
 }
 
 int __lock arch_read_trylock(arch_rwlock_t *lock)
 {
-	unsigned int tmp, tmp2 = 1;
-
-	asm volatile(
-	"	ldaxr	%w0, [%2]\n"
-	"	add	%w0, %w0, #1\n"
-	"	tbnz	%w0, #31, 1f\n"
-	"	stxr	%w1, %w0, [%2]\n"
-	"1:\n"
-	: "=&r" (tmp), "+r" (tmp2)
-	: "r" (&lock->lock)
-	: "memory");
+	u32 cnts = lock->cnts;
 
-	if (tmp2 == 0) {
-		return 1;
-	} else {
+	if (cnts & __ARCH_RW_WMASK) {
 		return 0;
 	}
+
+	return (__lock_cmpxchg_acquire(&lock->cnts, cnts,
+				cnts + __ARCH_RW_RBIAS) == cnts) ? 1 : 0;
 }
 
 void __lock arch_read_unlock(arch_rwlock_t *lock)
 {
-	unsigned int tmp, tmp2;
-
-	asm volatile(
-	"1:	ldxr	%w0, [%2]\n"
-	"	sub	%w0, %w0, #1\n"
-	"	stlxr	%w1, %w0, [%2]\n"
-	"	cbnz	%w1, 1b\n"
-	: "=&r" (tmp), "=&r" (tmp2)
-	: "r" (&lock->lock)
-	: "memory");
+	__lock_add_release(&lock->cnts, -__ARCH_RW_RBIAS);
 }
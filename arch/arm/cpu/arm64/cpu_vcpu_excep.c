@@ -22,9 +22,11 @@
  */
 
 #include <vmm_error.h>
+#include <vmm_compiler.h>
 #include <vmm_stdio.h>
 #include <vmm_host_aspace.h>
 #include <vmm_guest_aspace.h>
+#include <arch_atomic64.h>
 #include <libs/stringlib.h>
 #include <cpu_inline_asm.h>
 #include <cpu_vcpu_helper.h>
@@ -34,10 +36,13 @@
 #include <mmu_lpae.h>
 #include <emulate_arm.h>
 #include <emulate_thumb.h>
+#include <emulate_cache.h>
 
-static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
-			       arch_regs_t *regs,
-			       physical_addr_t fipa)
+/* Map biggest possible Stage2 block for given IPA */
+static int __cpu_vcpu_stage2_map(struct vmm_guest *guest,
+				 physical_addr_t fipa,
+				 struct cpu_page *out_pg,
+				 u32 *out_reg_flags)
 {
 	int rc, rc1;
 	u32 reg_flags = 0x0, pg_reg_flags = 0x0;
@@ -51,18 +56,14 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 	size = TTBL_L3_BLOCK_SIZE;
 	pg.sh = 3U;
 
-	rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
+	rc = vmm_guest_physical_map(guest, inaddr, size,
 				    &outaddr, &availsz, &reg_flags);
 	if (rc) {
-		vmm_printf("%s: IPA=0x%lx size=0x%lx map failed\n",
-			   __func__, inaddr, size);
 		return rc;
 	}
 
 	if (availsz < TTBL_L3_BLOCK_SIZE) {
-		vmm_printf("%s: availsz=0x%lx insufficent for IPA=0x%lx\n",
-			   __func__, availsz, inaddr);
-		return VMM_EFAIL;
+		return VMM_ENOSPC;
 	}
 
 	pg.ia = inaddr;
@@ -71,25 +72,26 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 	pg_reg_flags = reg_flags;
 
 	if (reg_flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) {
-		inaddr = fipa & TTBL_L2_MAP_MASK;
-		size = TTBL_L2_BLOCK_SIZE;
-		rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
-				    &outaddr, &availsz, &reg_flags);
-		if (!rc && (availsz >= TTBL_L2_BLOCK_SIZE)) {
-			pg.ia = inaddr;
-			pg.sz = size;
-			pg.oa = outaddr;
-			pg_reg_flags = reg_flags;
-		}
 		inaddr = fipa & TTBL_L1_MAP_MASK;
 		size = TTBL_L1_BLOCK_SIZE;
-		rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
+		rc = vmm_guest_physical_map(guest, inaddr, size,
 				    &outaddr, &availsz, &reg_flags);
 		if (!rc && (availsz >= TTBL_L1_BLOCK_SIZE)) {
 			pg.ia = inaddr;
 			pg.sz = size;
 			pg.oa = outaddr;
 			pg_reg_flags = reg_flags;
+		} else {
+			inaddr = fipa & TTBL_L2_MAP_MASK;
+			size = TTBL_L2_BLOCK_SIZE;
+			rc = vmm_guest_physical_map(guest, inaddr, size,
+					    &outaddr, &availsz, &reg_flags);
+			if (!rc && (availsz >= TTBL_L2_BLOCK_SIZE)) {
+				pg.ia = inaddr;
+				pg.sz = size;
+				pg.oa = outaddr;
+				pg_reg_flags = reg_flags;
+			}
 		}
 	}
 
@@ -121,8 +123,12 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 		pg.memattr = 0x0;
 	}
 
+	if (out_reg_flags) {
+		*out_reg_flags = pg_reg_flags;
+	}
+
 	/* Try to map the page in Stage2 */
-	rc = mmu_lpae_map_page(arm_guest_priv(vcpu->guest)->ttbl, &pg);
+	rc = mmu_lpae_map_page(arm_guest_priv(guest)->ttbl, &pg);
 	if (rc) {
 		/* On SMP Guest, two different VCPUs may try to map same
 		 * Guest region in Stage2 at the same time. This may cause
@@ -132,7 +138,7 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 		 * when mmu_lpae_map_page() fails.
 		 */
 		memset(&pg, 0, sizeof(pg));
-		rc1 = mmu_lpae_get_page(arm_guest_priv(vcpu->guest)->ttbl,
+		rc1 = mmu_lpae_get_page(arm_guest_priv(guest)->ttbl,
 					fipa, &pg);
 		if (rc1) {
 			return rc1;
@@ -140,9 +146,189 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 		rc = VMM_OK;
 	}
 
+	if (out_pg) {
+		memcpy(out_pg, &pg, sizeof(pg));
+	}
+
 	return rc;
 }
 
+/* Map all unmapped Stage2 blocks of a RAM/ROM range */
+static u64 __cpu_vcpu_stage2_populate(struct vmm_guest *guest,
+				      physical_addr_t start,
+				      physical_addr_t end)
+{
+	u64 count = 0;
+	u32 reg_flags;
+	struct cpu_page pg;
+	physical_addr_t ipa = start & TTBL_L3_MAP_MASK;
+
+	while (ipa < end) {
+		if (!mmu_lpae_get_page(arm_guest_priv(guest)->ttbl,
+					ipa, &pg)) {
+			ipa = pg.ia + pg.sz;
+			continue;
+		}
+
+		if (__cpu_vcpu_stage2_map(guest, ipa, &pg, &reg_flags)) {
+			ipa += TTBL_L3_BLOCK_SIZE;
+			continue;
+		}
+
+		if (!(reg_flags & VMM_REGION_VIRTUAL) &&
+		    (reg_flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM))) {
+			count++;
+		}
+		ipa = pg.ia + pg.sz;
+	}
+
+	return count;
+}
+
+static void cpu_vcpu_stage2_fault_around(struct vmm_guest *guest,
+					 physical_addr_t fipa)
+{
+	physical_addr_t start, end;
+	physical_size_t win;
+	struct vmm_region *reg;
+
+	reg = vmm_guest_find_region(guest, fipa, VMM_REGION_MEMORY, FALSE);
+	if (!reg) {
+		return;
+	}
+
+	/* Clip fault-around window to the faulting region */
+	win = (physical_size_t)1 << VMM_REGION_FAULT_AROUND_ORDER(reg);
+	start = fipa & ~(win - 1);
+	end = start + win;
+	if (start < VMM_REGION_GPHYS_START(reg)) {
+		start = VMM_REGION_GPHYS_START(reg);
+	}
+	if (VMM_REGION_GPHYS_END(reg) < end) {
+		end = VMM_REGION_GPHYS_END(reg);
+	}
+
+	arch_atomic64_add(&arm_guest_priv(guest)->stage2_prefault_count,
+			  __cpu_vcpu_stage2_populate(guest, start, end));
+}
+
+static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
+			       arch_regs_t *regs,
+			       physical_addr_t fipa)
+{
+	int rc;
+	u32 reg_flags = 0x0;
+	struct vmm_guest *guest = vcpu->guest;
+
+	arch_atomic64_inc(&arm_guest_priv(guest)->stage2_fault_count);
+
+	rc = __cpu_vcpu_stage2_map(guest, fipa, NULL, &reg_flags);
+	if (rc == VMM_EAGAIN) {
+		/* File-backed region populated asynchronously */
+		return vmm_guest_physical_populate(vcpu, fipa);
+	} else if (rc == VMM_ENOSPC) {
+		vmm_printf("%s: insufficent mapping for IPA=0x%lx\n",
+			   __func__, fipa);
+		return VMM_EFAIL;
+	} else if (rc) {
+		vmm_printf("%s: IPA=0x%lx map failed\n", __func__, fipa);
+		return rc;
+	}
+
+	if (reg_flags & VMM_REGION_POPULATE_FAULT_AROUND) {
+		cpu_vcpu_stage2_fault_around(guest, fipa);
+	}
+
+	return VMM_OK;
+}
+
+/* Unmap all Stage2 blocks of a RAM/ROM range */
+static void __cpu_vcpu_stage2_unmap(struct vmm_guest *guest,
+				   physical_addr_t start,
+				   physical_addr_t end)
+{
+	struct cpu_page pg;
+	physical_addr_t ipa = start & TTBL_L3_MAP_MASK;
+
+	while (ipa < end) {
+		if (mmu_lpae_get_page(arm_guest_priv(guest)->ttbl,
+					ipa, &pg)) {
+			ipa += TTBL_L3_BLOCK_SIZE;
+			continue;
+		}
+
+		mmu_lpae_unmap_page(arm_guest_priv(guest)->ttbl, &pg);
+		ipa = pg.ia + pg.sz;
+	}
+}
+
+static void cpu_vcpu_stage2_unmap_region(struct vmm_guest *guest,
+					 struct vmm_region *reg,
+					 void *priv)
+{
+	if (reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL)) {
+		return;
+	}
+
+	__cpu_vcpu_stage2_unmap(guest, VMM_REGION_GPHYS_START(reg),
+				VMM_REGION_GPHYS_END(reg));
+}
+
+static void cpu_vcpu_stage2_populate_region(struct vmm_guest *guest,
+					    struct vmm_region *reg,
+					    void *priv)
+{
+	if (reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL)) {
+		return;
+	}
+
+	arch_atomic64_add(&arm_guest_priv(guest)->stage2_prefault_count,
+			  __cpu_vcpu_stage2_populate(guest,
+					VMM_REGION_GPHYS_START(reg),
+					VMM_REGION_GPHYS_END(reg)));
+}
+
+static int cpu_vcpu_stage2_aspace_notification(struct vmm_notifier_block *nb,
+						unsigned long evt, void *data)
+{
+	struct vmm_guest_aspace_event *edata = data;
+
+	if (evt != VMM_GUEST_ASPACE_EVENT_RESET) {
+		/* We are only interested in reset events so,
+		 * don't care about this event.
+		 */
+		return NOTIFY_DONE;
+	}
+
+	if (!edata->guest->arch_priv) {
+		return NOTIFY_DONE;
+	}
+
+	/* Unmap file-backed RAM regions which are re-populated
+	 * with fresh file contents after reset
+	 */
+	vmm_guest_iterate_region(edata->guest,
+			VMM_REGION_MEMORY | VMM_REGION_ISFILE | VMM_REGION_ISRAM,
+			cpu_vcpu_stage2_unmap_region, NULL);
+
+	/* Eagerly map RAM/ROM regions with populate = "eager" */
+	vmm_guest_iterate_region(edata->guest,
+			VMM_REGION_MEMORY | VMM_REGION_POPULATE_EAGER,
+			cpu_vcpu_stage2_populate_region, NULL);
+
+	return NOTIFY_OK;
+}
+
+static struct vmm_notifier_block cpu_vcpu_stage2_aspace_nb = {
+	.notifier_call = cpu_vcpu_stage2_aspace_notification,
+	.priority = 0,
+};
+
+int __init cpu_vcpu_excep_init(void)
+{
+	return vmm_guest_aspace_register_client(&cpu_vcpu_stage2_aspace_nb);
+}
+
 int cpu_vcpu_inst_abort(struct vmm_vcpu *vcpu,
 			arch_regs_t *regs,
 			u32 il, u32 iss,
@@ -163,8 +349,10 @@ int cpu_vcpu_inst_abort(struct vmm_vcpu *vcpu,
 int cpu_vcpu_data_abort(struct vmm_vcpu *vcpu,
 			arch_regs_t *regs,
 			u32 il, u32 iss,
+			virtual_addr_t far,
 			physical_addr_t fipa)
 {
+	int rc;
 	u32 read_count, inst;
 	physical_addr_t inst_pa;
 
@@ -192,9 +380,15 @@ int cpu_vcpu_data_abort(struct vmm_vcpu *vcpu,
 			}
 			if (regs->pstate & PSR_THUMB_ENABLED) {
 				return emulate_thumb_inst(vcpu, regs, inst);
-			} else {
-				return emulate_arm_inst(vcpu, regs, inst);
 			}
+
+			/* Use cached micro-op of the faulting instruction */
+			rc = emulate_cache_emulate(vcpu, regs, inst, far);
+			if (rc != VMM_ENOENT) {
+				return rc;
+			}
+			emulate_cache_fill(vcpu->guest, inst);
+			return emulate_arm_inst(vcpu, regs, inst);
 		}
 		if (iss & ISS_ABORT_WNR_MASK) {
 			return cpu_vcpu_emulate_store(vcpu, regs,
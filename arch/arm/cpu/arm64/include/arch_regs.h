@@ -151,6 +151,11 @@ struct arm_guest_priv {
 	 * Bits[15:0] = Minor number
 	 */
 	u32 psci_version;
+	/* Stage2 statistics */
+	atomic64_t stage2_fault_count;
+	atomic64_t stage2_prefault_count;
+	/* Decoded instruction cache */
+	void *inst_cache;
 };
 
 #define arm_regs(vcpu)		(&((vcpu)->regs))
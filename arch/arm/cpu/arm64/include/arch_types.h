@@ -46,8 +46,20 @@ typedef struct {
 	volatile long long counter;
 } atomic64_t;
 
+/* Ticket spinlock: lock is free when owner == next */
 typedef struct {
-	volatile long lock;
+	union {
+		volatile unsigned int lock;
+		struct {
+#ifdef CONFIG_CPU_BE
+			volatile unsigned short next;
+			volatile unsigned short owner;
+#else
+			volatile unsigned short owner;
+			volatile unsigned short next;
+#endif
+		} tickets;
+	};
 } arch_spinlock_t;
 
 #define ARCH_ATOMIC_INIT(_lptr, val)		\
@@ -62,7 +74,7 @@ typedef struct {
 #define ARCH_ATOMIC64_INITIALIZER(val)		\
 	{ .counter = (val), }
 
-#define __ARCH_SPIN_UNLOCKED		0xffffffffUL
+#define __ARCH_SPIN_UNLOCKED		0
 
 /* FIXME: Need memory barrier for this. */
 #define ARCH_SPIN_LOCK_INIT(_lptr)		\
@@ -70,19 +82,29 @@ typedef struct {
 
 #define ARCH_SPIN_LOCK_INITIALIZER		\
 	{ .lock = __ARCH_SPIN_UNLOCKED, }
+
+/* Queued rwlock: writer byte, writer waiting bit and reader count */
 typedef struct {
-	volatile long lock;
+	volatile unsigned int cnts;
+	arch_spinlock_t wait_lock;
 } arch_rwlock_t;
 
-#define __ARCH_RW_LOCKED		0x80000000UL
+#define __ARCH_RW_WLOCKED		0x000000ffU
+#define __ARCH_RW_WWAITING		0x00000100U
+#define __ARCH_RW_WMASK			0x000001ffU
+#define __ARCH_RW_RBIAS			0x00000200U
 #define __ARCH_RW_UNLOCKED		0
 
 /* FIXME: Need memory barrier for this. */
 #define ARCH_RW_LOCK_INIT(_lptr)		\
-	(_lptr)->lock = __ARCH_RW_UNLOCKED
+	do {					\
+		(_lptr)->cnts = __ARCH_RW_UNLOCKED;	\
+		ARCH_SPIN_LOCK_INIT(&(_lptr)->wait_lock); \
+	} while (0)
 
 #define ARCH_RW_LOCK_INITIALIZER		\
-	{ .lock = __ARCH_RW_UNLOCKED, }
+	{ .cnts = __ARCH_RW_UNLOCKED,		\
+	  .wait_lock = ARCH_SPIN_LOCK_INITIALIZER, }
 
 #define ARCH_BITS_PER_LONG		64
 #define ARCH_BITS_PER_LONG_LONG		64
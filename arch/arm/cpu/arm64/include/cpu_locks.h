@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file cpu_locks.h
+ * @author agent (agent@local)
+ * @brief Header file for ARM64 synchronization mechanisms
+ */
+#ifndef _CPU_LOCKS_H__
+#define _CPU_LOCKS_H__
+
+#include <vmm_types.h>
+
+#if defined(CONFIG_SMP)
+
+/** Select lock implementation based on boot CPU features */
+void cpu_locks_init(void);
+
+/** Check whether locks use ARMv8.1 LSE atomics */
+bool cpu_locks_lse_enabled(void);
+
+#else
+
+static inline void cpu_locks_init(void)
+{
+}
+
+static inline bool cpu_locks_lse_enabled(void)
+{
+	return FALSE;
+}
+
+#endif
+
+#endif /* _CPU_LOCKS_H__ */
@@ -36,6 +36,10 @@ int cpu_vcpu_inst_abort(struct vmm_vcpu *vcpu,
 int cpu_vcpu_data_abort(struct vmm_vcpu *vcpu,
 			arch_regs_t *regs,
 			u32 il, u32 iss, 
+			virtual_addr_t far,
 			physical_addr_t fipa);
 
+/** Initialize VCPU exception handling (Stage2 population) */
+int cpu_vcpu_excep_init(void);
+
 #endif /* _CPU_VCPU_EXCEP_H__ */
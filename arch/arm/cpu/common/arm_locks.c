@@ -24,6 +24,12 @@
  * @author Pranav Sawargaonkar (pranav.sawargaonkar@gmail.com)
  * @author Jim Huang (jserv@0xlab.org)
  * @brief ARM32 and ARM32VE specific synchronization mechanisms.
+ *
+ * Spinlocks are FIFO ticket locks and rwlocks are queued rwlocks which
+ * serialize contending readers and writers on an internal ticket lock.
+ * New readers back off while a writer is waiting so writers can't be
+ * starved, except readers in IRQ context which only wait for an active
+ * writer. Waiters sleep in WFE and every release does SEV.
  */
 
 #include <vmm_error.h>
@@ -31,177 +37,215 @@
 #include <vmm_compiler.h>
 #include <arch_barrier.h>
 #include <vmm_smp.h>
+#include <vmm_scheduler.h>
+
+#define TICKET_SHIFT			16
+
+/* Atomically add to lock word and return old value (no barrier) */
+static inline u32 __lock_fetch_add(volatile u32 *p, u32 val)
+{
+	u32 old, new, tmp;
+
+	__asm__ __volatile__(
+"1:	ldrex	%0, [%3]\n"
+"	add	%1, %0, %4\n"
+"	strex	%2, %1, [%3]\n"
+"	teq	%2, #0\n"
+"	bne	1b"
+	: "=&r" (old), "=&r" (new), "=&r" (tmp)
+	: "r" (p), "r" (val)
+	: "cc", "memory");
+
+	return old;
+}
+
+/* Compare and swap lock word and return previous value (no barrier) */
+static inline u32 __lock_cmpxchg(volatile u32 *p, u32 old, u32 new)
+{
+	u32 prev, tmp;
+
+	do {
+		__asm__ __volatile__(
+	"	mov	%1, #0\n"
+	"	ldrex	%0, [%2]\n"
+	"	teq	%0, %3\n"
+	"	strexeq	%1, %4, [%2]\n"
+		: "=&r" (prev), "=&r" (tmp)
+		: "r" (p), "r" (old), "r" (new)
+		: "cc", "memory");
+	} while (tmp);
+
+	return prev;
+}
+
+/* Sleep until (lock word & mask) == val */
+static inline void __lock_wait(volatile u32 *p, u32 mask, u32 val)
+{
+	while ((*p & mask) != val) {
+		wfe();
+	}
+	arch_smp_mb();
+}
+
+static inline void __lock_release_notify(void)
+{
+	dsb();
+	sev();
+}
 
 bool __lock arch_spin_lock_check(arch_spinlock_t *lock)
 {
-	return (lock->lock == __ARCH_SPIN_UNLOCKED) ? FALSE : TRUE;
+	u32 val = lock->lock;
+
+	return ((val >> TICKET_SHIFT) == (val & 0xffff)) ? FALSE : TRUE;
 }
 
 void __lock arch_spin_lock(arch_spinlock_t *lock)
 {
-	u32 cpu = vmm_smp_processor_id();
-	unsigned long tmp;
+	u32 val = __lock_fetch_add(&lock->lock, 1 << TICKET_SHIFT);
 
-	__asm__ __volatile__(
-"1:	ldrex	%0, [%1]\n"	/* load the lock value */
-"	teq	%0, %3\n"	/* is the lock free */
-"	wfene\n"		/* if not, we sleep until some other core wake us up */
-"	strexeq	%0, %2, [%1]\n" /* store (cpu) as a lock value */
-"	teqeq	%0, #0\n"	/* did we succeed */
-"	bne	1b"		/* if not try again */
-	: "=&r" (tmp)
-	: "r" (&lock->lock), "r" (cpu), "r" (__ARCH_SPIN_UNLOCKED)
-	: "cc");
+	/* Sleep until owner reaches our ticket */
+	while ((val >> TICKET_SHIFT) != lock->tickets.owner) {
+		wfe();
+	}
 
 	arch_smp_mb();		/* do a mb to sync everything */
 }
 
 int __lock arch_spin_trylock(arch_spinlock_t *lock)
 {
-	u32 cpu = vmm_smp_processor_id();
-	unsigned long tmp;
+	u32 val = lock->lock;
 
-	__asm__ __volatile__(
-"	ldrex	%0, [%1]\n"	/* load the lock value */
-"	teq	%0, %3\n"	/* is the lock free */
-"	movne	%0, #1\n"	/* assume failure if lock not free */
-"	strexeq	%0, %2, [%1]"	/* store cpu as a lock value */
-	: "=&r" (tmp) 
-	: "r" (&lock->lock), "r" (cpu), "r" (__ARCH_SPIN_UNLOCKED)
-	: "cc");
-
-	if (tmp == 0) {
-		arch_smp_mb();	/* do mb if we succeeded */
-		return 1;
-	} else {
+	if ((val >> TICKET_SHIFT) != (val & 0xffff)) {
 		return 0;
 	}
+
+	if (__lock_cmpxchg(&lock->lock, val,
+			   val + (1 << TICKET_SHIFT)) != val) {
+		return 0;
+	}
+
+	arch_smp_mb();	/* do mb if we succeeded */
+	return 1;
 }
 
 void __lock arch_spin_unlock(arch_spinlock_t *lock)
 {
 	arch_smp_mb();		/* sync everything */
 
-	lock->lock = __ARCH_SPIN_UNLOCKED;	/* free the lock */
-	dsb();			/* sync again */
-	sev();			/* notify all cores */
+	/* Only lock owner updates owner ticket so plain store will do */
+	lock->tickets.owner++;
+	__lock_release_notify();
 }
 
 bool __lock arch_write_lock_check(arch_rwlock_t *lock)
 {
-	return (lock->lock & __ARCH_RW_LOCKED) ? TRUE : FALSE;
+	return ((lock->cnts & __ARCH_RW_WLOCKED) ==
+		__ARCH_RW_WLOCKED) ? TRUE : FALSE;
 }
 
-/*
- * To take a write lock we set bit 31 to 1
- */
 void __lock arch_write_lock(arch_rwlock_t *lock)
 {
-	unsigned long tmp;
+	/* Fast path: lock is free */
+	if (!__lock_cmpxchg(&lock->cnts, 0, __ARCH_RW_WLOCKED)) {
+		arch_smp_mb();
+		return;
+	}
 
-	__asm__ __volatile__(
-"1:	ldrex   %0, [%1]\n"
-"	teq     %0, #0\n"
-"	wfene	\n"
-"	strexeq %0, %2, [%1]\n"
-"	teq     %0, #0\n"
-"	bne     1b"
-	: "=&r" (tmp)
-	: "r" (&lock->lock), "r" (__ARCH_RW_LOCKED)
-	: "cc");
+	/* Slow path: queue behind other waiters */
+	arch_spin_lock(&lock->wait_lock);
+
+	/* Tell readers that a writer is waiting */
+	__lock_fetch_add(&lock->cnts, __ARCH_RW_WWAITING);
+
+	/* Wait for readers to drain then take ownership */
+	while (1) {
+		__lock_wait(&lock->cnts, ~0U, __ARCH_RW_WWAITING);
+		if (__lock_cmpxchg(&lock->cnts, __ARCH_RW_WWAITING,
+				   __ARCH_RW_WLOCKED) == __ARCH_RW_WWAITING) {
+			break;
+		}
+	}
 
 	arch_smp_mb();
+	arch_spin_unlock(&lock->wait_lock);
 }
 
 int __lock arch_write_trylock(arch_rwlock_t *lock)
 {
-	unsigned long tmp;
+	if (lock->cnts) {
+		return 0;
+	}
 
-	__asm__ __volatile__(
-"	ldrex   %0, [%1]\n"
-"	teq     %0, #0\n"
-"	strexeq %0, %2, [%1]"
-	: "=&r" (tmp)
-	: "r" (&lock->lock), "r" (__ARCH_RW_LOCKED)
-	: "cc");
-
-	if (tmp == 0) {
-		 arch_smp_mb();
-		 return 1;
-	} else {
-		 return 0;
+	if (__lock_cmpxchg(&lock->cnts, 0, __ARCH_RW_WLOCKED)) {
+		return 0;
 	}
+
+	arch_smp_mb();
+	return 1;
 }
 
 void __lock arch_write_unlock(arch_rwlock_t *lock)
 {
 	arch_smp_mb();
-	lock->lock = __ARCH_RW_UNLOCKED;
-	dsb();
-	sev();
+	__lock_fetch_add(&lock->cnts, -__ARCH_RW_WLOCKED);
+	__lock_release_notify();
 }
 
 bool __lock arch_read_lock_check(arch_rwlock_t *lock)
 {
-	return (lock->lock == __ARCH_RW_UNLOCKED) ? FALSE : TRUE;
+	return (lock->cnts & ~__ARCH_RW_WWAITING) ? TRUE : FALSE;
 }
 
 void __lock arch_read_lock(arch_rwlock_t *lock)
 {
-	unsigned long tmp, tmp2;
+	u32 cnts;
 
-	__asm__ __volatile__(
-"1:	ldrex   %0, [%2]\n"
-"	adds    %0, %0, #1\n"
-"	strexpl %1, %0, [%2]\n"
-"	wfemi	\n"
-"	rsbpls  %0, %1, #0\n"
-"	bmi     1b"
-	: "=&r" (tmp), "=&r" (tmp2)
-	: "r" (&lock->lock)
-	: "cc");
+	/* Fast path: no writer holding or waiting for the lock */
+	cnts = __lock_fetch_add(&lock->cnts, __ARCH_RW_RBIAS);
+	if (!(cnts & __ARCH_RW_WMASK)) {
+		arch_smp_mb();
+		return;
+	}
 
-	arch_smp_mb();
+	/* Reader in IRQ context might have interrupted a reader of
+	 * same lock so it only waits for active writer otherwise it
+	 * would deadlock against the waiting writer.
+	 */
+	if (vmm_scheduler_irq_context()) {
+		__lock_wait(&lock->cnts, __ARCH_RW_WLOCKED, 0);
+		return;
+	}
+
+	/* Slow path: back off and queue behind waiting writer */
+	__lock_fetch_add(&lock->cnts, -__ARCH_RW_RBIAS);
+	__lock_release_notify();
+	arch_spin_lock(&lock->wait_lock);
+	__lock_fetch_add(&lock->cnts, __ARCH_RW_RBIAS);
+	__lock_wait(&lock->cnts, __ARCH_RW_WLOCKED, 0);
+	arch_spin_unlock(&lock->wait_lock);
 }
 
 int __lock arch_read_trylock(arch_rwlock_t *lock)
 {
-	unsigned long tmp, tmp2 = 1;
+	u32 cnts = lock->cnts;
 
-	__asm__ __volatile__(
-"	ldrex   %0, [%2]\n"
-"	adds    %0, %0, #1\n"
-"	strexpl %1, %0, [%2]\n"
-	: "=&r" (tmp), "+r" (tmp2)
-	: "r" (&lock->lock)
-	: "cc");
-
-	if (tmp2 == 0) {
-		arch_smp_mb();	/* do mb if we succeeded */
-		return 1;
-	} else {
+	if (cnts & __ARCH_RW_WMASK) {
+		return 0;
+	}
+
+	if (__lock_cmpxchg(&lock->cnts, cnts,
+			   cnts + __ARCH_RW_RBIAS) != cnts) {
 		return 0;
 	}
+
+	arch_smp_mb();	/* do mb if we succeeded */
+	return 1;
 }
 
 void __lock arch_read_unlock(arch_rwlock_t *lock)
 {
-	unsigned long tmp, tmp2;
-
 	arch_smp_mb();
-
-	__asm__ __volatile__(
-"1:	ldrex   %0, [%2]\n"
-"	sub     %0, %0, #1\n"
-"	strex   %1, %0, [%2]\n"
-"	teq     %1, #0\n"
-"	bne     1b"
-	: "=&r" (tmp), "=&r" (tmp2)
-	: "r" (&lock->lock)
-	: "cc");
-
-	if (tmp == 0) {
-		dsb();
-		sev();
-	}
+	__lock_fetch_add(&lock->cnts, -__ARCH_RW_RBIAS);
+	__lock_release_notify();
 }
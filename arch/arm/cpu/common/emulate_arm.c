@@ -3749,6 +3749,177 @@ static int arm_instgrp_uncond(u32 inst,
 	return VMM_EFAIL;
 }
 
+bool arm_inst_decode_uop(u32 inst, struct arm_inst_uop *uop)
+{
+	u32 cond, op1, op2, P, U, W, L, Rn, Rt, imm32;
+	u32 width, flags = 0;
+
+	cond = ARM_INST_DECODE(inst, ARM_INST_COND_MASK, ARM_INST_COND_SHIFT);
+	if (cond == 0xF) {
+		return FALSE;
+	}
+
+	op1 = ARM_INST_DECODE(inst,
+			      ARM_INST_LDRSTR_OP1_MASK, ARM_INST_LDRSTR_OP1_SHIFT);
+	L = op1 & 0x1;
+
+	switch (ARM_INST_DECODE(inst, ARM_INST_OP1_MASK, ARM_INST_OP1_SHIFT)) {
+	case 0x2:
+		/* ldr, ldrb, str and strb (immediate) */
+		width = (op1 & 0x4) ? 1 : 4;
+		imm32 = ARM_INST_BITS(inst,
+				      ARM_INST_LDRSTR_IMM12_END,
+				      ARM_INST_LDRSTR_IMM12_START);
+		break;
+	case 0x0:
+		/* ldrh, ldrsb, ldrsh and strh (immediate) */
+		if ((ARM_INST_BITS(inst, 7, 4) & 0x9) != 0x9) {
+			return FALSE;
+		}
+		if (!ARM_INST_BIT(inst, ARM_INST_LDRSTR_REGFORM1_START)) {
+			return FALSE;
+		}
+		op2 = ARM_INST_BITS(inst, 6, 5);
+		if (op2 == 0x1) {
+			width = 2;
+		} else if (op2 == 0x2 && L) {
+			width = 1;
+			flags |= ARM_INST_UOP_SIGNED;
+		} else if (op2 == 0x3 && L) {
+			width = 2;
+			flags |= ARM_INST_UOP_SIGNED;
+		} else {
+			/* ldrd and strd */
+			return FALSE;
+		}
+		imm32 = (ARM_INST_BITS(inst,
+				       ARM_INST_LDRSTR_IMM4H_END,
+				       ARM_INST_LDRSTR_IMM4H_START) << 4) |
+			ARM_INST_BITS(inst,
+				      ARM_INST_LDRSTR_IMM4L_END,
+				      ARM_INST_LDRSTR_IMM4L_START);
+		break;
+	default:
+		return FALSE;
+	};
+
+	P = ARM_INST_BIT(inst, ARM_INST_LDRSTR_P_START);
+	U = ARM_INST_BIT(inst, ARM_INST_LDRSTR_U_START);
+	W = ARM_INST_BIT(inst, ARM_INST_LDRSTR_W_START);
+	Rn = ARM_INST_BITS(inst,
+			   ARM_INST_LDRSTR_RN_END,
+			   ARM_INST_LDRSTR_RN_START);
+	Rt = ARM_INST_BITS(inst,
+			   ARM_INST_LDRSTR_RT_END,
+			   ARM_INST_LDRSTR_RT_START);
+
+	/* Unprivileged, literal, PC-relative and unpredictable
+	 * forms are left to full emulation.
+	 */
+	if ((P == 0) && (W == 1)) {
+		return FALSE;
+	}
+	if ((Rn == 15) || (Rt == 15)) {
+		return FALSE;
+	}
+	if (((P == 0) || (W == 1)) && (Rn == Rt)) {
+		return FALSE;
+	}
+
+	flags |= (L) ? 0 : ARM_INST_UOP_STORE;
+	flags |= (P) ? ARM_INST_UOP_INDEX : 0;
+	flags |= (U) ? ARM_INST_UOP_ADD : 0;
+	flags |= ((P == 0) || (W == 1)) ? ARM_INST_UOP_WBACK : 0;
+
+	uop->inst = inst;
+	uop->imm32 = arm_zero_extend(imm32, 32);
+	uop->cond = cond;
+	uop->Rn = Rn;
+	uop->Rt = Rt;
+	uop->width = width;
+	uop->flags = flags;
+
+	return TRUE;
+}
+
+int emulate_arm_uop(struct vmm_vcpu *vcpu, arch_regs_t *regs,
+		    struct arm_inst_uop *uop, virtual_addr_t far)
+{
+	int rc;
+	u8 data8;
+	u16 data16;
+	u32 data, address, offset_addr;
+
+	if (!arm_condition_passed(uop->cond, regs)) {
+		return VMM_ENOENT;
+	}
+
+	address = cpu_vcpu_reg_read(vcpu, regs, uop->Rn);
+	offset_addr = (uop->flags & ARM_INST_UOP_ADD) ?
+		      (address + uop->imm32) : (address - uop->imm32);
+	address = (uop->flags & ARM_INST_UOP_INDEX) ? offset_addr : address;
+	if (address != (u32)far) {
+		return VMM_ENOENT;
+	}
+
+	if (uop->flags & ARM_INST_UOP_STORE) {
+		data = cpu_vcpu_reg_read(vcpu, regs, uop->Rt);
+		switch (uop->width) {
+		case 1:
+			data8 = data & 0xFF;
+			rc = cpu_vcpu_mem_write(vcpu, regs, address,
+						&data8, 1, FALSE);
+			break;
+		case 2:
+			data16 = data & 0xFFFF;
+			rc = cpu_vcpu_mem_write(vcpu, regs, address,
+						&data16, 2, FALSE);
+			break;
+		default:
+			rc = cpu_vcpu_mem_write(vcpu, regs, address,
+						&data, 4, FALSE);
+			break;
+		};
+		if (rc) {
+			return rc;
+		}
+	} else {
+		switch (uop->width) {
+		case 1:
+			data8 = 0x0;
+			rc = cpu_vcpu_mem_read(vcpu, regs, address,
+					       &data8, 1, FALSE);
+			data = data8;
+			break;
+		case 2:
+			data16 = 0x0;
+			rc = cpu_vcpu_mem_read(vcpu, regs, address,
+					       &data16, 2, FALSE);
+			data = data16;
+			break;
+		default:
+			data = 0x0;
+			rc = cpu_vcpu_mem_read(vcpu, regs, address,
+					       &data, 4, FALSE);
+			break;
+		};
+		if (rc) {
+			return rc;
+		}
+		if (uop->flags & ARM_INST_UOP_SIGNED) {
+			data = arm_sign_extend(data, uop->width * 8, 32);
+		}
+		cpu_vcpu_reg_write(vcpu, regs, uop->Rt, data);
+	}
+
+	if (uop->flags & ARM_INST_UOP_WBACK) {
+		cpu_vcpu_reg_write(vcpu, regs, uop->Rn, offset_addr);
+	}
+
+	arm_pc(regs) += 4;
+	return VMM_OK;
+}
+
 int emulate_arm_inst(struct vmm_vcpu *vcpu, arch_regs_t *regs, u32 inst)
 {
 	u32 cond, op1, op;
@@ -0,0 +1,191 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file emulate_cache.c
+ * @author agent (agent@local)
+ * @brief Per-Guest cache of decoded trapped load/store instructions
+ *
+ * Data aborts without a valid syndrome (ISV=0) require fetching and
+ * decoding the faulting instruction. The cache maps encoding of such
+ * instruction to a pre-decoded micro-op so that a guest hitting same
+ * MMIO access in a loop skips the decode. The instruction is still
+ * fetched on every trap and a micro-op only depends on the encoding
+ * so cached entries never become stale.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_stdio.h>
+#include <vmm_spinlocks.h>
+#include <vmm_manager.h>
+#include <arch_atomic64.h>
+#include <arch_regs.h>
+#include <emulate_arm.h>
+#include <emulate_cache.h>
+#include <libs/stringlib.h>
+
+#define EMULATE_CACHE_ENTRIES		64
+
+struct emulate_cache_entry {
+	bool valid;
+	u32 inst;
+	struct arm_inst_uop uop;
+};
+
+struct emulate_cache {
+	vmm_rwlock_t lock;
+	struct emulate_cache_entry ent[EMULATE_CACHE_ENTRIES];
+	atomic64_t hit_count;
+	atomic64_t miss_count;
+};
+
+#define emulate_cache_get(guest) \
+	((struct emulate_cache *)arm_guest_priv(guest)->inst_cache)
+
+/* Mix register and offset fields which differ most between
+ * load/store instructions of same kind.
+ */
+static inline u32 emulate_cache_index(u32 inst)
+{
+	inst ^= inst >> 12;
+	inst ^= inst >> 6;
+	return inst & (EMULATE_CACHE_ENTRIES - 1);
+}
+
+int emulate_cache_emulate(struct vmm_vcpu *vcpu, arch_regs_t *regs,
+			  u32 inst, virtual_addr_t far)
+{
+	int rc;
+	bool found = FALSE;
+	irq_flags_t flags;
+	struct arm_inst_uop uop;
+	struct emulate_cache_entry *e;
+	struct emulate_cache *ec = emulate_cache_get(vcpu->guest);
+
+	if (!ec) {
+		return VMM_ENOENT;
+	}
+
+	e = &ec->ent[emulate_cache_index(inst)];
+
+	vmm_read_lock_irqsave_lite(&ec->lock, flags);
+	if (e->valid && (e->inst == inst)) {
+		memcpy(&uop, &e->uop, sizeof(uop));
+		found = TRUE;
+	}
+	vmm_read_unlock_irqrestore_lite(&ec->lock, flags);
+
+	if (!found) {
+		arch_atomic64_inc(&ec->miss_count);
+		return VMM_ENOENT;
+	}
+
+	rc = emulate_arm_uop(vcpu, regs, &uop, far);
+	if (rc == VMM_ENOENT) {
+		/* Micro-op does not match this fault */
+		arch_atomic64_inc(&ec->miss_count);
+		return VMM_ENOENT;
+	}
+
+	arch_atomic64_inc(&ec->hit_count);
+
+	return rc;
+}
+
+void emulate_cache_fill(struct vmm_guest *guest, u32 inst)
+{
+	irq_flags_t flags;
+	struct arm_inst_uop uop;
+	struct emulate_cache_entry *e;
+	struct emulate_cache *ec = emulate_cache_get(guest);
+
+	if (!ec || !arm_inst_decode_uop(inst, &uop)) {
+		return;
+	}
+
+	e = &ec->ent[emulate_cache_index(inst)];
+
+	vmm_write_lock_irqsave_lite(&ec->lock, flags);
+	e->valid = TRUE;
+	e->inst = inst;
+	memcpy(&e->uop, &uop, sizeof(uop));
+	vmm_write_unlock_irqrestore_lite(&ec->lock, flags);
+}
+
+void emulate_cache_flush(struct vmm_guest *guest)
+{
+	u32 i;
+	irq_flags_t flags;
+	struct emulate_cache *ec = emulate_cache_get(guest);
+
+	if (!ec) {
+		return;
+	}
+
+	vmm_write_lock_irqsave_lite(&ec->lock, flags);
+	for (i = 0; i < EMULATE_CACHE_ENTRIES; i++) {
+		ec->ent[i].valid = FALSE;
+	}
+	vmm_write_unlock_irqrestore_lite(&ec->lock, flags);
+
+	arch_atomic64_write(&ec->hit_count, 0);
+	arch_atomic64_write(&ec->miss_count, 0);
+}
+
+void emulate_cache_stat_dump(struct vmm_chardev *cdev,
+			     struct vmm_guest *guest)
+{
+	struct emulate_cache *ec = emulate_cache_get(guest);
+
+	if (!ec) {
+		return;
+	}
+
+	vmm_cprintf(cdev, "Guest Inst Cache Hits  : %"PRIu64"\n",
+		    arch_atomic64_read(&ec->hit_count));
+	vmm_cprintf(cdev, "Guest Inst Cache Misses: %"PRIu64"\n",
+		    arch_atomic64_read(&ec->miss_count));
+}
+
+int emulate_cache_init(struct vmm_guest *guest)
+{
+	struct emulate_cache *ec;
+
+	ec = vmm_zalloc(sizeof(*ec));
+	if (!ec) {
+		return VMM_ENOMEM;
+	}
+
+	INIT_RW_LOCK(&ec->lock);
+	arch_atomic64_write(&ec->hit_count, 0);
+	arch_atomic64_write(&ec->miss_count, 0);
+
+	arm_guest_priv(guest)->inst_cache = ec;
+
+	return VMM_OK;
+}
+
+void emulate_cache_deinit(struct vmm_guest *guest)
+{
+	struct emulate_cache *ec = emulate_cache_get(guest);
+
+	if (ec) {
+		arm_guest_priv(guest)->inst_cache = NULL;
+		vmm_free(ec);
+	}
+}
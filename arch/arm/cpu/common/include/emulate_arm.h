@@ -272,4 +272,33 @@ u32 arm_add_with_carry(u32 x, u32 y, u32 cin, u32 *cout, u32 *oout);
 /** Emulate ARM instructions */
 int emulate_arm_inst(struct vmm_vcpu *vcpu, arch_regs_t *regs, u32 inst);
 
+#define ARM_INST_UOP_STORE			(1 << 0)
+#define ARM_INST_UOP_SIGNED			(1 << 1)
+#define ARM_INST_UOP_INDEX			(1 << 2)
+#define ARM_INST_UOP_ADD			(1 << 3)
+#define ARM_INST_UOP_WBACK			(1 << 4)
+
+/** Pre-decoded single register load/store with immediate offset */
+struct arm_inst_uop {
+	u32 inst;
+	u32 imm32;
+	u8 cond;
+	u8 Rn;
+	u8 Rt;
+	u8 width;
+	u32 flags;
+};
+
+/** Decode ARM instruction into micro-op
+ *  NOTE: Returns FALSE for instructions not representable as micro-op
+ */
+bool arm_inst_decode_uop(u32 inst, struct arm_inst_uop *uop);
+
+/** Emulate pre-decoded ARM micro-op for data abort at given address
+ *  NOTE: Returns VMM_ENOENT (without any side effects) if the micro-op
+ *  does not access given address with its condition passing.
+ */
+int emulate_arm_uop(struct vmm_vcpu *vcpu, arch_regs_t *regs,
+		    struct arm_inst_uop *uop, virtual_addr_t far);
+
 #endif
@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file emulate_cache.h
+ * @author agent (agent@local)
+ * @brief Per-Guest cache of decoded trapped load/store instructions
+ */
+
+#ifndef __EMULATE_CACHE_H__
+#define __EMULATE_CACHE_H__
+
+#include <vmm_error.h>
+#include <vmm_types.h>
+#include <vmm_chardev.h>
+#include <vmm_manager.h>
+
+#if defined(CONFIG_ARM_EMULATE_CACHE)
+
+/** Emulate trapped load/store instruction inst using cached micro-op
+ *  NOTE: Returns VMM_ENOENT if nothing usable is cached for inst
+ *  so caller has to emulate the instruction itself.
+ */
+int emulate_cache_emulate(struct vmm_vcpu *vcpu, arch_regs_t *regs,
+			  u32 inst, virtual_addr_t far);
+
+/** Decode ARM instruction and cache it */
+void emulate_cache_fill(struct vmm_guest *guest, u32 inst);
+
+/** Drop all cached instructions and statistics of a guest */
+void emulate_cache_flush(struct vmm_guest *guest);
+
+/** Print instruction cache statistics of a guest */
+void emulate_cache_stat_dump(struct vmm_chardev *cdev,
+			     struct vmm_guest *guest);
+
+/** Allocate instruction cache of a guest */
+int emulate_cache_init(struct vmm_guest *guest);
+
+/** Free instruction cache of a guest */
+void emulate_cache_deinit(struct vmm_guest *guest);
+
+#else
+
+static inline int emulate_cache_emulate(struct vmm_vcpu *vcpu,
+					arch_regs_t *regs,
+					u32 inst, virtual_addr_t far)
+{
+	return VMM_ENOENT;
+}
+
+static inline void emulate_cache_fill(struct vmm_guest *guest, u32 inst) {}
+
+static inline void emulate_cache_flush(struct vmm_guest *guest) {}
+
+static inline void emulate_cache_stat_dump(struct vmm_chardev *cdev,
+					   struct vmm_guest *guest) {}
+
+static inline int emulate_cache_init(struct vmm_guest *guest)
+{
+	return VMM_OK;
+}
+
+static inline void emulate_cache_deinit(struct vmm_guest *guest) {}
+
+#endif
+
+#endif /* __EMULATE_CACHE_H__ */
@@ -854,7 +854,19 @@ int __cpuinit arch_cpu_aspace_memory_rwinit(virtual_addr_t tmp_va)
 	return VMM_OK;
 }
 
+virtual_size_t arch_cpu_aspace_best_page_size(virtual_addr_t page_va,
+					      physical_addr_t page_pa,
+					      virtual_size_t avail_sz)
+{
+	if (TTBL_L1_BLOCK_SIZE < avail_sz) {
+		avail_sz = TTBL_L1_BLOCK_SIZE;
+	}
+
+	return mmu_lpae_best_page_size(page_va, page_pa, avail_sz);
+}
+
 int arch_cpu_aspace_map(virtual_addr_t page_va,
+			virtual_size_t page_sz,
 			physical_addr_t page_pa,
 			u32 mem_flags)
 {
@@ -863,7 +875,7 @@ int arch_cpu_aspace_map(virtual_addr_t page_va,
 	memset(&p, 0, sizeof(p));
 	p.ia = page_va;
 	p.oa = page_pa;
-	p.sz = VMM_PAGE_SIZE;
+	p.sz = page_sz;
 	p.af = 1;
 	if (mem_flags & VMM_MEMORY_WRITEABLE) {
 		p.ap = TTBL_AP_SRW_U;
@@ -896,7 +908,8 @@ int arch_cpu_aspace_map(virtual_addr_t page_va,
 	return mmu_lpae_map_hypervisor_page(&p);
 }
 
-int arch_cpu_aspace_unmap(virtual_addr_t page_va)
+int arch_cpu_aspace_unmap(virtual_addr_t page_va,
+			  virtual_size_t *page_sz)
 {
 	int rc;
 	struct cpu_page p;
@@ -906,7 +919,12 @@ int arch_cpu_aspace_unmap(virtual_addr_t page_va)
 		return rc;
 	}
 
-	return mmu_lpae_unmap_hypervisor_page(&p);
+	rc = mmu_lpae_unmap_hypervisor_page(&p);
+	if (!rc && page_sz) {
+		*page_sz = p.sz;
+	}
+
+	return rc;
 }
 
 int arch_cpu_aspace_va2pa(virtual_addr_t va, physical_addr_t *pa)
@@ -24,6 +24,7 @@
 cpu-common-objs-y+=emulate_arm.o
 cpu-common-objs-y+=emulate_thumb.o
 cpu-common-objs-y+=emulate_psci.o
+cpu-common-objs-$(CONFIG_ARM_EMULATE_CACHE)+=emulate_cache.o
 cpu-common-objs-$(CONFIG_ARM_LOCKS)+=arm_locks.o
 cpu-common-objs-$(CONFIG_ARM_VGIC)+=vgic.o
 cpu-common-objs-$(CONFIG_ARM_VGIC)+=vgic_v2.o
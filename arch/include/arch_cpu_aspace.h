@@ -36,13 +36,30 @@ int arch_cpu_aspace_primary_init(physical_addr_t *core_resv_pa,
 /** Initialize address space on secondary cpu */
 int arch_cpu_aspace_secondary_init(void);
 
-/** Map given page virtual address to page physical address */
+/** Find out largest page size usable for mapping given page virtual
+ *  address to page physical address when avail_sz bytes are remaining
+ *  NOTE: Returned page size will be VMM_PAGE_SIZE if arch does not
+ *  support block (or section) mappings for hypervisor.
+ */
+virtual_size_t arch_cpu_aspace_best_page_size(virtual_addr_t page_va,
+					      physical_addr_t page_pa,
+					      virtual_size_t avail_sz);
+
+/** Map given page virtual address to page physical address
+ *  NOTE: The page_sz should be VMM_PAGE_SIZE or a page size returned
+ *  by arch_cpu_aspace_best_page_size().
+ */
 int arch_cpu_aspace_map(virtual_addr_t page_va, 
+			virtual_size_t page_sz,
 			physical_addr_t page_pa,
 			u32 mem_flags);
 
-/** Unmap given page based on its virtual address */
-int arch_cpu_aspace_unmap(virtual_addr_t page_va);
+/** Unmap given page based on its virtual address
+ *  NOTE: The page_sz (if not NULL) will be updated with size
+ *  of unmapped page.
+ */
+int arch_cpu_aspace_unmap(virtual_addr_t page_va,
+			  virtual_size_t *page_sz);
 
 /** Find out physical address mapped by given virtual address */
 int arch_cpu_aspace_va2pa(virtual_addr_t va, 
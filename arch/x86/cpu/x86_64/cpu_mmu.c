@@ -153,13 +153,26 @@ int __delete_bootstrap_pgtbl_entry(u64 va)
 	return VMM_OK;
 }
 
+virtual_size_t arch_cpu_aspace_best_page_size(virtual_addr_t page_va,
+					      physical_addr_t page_pa,
+					      virtual_size_t avail_sz)
+{
+	/* Hypervisor mappings only use 4K pages */
+	return VMM_PAGE_SIZE;
+}
+
 /* mmu inline asm routines */
 int arch_cpu_aspace_map(virtual_addr_t page_va,
+			virtual_size_t page_sz,
 			physical_addr_t page_pa,
 			u32 mem_flags)
 {
 	union page pg;
 
+	if (page_sz != VMM_PAGE_SIZE) {
+		return VMM_EINVALID;
+	}
+
 	/* FIXME: more specific page attributes */
 	pg._val = 0x0;
 	pg.bits.paddr = (page_pa >> PAGE_SHIFT);
@@ -175,8 +188,13 @@ int arch_cpu_aspace_map(virtual_addr_t page_va,
 	return mmu_map_page(&host_pgtbl_ctl, host_pgtbl_ctl.base_pgtbl, page_va, &pg);
 }
 
-int arch_cpu_aspace_unmap(virtual_addr_t page_va)
+int arch_cpu_aspace_unmap(virtual_addr_t page_va,
+			  virtual_size_t *page_sz)
 {
+	if (page_sz) {
+		*page_sz = VMM_PAGE_SIZE;
+	}
+
 	return mmu_unmap_page(&host_pgtbl_ctl, host_pgtbl_ctl.base_pgtbl, page_va);
 }
 
@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file cmd_lockstat.c
+ * @author agent (agent@local)
+ * @brief command for lock contention statistics
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_heap.h>
+#include <vmm_lockstat.h>
+#include <vmm_modules.h>
+#include <vmm_cmdmgr.h>
+#include <libs/stringlib.h>
+#include <libs/mathlib.h>
+#include <libs/libsort.h>
+
+#define MODULE_DESC			"Command lockstat"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		0
+#define	MODULE_INIT			cmd_lockstat_init
+#define	MODULE_EXIT			cmd_lockstat_exit
+
+#define CMD_LOCKSTAT_DEFAULT_COUNT	20
+
+static void cmd_lockstat_usage(struct vmm_chardev *cdev)
+{
+	vmm_cprintf(cdev, "Usage:\n");
+	vmm_cprintf(cdev, "   lockstat help\n");
+	vmm_cprintf(cdev, "   lockstat show [<count>]\n");
+	vmm_cprintf(cdev, "   lockstat reset\n");
+	vmm_cprintf(cdev, "Note:\n");
+	vmm_cprintf(cdev, "   Lock classes are sorted by total wait time\n");
+	vmm_cprintf(cdev, "   and all times are in nanoseconds.\n");
+}
+
+struct cmd_lockstat_array {
+	u32 count;
+	u32 max;
+	struct vmm_lockstat_info *info;
+};
+
+static int cmd_lockstat_collect(struct vmm_lockstat_info *info, void *priv)
+{
+	struct cmd_lockstat_array *arr = priv;
+
+	if (arr->max <= arr->count) {
+		return VMM_ENOSPC;
+	}
+
+	memcpy(&arr->info[arr->count], info, sizeof(*info));
+	arr->count++;
+
+	return VMM_OK;
+}
+
+static int cmd_lockstat_less(void *m, size_t a, size_t b)
+{
+	struct vmm_lockstat_info *info = m;
+
+	/* Descending order of total wait time */
+	return (info[a].counters.wait_total > info[b].counters.wait_total);
+}
+
+static void cmd_lockstat_swap(void *m, size_t a, size_t b)
+{
+	struct vmm_lockstat_info tmp;
+	struct vmm_lockstat_info *info = m;
+
+	memcpy(&tmp, &info[a], sizeof(tmp));
+	memcpy(&info[a], &info[b], sizeof(tmp));
+	memcpy(&info[b], &tmp, sizeof(tmp));
+}
+
+static int cmd_lockstat_show(struct vmm_chardev *cdev, u32 count)
+{
+	int rc;
+	u32 i;
+	u64 wait_avg, hold_avg;
+	struct vmm_lockstat_counters *c;
+	struct cmd_lockstat_array arr;
+
+	/* Few classes can be created while we are collecting */
+	arr.count = 0;
+	arr.max = vmm_lockstat_class_count() + 16;
+	arr.info = vmm_zalloc(arr.max * sizeof(*arr.info));
+	if (!arr.info) {
+		return VMM_ENOMEM;
+	}
+
+	rc = vmm_lockstat_iterate(cmd_lockstat_collect, &arr);
+	if (rc && rc != VMM_ENOSPC) {
+		vmm_free(arr.info);
+		return rc;
+	}
+
+	libsort_smoothsort(arr.info, 0, arr.count,
+			   cmd_lockstat_less, cmd_lockstat_swap);
+
+	vmm_cprintf(cdev, "%-8s %-24s %10s %10s %12s %10s %10s %10s\n",
+		    "Type", "Name", "Acquired", "Contended",
+		    "WaitTotal", "WaitMax", "HoldAvg", "HoldMax");
+	for (i = 0; (i < arr.count) && (i < count); i++) {
+		c = &arr.info[i].counters;
+		wait_avg = (c->contended) ?
+			   udiv64(c->wait_total, c->contended) : 0;
+		hold_avg = (c->held) ? udiv64(c->hold_total, c->held) : 0;
+		vmm_cprintf(cdev, "%-8s %-24s %10"PRIu64" %10"PRIu64
+			    " %12"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64"\n",
+			    vmm_lockstat_type_name(arr.info[i].type),
+			    arr.info[i].name, c->acquired, c->contended,
+			    c->wait_total, c->wait_max, hold_avg, c->hold_max);
+		vmm_cprintf(cdev, "         %s (wait avg %"PRIu64")\n",
+			    arr.info[i].site, wait_avg);
+	}
+
+	vmm_free(arr.info);
+
+	return VMM_OK;
+}
+
+static int cmd_lockstat_exec(struct vmm_chardev *cdev, int argc, char **argv)
+{
+	int count = CMD_LOCKSTAT_DEFAULT_COUNT;
+
+	if (argc > 1) {
+		if (strcmp(argv[1], "help") == 0) {
+			cmd_lockstat_usage(cdev);
+			return VMM_OK;
+		} else if (strcmp(argv[1], "show") == 0) {
+			if (argc > 2) {
+				count = atoi(argv[2]);
+				if (count <= 0) {
+					cmd_lockstat_usage(cdev);
+					return VMM_EINVALID;
+				}
+			}
+			return cmd_lockstat_show(cdev, count);
+		} else if (strcmp(argv[1], "reset") == 0) {
+			vmm_lockstat_reset();
+			return VMM_OK;
+		}
+	}
+	cmd_lockstat_usage(cdev);
+	return VMM_EFAIL;
+}
+
+static struct vmm_cmd cmd_lockstat = {
+	.name = "lockstat",
+	.desc = "lock contention statistics",
+	.usage = cmd_lockstat_usage,
+	.exec = cmd_lockstat_exec,
+};
+
+static int __init cmd_lockstat_init(void)
+{
+	return vmm_cmdmgr_register_cmd(&cmd_lockstat);
+}
+
+static void __exit cmd_lockstat_exit(void)
+{
+	vmm_cmdmgr_unregister_cmd(&cmd_lockstat);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
@@ -1001,67 +1001,32 @@ static int cmd_vfs_load(struct vmm_chardev *cdev,
 			const char *path, u32 off, u32 len)
 {
 	int fd, rc;
-	loff_t rd_off;
-	physical_addr_t wr_pa;
-	size_t buf_wr, buf_rd, buf_count, wr_count;
-	char *buf = NULL;
+	u32 flen;
+	size_t wr_count;
 
-	rc = cmd_vfs_file_open_read(cdev, path, &fd, &len);
+	rc = cmd_vfs_file_open_read(cdev, path, &fd, &flen);
 	if (VMM_OK != rc) {
 		return rc;
 	}
 
-	if (off >= len) {
+	if (off >= flen) {
 		vfs_close(fd);
 		vmm_cprintf(cdev, "Offset greater than file size\n");
 		return VMM_EINVALID;
 	}
 
-	if (NULL == (buf = vmm_malloc(VFS_LOAD_BUF_SZ))) {
-		vmm_cprintf(cdev, "Failed to allocate buffer\n");
-		vfs_close(fd);
-		return VMM_ENOMEM;
-	}
-
-	len = ((len - off) < len) ? (len - off) : len;
+	len = ((flen - off) < len) ? (flen - off) : len;
 
-	rd_off = 0;
-	wr_count = 0;
-	wr_pa = pa;
-	while (len) {
-		buf_rd = (len < VFS_LOAD_BUF_SZ) ? len : VFS_LOAD_BUF_SZ;
-		buf_count = vfs_read(fd, buf, buf_rd);
-		if (buf_count < 1) {
-			vmm_cprintf(cdev, "Failed to read "
-					  "%zu bytes @ 0x%llx from %s\n",
-					   buf_rd, rd_off, path);
-			break;
-		}
-		rd_off += buf_count;
-		if (guest) {
-			buf_wr = vmm_guest_memory_write(guest, wr_pa,
-							buf, buf_count, FALSE);
-		} else {
-			buf_wr = vmm_host_memory_write(wr_pa,
-						       buf, buf_count, FALSE);
-		}
-		if (buf_wr != buf_count) {
-			vmm_cprintf(cdev, "Failed to write "
-					  "%zu bytes @ 0x%"PRIPADDR" (%s)\n",
-					  buf_count, wr_pa,
-					  (guest) ? (guest->name) : "host");
-			break;
-		}
-		len -= buf_wr;
-		wr_count += buf_wr;
-		wr_pa += buf_wr;
+	wr_count = vfs_load(fd, off, len, guest, pa);
+	if (wr_count != len) {
+		vmm_cprintf(cdev, "Failed to load %u bytes @ 0x%x from %s\n",
+			    len, off, path);
 	}
 
 	vmm_cprintf(cdev, "%s: Loaded 0x%"PRIPADDR" with %zu bytes\n",
 			  (guest) ? (guest->name) : "host",
 			  pa, wr_count);
 
-	vmm_free(buf);
 	rc = vfs_close(fd);
 	if (rc) {
 		vmm_cprintf(cdev, "Failed to close %s\n", path);
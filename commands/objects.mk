@@ -39,6 +39,7 @@ commands-objs-$(CONFIG_CMD_HEAP)+= cmd_heap.o
 commands-objs-$(CONFIG_CMD_WALLCLOCK)+= cmd_wallclock.o
 commands-objs-$(CONFIG_CMD_MODULE)+= cmd_module.o
 commands-objs-$(CONFIG_CMD_PROFILE)+= cmd_profile.o
+commands-objs-$(CONFIG_CMD_LOCKSTAT)+= cmd_lockstat.o
 
 commands-objs-$(CONFIG_CMD_VMSG)+= cmd_vmsg.o
 commands-objs-$(CONFIG_CMD_VSERIAL)+= cmd_vserial.o
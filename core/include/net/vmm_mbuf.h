@@ -111,6 +111,12 @@ struct m_hdr {
  */
 struct m_pkthdr {
 	int	len;			/* total packet length */
+	int	csum_flags;		/* checksum offload flags; see below */
+	u16	csum_start;		/* offset to start checksumming from */
+	u16	csum_offset;		/* offset after that to place checksum */
+	u16	gso_type;		/* segmentation offload type; see below */
+	u16	gso_size;		/* payload bytes per segment */
+	u16	hdr_len;		/* ethernet + ip + tcp/udp headers */
 };
 
 struct m_ext {
@@ -135,6 +141,12 @@ struct vmm_mbuf {
 #define	m_len		m_hdr.mh_len
 #define	m_flags		m_hdr.mh_flags
 #define m_pktlen	m_pkthdr.len
+#define m_csum_flags	m_pkthdr.csum_flags
+#define m_csum_start	m_pkthdr.csum_start
+#define m_csum_offset	m_pkthdr.csum_offset
+#define m_gso_type	m_pkthdr.gso_type
+#define m_gso_size	m_pkthdr.gso_size
+#define m_hdr_len	m_pkthdr.hdr_len
 #define m_extbuf	m_ext.ext_buf
 #define m_extlen	m_ext.ext_size
 #define m_extref	m_ext.ext_refcnt
@@ -161,6 +173,31 @@ struct vmm_mbuf {
 #define	M_EXT_HEAP	0x10000000	/* ext storage is normal heap alloced */
 #define	M_EXT_DMA	0x20000000	/* ext storage is dma heap alloced */
 
+/* checksum offload flags (m_pkthdr.csum_flags) */
+#define	M_CSUM_PARTIAL	0x0001	/* csum from csum_start needs completion */
+#define	M_CSUM_VALID	0x0002	/* csum already verified or computed */
+
+/* segmentation offload types (m_pkthdr.gso_type) */
+#define	M_GSO_NONE	0x0000	/* not a GSO frame */
+#define	M_GSO_TCPV4	0x0001	/* IPv4 TCP segmentation */
+#define	M_GSO_TCPV6	0x0002	/* IPv6 TCP segmentation */
+#define	M_GSO_UDP	0x0003	/* IPv4 UDP fragmentation */
+#define	M_GSO_TYPE_MASK	0x00ff
+#define	M_GSO_ECN	0x0100	/* TCP has ECN set */
+
+#define	M_GSO_TYPE(m)	((m)->m_gso_type & M_GSO_TYPE_MASK)
+#define	M_IS_GSO(m)	(M_GSO_TYPE(m) != M_GSO_NONE)
+
+/* receive offload limits */
+#define	M_GRO_MAX_FLOWS	8	/* max flows held by GRO context */
+#define	M_GRO_MAX_SIZE	65536	/* max size of GRO super frame */
+
+/* generic receive offload context */
+struct vmm_mbuf_gro {
+	struct dlist flows;	/* held frames, one per flow */
+	u32 count;		/* number of held frames */
+};
+
 /* flags copied when copying m_pkthdr */
 #define	M_COPYFLAGS	(M_PKTHDR)
 
@@ -287,10 +324,22 @@ struct vmm_mbuf *m_get(int nowait, int flags);
 void *m_ext_get(struct vmm_mbuf *m, u32 size, enum vmm_mbuf_alloc_types how);
 void m_ext_dma_ensure(struct vmm_mbuf *m);
 void m_copydata(struct vmm_mbuf *m, int off, int len, void *vp);
+struct vmm_mbuf *m_dup(struct vmm_mbuf *m);
 void m_freem(struct vmm_mbuf *m);
 void m_ext_free(struct vmm_mbuf *m);
 void m_dump(struct vmm_mbuf *m);
 
+/*
+ * mbuf offload APIs.
+ */
+int m_csum_complete(struct vmm_mbuf *m);
+int m_gso_segment(struct vmm_mbuf *m, struct dlist *segs);
+u32 m_flow_hash(struct vmm_mbuf *m);
+void m_gro_init(struct vmm_mbuf_gro *g);
+bool m_gro_receive(struct vmm_mbuf_gro *g, struct vmm_mbuf *m,
+		   struct dlist *out);
+void m_gro_flush(struct vmm_mbuf_gro *g, struct dlist *out);
+
 /*
  * mbuf pool initializaton and exit.
  */
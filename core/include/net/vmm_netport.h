@@ -35,6 +35,13 @@
 /* Port Flags (should be defined as bits) */
 #define VMM_NETPORT_LINK_UP		1	/* If this bit is set link is up */
 
+/* Port offload features (should be defined as bits) */
+#define VMM_NETPORT_F_CSUM		0x1	/* Accepts partial checksum */
+#define VMM_NETPORT_F_TSO4		0x2	/* Accepts TCPv4 GSO frames */
+#define VMM_NETPORT_F_TSO6		0x4	/* Accepts TCPv6 GSO frames */
+#define VMM_NETPORT_F_TSO_ECN		0x8	/* Accepts TCP GSO w/ ECN */
+#define VMM_NETPORT_F_UFO		0x10	/* Accepts UDP GSO frames */
+
 /* Default per-port queue size */
 #define VMM_NETPORT_MAX_QUEUE_SIZE	256
 
@@ -66,6 +73,7 @@ struct vmm_netport {
 	char name[VMM_FIELD_NAME_SIZE];
 	u32 queue_size;
 	int flags;
+	u32 features;
 	int mtu;
 	u8 macaddr[6];
 	struct vmm_netswitch *nsw;
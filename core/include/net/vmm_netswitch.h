@@ -68,6 +68,13 @@ int vmm_port2switch_xfer_lazy(struct vmm_netport *src,
 			 void (*lazy_xfer)(struct vmm_netport *, void *, int),
 			 void *lazy_arg, int lazy_budget);
 
+/** Lazy transfer from port to switch processed by given host CPU
+ *  so that ports with multiple queues can spread work across CPUs
+ */
+int vmm_port2switch_xfer_lazy_on(struct vmm_netport *src, u32 cpu,
+			 void (*lazy_xfer)(struct vmm_netport *, void *, int),
+			 void *lazy_arg, int lazy_budget);
+
 /** Transfer packets from switch to port */
 int vmm_switch2port_xfer_mbuf(struct vmm_netswitch *nsw,
 			      struct vmm_netport *dst,
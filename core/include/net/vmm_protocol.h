@@ -224,6 +224,24 @@ struct ip_header {
 #define ip_chksum(ip_frame)	vmm_be16_to_cpu(((struct ip_header *)(ip_frame))->ipchksum)
 #define ip_payload(ip_frame)	(((struct ip_header *)(ip_frame))->payload)
 
+struct ip6_header {
+	u32 vtcfl;
+	u16 payload_len;
+	u8 nexthdr;
+	u8 hop_limit;
+	u8 srcipaddr[16];
+	u8 dstipaddr[16];
+	u8 payload[0];
+} __packed;
+
+#define IP6_HLEN	(sizeof(struct ip6_header))
+
+#define ip6_srcaddr(ip6_frame)	(((struct ip6_header *)(ip6_frame))->srcipaddr)
+#define ip6_dstaddr(ip6_frame)	(((struct ip6_header *)(ip6_frame))->dstipaddr)
+#define ip6_nexthdr(ip6_frame)	(((struct ip6_header *)(ip6_frame))->nexthdr)
+#define ip6_payload_len(ip6_frame) vmm_be16_to_cpu(((struct ip6_header *)(ip6_frame))->payload_len)
+#define ip6_payload(ip6_frame)	(((struct ip6_header *)(ip6_frame))->payload)
+
 struct icmp_header {
 	u8 type;
 	u8 code;
@@ -266,6 +284,22 @@ struct tcp_header {
 #define tcp_urgent(tcp_frame)	vmm_be16_to_cpu(((struct tcp_header *)(tcp_frame))->urgent)
 #define tcp_payload(tcp_frame)	(((struct tcp_header *)(tcp_frame))->payload)
 
+struct udp_header {
+	u16 srcport;
+	u16 dstport;
+	u16 len;
+	u16 checksum;
+	u8 payload[0];
+} __packed;
+
+#define UDP_HLEN	(sizeof(struct udp_header))
+
+#define udp_srcport(udp_frame)	vmm_be16_to_cpu(((struct udp_header *)(udp_frame))->srcport)
+#define udp_dstport(udp_frame)	vmm_be16_to_cpu(((struct udp_header *)(udp_frame))->dstport)
+#define udp_len(udp_frame)	vmm_be16_to_cpu(((struct udp_header *)(udp_frame))->len)
+#define udp_checksum(udp_frame)	vmm_be16_to_cpu(((struct udp_header *)(udp_frame))->checksum)
+#define udp_payload(udp_frame)	(((struct udp_header *)(udp_frame))->payload)
+
 struct arp_header {
 	u16 htype;
 	u16 ptype;
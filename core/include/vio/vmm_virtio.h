@@ -24,6 +24,9 @@
 #define __VMM_VIRTIO_H__
 
 #include <vmm_types.h>
+#include <vmm_spinlocks.h>
+#include <vmm_mutex.h>
+#include <vmm_completion.h>
 #include <vio/vmm_virtio_config.h>
 #include <vio/vmm_virtio_ids.h>
 #include <vio/vmm_virtio_ring.h>
@@ -37,7 +40,10 @@
 #define VMM_VIRTIO_IRQ_LOW			0
 #define VMM_VIRTIO_IRQ_HIGH			1
 
+#define VMM_VIRTIO_DOORBELL_MAX_VQ		64
+
 struct vmm_guest;
+struct vmm_thread;
 struct vmm_virtio_device;
 
 struct vmm_virtio_iovec {
@@ -49,14 +55,53 @@ struct vmm_virtio_iovec {
 	u16 flags;
 };
 
+/** Guest placement of a virtqueue as programmed through a transport */
+struct vmm_virtio_queue_layout {
+	u32 desc_count;
+	/* Packed ring (descriptor, driver and device areas used) */
+	bool packed;
+	/* Legacy placement: rings are contiguous at guest page frame */
+	physical_addr_t guest_pfn;
+	physical_size_t guest_page_size;
+	u32 align;
+	/* Modern placement: each area at its own guest address */
+	physical_addr_t desc_addr;
+	physical_addr_t driver_addr;
+	physical_addr_t device_addr;
+};
+
 struct vmm_virtio_queue {
 	/* The last_avail_idx field is an index to ->ring of struct vring_avail.
 	   It's where we assume the next request index is at.  */
 	u16			last_avail_idx;
 	u16			last_used_signalled;
 
+	/* For packed ring the vring desc_pa points to descriptor ring,
+	 * avail_pa to driver event suppression and used_pa to device
+	 * event suppression structure.
+	 */
 	struct vmm_vring	vring;
 
+	/* Packed ring state */
+	bool			packed;
+	bool			avail_wrap;
+	bool			used_wrap;
+	u16			last_used_idx;
+	u16			fill_used_idx;
+	bool			fill_used_wrap;
+	u32			fill_used_count;
+	u32			pop_count;
+	/* Per buffer id: first ring slot and number of descriptors */
+	u16			*packed_start;
+	u16			*packed_num;
+	/* Ring slot (and wrap) of each pop and each filled used entry */
+	u16			*packed_pop_hist;
+	u16			*packed_fill_pos;
+	/* Set when guest posted a malformed buffer, the queue is not
+	 * processed any further till it is setup again.
+	 */
+	bool			broken;
+
 	struct vmm_guest	*guest;
 	u32			desc_count;
 	u32			align;
@@ -77,6 +122,11 @@ struct vmm_virtio_device {
 
 	struct vmm_virtio_device_id id;
 
+	/* Transport uses virtio 1.x register layout */
+	bool modern;
+	/* Features accepted by guest */
+	u64 features;
+
 	struct vmm_virtio_transport *tra;
 	void *tra_data;
 
@@ -85,6 +135,15 @@ struct vmm_virtio_device {
 
 	struct dlist node;
 	struct vmm_guest *guest;
+
+#ifdef CONFIG_VIRTIO_DOORBELL
+	/* Doorbell worker state (managed by VirtIO core) */
+	struct vmm_thread *db_worker;
+	struct vmm_completion db_avail;
+	vmm_spinlock_t db_lock;
+	vmm_spinlock_t db_pending_lock;
+	u64 db_pending;
+#endif
 };
 
 struct vmm_virtio_transport {
@@ -98,11 +157,11 @@ struct vmm_virtio_emulator {
 	const struct vmm_virtio_device_id *id_table;
 
 	/* VirtIO operations */
-	u32 (*get_host_features) (struct vmm_virtio_device *dev);
+	u64 (*get_host_features) (struct vmm_virtio_device *dev);
 	void (*set_guest_features) (struct vmm_virtio_device *dev,
-				    u32 features);
-	int (*init_vq) (struct vmm_virtio_device *dev, u32 vq, u32 page_size,
-			u32 align, u32 pfn);
+				    u64 features);
+	int (*init_vq) (struct vmm_virtio_device *dev, u32 vq,
+			struct vmm_virtio_queue_layout *layout);
 	int (*get_pfn_vq) (struct vmm_virtio_device *dev, u32 vq);
 	int (*get_size_vq) (struct vmm_virtio_device *dev, u32 vq);
 	int (*set_size_vq) (struct vmm_virtio_device *dev, u32 vq, int size);
@@ -198,6 +257,23 @@ void vmm_virtio_queue_set_avail_event(struct vmm_virtio_queue *vq);
 void vmm_virtio_queue_set_used_elem(struct vmm_virtio_queue *vq,
 				    u32 head, u32 len);
 
+/** Fill used element at given offset from current used index
+ *  without making it visible to guest
+ *  Note: works only after queue setup is done
+ */
+void vmm_virtio_queue_fill_used_elem(struct vmm_virtio_queue *vq,
+				     u32 head, u32 len, u32 offset);
+
+/** Make given number of filled used elements visible to guest
+ *  Note: works only after queue setup is done
+ */
+void vmm_virtio_queue_flush_used(struct vmm_virtio_queue *vq, u32 count);
+
+/** Give back given number of popped heads to available ring
+ *  Note: works only after queue setup is done
+ */
+void vmm_virtio_queue_discard(struct vmm_virtio_queue *vq, u32 count);
+
 /** Check whether queue setup is done by guest or not */
 bool vmm_virtio_queue_setup_done(struct vmm_virtio_queue *vq);
 
@@ -211,9 +287,7 @@ int vmm_virtio_queue_cleanup(struct vmm_virtio_queue *vq);
  */
 int vmm_virtio_queue_setup(struct vmm_virtio_queue *vq,
 			   struct vmm_guest *guest,
-			   physical_addr_t guest_pfn,
-			   physical_size_t guest_page_size,
-			   u32 desc_count, u32 align);
+			   struct vmm_virtio_queue_layout *layout);
 
 /** Get guest IO vectors based on given head
  *  Note: works only after queue setup is done
@@ -246,6 +320,33 @@ void vmm_virtio_iovec_fill_zeros(struct vmm_virtio_device *dev,
 				 struct vmm_virtio_iovec *iov,
 				 u32 iov_cnt);
 
+/** Check whether a feature was accepted by guest */
+static inline bool vmm_virtio_has_feature(struct vmm_virtio_device *dev,
+					  u32 fbit)
+{
+	return (dev->features & (1ULL << fbit)) ? TRUE : FALSE;
+}
+
+/** Get features offered by VirtIO device including transport features */
+u64 vmm_virtio_get_host_features(struct vmm_virtio_device *dev);
+
+/** Set features accepted by guest */
+void vmm_virtio_set_guest_features(struct vmm_virtio_device *dev,
+				   u64 features);
+
+/** Setup queue of VirtIO device placed using legacy page frame layout */
+int vmm_virtio_init_vq_legacy(struct vmm_virtio_device *dev, u32 vq,
+			      u32 desc_count, u32 page_size,
+			      u32 align, u32 pfn);
+
+/** Setup queue of VirtIO device placed using modern layout
+ *  Note: Ring format is selected based on features accepted by guest
+ */
+int vmm_virtio_init_vq(struct vmm_virtio_device *dev, u32 vq,
+		       u32 desc_count, physical_addr_t desc_addr,
+		       physical_addr_t driver_addr,
+		       physical_addr_t device_addr);
+
 /** Read VirtIO device configuration */
 int vmm_virtio_config_read(struct vmm_virtio_device *dev,
 			   u32 offset, void *dst, u32 dst_len);
@@ -257,6 +358,13 @@ int vmm_virtio_config_write(struct vmm_virtio_device *dev,
 /** Reset VirtIO device */
 int vmm_virtio_reset(struct vmm_virtio_device *dev);
 
+/** Ring queue notify doorbell of a virtio device
+ *  Note: This can be called from VCPU context. The emulator notify_vq()
+ *  is called later from the device worker thread when doorbells are
+ *  enabled otherwise it is called immediately.
+ */
+int vmm_virtio_doorbell(struct vmm_virtio_device *dev, u32 vq);
+
 /** Register VirtIO device */
 int vmm_virtio_register_device(struct vmm_virtio_device *dev);
 
@@ -42,7 +42,7 @@
  * feature bits.
  */
 #define VMM_VIRTIO_TRANSPORT_F_START		28
-#define VMM_VIRTIO_TRANSPORT_F_END		34
+#define VMM_VIRTIO_TRANSPORT_F_END		38
 
 #ifndef VMM_VIRTIO_CONFIG_NO_LEGACY
 /* Do we get callbacks when the ring is completely used, even if we've
@@ -65,4 +65,7 @@
  */
 #define VMM_VIRTIO_F_IOMMU_PLATFORM		33
 
+/* This feature indicates support for the packed virtqueue layout. */
+#define VMM_VIRTIO_F_RING_PACKED		34
+
 #endif /* __VMM_VIRTIO_CONFIG_H__ */
@@ -88,4 +88,77 @@ struct vmm_virtio_pci_config {
 #define VMM_VIRTIO_PCI_O_CONFIG			0
 #define VMM_VIRTIO_PCI_O_MSIX			1
 
+/* Modern (virtio 1.x) PCI transport --> from Linux's linux/virtio_pci.h */
+
+/* PCI device ID of modern device is offset by VirtIO device type */
+#define VMM_VIRTIO_PCI_MODERN_DEVICE_ID_BASE	0x1040
+
+/* Vendor specific capability ID */
+#define VMM_VIRTIO_PCI_CAP_ID_VNDR		0x09
+
+/* Common configuration */
+#define VMM_VIRTIO_PCI_CAP_COMMON_CFG		1
+/* Notifications */
+#define VMM_VIRTIO_PCI_CAP_NOTIFY_CFG		2
+/* ISR access */
+#define VMM_VIRTIO_PCI_CAP_ISR_CFG		3
+/* Device specific configuration */
+#define VMM_VIRTIO_PCI_CAP_DEVICE_CFG		4
+
+struct vmm_virtio_pci_cap {
+	u8	cap_vndr;
+	u8	cap_next;
+	u8	cap_len;
+	u8	cfg_type;
+	u8	bar;
+	u8	padding[3];
+	u32	offset;
+	u32	length;
+} __attribute__((packed));
+
+struct vmm_virtio_pci_notify_cap {
+	struct vmm_virtio_pci_cap cap;
+	u32	notify_off_multiplier;
+} __attribute__((packed));
+
+/* Offsets of fields in common configuration structure */
+#define VMM_VIRTIO_PCI_COMMON_DFSELECT		0
+#define VMM_VIRTIO_PCI_COMMON_DF		4
+#define VMM_VIRTIO_PCI_COMMON_GFSELECT		8
+#define VMM_VIRTIO_PCI_COMMON_GF		12
+#define VMM_VIRTIO_PCI_COMMON_MSIX		16
+#define VMM_VIRTIO_PCI_COMMON_NUMQ		18
+#define VMM_VIRTIO_PCI_COMMON_STATUS		20
+#define VMM_VIRTIO_PCI_COMMON_CFGGENERATION	21
+#define VMM_VIRTIO_PCI_COMMON_Q_SELECT		22
+#define VMM_VIRTIO_PCI_COMMON_Q_SIZE		24
+#define VMM_VIRTIO_PCI_COMMON_Q_MSIX		26
+#define VMM_VIRTIO_PCI_COMMON_Q_ENABLE		28
+#define VMM_VIRTIO_PCI_COMMON_Q_NOFF		30
+#define VMM_VIRTIO_PCI_COMMON_Q_DESCLO		32
+#define VMM_VIRTIO_PCI_COMMON_Q_DESCHI		36
+#define VMM_VIRTIO_PCI_COMMON_Q_AVAILLO		40
+#define VMM_VIRTIO_PCI_COMMON_Q_AVAILHI		44
+#define VMM_VIRTIO_PCI_COMMON_Q_USEDLO		48
+#define VMM_VIRTIO_PCI_COMMON_Q_USEDHI		52
+
+/* No MSI-X vector assigned */
+#define VMM_VIRTIO_MSI_NO_VECTOR		0xffff
+
+/* Placement of modern capabilities in PCI config space */
+#define VMM_VIRTIO_PCI_MODERN_CAP_START		0x40
+
+/* Placement of modern register blocks in BAR0 */
+#define VMM_VIRTIO_PCI_MODERN_COMMON_OFFSET	0x000
+#define VMM_VIRTIO_PCI_MODERN_COMMON_SIZE	0x038
+#define VMM_VIRTIO_PCI_MODERN_ISR_OFFSET	0x100
+#define VMM_VIRTIO_PCI_MODERN_ISR_SIZE		0x001
+#define VMM_VIRTIO_PCI_MODERN_NOTIFY_OFFSET	0x200
+#define VMM_VIRTIO_PCI_MODERN_NOTIFY_MULT	4
+#define VMM_VIRTIO_PCI_MODERN_NOTIFY_SIZE	\
+		(VMM_VIRTIO_PCI_QUEUE_MAX * VMM_VIRTIO_PCI_MODERN_NOTIFY_MULT)
+#define VMM_VIRTIO_PCI_MODERN_DEVICE_OFFSET	0x300
+#define VMM_VIRTIO_PCI_MODERN_DEVICE_SIZE	0x100
+#define VMM_VIRTIO_PCI_MODERN_BAR_SIZE		0x400
+
 #endif /* __VMM_VIRTIO_PCI_H__ */
@@ -162,4 +162,49 @@ static inline int vmm_vring_need_event(u16 event_idx, u16 new_idx, u16 old)
 	return (u16)(new_idx - event_idx - 1) < (u16)(new_idx - old);
 }
 
+/*
+ * Packed virtqueue layout (virtio 1.1 or higher)
+ *
+ * A single ring of descriptors is shared by driver and device. The
+ * driver makes a descriptor available by setting AVAIL flag equal to
+ * its wrap counter and USED flag to the inverse. The device marks a
+ * buffer used by writing a descriptor with both flags equal to its
+ * own wrap counter. Each side flips its wrap counter every time it
+ * wraps around the ring.
+ */
+
+/* Mark a descriptor as available or used. */
+#define VMM_VRING_PACKED_DESC_F_AVAIL		7
+#define VMM_VRING_PACKED_DESC_F_USED		15
+
+/* Enable events. */
+#define VMM_VRING_PACKED_EVENT_FLAG_ENABLE	0x0
+/* Disable events. */
+#define VMM_VRING_PACKED_EVENT_FLAG_DISABLE	0x1
+/* Enable events for a specific descriptor as given by off_wrap. */
+#define VMM_VRING_PACKED_EVENT_FLAG_DESC	0x2
+
+/* Wrap counter bit shift in event suppression structure off_wrap. */
+#define VMM_VRING_PACKED_EVENT_F_WRAP_CTR	15
+
+/* Packed ring descriptors: 16 bytes. */
+struct vmm_vring_packed_desc {
+	/* Buffer Address. */
+	u64 addr;
+	/* Buffer Length. */
+	u32 len;
+	/* Buffer ID. */
+	u16 id;
+	/* The flags depending on descriptor type. */
+	u16 flags;
+};
+
+/* Packed ring event suppression structure: 4 bytes. */
+struct vmm_vring_packed_desc_event {
+	/* Descriptor Ring Change Event Offset/Wrap Counter. */
+	u16 off_wrap;
+	/* Descriptor Ring Change Event Flags. */
+	u16 flags;
+};
+
 #endif /* __VMM_VIRTIO_RING_H__ */
@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_virtio_rpmsg.h
+ * @author agent (agent@local)
+ * @brief VirtIO RPMSG Device Interface.
+ *
+ * The message header and name service layout are same as
+ * <linux_source>/drivers/rpmsg/virtio_rpmsg_bus.c
+ *
+ * The shared memory feature, descriptor and config space are
+ * Xvisor specific and used for zero-copy messages.
+ */
+
+#ifndef __VMM_VIRTIO_RPMSG_H__
+#define __VMM_VIRTIO_RPMSG_H__
+
+#include <vmm_types.h>
+
+/* Feature bits */
+#define VMM_VIRTIO_RPMSG_F_NS		0 /* Remote supports name service */
+#define VMM_VIRTIO_RPMSG_F_SHMEM	1 /* Shared memory window in config */
+
+/* Reserved address of name service endpoint */
+#define VMM_VIRTIO_RPMSG_NS_ADDR	53
+#define VMM_VIRTIO_RPMSG_ADDR_ANY	0xFFFFFFFF
+
+#define VMM_VIRTIO_RPMSG_NAME_SIZE	32
+
+/* Message header flags */
+#define VMM_VIRTIO_RPMSG_HDR_F_SHMEM	0x1 /* Payload is shmem descriptor */
+
+struct vmm_virtio_rpmsg_hdr {
+	u32 src;
+	u32 dst;
+	u32 reserved;
+	u16 len;
+	u16 flags;
+	u8 data[0];
+} __packed;
+
+/* Name service flags */
+#define VMM_VIRTIO_RPMSG_NS_CREATE	0
+#define VMM_VIRTIO_RPMSG_NS_DESTROY	1
+
+struct vmm_virtio_rpmsg_ns_msg {
+	char name[VMM_VIRTIO_RPMSG_NAME_SIZE];
+	u32 addr;
+	u32 flags;
+} __packed;
+
+/* Payload of message with VMM_VIRTIO_RPMSG_HDR_F_SHMEM flag
+ * where offset is relative to start of shared memory window.
+ */
+struct vmm_virtio_rpmsg_shmem_desc {
+	u64 offset;
+	u64 len;
+} __packed;
+
+struct vmm_virtio_rpmsg_config {
+	/* guest physical address of shared memory window */
+	u64 shmem_addr;
+	/* size of shared memory window (zero if not available) */
+	u64 shmem_size;
+} __packed;
+
+#endif /* __VMM_VIRTIO_RPMSG_H__ */
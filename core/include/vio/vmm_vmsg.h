@@ -49,6 +49,7 @@
 #include <vmm_mutex.h>
 #include <vmm_threads.h>
 #include <vmm_notifier.h>
+#include <vmm_shmem.h>
 #include <arch_atomic.h>
 #include <libs/list.h>
 
@@ -77,24 +78,36 @@ int vmm_vmsg_register_client(struct vmm_notifier_block *nb);
 /** Unregister a notifier client to not receive virtual messaging events */
 int vmm_vmsg_unregister_client(struct vmm_notifier_block *nb);
 
-/** Representation of a virtual message */
+/** Representation of a virtual message
+ *
+ * Payload of a message is either @data (copied by receivers) or, for
+ * zero-copy messages, @len bytes at offset @shm_off in shared memory
+ * @shm. Zero-copy messages only carry the descriptor and receivers
+ * mapping the same shared memory can access payload in-place.
+ */
 struct vmm_vmsg {
+	struct dlist head;
 	atomic_t ref_count;
 	u32 dst;
 	u32 src;
 	void *data;
 	size_t len;
+	struct vmm_shmem *shm;
+	physical_addr_t shm_off;
 	void *priv;
 	void (*release) (struct vmm_vmsg *);
 };
 
 #define INIT_VMSG(__msg, __dst, __src, __data, __len, __priv, __rel)	\
 	do {								\
+		INIT_LIST_HEAD(&(__msg)->head);				\
 		arch_atomic_write(&(__msg)->ref_count, 1);		\
 		(__msg)->dst = (__dst);					\
 		(__msg)->src = (__src);					\
 		(__msg)->data = (__data);				\
 		(__msg)->len = (__len);					\
+		(__msg)->shm = NULL;					\
+		(__msg)->shm_off = 0;					\
 		(__msg)->priv = (__priv);				\
 		(__msg)->release = (__rel);				\
 	} while (0)
@@ -108,6 +121,7 @@ struct vmm_vmsg_domain {
 	struct vmm_completion work_avail;
 	vmm_spinlock_t work_lock;
 	struct dlist work_list;
+	struct dlist msg_list;
 	struct vmm_mutex node_lock;
 	struct dlist node_list;
 };
@@ -144,6 +158,19 @@ void vmm_vmsg_dref(struct vmm_vmsg *msg);
 /** Allocate new virtual message */
 struct vmm_vmsg *vmm_vmsg_alloc(u32 dst, u32 src, void *data, size_t len);
 
+/** Allocate new zero-copy virtual message with payload in shared memory
+ *  Note: The message holds a reference to shared memory until freed.
+ */
+struct vmm_vmsg *vmm_vmsg_alloc_shmem(u32 dst, u32 src,
+				      struct vmm_shmem *shm,
+				      physical_addr_t off, size_t len);
+
+/** Check whether virtual message is zero-copy */
+static inline bool vmm_vmsg_is_shmem(struct vmm_vmsg *msg)
+{
+	return (msg && msg->shm) ? TRUE : FALSE;
+}
+
 /** Free a virtual message */
 static inline void vmm_vmsg_free(struct vmm_vmsg *msg)
 {
@@ -199,7 +226,12 @@ struct vmm_vmsg_node *vmm_vmsg_node_find(const char *name);
 /** Count of available virtual messaging nodes */
 u32 vmm_vmsg_node_count(void);
 
-/** Send message from virtual messaging node */
+/** Send message from virtual messaging node
+ *  Note: The domain takes its own reference on message until it is
+ *  delivered so caller can free message right after sending. The
+ *  recv_msg() callback of receivers has to take a reference if it
+ *  wants to keep message beyond the callback.
+ */
 int vmm_vmsg_node_send(struct vmm_vmsg_node *node, struct vmm_vmsg *msg);
 
 /** Mark virtual messaging node as ready */
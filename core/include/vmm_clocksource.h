@@ -97,13 +97,20 @@ VMM_DEVTREE_NIDTBL_ENTRY(name, "clocksource", "", "", compat, fn)
  * than the clocksource wraps around. The nanosecond counter will only 
  * wrap around after ~585 years.
  *
+ * Only vmm_timecounter_read() updates the (cycles_last, nsec) base and
+ * it must not run concurrently with itself. The vmm_timecounter_peek()
+ * does not modify anything and can run on any CPU at any time because
+ * the base is protected by a sequence count.
+ *
  * @cs:			the cycle counter used by this instance
+ * @seq:		sequence count (odd while base is being updated)
  * @cycles_last:	most recent cycle counter value seen by
  *			vmm_timecounter_read()
  * @nsec:		continuously increasing count
  */
 struct vmm_timecounter {
 	struct vmm_clocksource *cs;
+	u32 seq;
 	u64 cycles_last;
 	u64 nsec;
 };
@@ -130,9 +137,21 @@ static inline u32 vmm_clocksource_hz2mult(u32 hz, u32 shift)
 #define vmm_clocksource_delta2nsecs(cycles, mult, shift) \
 		(((cycles) * (mult)) >> (shift)) 
 
-/** Get current value from nanosecond counter (nanoseconds elapsed) */
+/** Maximum nanoseconds between two updates of nanosecond counter base
+ *  such that conversion of cycles to nanoseconds does not overflow
+ */
+u64 vmm_timecounter_max_nsecs(struct vmm_timecounter *tc);
+
+/** Get current value from nanosecond counter (nanoseconds elapsed)
+ *  and update the base of nanosecond counter
+ */
 u64 vmm_timecounter_read(struct vmm_timecounter *tc);
 
+/** Get current value from nanosecond counter (nanoseconds elapsed)
+ *  without updating the base of nanosecond counter (lockless)
+ */
+u64 vmm_timecounter_peek(struct vmm_timecounter *tc);
+
 #if defined(CONFIG_PROFILE)
 /** Special version for profile */
 u64 vmm_timecounter_read_for_profile(struct vmm_timecounter *tc);
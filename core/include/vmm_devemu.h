@@ -39,10 +39,44 @@ enum vmm_devemu_endianness {
 	VMM_DEVEMU_MAX_ENDIAN=4,
 };
 
+/** Coalesced register range of an emulator
+ *
+ * Guest writes falling completely inside a coalesced range are not
+ * emulated immediately. They are appended to a per-VCPU ring and
+ * applied in order on the next non-coalesced access to any emulated
+ * device of the guest, when the ring is full, or after a short delay.
+ *
+ * Only write-only registers whose side effects can be batched (such
+ * as palette or doorbell counters) should be marked as coalesced.
+ */
+struct vmm_devemu_coalesced_range {
+	physical_addr_t offset;
+	physical_size_t size;
+};
+
+/** Doorbell register of an emulated device
+ *
+ * A guest write of exactly len bytes at given offset of the emulated
+ * device is not passed to the emulator write callbacks. Instead, the
+ * ring() callback is invoked with the value in host CPU endianness.
+ *
+ * The ring() callback is called from VCPU context so it must only
+ * record the doorbell and wake up whoever processes it.
+ */
+struct vmm_devemu_doorbell {
+	struct dlist head;
+	physical_addr_t offset;
+	u32 len;
+	void (*ring) (struct vmm_devemu_doorbell *db, u64 val);
+	void *priv;
+};
+
 struct vmm_emulator {
 	struct dlist head;
 	char name[VMM_FIELD_NAME_SIZE];
 	const struct vmm_devtree_nodeid *match_table;
+	/* Coalesced ranges terminated by an entry with zero size */
+	const struct vmm_devemu_coalesced_range *coalesced_table;
 	enum vmm_devemu_endianness endian;
 	int (*probe) (struct vmm_guest *guest,
 		      struct vmm_emudev *edev,
@@ -136,6 +170,8 @@ struct vmm_emudev {
 	struct dlist head;
 	vmm_rwlock_t child_list_lock;
 	struct dlist child_list;
+	vmm_rwlock_t doorbell_lock;
+	struct dlist doorbell_list;
 	void *priv;
 #ifdef CONFIG_DEVEMU_DEBUG
 	u32 debug_info;
@@ -165,6 +201,17 @@ int vmm_devemu_emulate_write(struct vmm_vcpu *vcpu,
 			     void *src, u32 src_len,
 			     enum vmm_devemu_endianness src_endian);
 
+/** Apply all buffered coalesced writes of given guest */
+int vmm_devemu_flush_coalesced(struct vmm_guest *guest);
+
+/** Register doorbell register for given emulated device */
+int vmm_devemu_register_doorbell(struct vmm_emudev *edev,
+				 struct vmm_devemu_doorbell *db);
+
+/** Unregister doorbell register of given emulated device */
+int vmm_devemu_unregister_doorbell(struct vmm_emudev *edev,
+				   struct vmm_devemu_doorbell *db);
+
 /** Emulate IO read to virtual device for given VCPU */
 int vmm_devemu_emulate_ioread(struct vmm_vcpu *vcpu,
 			      physical_addr_t gphys_addr,
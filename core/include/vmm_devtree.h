@@ -48,6 +48,8 @@
 #define VMM_DEVTREE_DEVICE_TYPE_VAL_ALLOCED_ROM	"alloced_rom"
 #define VMM_DEVTREE_DEVICE_TYPE_VAL_COLORED_ROM	"colored_rom"
 #define VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_ROM	"shared_rom"
+#define VMM_DEVTREE_DEVICE_TYPE_VAL_FILE_RAM	"file_ram"
+#define VMM_DEVTREE_DEVICE_TYPE_VAL_FILE_ROM	"file_rom"
 #define VMM_DEVTREE_COMPATIBLE_ATTR_NAME	"compatible"
 #define VMM_DEVTREE_CLOCK_FREQ_ATTR_NAME	"clock-frequency"
 #define VMM_DEVTREE_CLOCKS_ATTR_NAME		"clocks"
@@ -115,6 +117,13 @@
 #define VMM_DEVTREE_NUM_COLORS_ATTR_NAME	"num_colors"
 #define VMM_DEVTREE_SHARED_MEM_ATTR_NAME	"shared_mem"
 #define VMM_DEVTREE_MAP_ORDER_ATTR_NAME		"map_order"
+#define VMM_DEVTREE_POPULATE_ATTR_NAME		"populate"
+#define VMM_DEVTREE_POPULATE_VAL_LAZY		"lazy"
+#define VMM_DEVTREE_POPULATE_VAL_EAGER		"eager"
+#define VMM_DEVTREE_POPULATE_VAL_FAULT_AROUND	"fault_around"
+#define VMM_DEVTREE_FAULT_AROUND_ORDER_ATTR_NAME "fault_around_order"
+#define VMM_DEVTREE_FILE_ATTR_NAME		"file"
+#define VMM_DEVTREE_FILE_OFFSET_ATTR_NAME	"file_offset"
 #define VMM_DEVTREE_SWITCH_ATTR_NAME		"switch"
 #define VMM_DEVTREE_BLKDEV_ATTR_NAME		"blkdev"
 #define VMM_DEVTREE_VCPU_AFFINITY_ATTR_NAME	"affinity"
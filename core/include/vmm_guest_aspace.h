@@ -83,12 +83,18 @@ int vmm_guest_overwrite_real_device_mapping(struct vmm_guest *guest,
 					    physical_addr_t gphys_addr,
 					    physical_addr_t hphys_addr);
 
-/** Read from guest memory regions (i.e. RAM or ROM regions) */
+/** Read from guest memory regions (i.e. RAM or ROM regions)
+ *  Note: Outside orphan context, the read stops short at file-backed
+ *  mapping not populated yet and the mapping is populated in background
+ *  so caller has to retry later.
+ */
 u32 vmm_guest_memory_read(struct vmm_guest *guest, 
 			  physical_addr_t gphys_addr, 
 			  void *dst, u32 len, bool cacheable);
 
-/** Write to guest memory regions (i.e. RAM or ROM regions) */
+/** Write to guest memory regions (i.e. RAM or ROM regions)
+ *  Note: Stops short at file-backed mappings like vmm_guest_memory_read()
+ */
 u32 vmm_guest_memory_write(struct vmm_guest *guest, 
 			   physical_addr_t gphys_addr, 
 			   void *src, u32 len, bool cacheable);
@@ -101,6 +107,14 @@ int vmm_guest_physical_map(struct vmm_guest *guest,
 			   physical_size_t *phys_size,
 			   u32 *reg_flags);
 
+/** Populate guest physical address on behalf of VCPU when
+ *  vmm_guest_physical_map() returns VMM_EAGAIN (i.e. file-backed
+ *  region not populated yet). The VCPU is paused till population
+ *  completes in orphan context so it must retry the access.
+ */
+int vmm_guest_physical_populate(struct vmm_vcpu *vcpu,
+				physical_addr_t gphys_addr);
+
 /** Unmap guest physical address */
 int vmm_guest_physical_unmap(struct vmm_guest *guest,
 			     physical_addr_t gphys_addr,
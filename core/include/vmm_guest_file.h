@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_guest_file.h
+ * @author agent (agent@local)
+ * @brief header file for files backing guest RAM/ROM regions
+ *
+ * Contents of file-backed guest regions (i.e. "file_ram" and
+ * "file_rom" regions) are read on-demand one mapping at a time using
+ * a file backend (such as VFS library) registered at runtime. Read-only
+ * copies of file contents are reference counted and shared by all
+ * guests using same file.
+ */
+#ifndef _VMM_GUEST_FILE_H__
+#define _VMM_GUEST_FILE_H__
+
+#include <vmm_types.h>
+#include <libs/list.h>
+
+/** Default mapping order of file-backed guest regions (64 KB) */
+#define VMM_GUEST_FILE_DEF_MAP_ORDER	16
+
+/** Representation of file backend
+ *  Note: All callbacks are called from orphan context
+ */
+struct vmm_guest_file_backend {
+	const char *name;
+	int (*open)(const char *path, void **priv);
+	void (*close)(void *priv);
+	/* Read file contents to buffer and return number of
+	 * bytes read in rd which is less than len only when
+	 * end of file is reached
+	 */
+	int (*read)(void *priv, u64 off, void *buf, size_t len, size_t *rd);
+};
+
+struct vmm_guest_file;
+
+/** Register file backend (only one backend at a time) */
+int vmm_guest_file_register_backend(struct vmm_guest_file_backend *be);
+
+/** Unregister file backend and close all files opened by it */
+int vmm_guest_file_unregister_backend(struct vmm_guest_file_backend *be);
+
+/** Get (find or create) file instance for given path
+ *  Note: The file is opened on first access so backend need not
+ *  be available at this time.
+ */
+struct vmm_guest_file *vmm_guest_file_get(const char *path);
+
+/** Release file instance */
+void vmm_guest_file_put(struct vmm_guest_file *f);
+
+/** Path of file instance */
+const char *vmm_guest_file_path(struct vmm_guest_file *f);
+
+/** Read file contents to host RAM and zero fill beyond EOF
+ *  Note: Must be called from orphan context
+ */
+int vmm_guest_file_read(struct vmm_guest_file *f, u64 off,
+			physical_addr_t hphys_addr, physical_size_t len);
+
+/** Get shared read-only copy of file contents in host RAM
+ *  Note: Must be called from orphan context
+ */
+int vmm_guest_file_get_page(struct vmm_guest_file *f, u64 off,
+			    physical_size_t len, u32 align_order,
+			    physical_addr_t *hphys_addr);
+
+/** Release shared read-only copy of file contents */
+void vmm_guest_file_put_page(struct vmm_guest_file *f,
+			     physical_addr_t hphys_addr);
+
+/** Initialize guest file subsystem */
+int vmm_guest_file_init(void);
+
+#endif
@@ -105,6 +105,42 @@ physical_addr_t vmm_dma_map(virtual_addr_t vaddr, virtual_size_t size,
 void vmm_dma_unmap(physical_addr_t daddr, physical_size_t size,
 		   enum vmm_dma_direction dir);
 
+/** Entry of DMA scatter-gather list */
+struct vmm_dma_sg {
+	virtual_addr_t vaddr;
+	virtual_size_t len;
+	physical_addr_t daddr; /* Updated by vmm_dma_map_sg() */
+};
+
+/** Map a list of DMA buffers for the device
+ *  Note: cache maintenance of adjacent buffers is merged
+ */
+int vmm_dma_map_sg(struct vmm_dma_sg *sg, u32 nents,
+		   enum vmm_dma_direction dir);
+
+/** Unmap a list of DMA buffers, which can be then read by the CPU */
+void vmm_dma_unmap_sg(struct vmm_dma_sg *sg, u32 nents,
+		      enum vmm_dma_direction dir);
+
+struct vmm_dma_pool;
+
+/** Create pool of fixed size blocks on DMA heap
+ *  Note: blocks don't need cache maintenance hence they
+ *  are suitable for descriptor rings
+ */
+struct vmm_dma_pool *vmm_dma_pool_create(const char *name,
+					 virtual_size_t size,
+					 virtual_size_t align);
+
+/** Destroy pool of fixed size blocks */
+void vmm_dma_pool_destroy(struct vmm_dma_pool *pool);
+
+/** Allocate zeroed block from pool and get its physical address */
+void *vmm_dma_pool_alloc(struct vmm_dma_pool *pool, physical_addr_t *daddr);
+
+/** Free block back to pool */
+void vmm_dma_pool_free(struct vmm_dma_pool *pool, void *vaddr);
+
 /** Retrieve allocation size from DMA heap */
 virtual_size_t vmm_dma_alloc_size(const void *ptr);
 
@@ -141,7 +141,10 @@ virtual_addr_t vmm_host_alloc_aligned_pages(u32 page_count,
 /** Allocate pages from host memory with default alignment */
 virtual_addr_t vmm_host_alloc_pages(u32 page_count, u32 mem_flags);
 
-/** Free pages back to host memory */
+/** Free pages back to host memory
+ *  Note: Freeing part of pages mapped using block mappings
+ *  is not supported and returns VMM_ENOTSUPP.
+ */
 int vmm_host_free_pages(virtual_addr_t page_va, u32 page_count);
 
 /** Convert virtual address to its physical address */
@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_lockstat.h
+ * @author agent (agent@local)
+ * @brief Lock contention statistics
+ *
+ * Locks are grouped into classes by the source location which
+ * initialized them (INIT_xxx() call site or static initializer) so
+ * that, for example, all heap locks are accounted together. Each class
+ * keeps per-CPU counters which are summed up only when dumped.
+ *
+ * When CONFIG_LOCKSTAT is disabled none of this is compiled and
+ * lock operations expand to the plain arch lock calls.
+ */
+
+#ifndef __VMM_LOCKSTAT_H__
+#define __VMM_LOCKSTAT_H__
+
+#include <vmm_types.h>
+#include <vmm_compiler.h>
+
+#if defined(CONFIG_LOCKSTAT)
+
+/** Types of lock classes */
+enum vmm_lockstat_types {
+	VMM_LOCKSTAT_SPINLOCK=0,
+	VMM_LOCKSTAT_RWLOCK=1,
+	VMM_LOCKSTAT_MUTEX=2,
+	VMM_LOCKSTAT_MAX_TYPES=3
+};
+
+/** Per-CPU counters of lock class (times in nanoseconds) */
+struct vmm_lockstat_counters {
+	u64 acquired;
+	u64 contended;
+	u64 wait_total;
+	u64 wait_max;
+	u64 held;
+	u64 hold_total;
+	u64 hold_max;
+};
+
+struct vmm_lockstat_class;
+
+/** Lockstat state embedded in each lock instance */
+struct vmm_lockstat_lock {
+	const char *name;
+	const char *site;
+	struct vmm_lockstat_class *class;
+	u64 acquire_tstamp;
+};
+
+#define VMM_LOCKSTAT_SITE	__FILE__ ":" stringify(__LINE__)
+
+#define VMM_LOCKSTAT_INIT(__ls, __name)		\
+do { \
+	(__ls)->name = #__name; \
+	(__ls)->site = VMM_LOCKSTAT_SITE; \
+	(__ls)->class = NULL; \
+	(__ls)->acquire_tstamp = 0; \
+} while (0)
+
+#define VMM_LOCKSTAT_INITIALIZER(__name) \
+{ \
+	.name = #__name, \
+	.site = VMM_LOCKSTAT_SITE, \
+	.class = NULL, \
+	.acquire_tstamp = 0, \
+}
+
+/** Summary of lock class returned by vmm_lockstat_iterate() */
+struct vmm_lockstat_info {
+	const char *name;
+	const char *site;
+	enum vmm_lockstat_types type;
+	struct vmm_lockstat_counters counters;
+};
+
+/* Hooks used by lock implementations.
+ * Note: These functions should not be directly called from anywhere.
+ */
+void vmm_lockstat_spin_lock(arch_spinlock_t *tlock,
+			    struct vmm_lockstat_lock *ls);
+int vmm_lockstat_spin_trylock(arch_spinlock_t *tlock,
+			      struct vmm_lockstat_lock *ls);
+void vmm_lockstat_spin_unlock(arch_spinlock_t *tlock,
+			      struct vmm_lockstat_lock *ls);
+void vmm_lockstat_write_lock(arch_rwlock_t *tlock,
+			     struct vmm_lockstat_lock *ls);
+int vmm_lockstat_write_trylock(arch_rwlock_t *tlock,
+			       struct vmm_lockstat_lock *ls);
+void vmm_lockstat_write_unlock(arch_rwlock_t *tlock,
+			       struct vmm_lockstat_lock *ls);
+void vmm_lockstat_read_lock(arch_rwlock_t *tlock,
+			    struct vmm_lockstat_lock *ls);
+int vmm_lockstat_read_trylock(arch_rwlock_t *tlock,
+			      struct vmm_lockstat_lock *ls);
+void vmm_lockstat_mutex_acquired(struct vmm_lockstat_lock *ls,
+				 bool contended, u64 wait_start);
+void vmm_lockstat_mutex_released(struct vmm_lockstat_lock *ls);
+
+/** Current timestamp used for lock wait times */
+u64 vmm_lockstat_timestamp(void);
+
+/** Printable name of lock class type */
+const char *vmm_lockstat_type_name(enum vmm_lockstat_types type);
+
+/** Number of lock classes seen so far */
+u32 vmm_lockstat_class_count(void);
+
+/** Iterate over lock classes with counters summed over all CPUs */
+int vmm_lockstat_iterate(int (*iter)(struct vmm_lockstat_info *info,
+				     void *priv),
+			 void *priv);
+
+/** Clear counters of all lock classes */
+void vmm_lockstat_reset(void);
+
+#endif
+
+#endif /* __VMM_LOCKSTAT_H__ */
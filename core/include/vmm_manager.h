@@ -52,18 +52,30 @@ enum vmm_region_flags {
 	VMM_REGION_ISCOLORED=0x00002000,
 	VMM_REGION_ISSHARED=0x00004000,
 	VMM_REGION_ISDYNAMIC=0x00008000,
+	VMM_REGION_POPULATE_EAGER=0x00010000,
+	VMM_REGION_POPULATE_FAULT_AROUND=0x00020000,
+	VMM_REGION_ISFILE=0x00040000,
 };
 
 #define VMM_REGION_MANIFEST_MASK	(VMM_REGION_REAL | \
 					 VMM_REGION_VIRTUAL | \
 					 VMM_REGION_ALIAS)
 
+#define VMM_REGION_POPULATE_MASK	(VMM_REGION_POPULATE_EAGER | \
+					 VMM_REGION_POPULATE_FAULT_AROUND)
+
+/* Default fault-around window (64 KB) for fault_around regions */
+#define VMM_REGION_DEF_FAULT_AROUND_ORDER	16
+
 enum vmm_region_mapping_flags {
 	VMM_REGION_MAPPING_ISHOSTRAM=0x00000001,
+	VMM_REGION_MAPPING_ISPOPULATED=0x00000002,
+	VMM_REGION_MAPPING_ISFILEPAGE=0x00000004,
 };
 
 struct vmm_region;
 struct vmm_region_mapping;
+struct vmm_guest_file;
 struct vmm_guest_aspace;
 struct vmm_vcpu_irqs;
 struct vmm_vcpu;
@@ -88,8 +100,11 @@ struct vmm_region {
 	struct vmm_shmem *shm;
 	u32 align_order;
 	u32 map_order;
+	u32 fault_around_order;
 	u32 maps_count;
 	struct vmm_region_mapping *maps;
+	struct vmm_guest_file *file;
+	u64 file_offset;
 	void *devemu_priv;
 	void *priv;
 };
@@ -104,6 +119,7 @@ struct vmm_region {
 #define VMM_REGION_ALIGN_ORDER(reg)	((reg)->align_order)
 #define VMM_REGION_MAP_ORDER(reg)	((reg)->map_order)
 #define VMM_REGION_MAPS_COUNT(reg)	((reg)->maps_count)
+#define VMM_REGION_FAULT_AROUND_ORDER(reg)	((reg)->fault_around_order)
 
 struct vmm_guest_aspace {
 	struct vmm_devtree_node *node;
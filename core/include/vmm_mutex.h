@@ -26,6 +26,7 @@
 
 #include <vmm_types.h>
 #include <vmm_waitqueue.h>
+#include <vmm_lockstat.h>
 
 /** Mutex lock structure */
 struct vmm_mutex {
@@ -33,6 +34,9 @@ struct vmm_mutex {
 	struct vmm_vcpu_resource res;
 	struct vmm_vcpu *owner;
 	struct vmm_waitqueue wq;
+#if defined(CONFIG_LOCKSTAT)
+	struct vmm_lockstat_lock ls;
+#endif
 };
 
 /** Cleanup callback for mutex when VCPU is destroyed
@@ -41,6 +45,16 @@ struct vmm_mutex {
 void __vmm_mutex_cleanup(struct vmm_vcpu *vcpu,
 			 struct vmm_vcpu_resource *vcpu_res);
 
+#if defined(CONFIG_LOCKSTAT)
+#define __MUTEX_LOCKSTAT_INIT(__mut) \
+	VMM_LOCKSTAT_INIT(&(__mut)->ls, __mut)
+#define __MUTEX_LOCKSTAT_INITIALIZER(__mut) \
+	.ls = VMM_LOCKSTAT_INITIALIZER(__mut),
+#else
+#define __MUTEX_LOCKSTAT_INIT(__mut)
+#define __MUTEX_LOCKSTAT_INITIALIZER(__mut)
+#endif
+
 /** Initialize mutex lock */
 #define INIT_MUTEX(__mut)	\
 do { \
@@ -49,6 +63,7 @@ do { \
 	(__mut)->res.cleanup = __vmm_mutex_cleanup; \
 	(__mut)->owner = NULL; \
 	INIT_WAITQUEUE(&(__mut)->wq, (__mut)); \
+	__MUTEX_LOCKSTAT_INIT(__mut); \
 } while (0)
 
 #define __MUTEX_INITIALIZER(__mut) \
@@ -57,6 +72,7 @@ do { \
 	.res = { .name = "vmm_mutex", .cleanup = __vmm_mutex_cleanup }, \
 	.owner = NULL, \
 	.wq = __WAITQUEUE_INITIALIZER((__mut).wq, &(__mut)), \
+	__MUTEX_LOCKSTAT_INITIALIZER(__mut) \
 }
 
 #define DEFINE_MUTEX(__mut) \
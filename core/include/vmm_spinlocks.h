@@ -28,6 +28,7 @@
 #include <arch_cpu_irq.h>
 #include <arch_locks.h>
 #include <vmm_types.h>
+#include <vmm_lockstat.h>
 
 #if defined(CONFIG_SMP)
 
@@ -38,19 +39,75 @@
  */
 struct vmm_spinlock {
 	arch_spinlock_t __tlock;
+#if defined(CONFIG_LOCKSTAT)
+	struct vmm_lockstat_lock __ls;
+#endif
 };
 
+#if defined(CONFIG_LOCKSTAT)
+#define INIT_SPIN_LOCK(_lptr)		do { \
+					ARCH_SPIN_LOCK_INIT(&((_lptr)->__tlock)); \
+					VMM_LOCKSTAT_INIT(&((_lptr)->__ls), _lptr); \
+					} while (0)
+#define __SPINLOCK_INITIALIZER(_lock) 	\
+		{ .__tlock = ARCH_SPIN_LOCK_INITIALIZER, \
+		  .__ls = VMM_LOCKSTAT_INITIALIZER(_lock), }
+#else
 #define INIT_SPIN_LOCK(_lptr)		ARCH_SPIN_LOCK_INIT(&((_lptr)->__tlock))
 #define __SPINLOCK_INITIALIZER(_lock) 	\
 		{ .__tlock = ARCH_SPIN_LOCK_INITIALIZER, }
+#endif
 
 struct vmm_rwlock {
 	arch_rwlock_t __tlock;
+#if defined(CONFIG_LOCKSTAT)
+	struct vmm_lockstat_lock __ls;
+#endif
 };
 
+#if defined(CONFIG_LOCKSTAT)
+#define INIT_RW_LOCK(_lptr)		do { \
+					ARCH_RW_LOCK_INIT(&((_lptr)->__tlock)); \
+					VMM_LOCKSTAT_INIT(&((_lptr)->__ls), _lptr); \
+					} while (0)
+#define __RWLOCK_INITIALIZER(_lock) 	\
+		{ .__tlock = ARCH_RW_LOCK_INITIALIZER, \
+		  .__ls = VMM_LOCKSTAT_INITIALIZER(_lock), }
+#else
 #define INIT_RW_LOCK(_lptr)		ARCH_RW_LOCK_INIT(&((_lptr)->__tlock))
 #define __RWLOCK_INITIALIZER(_lock) 	\
 		{ .__tlock = ARCH_RW_LOCK_INITIALIZER, }
+#endif
+
+/* Lock primitives used by all spinlock and rwlock variants below */
+#if defined(CONFIG_LOCKSTAT)
+#define __vmm_spin_lock(lock)		\
+		vmm_lockstat_spin_lock(&(lock)->__tlock, &(lock)->__ls)
+#define __vmm_spin_trylock(lock)	\
+		vmm_lockstat_spin_trylock(&(lock)->__tlock, &(lock)->__ls)
+#define __vmm_spin_unlock(lock)		\
+		vmm_lockstat_spin_unlock(&(lock)->__tlock, &(lock)->__ls)
+#define __vmm_write_lock(lock)		\
+		vmm_lockstat_write_lock(&(lock)->__tlock, &(lock)->__ls)
+#define __vmm_write_trylock(lock)	\
+		vmm_lockstat_write_trylock(&(lock)->__tlock, &(lock)->__ls)
+#define __vmm_write_unlock(lock)	\
+		vmm_lockstat_write_unlock(&(lock)->__tlock, &(lock)->__ls)
+#define __vmm_read_lock(lock)		\
+		vmm_lockstat_read_lock(&(lock)->__tlock, &(lock)->__ls)
+#define __vmm_read_trylock(lock)	\
+		vmm_lockstat_read_trylock(&(lock)->__tlock, &(lock)->__ls)
+#else
+#define __vmm_spin_lock(lock)		arch_spin_lock(&(lock)->__tlock)
+#define __vmm_spin_trylock(lock)	arch_spin_trylock(&(lock)->__tlock)
+#define __vmm_spin_unlock(lock)		arch_spin_unlock(&(lock)->__tlock)
+#define __vmm_write_lock(lock)		arch_write_lock(&(lock)->__tlock)
+#define __vmm_write_trylock(lock)	arch_write_trylock(&(lock)->__tlock)
+#define __vmm_write_unlock(lock)	arch_write_unlock(&(lock)->__tlock)
+#define __vmm_read_lock(lock)		arch_read_lock(&(lock)->__tlock)
+#define __vmm_read_trylock(lock)	arch_read_trylock(&(lock)->__tlock)
+#endif
+#define __vmm_read_unlock(lock)		arch_read_unlock(&(lock)->__tlock)
 
 #else
 
@@ -104,15 +161,15 @@ extern void vmm_scheduler_preempt_enable(void);
 #if defined(CONFIG_SMP)
 #define vmm_spin_lock(lock)		do { \
 					vmm_scheduler_preempt_disable(); \
-					arch_spin_lock(&(lock)->__tlock); \
+					__vmm_spin_lock(lock); \
 					} while (0)
 #define vmm_write_lock(lock)		do { \
 					vmm_scheduler_preempt_disable(); \
-					arch_write_lock(&(lock)->__tlock); \
+					__vmm_write_lock(lock); \
 					} while (0)
 #define vmm_read_lock(lock)		do { \
 					vmm_scheduler_preempt_disable(); \
-					arch_read_lock(&(lock)->__tlock); \
+					__vmm_read_lock(lock); \
 					} while (0)
 #else
 #define vmm_spin_lock(lock)		do { \
@@ -130,7 +187,7 @@ extern void vmm_scheduler_preempt_enable(void);
 #define vmm_spin_trylock(lock)		({ \
 					int ret; \
 					vmm_scheduler_preempt_disable(); \
-					ret = arch_spin_trylock(&(lock)->__tlock); \
+					ret = __vmm_spin_trylock(lock); \
 					if (!ret) { \
 						vmm_scheduler_preempt_enable(); \
 					} \
@@ -139,7 +196,7 @@ extern void vmm_scheduler_preempt_enable(void);
 #define vmm_write_trylock(lock)		({ \
 					int ret; \
 					vmm_scheduler_preempt_disable(); \
-					ret = arch_write_trylock(&(lock)->__tlock); \
+					ret = __vmm_write_trylock(lock); \
 					if (!ret) { \
 						vmm_scheduler_preempt_enable(); \
 					} \
@@ -148,7 +205,7 @@ extern void vmm_scheduler_preempt_enable(void);
 #define vmm_read_trylock(lock)		({ \
 					int ret; \
 					vmm_scheduler_preempt_disable(); \
-					ret = arch_read_trylock(&(lock)->__tlock); \
+					ret = __vmm_read_trylock(lock); \
 					if (!ret) { \
 						vmm_scheduler_preempt_enable(); \
 					} \
@@ -176,15 +233,15 @@ extern void vmm_scheduler_preempt_enable(void);
  */
 #if defined(CONFIG_SMP)
 #define vmm_spin_unlock(lock)		do { \
-					arch_spin_unlock(&(lock)->__tlock); \
+					__vmm_spin_unlock(lock); \
 					vmm_scheduler_preempt_enable(); \
 					} while (0)
 #define vmm_write_unlock(lock)		do { \
-					arch_write_unlock(&(lock)->__tlock); \
+					__vmm_write_unlock(lock); \
 					vmm_scheduler_preempt_enable(); \
 					} while (0)
 #define vmm_read_unlock(lock)		do { \
-					arch_read_unlock(&(lock)->__tlock); \
+					__vmm_read_unlock(lock); \
 					vmm_scheduler_preempt_enable(); \
 					} while (0)
 #else
@@ -201,13 +258,13 @@ extern void vmm_scheduler_preempt_enable(void);
  */
 #if defined(CONFIG_SMP)
 #define vmm_spin_lock_lite(lock)	do { \
-					arch_spin_lock(&(lock)->__tlock); \
+					__vmm_spin_lock(lock); \
 					} while (0)
 #define vmm_write_lock_lite(lock)	do { \
-					arch_write_lock(&(lock)->__tlock); \
+					__vmm_write_lock(lock); \
 					} while (0)
 #define vmm_read_lock_lite(lock)	do { \
-					arch_read_lock(&(lock)->__tlock); \
+					__vmm_read_lock(lock); \
 					} while (0)
 #else
 #define vmm_spin_lock_lite(lock)	do { \
@@ -222,13 +279,13 @@ extern void vmm_scheduler_preempt_enable(void);
  */
 #if defined(CONFIG_SMP)
 #define vmm_spin_unlock_lite(lock)	do { \
-					arch_spin_unlock(&(lock)->__tlock); \
+					__vmm_spin_unlock(lock); \
 					} while (0)
 #define vmm_write_unlock_lite(lock)	do { \
-					arch_write_unlock(&(lock)->__tlock); \
+					__vmm_write_unlock(lock); \
 					} while (0)
 #define vmm_read_unlock_lite(lock)	do { \
-					arch_read_unlock(&(lock)->__tlock); \
+					__vmm_read_unlock(lock); \
 					} while (0)
 #else
 #define vmm_spin_unlock_lite(lock)	do { \
@@ -245,17 +302,17 @@ extern void vmm_scheduler_preempt_enable(void);
 #define vmm_spin_lock_irq(lock) 	do { \
 					arch_cpu_irq_disable(); \
 					vmm_scheduler_preempt_disable(); \
-					arch_spin_lock(&(lock)->__tlock); \
+					__vmm_spin_lock(lock); \
 					} while (0)
 #define vmm_write_lock_irq(lock) 	do { \
 					arch_cpu_irq_disable(); \
 					vmm_scheduler_preempt_disable(); \
-					arch_write_lock(&(lock)->__tlock); \
+					__vmm_write_lock(lock); \
 					} while (0)
 #define vmm_read_lock_irq(lock) 	do { \
 					arch_cpu_irq_disable(); \
 					vmm_scheduler_preempt_disable(); \
-					arch_read_lock(&(lock)->__tlock); \
+					__vmm_read_lock(lock); \
 					} while (0)
 #else
 #define vmm_spin_lock_irq(lock) 	do { \
@@ -272,17 +329,17 @@ extern void vmm_scheduler_preempt_enable(void);
  */
 #if defined(CONFIG_SMP)
 #define vmm_spin_unlock_irq(lock)	do { \
-					arch_spin_unlock(&(lock)->__tlock); \
+					__vmm_spin_unlock(lock); \
 					vmm_scheduler_preempt_enable(); \
 					arch_cpu_irq_enable(); \
 					} while (0)
 #define vmm_write_unlock_irq(lock)	do { \
-					arch_write_unlock(&(lock)->__tlock); \
+					__vmm_write_unlock(lock); \
 					vmm_scheduler_preempt_enable(); \
 					arch_cpu_irq_enable(); \
 					} while (0)
 #define vmm_read_unlock_irq(lock)	do { \
-					arch_read_unlock(&(lock)->__tlock); \
+					__vmm_read_unlock(lock); \
 					vmm_scheduler_preempt_enable(); \
 					arch_cpu_irq_enable(); \
 					} while (0)
@@ -306,7 +363,7 @@ extern void vmm_scheduler_preempt_enable(void);
 					int ret; \
 					arch_cpu_irq_save((flags)); \
 					vmm_scheduler_preempt_disable(); \
-					ret = arch_spin_trylock(&(lock)->__tlock); \
+					ret = __vmm_spin_trylock(lock); \
 					if (!ret) { \
 						vmm_scheduler_preempt_enable(); \
 						arch_cpu_irq_restore(flags); \
@@ -318,7 +375,7 @@ extern void vmm_scheduler_preempt_enable(void);
 					int ret; \
 					arch_cpu_irq_save((flags)); \
 					vmm_scheduler_preempt_disable(); \
-					ret = arch_write_trylock(&(lock)->__tlock); \
+					ret = __vmm_write_trylock(lock); \
 					if (!ret) { \
 						vmm_scheduler_preempt_enable(); \
 						arch_cpu_irq_restore(flags); \
@@ -330,7 +387,7 @@ extern void vmm_scheduler_preempt_enable(void);
 					int ret; \
 					arch_cpu_irq_save((flags)); \
 					vmm_scheduler_preempt_disable(); \
-					ret = arch_read_trylock(&(lock)->__tlock); \
+					ret = __vmm_read_trylock(lock); \
 					if (!ret) { \
 						vmm_scheduler_preempt_enable(); \
 						arch_cpu_irq_restore(flags); \
@@ -368,19 +425,19 @@ extern void vmm_scheduler_preempt_enable(void);
 					do { \
 					arch_cpu_irq_save((flags)); \
 					vmm_scheduler_preempt_disable(); \
-					arch_spin_lock(&(lock)->__tlock); \
+					__vmm_spin_lock(lock); \
 					} while (0)
 #define vmm_write_lock_irqsave(lock, flags) \
 					do { \
 					arch_cpu_irq_save((flags)); \
 					vmm_scheduler_preempt_disable(); \
-					arch_write_lock(&(lock)->__tlock); \
+					__vmm_write_lock(lock); \
 					} while (0)
 #define vmm_read_lock_irqsave(lock, flags) \
 					do { \
 					arch_cpu_irq_save((flags)); \
 					vmm_scheduler_preempt_disable(); \
-					arch_read_lock(&(lock)->__tlock); \
+					__vmm_read_lock(lock); \
 					} while (0)
 #else
 #define vmm_spin_lock_irqsave(lock, flags) \
@@ -400,19 +457,19 @@ extern void vmm_scheduler_preempt_enable(void);
 #if defined(CONFIG_SMP)
 #define vmm_spin_unlock_irqrestore(lock, flags)	\
 					do { \
-					arch_spin_unlock(&(lock)->__tlock); \
+					__vmm_spin_unlock(lock); \
 					vmm_scheduler_preempt_enable(); \
 					arch_cpu_irq_restore(flags); \
 					} while (0)
 #define vmm_write_unlock_irqrestore(lock, flags)	\
 					do { \
-					arch_write_unlock(&(lock)->__tlock); \
+					__vmm_write_unlock(lock); \
 					vmm_scheduler_preempt_enable(); \
 					arch_cpu_irq_restore(flags); \
 					} while (0)
 #define vmm_read_unlock_irqrestore(lock, flags)	\
 					do { \
-					arch_read_unlock(&(lock)->__tlock); \
+					__vmm_read_unlock(lock); \
 					vmm_scheduler_preempt_enable(); \
 					arch_cpu_irq_restore(flags); \
 					} while (0)
@@ -434,17 +491,17 @@ extern void vmm_scheduler_preempt_enable(void);
 #define vmm_spin_lock_irqsave_lite(lock, flags) \
 					do { \
 					arch_cpu_irq_save((flags)); \
-					arch_spin_lock(&(lock)->__tlock); \
+					__vmm_spin_lock(lock); \
 					} while (0)
 #define vmm_write_lock_irqsave_lite(lock, flags) \
 					do { \
 					arch_cpu_irq_save((flags)); \
-					arch_write_lock(&(lock)->__tlock); \
+					__vmm_write_lock(lock); \
 					} while (0)
 #define vmm_read_lock_irqsave_lite(lock, flags) \
 					do { \
 					arch_cpu_irq_save((flags)); \
-					arch_read_lock(&(lock)->__tlock); \
+					__vmm_read_lock(lock); \
 					} while (0)
 #else
 #define vmm_spin_lock_irqsave_lite(lock, flags) \
@@ -463,17 +520,17 @@ extern void vmm_scheduler_preempt_enable(void);
 #if defined(CONFIG_SMP)
 #define vmm_spin_unlock_irqrestore_lite(lock, flags)	\
 					do { \
-					arch_spin_unlock(&(lock)->__tlock); \
+					__vmm_spin_unlock(lock); \
 					arch_cpu_irq_restore(flags); \
 					} while (0)
 #define vmm_write_unlock_irqrestore_lite(lock, flags)	\
 					do { \
-					arch_write_unlock(&(lock)->__tlock); \
+					__vmm_write_unlock(lock); \
 					arch_cpu_irq_restore(flags); \
 					} while (0)
 #define vmm_read_unlock_irqrestore_lite(lock, flags)	\
 					do { \
-					arch_read_unlock(&(lock)->__tlock); \
+					__vmm_read_unlock(lock); \
 					arch_cpu_irq_restore(flags); \
 					} while (0)
 #else
@@ -24,6 +24,7 @@
 core-objs-$(CONFIG_NET)+= net/vmm_netcore.o
 
 vmm_netcore-y += vmm_mbuf.o
+vmm_netcore-y += vmm_mbuf_offload.o
 vmm_netcore-y += vmm_net.o
 vmm_netcore-y += vmm_netswitch.o
 vmm_netcore-y += vmm_netport.o
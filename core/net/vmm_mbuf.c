@@ -288,6 +288,12 @@ struct vmm_mbuf *m_get(int nowait, int flags)
 	m->m_flags = flags;
 	if (flags & M_PKTHDR) {
 		m->m_pktlen = 0;
+		m->m_csum_flags = 0;
+		m->m_csum_start = 0;
+		m->m_csum_offset = 0;
+		m->m_gso_type = M_GSO_NONE;
+		m->m_gso_size = 0;
+		m->m_hdr_len = 0;
 	}
 	m->m_ref = 1;
 
@@ -361,7 +367,7 @@ void m_ext_dma_ensure(struct vmm_mbuf *m)
 	}
 
 	buf = vmm_dma_malloc(m->m_len);
-	memcpy(buf, m->m_extbuf, m->m_len);
+	memcpy(buf, m->m_data, m->m_len);
 	if (m->m_extfree) {
 		m->m_extfree(m, m->m_extbuf, m->m_extlen, m->m_extarg);
 	} else {
@@ -411,12 +417,44 @@ void m_freem(struct vmm_mbuf *m)
 	if (m == NULL)
 		return;
 	do {
-		MFREE(m, n);
+		/* Rest of chain stays with mbuf while it is referenced */
+		n = (m->m_ref > 1) ? NULL : m->m_next;
+		m_ext_free(m);
 		m = n;
 	} while (m);
 }
 VMM_EXPORT_SYMBOL(m_freem);
 
+/*
+ * m_dup: Make a deep copy of a packet with its packet header, flattening
+ * the mbuf chain into a single external storage buffer.
+ */
+struct vmm_mbuf *m_dup(struct vmm_mbuf *m)
+{
+	struct vmm_mbuf *n;
+
+	if (!m || !(m->m_flags & M_PKTHDR)) {
+		return NULL;
+	}
+
+	MGETHDR(n, 0, 0);
+	if (!n) {
+		return NULL;
+	}
+
+	if (!m_ext_get(n, m->m_pktlen, VMM_MBUF_ALLOC_DEFAULT)) {
+		m_freem(n);
+		return NULL;
+	}
+
+	m_copydata(m, 0, m->m_pktlen, mtod(n, void *));
+	n->m_len = m->m_pktlen;
+	n->m_pkthdr = m->m_pkthdr;
+
+	return n;
+}
+VMM_EXPORT_SYMBOL(m_dup);
+
 static void mbuf_data_dump(char *buf, unsigned int buflen)
 {
 	int index;
@@ -444,6 +482,10 @@ void m_dump(struct vmm_mbuf *m)
 	vmm_printf("  MBuf flags:    0x%x\n", m->m_flags);
 	vmm_printf("MBuf packet\n");
 	vmm_printf("  MBuf len:      %d\n", m->m_pktlen);
+	vmm_printf("  MBuf csum:     0x%x start=%d offset=%d\n",
+		   m->m_csum_flags, m->m_csum_start, m->m_csum_offset);
+	vmm_printf("  MBuf gso:      0x%x size=%d hdr_len=%d\n",
+		   m->m_gso_type, m->m_gso_size, m->m_hdr_len);
 	vmm_printf("MBuf ext\n");
 	vmm_printf("  MBuf buf:      %p\n", m->m_extbuf);
 	vmm_printf("  MBuf len:      %d\n", m->m_extlen);
@@ -0,0 +1,810 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_mbuf_offload.c
+ * @author agent (agent@local)
+ * @brief Software checksum and segmentation offload for mbufs
+ *
+ * Ports which can handle partially checksummed frames or GSO super
+ * frames receive them as-is from the netswitch. For all other ports
+ * the netswitch uses the routines below to complete the checksum or
+ * to split the super frame into MTU sized frames.
+ *
+ * In the receive direction, GRO coalesces in-order TCP segments of
+ * the same flow into a GSO super frame so that fewer and larger frames
+ * travel through the netswitch.
+ */
+
+#include <vmm_error.h>
+#include <vmm_types.h>
+#include <vmm_stdio.h>
+#include <vmm_modules.h>
+#include <net/vmm_mbuf.h>
+#include <net/vmm_protocol.h>
+#include <libs/list.h>
+#include <libs/stringlib.h>
+
+#define OFFLOAD_ETH_P_IP		0x0800
+#define OFFLOAD_ETH_P_IPV6		0x86DD
+#define OFFLOAD_ETH_P_8021Q		0x8100
+#define OFFLOAD_VLAN_HLEN		4
+
+#define OFFLOAD_IPPROTO_TCP		6
+#define OFFLOAD_IPPROTO_UDP		17
+
+#define OFFLOAD_IP_MF			0x2000
+
+#define OFFLOAD_TCP_FIN			0x01
+#define OFFLOAD_TCP_SYN			0x02
+#define OFFLOAD_TCP_RST			0x04
+#define OFFLOAD_TCP_PSH			0x08
+#define OFFLOAD_TCP_ACK			0x10
+#define OFFLOAD_TCP_URG			0x20
+#define OFFLOAD_TCP_CWR			0x80
+
+/* TCP flags which always end coalescing of a flow */
+#define GRO_TCP_FLUSH_FLAGS		(OFFLOAD_TCP_FIN | OFFLOAD_TCP_SYN | \
+					 OFFLOAD_TCP_RST | OFFLOAD_TCP_URG | \
+					 OFFLOAD_TCP_CWR)
+
+struct offload_hdrs {
+	u16 l3_proto;
+	u8 l4_proto;
+	u32 l3_off;
+	u32 l4_off;
+	u32 payload_off;
+};
+
+static inline u16 rd_be16(const u8 *p)
+{
+	return ((u16)p[0] << 8) | p[1];
+}
+
+static inline void wr_be16(u8 *p, u16 val)
+{
+	p[0] = (val >> 8) & 0xff;
+	p[1] = val & 0xff;
+}
+
+static inline u32 rd_be32(const u8 *p)
+{
+	return ((u32)p[0] << 24) | ((u32)p[1] << 16) |
+	       ((u32)p[2] << 8) | p[3];
+}
+
+static inline void wr_be32(u8 *p, u32 val)
+{
+	p[0] = (val >> 24) & 0xff;
+	p[1] = (val >> 16) & 0xff;
+	p[2] = (val >> 8) & 0xff;
+	p[3] = val & 0xff;
+}
+
+static u32 csum_add(const u8 *buf, u32 len, u32 sum)
+{
+	while (len > 1) {
+		sum += ((u32)buf[0] << 8) | buf[1];
+		buf += 2;
+		len -= 2;
+	}
+	if (len) {
+		sum += (u32)buf[0] << 8;
+	}
+
+	return sum;
+}
+
+static u16 csum_fold(u32 sum)
+{
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return (u16)~sum;
+}
+
+/* Zero in UDP checksum field means "no checksum" so transmit the
+ * equivalent all-ones value instead.
+ */
+static u16 csum_fold_l4(u32 sum)
+{
+	u16 csum = csum_fold(sum);
+
+	return (csum) ? csum : 0xffff;
+}
+
+static u32 csum_pseudo(const u8 *l3, const struct offload_hdrs *h,
+		       u32 l4_len)
+{
+	u32 sum = 0;
+
+	if (h->l3_proto == OFFLOAD_ETH_P_IP) {
+		sum = csum_add(ip_srcaddr(l3), 4, sum);
+		sum = csum_add(ip_dstaddr(l3), 4, sum);
+	} else {
+		sum = csum_add(ip6_srcaddr(l3), 16, sum);
+		sum = csum_add(ip6_dstaddr(l3), 16, sum);
+	}
+	sum += h->l4_proto;
+	sum += l4_len & 0xffff;
+	sum += l4_len >> 16;
+
+	return sum;
+}
+
+static int offload_parse(const u8 *data, u32 len, struct offload_hdrs *h)
+{
+	u32 ihl;
+
+	if (len < ETHER_HLEN) {
+		return VMM_EINVALID;
+	}
+
+	h->l3_off = ETHER_HLEN;
+	h->l3_proto = ether_type(data);
+	if (h->l3_proto == OFFLOAD_ETH_P_8021Q) {
+		if (len < (ETHER_HLEN + OFFLOAD_VLAN_HLEN)) {
+			return VMM_EINVALID;
+		}
+		h->l3_proto = rd_be16(data + ETHER_HLEN + 2);
+		h->l3_off += OFFLOAD_VLAN_HLEN;
+	}
+
+	switch (h->l3_proto) {
+	case OFFLOAD_ETH_P_IP:
+		if (len < (h->l3_off + IP4_HLEN)) {
+			return VMM_EINVALID;
+		}
+		ihl = (data[h->l3_off] & 0xf) * 4;
+		if (ihl < IP4_HLEN) {
+			return VMM_EINVALID;
+		}
+		h->l4_proto = ip_protocol(data + h->l3_off);
+		h->l4_off = h->l3_off + ihl;
+		break;
+	case OFFLOAD_ETH_P_IPV6:
+		if (len < (h->l3_off + IP6_HLEN)) {
+			return VMM_EINVALID;
+		}
+		/* IPv6 extension headers are not supported */
+		h->l4_proto = ip6_nexthdr(data + h->l3_off);
+		h->l4_off = h->l3_off + IP6_HLEN;
+		break;
+	default:
+		return VMM_EPROTONOSUPPORT;
+	};
+
+	switch (h->l4_proto) {
+	case OFFLOAD_IPPROTO_TCP:
+		if (len < (h->l4_off + TCP_HLEN)) {
+			return VMM_EINVALID;
+		}
+		h->payload_off = h->l4_off + (data[h->l4_off + 12] >> 4) * 4;
+		if (h->payload_off < (h->l4_off + TCP_HLEN)) {
+			return VMM_EINVALID;
+		}
+		break;
+	case OFFLOAD_IPPROTO_UDP:
+		h->payload_off = h->l4_off + UDP_HLEN;
+		break;
+	default:
+		return VMM_EPROTONOSUPPORT;
+	};
+
+	if (len < h->payload_off) {
+		return VMM_EINVALID;
+	}
+
+	return VMM_OK;
+}
+
+static void offload_fix_ip4_csum(u8 *l3)
+{
+	struct ip_header *ip = (struct ip_header *)l3;
+	u32 ihl = (l3[0] & 0xf) * 4;
+
+	ip->ipchksum = 0;
+	wr_be16((u8 *)&ip->ipchksum, csum_fold(csum_add(l3, ihl, 0)));
+}
+
+static struct vmm_mbuf *offload_alloc(u32 len)
+{
+	struct vmm_mbuf *m;
+
+	MGETHDR(m, 0, 0);
+	if (!m) {
+		return NULL;
+	}
+
+	if (!m_ext_get(m, len, VMM_MBUF_ALLOC_DEFAULT)) {
+		m_freem(m);
+		return NULL;
+	}
+
+	m->m_len = m->m_pktlen = len;
+	m->m_csum_flags = M_CSUM_VALID;
+
+	return m;
+}
+
+static void offload_free_list(struct dlist *segs)
+{
+	struct vmm_mbuf *m;
+
+	while (!list_empty(segs)) {
+		m = m_list_entry(list_pop(segs));
+		m_freem(m);
+	}
+}
+
+/*
+ * m_csum_complete: Complete a partial checksum in place. The checksum
+ * field must already hold the pseudo header sum as is the convention
+ * for partially checksummed frames.
+ */
+int m_csum_complete(struct vmm_mbuf *m)
+{
+	u8 *data;
+	u32 start, off;
+
+	if (!m) {
+		return VMM_EINVALID;
+	}
+	if (!(m->m_csum_flags & M_CSUM_PARTIAL)) {
+		return VMM_OK;
+	}
+	if (m->m_next) {
+		return VMM_ENOTSUPP;
+	}
+
+	data = mtod(m, u8 *);
+	start = m->m_csum_start;
+	off = start + m->m_csum_offset;
+	if ((m->m_len < start) || (m->m_len < (off + 2))) {
+		return VMM_EINVALID;
+	}
+
+	wr_be16(data + off, csum_fold_l4(csum_add(data + start,
+						  m->m_len - start, 0)));
+
+	m->m_csum_flags &= ~M_CSUM_PARTIAL;
+	m->m_csum_flags |= M_CSUM_VALID;
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(m_csum_complete);
+
+static int offload_tcp_segment(struct vmm_mbuf *m,
+			       const struct offload_hdrs *h,
+			       struct dlist *segs)
+{
+	u8 *data = mtod(m, u8 *), *sd, *tcp;
+	u16 ipid = 0;
+	u32 i, pos, seglen, plen, l4_len, seq, mss = m->m_gso_size;
+	struct vmm_mbuf *s;
+
+	plen = m->m_len - h->payload_off;
+	seq = rd_be32(data + h->l4_off + 4);
+	if (h->l3_proto == OFFLOAD_ETH_P_IP) {
+		ipid = rd_be16(data + h->l3_off + 4);
+	}
+
+	for (i = 0, pos = 0; pos < plen; i++, pos += mss) {
+		seglen = ((plen - pos) < mss) ? (plen - pos) : mss;
+
+		s = offload_alloc(h->payload_off + seglen);
+		if (!s) {
+			offload_free_list(segs);
+			return VMM_ENOMEM;
+		}
+		sd = mtod(s, u8 *);
+		memcpy(sd, data, h->payload_off);
+		memcpy(sd + h->payload_off, data + h->payload_off + pos, seglen);
+
+		l4_len = s->m_len - h->l4_off;
+		if (h->l3_proto == OFFLOAD_ETH_P_IP) {
+			wr_be16(sd + h->l3_off + 2, s->m_len - h->l3_off);
+			wr_be16(sd + h->l3_off + 4, ipid + i);
+			offload_fix_ip4_csum(sd + h->l3_off);
+		} else {
+			wr_be16(sd + h->l3_off + 4, l4_len);
+		}
+
+		tcp = sd + h->l4_off;
+		wr_be32(tcp + 4, seq + pos);
+		if ((pos + seglen) < plen) {
+			tcp[13] &= ~(OFFLOAD_TCP_FIN | OFFLOAD_TCP_PSH);
+		}
+		if (i) {
+			tcp[13] &= ~OFFLOAD_TCP_CWR;
+		}
+		wr_be16(tcp + 16, 0);
+		wr_be16(tcp + 16,
+			csum_fold(csum_add(tcp, l4_len,
+				  csum_pseudo(sd + h->l3_off, h, l4_len))));
+
+		list_add_tail(&s->m_list, segs);
+	}
+
+	return VMM_OK;
+}
+
+static int offload_udp_fragment(struct vmm_mbuf *m,
+				const struct offload_hdrs *h,
+				struct dlist *segs)
+{
+	u8 *data = mtod(m, u8 *), *sd;
+	u16 udp_csum = 0;
+	u32 pos, fraglen, plen, fs = m->m_gso_size & ~0x7;
+	struct vmm_mbuf *s;
+
+	if (h->l3_proto != OFFLOAD_ETH_P_IP || !fs) {
+		return VMM_EPROTONOSUPPORT;
+	}
+
+	/* UDP checksum covers the whole datagram so compute it up-front */
+	if (m->m_csum_flags & M_CSUM_PARTIAL) {
+		if ((m->m_csum_start + m->m_csum_offset + 2) != (h->l4_off + 8)) {
+			return VMM_EINVALID;
+		}
+		udp_csum = csum_fold_l4(csum_add(data + m->m_csum_start,
+					m->m_len - m->m_csum_start, 0));
+	} else {
+		udp_csum = rd_be16(data + h->l4_off + 6);
+	}
+
+	plen = m->m_len - h->l4_off;
+	for (pos = 0; pos < plen; pos += fs) {
+		fraglen = ((plen - pos) < fs) ? (plen - pos) : fs;
+
+		s = offload_alloc(h->l4_off + fraglen);
+		if (!s) {
+			offload_free_list(segs);
+			return VMM_ENOMEM;
+		}
+		sd = mtod(s, u8 *);
+		memcpy(sd, data, h->l4_off);
+		memcpy(sd + h->l4_off, data + h->l4_off + pos, fraglen);
+
+		if (!pos) {
+			wr_be16(sd + h->l4_off + 6, udp_csum);
+		}
+
+		wr_be16(sd + h->l3_off + 2, s->m_len - h->l3_off);
+		wr_be16(sd + h->l3_off + 6, (pos >> 3) |
+			(((pos + fraglen) < plen) ? OFFLOAD_IP_MF : 0));
+		offload_fix_ip4_csum(sd + h->l3_off);
+
+		list_add_tail(&s->m_list, segs);
+	}
+
+	return VMM_OK;
+}
+
+/*
+ * m_gso_segment: Split a GSO super frame into a list of frames carrying
+ * at most gso_size bytes of payload each. The source mbuf is left
+ * untouched so that it can still be delivered as-is to other ports.
+ */
+int m_gso_segment(struct vmm_mbuf *m, struct dlist *segs)
+{
+	int rc;
+	struct offload_hdrs h;
+
+	if (!m || !segs) {
+		return VMM_EINVALID;
+	}
+	if (!M_IS_GSO(m) || !m->m_gso_size) {
+		return VMM_EINVALID;
+	}
+	if (m->m_next) {
+		return VMM_ENOTSUPP;
+	}
+
+	rc = offload_parse(mtod(m, u8 *), m->m_len, &h);
+	if (rc) {
+		return rc;
+	}
+
+	switch (M_GSO_TYPE(m)) {
+	case M_GSO_TCPV4:
+		if ((h.l3_proto != OFFLOAD_ETH_P_IP) ||
+		    (h.l4_proto != OFFLOAD_IPPROTO_TCP)) {
+			return VMM_EINVALID;
+		}
+		return offload_tcp_segment(m, &h, segs);
+	case M_GSO_TCPV6:
+		if ((h.l3_proto != OFFLOAD_ETH_P_IPV6) ||
+		    (h.l4_proto != OFFLOAD_IPPROTO_TCP)) {
+			return VMM_EINVALID;
+		}
+		return offload_tcp_segment(m, &h, segs);
+	case M_GSO_UDP:
+		if (h.l4_proto != OFFLOAD_IPPROTO_UDP) {
+			return VMM_EINVALID;
+		}
+		return offload_udp_fragment(m, &h, segs);
+	default:
+		break;
+	};
+
+	return VMM_EPROTONOSUPPORT;
+}
+VMM_EXPORT_SYMBOL(m_gso_segment);
+
+static u32 flow_hash_mix(u32 hash, const u8 *p, u32 len)
+{
+	u32 i;
+
+	for (i = 0; (i + 4) <= len; i += 4) {
+		hash ^= rd_be32(p + i);
+		hash *= 0x9e3779b1;
+		hash ^= hash >> 15;
+	}
+
+	return hash;
+}
+
+u32 m_flow_hash(struct vmm_mbuf *m)
+{
+	int rc;
+	u8 *l3;
+	u32 hash = 0;
+	struct offload_hdrs h;
+
+	if (!m) {
+		return 0;
+	}
+
+	/* Only protocol headers in first mbuf are considered */
+	memset(&h, 0, sizeof(h));
+	rc = offload_parse(mtod(m, u8 *), m->m_len, &h);
+	if (rc && (rc != VMM_EPROTONOSUPPORT)) {
+		return 0;
+	}
+
+	l3 = mtod(m, u8 *) + h.l3_off;
+	switch (h.l3_proto) {
+	case OFFLOAD_ETH_P_IP:
+		hash = flow_hash_mix(h.l4_proto, l3 + 12, 8);
+		break;
+	case OFFLOAD_ETH_P_IPV6:
+		hash = flow_hash_mix(h.l4_proto, l3 + 8, 32);
+		break;
+	default:
+		return 0;
+	};
+
+	/* Ports are part of flow only when L4 header was parsed */
+	if (rc == VMM_OK) {
+		hash = flow_hash_mix(hash, mtod(m, u8 *) + h.l4_off, 4);
+	}
+
+	return hash;
+}
+VMM_EXPORT_SYMBOL(m_flow_hash);
+
+/* Parse TCP headers of frame and find its end excluding any padding */
+static int gro_parse(struct vmm_mbuf *m, struct offload_hdrs *h, u32 *end)
+{
+	int rc;
+	u8 *l3;
+	u32 l3_len;
+
+	rc = offload_parse(mtod(m, u8 *), m->m_len, h);
+	if (rc) {
+		return rc;
+	}
+	if (h->l4_proto != OFFLOAD_IPPROTO_TCP) {
+		return VMM_EPROTONOSUPPORT;
+	}
+
+	l3 = mtod(m, u8 *) + h->l3_off;
+	if (h->l3_proto == OFFLOAD_ETH_P_IP) {
+		/* IP options and fragments are not coalesced */
+		if ((h->l4_off - h->l3_off) != IP4_HLEN) {
+			return VMM_ENOTSUPP;
+		}
+		if (rd_be16(l3 + 6) & 0x3fff) {
+			return VMM_ENOTSUPP;
+		}
+		l3_len = rd_be16(l3 + 2);
+	} else {
+		l3_len = IP6_HLEN + rd_be16(l3 + 4);
+	}
+
+	/* Length fields of held super frame are fixed up on flush */
+	*end = (M_IS_GSO(m)) ? m->m_len : (h->l3_off + l3_len);
+	if ((*end < h->payload_off) || (m->m_len < *end)) {
+		return VMM_EINVALID;
+	}
+
+	return VMM_OK;
+}
+
+/* Check whether segment can be coalesced and verify its checksums */
+static bool gro_segment_ok(struct vmm_mbuf *m,
+			   const struct offload_hdrs *h, u32 end)
+{
+	u8 *data = mtod(m, u8 *), *tcp = data + h->l4_off;
+	u32 l4_len = end - h->l4_off;
+
+	if (end == h->payload_off) {
+		return FALSE;
+	}
+	if ((tcp[13] & GRO_TCP_FLUSH_FLAGS) || !(tcp[13] & OFFLOAD_TCP_ACK)) {
+		return FALSE;
+	}
+	if (m->m_csum_flags & M_CSUM_VALID) {
+		return TRUE;
+	}
+
+	if ((h->l3_proto == OFFLOAD_ETH_P_IP) &&
+	    csum_fold(csum_add(data + h->l3_off, IP4_HLEN, 0))) {
+		return FALSE;
+	}
+	if (csum_fold(csum_add(tcp, l4_len,
+			       csum_pseudo(data + h->l3_off, h, l4_len)))) {
+		return FALSE;
+	}
+	m->m_csum_flags |= M_CSUM_VALID;
+
+	return TRUE;
+}
+
+static bool gro_same_flow(struct vmm_mbuf *p, const struct offload_hdrs *hp,
+			  struct vmm_mbuf *m, const struct offload_hdrs *hm)
+{
+	u8 *pd = mtod(p, u8 *), *md = mtod(m, u8 *);
+
+	if ((hp->l3_proto != hm->l3_proto) || (hp->l3_off != hm->l3_off)) {
+		return FALSE;
+	}
+
+	/* Ethernet header including VLAN tag */
+	if (memcmp(pd, md, hp->l3_off)) {
+		return FALSE;
+	}
+
+	/* Source and destination address */
+	if (hp->l3_proto == OFFLOAD_ETH_P_IP) {
+		if (memcmp(pd + hp->l3_off + 12, md + hm->l3_off + 12, 8)) {
+			return FALSE;
+		}
+	} else {
+		if (memcmp(pd + hp->l3_off + 8, md + hm->l3_off + 8, 32)) {
+			return FALSE;
+		}
+	}
+
+	/* Source and destination port */
+	return memcmp(pd + hp->l4_off, md + hm->l4_off, 4) ? FALSE : TRUE;
+}
+
+static bool gro_can_merge(struct vmm_mbuf *p, const struct offload_hdrs *hp,
+			  u32 pend,
+			  struct vmm_mbuf *m, const struct offload_hdrs *hm,
+			  u32 mend)
+{
+	u8 *pl3 = mtod(p, u8 *) + hp->l3_off, *ml3 = mtod(m, u8 *) + hm->l3_off;
+	u8 *ptcp = mtod(p, u8 *) + hp->l4_off, *mtcp = mtod(m, u8 *) + hm->l4_off;
+	u32 mss, plen = mend - hm->payload_off;
+
+	mss = (M_IS_GSO(p)) ? p->m_gso_size : (pend - hp->payload_off);
+	if (plen > mss) {
+		return FALSE;
+	}
+
+	if (hp->l3_proto == OFFLOAD_ETH_P_IP) {
+		if ((pl3[1] != ml3[1]) || (pl3[8] != ml3[8])) {
+			return FALSE;
+		}
+	} else {
+		if (memcmp(pl3, ml3, 4) || (pl3[7] != ml3[7])) {
+			return FALSE;
+		}
+	}
+
+	/* Segment must directly follow the held data */
+	if (rd_be32(mtcp + 4) != (rd_be32(ptcp + 4) + (pend - hp->payload_off))) {
+		return FALSE;
+	}
+
+	/* Same ack, header length, flags (except PSH), window and options */
+	if (hp->payload_off != hm->payload_off) {
+		return FALSE;
+	}
+	if (memcmp(ptcp + 8, mtcp + 8, 5) ||
+	    ((ptcp[13] ^ mtcp[13]) & ~OFFLOAD_TCP_PSH) ||
+	    memcmp(ptcp + 14, mtcp + 14, 2) ||
+	    memcmp(ptcp + TCP_HLEN, mtcp + TCP_HLEN,
+		   hp->payload_off - hp->l4_off - TCP_HLEN)) {
+		return FALSE;
+	}
+
+	if ((pend + plen) > M_GRO_MAX_SIZE) {
+		return FALSE;
+	}
+	if (hp->l3_proto == OFFLOAD_ETH_P_IP) {
+		if ((pend + plen - hp->l3_off) > 0xffff) {
+			return FALSE;
+		}
+	} else {
+		if ((pend + plen - hp->l4_off) > 0xffff) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* Append segment payload to held frame. The first merge moves the held
+ * frame into a super frame buffer which replaces it on the flow list.
+ */
+static struct vmm_mbuf *gro_merge(struct vmm_mbuf *p,
+				  const struct offload_hdrs *hp, u32 pend,
+				  struct vmm_mbuf *m,
+				  const struct offload_hdrs *hm, u32 mend)
+{
+	u8 *nd;
+	u32 plen = mend - hm->payload_off;
+	struct vmm_mbuf *n = p;
+
+	if (!M_IS_GSO(p)) {
+		n = offload_alloc(M_GRO_MAX_SIZE);
+		if (!n) {
+			return NULL;
+		}
+		memcpy(mtod(n, u8 *), mtod(p, u8 *), pend);
+		n->m_len = n->m_pktlen = pend;
+		n->m_gso_type = (hp->l3_proto == OFFLOAD_ETH_P_IP) ?
+				M_GSO_TCPV4 : M_GSO_TCPV6;
+		n->m_gso_size = pend - hp->payload_off;
+		n->m_hdr_len = hp->payload_off;
+		list_add(&n->m_list, &p->m_list);
+		list_del(&p->m_list);
+		m_freem(p);
+	}
+
+	nd = mtod(n, u8 *);
+	memcpy(nd + n->m_len, mtod(m, u8 *) + hm->payload_off, plen);
+	n->m_len += plen;
+	n->m_pktlen = n->m_len;
+	nd[hp->l4_off + 13] |= mtod(m, u8 *)[hm->l4_off + 13] & OFFLOAD_TCP_PSH;
+
+	return n;
+}
+
+/* Fix up headers of super frame and leave TCP checksum partial */
+static void gro_complete(struct vmm_mbuf *m)
+{
+	u8 *l3;
+	u32 l4_len;
+	struct offload_hdrs h;
+
+	if (!M_IS_GSO(m) || offload_parse(mtod(m, u8 *), m->m_len, &h)) {
+		return;
+	}
+
+	l3 = mtod(m, u8 *) + h.l3_off;
+	l4_len = m->m_len - h.l4_off;
+	if (h.l3_proto == OFFLOAD_ETH_P_IP) {
+		wr_be16(l3 + 2, m->m_len - h.l3_off);
+		offload_fix_ip4_csum(l3);
+	} else {
+		wr_be16(l3 + 4, l4_len);
+	}
+
+	wr_be16(mtod(m, u8 *) + h.l4_off + 16,
+		~csum_fold(csum_pseudo(l3, &h, l4_len)));
+	m->m_csum_flags = M_CSUM_PARTIAL;
+	m->m_csum_start = h.l4_off;
+	m->m_csum_offset = 16;
+}
+
+static void gro_flush_one(struct vmm_mbuf_gro *g, struct vmm_mbuf *p,
+			  struct dlist *out)
+{
+	list_del(&p->m_list);
+	g->count--;
+	gro_complete(p);
+	list_add_tail(&p->m_list, out);
+}
+
+void m_gro_init(struct vmm_mbuf_gro *g)
+{
+	INIT_LIST_HEAD(&g->flows);
+	g->count = 0;
+}
+VMM_EXPORT_SYMBOL(m_gro_init);
+
+/*
+ * m_gro_receive: Offer a received frame to GRO context. Frames which
+ * are ready for delivery, including the offered frame when it cannot
+ * be held, are appended to the out list. Returns TRUE if the offered
+ * frame was held or merged by the GRO context.
+ */
+bool m_gro_receive(struct vmm_mbuf_gro *g, struct vmm_mbuf *m,
+		   struct dlist *out)
+{
+	bool ok;
+	u32 pend, mend;
+	struct vmm_mbuf *p, *n;
+	struct offload_hdrs hp, hm;
+
+	if (!(m->m_flags & M_PKTHDR) || m->m_next || M_IS_GSO(m) ||
+	    (m->m_csum_flags & M_CSUM_PARTIAL) || gro_parse(m, &hm, &mend)) {
+		list_add_tail(&m->m_list, out);
+		return FALSE;
+	}
+	ok = gro_segment_ok(m, &hm, mend);
+
+	list_for_each_entry(p, &g->flows, m_list) {
+		if (gro_parse(p, &hp, &pend) ||
+		    !gro_same_flow(p, &hp, m, &hm)) {
+			continue;
+		}
+
+		if (ok && gro_can_merge(p, &hp, pend, m, &hm, mend)) {
+			n = gro_merge(p, &hp, pend, m, &hm, mend);
+			if (n) {
+				/* Short or pushed segment ends the flow */
+				if (((mend - hm.payload_off) < n->m_gso_size) ||
+				    (mtod(m, u8 *)[hm.l4_off + 13] &
+							OFFLOAD_TCP_PSH)) {
+					gro_flush_one(g, n, out);
+				}
+				m_freem(m);
+				return TRUE;
+			}
+		}
+
+		/* Held frame must go out before this segment */
+		gro_flush_one(g, p, out);
+		break;
+	}
+
+	if (!ok || (mtod(m, u8 *)[hm.l4_off + 13] & OFFLOAD_TCP_PSH)) {
+		list_add_tail(&m->m_list, out);
+		return FALSE;
+	}
+
+	if (g->count >= M_GRO_MAX_FLOWS) {
+		p = list_first_entry(&g->flows, struct vmm_mbuf, m_list);
+		gro_flush_one(g, p, out);
+	}
+	list_add_tail(&m->m_list, &g->flows);
+	g->count++;
+
+	return TRUE;
+}
+VMM_EXPORT_SYMBOL(m_gro_receive);
+
+/*
+ * m_gro_flush: Move all frames held by GRO context to the out list.
+ */
+void m_gro_flush(struct vmm_mbuf_gro *g, struct dlist *out)
+{
+	struct vmm_mbuf *p;
+
+	while (!list_empty(&g->flows)) {
+		p = list_first_entry(&g->flows, struct vmm_mbuf, m_list);
+		gro_flush_one(g, p, out);
+	}
+}
+VMM_EXPORT_SYMBOL(m_gro_flush);
@@ -318,14 +318,14 @@ int vmm_port2switch_xfer_mbuf(struct vmm_netport *src, struct vmm_mbuf *mbuf)
 }
 VMM_EXPORT_SYMBOL(vmm_port2switch_xfer_mbuf);
 
-int vmm_port2switch_xfer_lazy(struct vmm_netport *src,
-			 void (*lazy_xfer)(struct vmm_netport *, void *, int),
-			 void *lazy_arg, int lazy_budget)
+static int netswitch_xfer_lazy(struct vmm_netport *src,
+			struct vmm_netswitch_bh_ctrl *nbp,
+			void (*lazy_xfer)(struct vmm_netport *, void *, int),
+			void *lazy_arg, int lazy_budget)
 {
 	int rc;
 	struct vmm_netport_xfer *xfer;
 	struct vmm_netswitch *nsw;
-	struct vmm_netswitch_bh_ctrl *nbp;
 
 	if (!lazy_xfer || !src || !src->nsw) {
 		vmm_printf("%s: invalid source port or xfer callback.\n",
@@ -333,7 +333,6 @@ int vmm_port2switch_xfer_lazy(struct vmm_netport *src,
 		return VMM_EFAIL;
 	}
 	nsw = src->nsw;
-	nbp = &this_cpu(nbctrl);
 
 	/* Print debug info */
 	DPRINTF("%s: nsw=%s src=%s\n", __func__, nsw->name, src->name);
@@ -363,8 +362,140 @@ int vmm_port2switch_xfer_lazy(struct vmm_netport *src,
 
 	return rc;
 }
+
+int vmm_port2switch_xfer_lazy(struct vmm_netport *src,
+			 void (*lazy_xfer)(struct vmm_netport *, void *, int),
+			 void *lazy_arg, int lazy_budget)
+{
+	return netswitch_xfer_lazy(src, &this_cpu(nbctrl),
+				   lazy_xfer, lazy_arg, lazy_budget);
+}
 VMM_EXPORT_SYMBOL(vmm_port2switch_xfer_lazy);
 
+int vmm_port2switch_xfer_lazy_on(struct vmm_netport *src, u32 cpu,
+			 void (*lazy_xfer)(struct vmm_netport *, void *, int),
+			 void *lazy_arg, int lazy_budget)
+{
+	/* Fallback to current CPU if requested CPU went away */
+	if (!vmm_cpu_online(cpu)) {
+		cpu = vmm_smp_processor_id();
+	}
+
+	return netswitch_xfer_lazy(src, &per_cpu(nbctrl, cpu),
+				   lazy_xfer, lazy_arg, lazy_budget);
+}
+VMM_EXPORT_SYMBOL(vmm_port2switch_xfer_lazy_on);
+
+static bool netswitch_port_offload_capable(struct vmm_netport *dst,
+					   struct vmm_mbuf *mbuf)
+{
+	u32 need = 0;
+
+	if (!(mbuf->m_flags & M_PKTHDR)) {
+		return TRUE;
+	}
+
+	if (mbuf->m_csum_flags & M_CSUM_PARTIAL) {
+		need |= VMM_NETPORT_F_CSUM;
+	}
+
+	switch (M_GSO_TYPE(mbuf)) {
+	case M_GSO_TCPV4:
+		need |= VMM_NETPORT_F_TSO4;
+		break;
+	case M_GSO_TCPV6:
+		need |= VMM_NETPORT_F_TSO6;
+		break;
+	case M_GSO_UDP:
+		need |= VMM_NETPORT_F_UFO;
+		break;
+	default:
+		break;
+	};
+
+	if (M_IS_GSO(mbuf) && (mbuf->m_gso_type & M_GSO_ECN)) {
+		need |= VMM_NETPORT_F_TSO_ECN;
+	}
+
+	return ((dst->features & need) == need) ? TRUE : FALSE;
+}
+
+/* Frames which are not segmented any further must fit the MTU of
+ * destination port (plus ethernet header and one VLAN tag).
+ */
+static bool netswitch_port_mtu_fits(struct vmm_netport *dst,
+				    struct vmm_mbuf *mbuf)
+{
+	if (!(mbuf->m_flags & M_PKTHDR) || M_IS_GSO(mbuf) || (dst->mtu <= 0)) {
+		return TRUE;
+	}
+
+	return (mbuf->m_pktlen <= (dst->mtu + ETHER_HLEN + 4)) ? TRUE : FALSE;
+}
+
+/* Software checksum and segmentation for ports without offload
+ * support. The mbuf might be shared with other destination ports
+ * hence we only work on private copies of it.
+ */
+static int netswitch_xfer_soft_offload(struct vmm_netswitch *nsw,
+				       struct vmm_netport *dst,
+				       struct vmm_mbuf *mbuf)
+{
+	int rc, rc1;
+	irq_flags_t f;
+	struct dlist segs;
+	struct vmm_mbuf *m;
+
+	INIT_LIST_HEAD(&segs);
+
+	if (M_IS_GSO(mbuf) && mbuf->m_next) {
+		/* Segmentation works on linear frames only */
+		m = m_dup(mbuf);
+		if (!m) {
+			return VMM_ENOMEM;
+		}
+		rc = m_gso_segment(m, &segs);
+		m_freem(m);
+	} else if (M_IS_GSO(mbuf)) {
+		rc = m_gso_segment(mbuf, &segs);
+	} else {
+		m = m_dup(mbuf);
+		if (!m) {
+			return VMM_ENOMEM;
+		}
+		rc = m_csum_complete(m);
+		if (rc) {
+			m_freem(m);
+		} else {
+			list_add_tail(&m->m_list, &segs);
+		}
+	}
+	if (rc) {
+		DPRINTF("%s: nsw=%s dst=%s soft offload failed (error %d)\n",
+			__func__, nsw->name, dst->name, rc);
+		return rc;
+	}
+
+	while (!list_empty(&segs)) {
+		m = m_list_entry(list_pop(&segs));
+		if (!netswitch_port_mtu_fits(dst, m)) {
+			DPRINTF("%s: nsw=%s dst=%s oversized segment dropped\n",
+				__func__, nsw->name, dst->name);
+			m_freem(m);
+			rc = VMM_EINVALID;
+			continue;
+		}
+		vmm_spin_lock_irqsave_lite(&dst->switch2port_xfer_lock, f);
+		rc1 = dst->switch2port_xfer(dst, m);
+		vmm_spin_unlock_irqrestore_lite(&dst->switch2port_xfer_lock, f);
+		if (rc1) {
+			rc = rc1;
+		}
+	}
+
+	return rc;
+}
+
 int vmm_switch2port_xfer_mbuf(struct vmm_netswitch *nsw,
 			      struct vmm_netport *dst,
 			      struct vmm_mbuf *mbuf)
@@ -383,6 +514,16 @@ int vmm_switch2port_xfer_mbuf(struct vmm_netswitch *nsw,
 		return VMM_OK;
 	}
 
+	if (!netswitch_port_offload_capable(dst, mbuf)) {
+		return netswitch_xfer_soft_offload(nsw, dst, mbuf);
+	}
+
+	if (!netswitch_port_mtu_fits(dst, mbuf)) {
+		DPRINTF("%s: nsw=%s dst=%s oversized frame dropped\n",
+			__func__, nsw->name, dst->name);
+		return VMM_EINVALID;
+	}
+
 	MADDREFERENCE(mbuf);
 	MCLADDREFERENCE(mbuf);
 
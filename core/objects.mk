@@ -51,6 +51,7 @@ core-objs-y+= vmm_delay.o
 core-objs-y+= vmm_shmem.o
 core-objs-y+= vmm_vcpu_irq.o
 core-objs-y+= vmm_guest_aspace.o
+core-objs-y+= vmm_guest_file.o
 core-objs-y+= vmm_manager.o
 core-objs-y+= vmm_scheduler.o
 core-objs-y+= vmm_threads.o
@@ -67,5 +68,6 @@ core-objs-y+= vmm_chardev.o
 core-objs-y+= vmm_modules.o
 core-objs-y+= vmm_params.o
 core-objs-$(CONFIG_PROFILE)+= vmm_profiler.o
+core-objs-$(CONFIG_LOCKSTAT)+= vmm_lockstat.o
 core-objs-$(CONFIG_LOADBAL)+= vmm_loadbal.o
 core-objs-y+= vmm_extable.o
@@ -26,12 +26,14 @@
 #include <vmm_heap.h>
 #include <vmm_mutex.h>
 #include <vmm_stdio.h>
+#include <vmm_threads.h>
 #include <vmm_host_io.h>
 #include <vmm_guest_aspace.h>
 #include <vmm_modules.h>
 #include <vio/vmm_virtio.h>
 #include <libs/mathlib.h>
 #include <libs/stringlib.h>
+#include <arch_barrier.h>
 
 #define MODULE_DESC		"VirtIO Para-virtualization Framework"
 #define MODULE_AUTHOR		"Pranav Sawargaonkar"
@@ -111,16 +113,65 @@ u32 vmm_virtio_queue_max_desc(struct vmm_virtio_queue *vq)
 }
 VMM_EXPORT_SYMBOL(vmm_virtio_queue_max_desc);
 
+/* Packed ring slot encoded along with wrap counter */
+#define PACKED_POS(idx, wrap)		((idx) | ((wrap) ? 0x8000 : 0))
+#define PACKED_POS_IDX(pos)		((pos) & 0x7fff)
+#define PACKED_POS_WRAP(pos)		(((pos) & 0x8000) ? TRUE : FALSE)
+
+static int virtio_queue_packed_read(struct vmm_virtio_queue *vq, u16 indx,
+				    struct vmm_vring_packed_desc *pdesc)
+{
+	u32 ret;
+	physical_addr_t desc_pa;
+
+	desc_pa = vq->vring.desc_pa + indx * sizeof(*pdesc);
+	ret = vmm_guest_memory_read(vq->guest, desc_pa,
+				    pdesc, sizeof(*pdesc), TRUE);
+	if (ret != sizeof(*pdesc)) {
+		return VMM_EIO;
+	}
+
+	return VMM_OK;
+}
+
+static u16 virtio_queue_packed_next(struct vmm_virtio_queue *vq,
+				    u16 indx, bool *wrap)
+{
+	if (++indx < vq->desc_count) {
+		return indx;
+	}
+
+	if (wrap) {
+		*wrap = !(*wrap);
+	}
+
+	return 0;
+}
+
 int vmm_virtio_queue_get_desc(struct vmm_virtio_queue *vq, u16 indx,
 			      struct vmm_vring_desc *desc)
 {
 	u32 ret;
 	physical_addr_t desc_pa;
+	struct vmm_vring_packed_desc pdesc;
 
 	if (!vq || !vq->guest || !desc) {
 		return VMM_EINVALID;
 	}
 
+	if (vq->packed) {
+		if (virtio_queue_packed_read(vq, indx, &pdesc)) {
+			return VMM_EIO;
+		}
+		desc->addr = pdesc.addr;
+		desc->len = pdesc.len;
+		desc->flags = pdesc.flags & (VMM_VRING_DESC_F_NEXT |
+					     VMM_VRING_DESC_F_WRITE |
+					     VMM_VRING_DESC_F_INDIRECT);
+		desc->next = virtio_queue_packed_next(vq, indx, NULL);
+		return VMM_OK;
+	}
+
 	desc_pa = vq->vring.desc_pa + indx * sizeof(*desc);
 	ret = vmm_guest_memory_read(vq->guest, desc_pa,
 				    desc, sizeof(*desc), TRUE);
@@ -132,6 +183,52 @@ int vmm_virtio_queue_get_desc(struct vmm_virtio_queue *vq, u16 indx,
 }
 VMM_EXPORT_SYMBOL(vmm_virtio_queue_get_desc);
 
+/* Consume next available buffer of packed ring and remember where
+ * its descriptors are so that they can be walked again by buffer id.
+ * A malformed buffer is not consumed and marks the queue broken.
+ */
+static u16 virtio_queue_packed_pop(struct vmm_virtio_queue *vq)
+{
+	u16 idx, start, num = 0;
+	bool wrap;
+	struct vmm_vring_packed_desc pdesc;
+
+	idx = vq->last_avail_idx;
+	wrap = vq->avail_wrap;
+	start = PACKED_POS(idx, wrap);
+
+	/* Read descriptors only after seeing them available */
+	arch_smp_rmb();
+
+	do {
+		if (virtio_queue_packed_read(vq, idx, &pdesc)) {
+			vmm_printf("%s: read failed at idx=%d\n",
+				   __func__, idx);
+			vq->broken = TRUE;
+			return 0;
+		}
+		idx = virtio_queue_packed_next(vq, idx, &wrap);
+		num++;
+	} while ((pdesc.flags & VMM_VRING_DESC_F_NEXT) &&
+		 (num < vq->desc_count));
+
+	/* Buffer id is taken from last descriptor of the chain */
+	if (vq->desc_count <= pdesc.id) {
+		vmm_printf("%s: invalid buffer id=%d\n", __func__, pdesc.id);
+		vq->broken = TRUE;
+		return 0;
+	}
+
+	vq->last_avail_idx = idx;
+	vq->avail_wrap = wrap;
+	vq->packed_pop_hist[umod32(vq->pop_count, vq->desc_count)] = start;
+	vq->pop_count++;
+	vq->packed_start[pdesc.id] = PACKED_POS_IDX(start);
+	vq->packed_num[pdesc.id] = num;
+
+	return pdesc.id;
+}
+
 u16 vmm_virtio_queue_pop(struct vmm_virtio_queue *vq)
 {
 	u16 val;
@@ -142,6 +239,10 @@ u16 vmm_virtio_queue_pop(struct vmm_virtio_queue *vq)
 		return 0;
 	}
 
+	if (vq->packed) {
+		return virtio_queue_packed_pop(vq);
+	}
+
 	ret = umod32(vq->last_avail_idx++, vq->desc_count);
 
 	avail_pa = vq->vring.avail_pa +
@@ -164,10 +265,28 @@ bool vmm_virtio_queue_available(struct vmm_virtio_queue *vq)
 	u32 ret;
 	physical_addr_t avail_pa;
 
-	if (!vq || !vq->guest) {
+	if (!vq || !vq->guest || vq->broken) {
 		return FALSE;
 	}
 
+	if (vq->packed) {
+		/* Available when AVAIL matches driver wrap and USED not */
+		avail_pa = vq->vring.desc_pa +
+			   vq->last_avail_idx * sizeof(struct vmm_vring_packed_desc) +
+			   offsetof(struct vmm_vring_packed_desc, flags);
+		ret = vmm_guest_memory_read(vq->guest, avail_pa,
+					    &val, sizeof(val), TRUE);
+		if (ret != sizeof(val)) {
+			vmm_printf("%s: read failed at desc_pa=0x%"PRIPADDR"\n",
+				   __func__, avail_pa);
+			return FALSE;
+		}
+		return ((!!(val & (1 << VMM_VRING_PACKED_DESC_F_AVAIL)) ==
+			 vq->avail_wrap) &&
+			(!!(val & (1 << VMM_VRING_PACKED_DESC_F_USED)) !=
+			 vq->avail_wrap)) ? TRUE : FALSE;
+	}
+
 	avail_pa = vq->vring.avail_pa +
 		   offsetof(struct vmm_vring_avail, idx);
 	ret = vmm_guest_memory_read(vq->guest, avail_pa,
@@ -182,6 +301,44 @@ bool vmm_virtio_queue_available(struct vmm_virtio_queue *vq)
 }
 VMM_EXPORT_SYMBOL(vmm_virtio_queue_available);
 
+static bool virtio_queue_packed_should_signal(struct vmm_virtio_queue *vq)
+{
+	u32 ret;
+	u16 old_idx, new_idx, off;
+	struct vmm_vring_packed_desc_event evt;
+
+	old_idx = vq->last_used_signalled;
+	new_idx = vq->last_used_signalled = vq->last_used_idx;
+
+	/* Used descriptors must be visible before reading driver event */
+	arch_smp_mb();
+
+	ret = vmm_guest_memory_read(vq->guest, vq->vring.avail_pa,
+				    &evt, sizeof(evt), TRUE);
+	if (ret != sizeof(evt)) {
+		vmm_printf("%s: read failed at driver_pa=0x%"PRIPADDR"\n",
+			   __func__, vq->vring.avail_pa);
+		return FALSE;
+	}
+
+	switch (evt.flags) {
+	case VMM_VRING_PACKED_EVENT_FLAG_DISABLE:
+		return FALSE;
+	case VMM_VRING_PACKED_EVENT_FLAG_DESC:
+		break;
+	default:
+		return TRUE;
+	}
+
+	off = evt.off_wrap & ~(1 << VMM_VRING_PACKED_EVENT_F_WRAP_CTR);
+	if ((evt.off_wrap >> VMM_VRING_PACKED_EVENT_F_WRAP_CTR) !=
+	    vq->used_wrap) {
+		off -= vq->desc_count;
+	}
+
+	return vmm_vring_need_event(off, new_idx, old_idx) ? TRUE : FALSE;
+}
+
 bool vmm_virtio_queue_should_signal(struct vmm_virtio_queue *vq)
 {
 	u32 ret;
@@ -192,6 +349,10 @@ bool vmm_virtio_queue_should_signal(struct vmm_virtio_queue *vq)
 		return FALSE;
 	}
 
+	if (vq->packed) {
+		return virtio_queue_packed_should_signal(vq);
+	}
+
 	old_idx = vq->last_used_signalled;
 
 	used_pa = vq->vring.used_pa +
@@ -229,7 +390,10 @@ void vmm_virtio_queue_set_avail_event(struct vmm_virtio_queue *vq)
 	u32 ret;
 	physical_addr_t avail_evt_pa;
 
-	if (!vq || !vq->guest) {
+	/* Device event suppression of packed ring is left zeroed by
+	 * guest which means notifications are always enabled.
+	 */
+	if (!vq || !vq->guest || vq->packed) {
 		return;
 	}
 
@@ -246,15 +410,117 @@ void vmm_virtio_queue_set_avail_event(struct vmm_virtio_queue *vq)
 }
 VMM_EXPORT_SYMBOL(vmm_virtio_queue_set_avail_event);
 
-void vmm_virtio_queue_set_used_elem(struct vmm_virtio_queue *vq,
-				    u32 head, u32 len)
+/* Write id and length of used descriptor but leave its flags so
+ * that guest does not see it until flush. Used descriptors of packed
+ * ring are written in order hence offset must follow previous fills.
+ */
+static void virtio_queue_packed_fill_used(struct vmm_virtio_queue *vq,
+					  u32 head, u32 len, u32 offset)
+{
+	u32 ret;
+	u16 id = head;
+	physical_addr_t desc_pa;
+
+	if (vq->desc_count <= head) {
+		return;
+	}
+	if (offset != vq->fill_used_count) {
+		vmm_printf("%s: out of order fill offset=%d pending=%d\n",
+			   __func__, offset, vq->fill_used_count);
+	}
+	if (!vq->fill_used_count) {
+		vq->fill_used_idx = vq->last_used_idx;
+		vq->fill_used_wrap = vq->used_wrap;
+	}
+
+	desc_pa = vq->vring.desc_pa +
+		  vq->fill_used_idx * sizeof(struct vmm_vring_packed_desc);
+	ret = vmm_guest_memory_write(vq->guest, desc_pa +
+			offsetof(struct vmm_vring_packed_desc, len),
+			&len, sizeof(len), TRUE);
+	ret += vmm_guest_memory_write(vq->guest, desc_pa +
+			offsetof(struct vmm_vring_packed_desc, id),
+			&id, sizeof(id), TRUE);
+	if (ret != (sizeof(len) + sizeof(id))) {
+		vmm_printf("%s: write failed at desc_pa=0x%"PRIPADDR"\n",
+			   __func__, desc_pa);
+	}
+
+	vq->packed_fill_pos[vq->fill_used_count++] =
+			PACKED_POS(vq->fill_used_idx, vq->fill_used_wrap);
+
+	/* Next used descriptor goes after all descriptors of buffer */
+	for (ret = 0; ret < vq->packed_num[head]; ret++) {
+		vq->fill_used_idx = virtio_queue_packed_next(vq,
+					vq->fill_used_idx,
+					&vq->fill_used_wrap);
+	}
+}
+
+/* Publish filled used descriptors by writing their flags. The first
+ * one is written last so that guest sees whole batch at once.
+ */
+static void virtio_queue_packed_flush_used(struct vmm_virtio_queue *vq,
+					   u32 count)
+{
+	u32 i, ret;
+	u16 flags, pos;
+	physical_addr_t flags_pa;
+
+	count = (count < vq->fill_used_count) ? count : vq->fill_used_count;
+	if (!count) {
+		return;
+	}
+
+	/* Id and length must be visible before flags */
+	arch_smp_wmb();
+
+	for (i = count; i > 0; i--) {
+		pos = vq->packed_fill_pos[i - 1];
+		flags = (PACKED_POS_WRAP(pos)) ?
+			((1 << VMM_VRING_PACKED_DESC_F_AVAIL) |
+			 (1 << VMM_VRING_PACKED_DESC_F_USED)) : 0;
+		flags_pa = vq->vring.desc_pa +
+			PACKED_POS_IDX(pos) * sizeof(struct vmm_vring_packed_desc) +
+			offsetof(struct vmm_vring_packed_desc, flags);
+		if (i == 1) {
+			arch_smp_wmb();
+		}
+		ret = vmm_guest_memory_write(vq->guest, flags_pa,
+					     &flags, sizeof(flags), TRUE);
+		if (ret != sizeof(flags)) {
+			vmm_printf("%s: write failed at flags_pa="
+				   "0x%"PRIPADDR"\n", __func__, flags_pa);
+		}
+	}
+
+	vq->fill_used_count -= count;
+	if (vq->fill_used_count) {
+		pos = vq->packed_fill_pos[count];
+		vq->last_used_idx = PACKED_POS_IDX(pos);
+		vq->used_wrap = PACKED_POS_WRAP(pos);
+		memmove(vq->packed_fill_pos, &vq->packed_fill_pos[count],
+			vq->fill_used_count * sizeof(*vq->packed_fill_pos));
+	} else {
+		vq->last_used_idx = vq->fill_used_idx;
+		vq->used_wrap = vq->fill_used_wrap;
+	}
+}
+
+void vmm_virtio_queue_fill_used_elem(struct vmm_virtio_queue *vq,
+				     u32 head, u32 len, u32 offset)
 {
 	u32 ret;
 	u16 used_idx;
 	struct vmm_vring_used_elem used_elem;
 	physical_addr_t used_idx_pa, used_elem_pa;
 
-	if (!vq || !vq->guest) {
+	if (!vq || !vq->guest || vq->broken) {
+		return;
+	}
+
+	if (vq->packed) {
+		virtio_queue_packed_fill_used(vq, head, len, offset);
 		return;
 	}
 
@@ -269,7 +535,7 @@ void vmm_virtio_queue_set_used_elem(struct vmm_virtio_queue *vq,
 
 	used_elem.id = head;
 	used_elem.len = len;
-	ret = umod32(used_idx, vq->vring.num);
+	ret = umod32((u16)(used_idx + offset), vq->vring.num);
 	used_elem_pa = vq->vring.used_pa +
 		       offsetof(struct vmm_vring_used, ring[ret]);
 	ret = vmm_guest_memory_write(vq->guest, used_elem_pa,
@@ -278,8 +544,37 @@ void vmm_virtio_queue_set_used_elem(struct vmm_virtio_queue *vq,
 		vmm_printf("%s: write failed at used_elem_pa=0x%"PRIPADDR"\n",
 			   __func__, used_elem_pa);
 	}
+}
+VMM_EXPORT_SYMBOL(vmm_virtio_queue_fill_used_elem);
+
+void vmm_virtio_queue_flush_used(struct vmm_virtio_queue *vq, u32 count)
+{
+	u32 ret;
+	u16 used_idx;
+	physical_addr_t used_idx_pa;
+
+	if (!vq || !vq->guest || vq->broken) {
+		return;
+	}
+
+	if (vq->packed) {
+		virtio_queue_packed_flush_used(vq, count);
+		return;
+	}
 
-	used_idx++;
+	used_idx_pa = vq->vring.used_pa +
+		      offsetof(struct vmm_vring_used, idx);
+	ret = vmm_guest_memory_read(vq->guest, used_idx_pa,
+				    &used_idx, sizeof(used_idx), TRUE);
+	if (ret != sizeof(used_idx)) {
+		vmm_printf("%s: read failed at used_idx_pa=0x%"PRIPADDR"\n",
+			   __func__, used_idx_pa);
+	}
+
+	/* Used elements must be visible before used index */
+	arch_smp_wmb();
+
+	used_idx += count;
 	ret = vmm_guest_memory_write(vq->guest, used_idx_pa,
 				     &used_idx, sizeof(used_idx), TRUE);
 	if (ret != sizeof(used_idx)) {
@@ -287,8 +582,42 @@ void vmm_virtio_queue_set_used_elem(struct vmm_virtio_queue *vq,
 			   __func__, used_idx_pa);
 	}
 }
+VMM_EXPORT_SYMBOL(vmm_virtio_queue_flush_used);
+
+void vmm_virtio_queue_set_used_elem(struct vmm_virtio_queue *vq,
+				    u32 head, u32 len)
+{
+	vmm_virtio_queue_fill_used_elem(vq, head, len, 0);
+	vmm_virtio_queue_flush_used(vq, 1);
+}
 VMM_EXPORT_SYMBOL(vmm_virtio_queue_set_used_elem);
 
+void vmm_virtio_queue_discard(struct vmm_virtio_queue *vq, u32 count)
+{
+	u16 pos;
+
+	if (!vq || !vq->guest) {
+		return;
+	}
+
+	if (vq->packed) {
+		if (!count || (vq->pop_count < count) ||
+		    (vq->desc_count < count)) {
+			return;
+		}
+		/* Rewind to where oldest discarded buffer started */
+		vq->pop_count -= count;
+		pos = vq->packed_pop_hist[umod32(vq->pop_count,
+						 vq->desc_count)];
+		vq->last_avail_idx = PACKED_POS_IDX(pos);
+		vq->avail_wrap = PACKED_POS_WRAP(pos);
+		return;
+	}
+
+	vq->last_avail_idx -= count;
+}
+VMM_EXPORT_SYMBOL(vmm_virtio_queue_discard);
+
 bool vmm_virtio_queue_setup_done(struct vmm_virtio_queue *vq)
 {
 	return (vq) ? ((vq->guest) ? TRUE : FALSE) : FALSE;
@@ -306,6 +635,23 @@ int vmm_virtio_queue_cleanup(struct vmm_virtio_queue *vq)
 
 	vq->guest = NULL;
 
+	if (vq->packed_start) {
+		vmm_free(vq->packed_start);
+	}
+	vq->packed_start = NULL;
+	vq->packed_num = NULL;
+	vq->packed_pop_hist = NULL;
+	vq->packed_fill_pos = NULL;
+	vq->packed = FALSE;
+	vq->avail_wrap = FALSE;
+	vq->used_wrap = FALSE;
+	vq->last_used_idx = 0;
+	vq->fill_used_idx = 0;
+	vq->fill_used_wrap = FALSE;
+	vq->fill_used_count = 0;
+	vq->pop_count = 0;
+	vq->broken = FALSE;
+
 	vq->desc_count = 0;
 	vq->align = 0;
 	vq->guest_pfn = 0;
@@ -320,18 +666,41 @@ done:
 }
 VMM_EXPORT_SYMBOL(vmm_virtio_queue_cleanup);
 
+static int virtio_queue_map_area(struct vmm_guest *guest,
+				 physical_addr_t gphys_addr,
+				 physical_size_t gphys_size,
+				 physical_addr_t *hphys_addr)
+{
+	u32 reg_flags;
+	physical_size_t avail_size;
+
+	if (vmm_guest_physical_map(guest, gphys_addr, gphys_size,
+				   hphys_addr, &avail_size, &reg_flags)) {
+		vmm_printf("Failed vmm_guest_physical_map\n");
+		return VMM_EFAIL;
+	}
+
+	if (!(reg_flags & VMM_REGION_ISRAM)) {
+		return VMM_EINVALID;
+	}
+
+	if (avail_size < gphys_size) {
+		return VMM_EINVALID;
+	}
+
+	return VMM_OK;
+}
+
 int vmm_virtio_queue_setup(struct vmm_virtio_queue *vq,
 			   struct vmm_guest *guest,
-			   physical_addr_t guest_pfn,
-			   physical_size_t guest_page_size,
-			   u32 desc_count, u32 align)
+			   struct vmm_virtio_queue_layout *layout)
 {
 	int rc = VMM_OK;
-	u32 reg_flags;
-	physical_addr_t gphys_addr, hphys_addr;
-	physical_size_t gphys_size, avail_size;
+	u32 num;
+	physical_addr_t hphys_addr, tmp;
+	physical_size_t desc_size, driver_size, device_size;
 
-	if (!vq || !guest) {
+	if (!vq || !guest || !layout) {
 		return VMM_EFAIL;
 	}
 
@@ -339,35 +708,69 @@ int vmm_virtio_queue_setup(struct vmm_virtio_queue *vq,
 		return rc;
 	}
 
-	gphys_addr = guest_pfn * guest_page_size;
-	gphys_size = vmm_vring_size(desc_count, align);
+	num = layout->desc_count;
+	if (!num || (0x8000 <= num)) {
+		return VMM_EINVALID;
+	}
 
-	if ((rc = vmm_guest_physical_map(guest, gphys_addr, gphys_size,
-					 &hphys_addr, &avail_size,
-					 &reg_flags))) {
-		vmm_printf("Failed vmm_guest_physical_map\n");
-		return VMM_EFAIL;
+	if (layout->packed) {
+		desc_size = sizeof(struct vmm_vring_packed_desc) * num;
+		driver_size = sizeof(struct vmm_vring_packed_desc_event);
+		device_size = sizeof(struct vmm_vring_packed_desc_event);
+	} else {
+		desc_size = sizeof(struct vmm_vring_desc) * num;
+		driver_size = sizeof(u16) * (3 + num);
+		device_size = sizeof(u16) * 3 +
+			      sizeof(struct vmm_vring_used_elem) * num;
 	}
 
-	if (!(reg_flags & VMM_REGION_ISRAM)) {
-		return VMM_EINVALID;
+	if ((rc = virtio_queue_map_area(guest, layout->desc_addr,
+					desc_size, &hphys_addr))) {
+		return rc;
+	}
+	if ((rc = virtio_queue_map_area(guest, layout->driver_addr,
+					driver_size, &tmp))) {
+		return rc;
+	}
+	if ((rc = virtio_queue_map_area(guest, layout->device_addr,
+					device_size, &tmp))) {
+		return rc;
 	}
 
-	if (avail_size < gphys_size) {
-		return VMM_EINVALID;
+	if (layout->packed) {
+		/* Buffer start, buffer length, pop history and fill
+		 * positions share one allocation.
+		 */
+		vq->packed_start = vmm_zalloc(sizeof(u16) * num * 4);
+		if (!vq->packed_start) {
+			return VMM_ENOMEM;
+		}
+		vq->packed_num = vq->packed_start + num;
+		vq->packed_pop_hist = vq->packed_num + num;
+		vq->packed_fill_pos = vq->packed_pop_hist + num;
+		vq->packed = TRUE;
+		/* Both wrap counters start at 1 */
+		vq->avail_wrap = TRUE;
+		vq->used_wrap = TRUE;
 	}
 
-	vmm_vring_init(&vq->vring, desc_count, NULL, gphys_addr, align);
+	vq->vring.num = num;
+	vq->vring.desc = NULL;
+	vq->vring.desc_pa = layout->desc_addr;
+	vq->vring.avail = NULL;
+	vq->vring.avail_pa = layout->driver_addr;
+	vq->vring.used = NULL;
+	vq->vring.used_pa = layout->device_addr;
 
 	vq->guest = guest;
-	vq->desc_count = desc_count;
-	vq->align = align;
-	vq->guest_pfn = guest_pfn;
-	vq->guest_page_size = guest_page_size;
+	vq->desc_count = num;
+	vq->align = layout->align;
+	vq->guest_pfn = layout->guest_pfn;
+	vq->guest_page_size = layout->guest_page_size;
 
-	vq->guest_addr = gphys_addr;
+	vq->guest_addr = layout->desc_addr;
 	vq->host_addr = hphys_addr;
-	vq->total_size = gphys_size;
+	vq->total_size = desc_size + driver_size + device_size;
 
 	return VMM_OK;
 }
@@ -401,15 +804,135 @@ static unsigned next_desc(struct vmm_virtio_queue *vq,
 	return next;
 }
 
+/* Number of indirect descriptors fetched from guest memory at a time */
+#define VIRTIO_INDIRECT_BATCH		16
+
+struct virtio_indirect_table {
+	physical_addr_t addr;
+	u32 count;
+	u32 base;
+	u32 avail;
+	struct vmm_vring_desc descs[VIRTIO_INDIRECT_BATCH];
+};
+
+static int virtio_indirect_get_desc(struct vmm_virtio_queue *vq,
+				    struct virtio_indirect_table *t,
+				    u32 indx, struct vmm_vring_desc *desc)
+{
+	u16 flags;
+	u32 i, len;
+	struct vmm_vring_packed_desc *pdesc;
+
+	if (t->count <= indx) {
+		return VMM_EINVALID;
+	}
+
+	/* Refill batch from guest memory when index is not cached */
+	if ((indx < t->base) || ((t->base + t->avail) <= indx)) {
+		t->base = indx;
+		t->avail = t->count - indx;
+		if (VIRTIO_INDIRECT_BATCH < t->avail) {
+			t->avail = VIRTIO_INDIRECT_BATCH;
+		}
+		len = t->avail * sizeof(struct vmm_vring_desc);
+		if (vmm_guest_memory_read(vq->guest,
+				t->addr + indx * sizeof(struct vmm_vring_desc),
+				t->descs, len, TRUE) != len) {
+			t->avail = 0;
+			return VMM_EIO;
+		}
+
+		/* Packed indirect tables are sequential without next field */
+		if (vq->packed) {
+			for (i = 0; i < t->avail; i++) {
+				pdesc = (struct vmm_vring_packed_desc *)
+								&t->descs[i];
+				flags = pdesc->flags & VMM_VRING_DESC_F_WRITE;
+				t->descs[i].flags = flags;
+				t->descs[i].next = t->base + i + 1;
+				if ((t->base + i + 1) < t->count) {
+					t->descs[i].flags |=
+						VMM_VRING_DESC_F_NEXT;
+				}
+			}
+		}
+	}
+
+	memcpy(desc, &t->descs[indx - t->base], sizeof(*desc));
+
+	return VMM_OK;
+}
+
+static u32 virtio_indirect_iovec(struct vmm_virtio_queue *vq,
+				 struct vmm_vring_desc *head,
+				 struct vmm_virtio_iovec *iov,
+				 u32 *ret_total_len)
+{
+	u32 i, indx = 0;
+	struct vmm_vring_desc desc;
+	struct virtio_indirect_table t;
+
+	if (!head->len || (head->len % sizeof(struct vmm_vring_desc))) {
+		vmm_printf("%s: invalid indirect table length %d\n",
+			   __func__, head->len);
+		return 0;
+	}
+
+	t.addr = head->addr;
+	t.count = head->len / sizeof(struct vmm_vring_desc);
+	t.base = 0;
+	t.avail = 0;
+
+	/* Chains longer than queue size are not allowed by spec and
+	 * would overflow iovec array of emulator.
+	 */
+	if (vmm_virtio_queue_max_desc(vq) < t.count) {
+		vmm_printf("%s: indirect table too large count=%d\n",
+			   __func__, t.count);
+		return 0;
+	}
+
+	for (i = 0; i < t.count; i++) {
+		if (virtio_indirect_get_desc(vq, &t, indx, &desc)) {
+			vmm_printf("%s: failed to get indirect descriptor "
+				   "idx=%d\n", __func__, indx);
+			return 0;
+		}
+
+		if (desc.flags & VMM_VRING_DESC_F_INDIRECT) {
+			vmm_printf("%s: nested indirect descriptor idx=%d\n",
+				   __func__, indx);
+			return 0;
+		}
+
+		iov[i].addr = desc.addr;
+		iov[i].len = desc.len;
+		iov[i].flags = (desc.flags & VMM_VRING_DESC_F_WRITE) ? 1 : 0;
+		if (ret_total_len) {
+			*ret_total_len += desc.len;
+		}
+
+		if (!(desc.flags & VMM_VRING_DESC_F_NEXT)) {
+			return i + 1;
+		}
+		indx = desc.next;
+	}
+
+	/* Ran out of entries without finding end of chain */
+	vmm_printf("%s: indirect chain loops\n", __func__);
+
+	return 0;
+}
+
 u16 vmm_virtio_queue_get_head_iovec(struct vmm_virtio_queue *vq,
 				    u16 head, struct vmm_virtio_iovec *iov,
 				    u32 *ret_iov_cnt, u32 *ret_total_len)
 {
 	int i, rc;
-	u16 idx, max;
+	u16 idx, max, num = 0;
 	struct vmm_vring_desc desc;
 
-	if (!vq || !vq->guest || !iov) {
+	if (!vq || !vq->guest || vq->broken || !iov) {
 		goto fail;
 	}
 
@@ -424,6 +947,15 @@ u16 vmm_virtio_queue_get_head_iovec(struct vmm_virtio_queue *vq,
 
 	max = vmm_virtio_queue_max_desc(vq);
 
+	/* Descriptors of packed ring buffer are located by buffer id */
+	if (vq->packed) {
+		if (max <= head) {
+			goto fail;
+		}
+		idx = vq->packed_start[head];
+		num = vq->packed_num[head];
+	}
+
 	rc = vmm_virtio_queue_get_desc(vq, idx, &desc);
 	if (rc) {
 		vmm_printf("%s: failed to get descriptor idx=%d error=%d\n",
@@ -431,15 +963,17 @@ u16 vmm_virtio_queue_get_head_iovec(struct vmm_virtio_queue *vq,
 		goto fail;
 	}
 
+	/* Indirect descriptor occupies single ring slot */
 	if (desc.flags & VMM_VRING_DESC_F_INDIRECT) {
-#if 0
-		max = desc[idx].len / sizeof(struct vring_desc);
-		desc = guest_flat_to_host(kvm, desc[idx].addr);
-		idx = 0;
-#endif
-		vmm_printf("%s: indirect descriptor not supported idx=%d\n",
-			   __func__, idx);
-		goto fail;
+		i = virtio_indirect_iovec(vq, &desc, iov, ret_total_len);
+		if (!i) {
+			goto fail;
+		}
+		if (ret_iov_cnt) {
+			*ret_iov_cnt = i;
+		}
+		vmm_virtio_queue_set_avail_event(vq);
+		return head;
 	}
 
 	i = 0;
@@ -458,7 +992,8 @@ u16 vmm_virtio_queue_get_head_iovec(struct vmm_virtio_queue *vq,
 		}
 
 		i++;
-	} while ((idx = next_desc(vq, &desc, idx, max)) != max);
+	} while ((!num || (i < num)) &&
+		 ((idx = next_desc(vq, &desc, idx, max)) != max));
 
 	if (ret_iov_cnt) {
 		*ret_iov_cnt = i;
@@ -668,6 +1203,93 @@ static void __virtio_attach_emulator(struct vmm_virtio_emulator *emu)
 	}
 }
 
+u64 vmm_virtio_get_host_features(struct vmm_virtio_device *dev)
+{
+	u64 features = 0;
+
+	if (!dev || !dev->emu) {
+		return 0;
+	}
+
+	if (dev->emu->get_host_features) {
+		features = dev->emu->get_host_features(dev);
+	}
+
+	/* Ring layout is handled by VirtIO core for all emulators */
+	if (dev->modern) {
+		features |= (1ULL << VMM_VIRTIO_F_VERSION_1) |
+			    (1ULL << VMM_VIRTIO_F_RING_PACKED);
+	}
+
+	return features;
+}
+VMM_EXPORT_SYMBOL(vmm_virtio_get_host_features);
+
+void vmm_virtio_set_guest_features(struct vmm_virtio_device *dev,
+				   u64 features)
+{
+	if (!dev || !dev->emu) {
+		return;
+	}
+
+	dev->features = features & vmm_virtio_get_host_features(dev);
+
+	if (dev->emu->set_guest_features) {
+		dev->emu->set_guest_features(dev, dev->features);
+	}
+}
+VMM_EXPORT_SYMBOL(vmm_virtio_set_guest_features);
+
+int vmm_virtio_init_vq_legacy(struct vmm_virtio_device *dev, u32 vq,
+			      u32 desc_count, u32 page_size,
+			      u32 align, u32 pfn)
+{
+	struct vmm_vring vring;
+	struct vmm_virtio_queue_layout layout;
+
+	if (!dev || !dev->emu || !dev->emu->init_vq) {
+		return VMM_EINVALID;
+	}
+
+	vmm_vring_init(&vring, desc_count, NULL,
+		       (physical_addr_t)pfn * page_size, align);
+
+	memset(&layout, 0, sizeof(layout));
+	layout.desc_count = desc_count;
+	layout.packed = FALSE;
+	layout.guest_pfn = pfn;
+	layout.guest_page_size = page_size;
+	layout.align = align;
+	layout.desc_addr = vring.desc_pa;
+	layout.driver_addr = vring.avail_pa;
+	layout.device_addr = vring.used_pa;
+
+	return dev->emu->init_vq(dev, vq, &layout);
+}
+VMM_EXPORT_SYMBOL(vmm_virtio_init_vq_legacy);
+
+int vmm_virtio_init_vq(struct vmm_virtio_device *dev, u32 vq,
+		       u32 desc_count, physical_addr_t desc_addr,
+		       physical_addr_t driver_addr,
+		       physical_addr_t device_addr)
+{
+	struct vmm_virtio_queue_layout layout;
+
+	if (!dev || !dev->emu || !dev->emu->init_vq) {
+		return VMM_EINVALID;
+	}
+
+	memset(&layout, 0, sizeof(layout));
+	layout.desc_count = desc_count;
+	layout.packed = vmm_virtio_has_feature(dev, VMM_VIRTIO_F_RING_PACKED);
+	layout.desc_addr = desc_addr;
+	layout.driver_addr = driver_addr;
+	layout.device_addr = device_addr;
+
+	return dev->emu->init_vq(dev, vq, &layout);
+}
+VMM_EXPORT_SYMBOL(vmm_virtio_init_vq);
+
 int vmm_virtio_config_read(struct vmm_virtio_device *dev,
 			   u32 offset, void *dst, u32 dst_len)
 {
@@ -682,12 +1304,177 @@ int vmm_virtio_config_write(struct vmm_virtio_device *dev,
 }
 VMM_EXPORT_SYMBOL(vmm_virtio_config_write);
 
+#ifdef CONFIG_VIRTIO_DOORBELL
+
+/* Keep doorbell worker out of notify_vq() and drop pending
+ * doorbells which were rung before the device was reset.
+ */
+static void __virtio_doorbell_quiesce(struct vmm_virtio_device *dev)
+{
+	irq_flags_t flags;
+
+	vmm_spin_lock(&dev->db_lock);
+
+	vmm_spin_lock_irqsave(&dev->db_pending_lock, flags);
+	dev->db_pending = 0;
+	vmm_spin_unlock_irqrestore(&dev->db_pending_lock, flags);
+}
+
+static void __virtio_doorbell_resume(struct vmm_virtio_device *dev)
+{
+	vmm_spin_unlock(&dev->db_lock);
+}
+
+#else
+
+static void __virtio_doorbell_quiesce(struct vmm_virtio_device *dev)
+{
+}
+
+static void __virtio_doorbell_resume(struct vmm_virtio_device *dev)
+{
+}
+
+#endif
+
 int vmm_virtio_reset(struct vmm_virtio_device *dev)
 {
-	return __virtio_reset_emulator(dev);
+	int rc;
+
+	if (!dev) {
+		return __virtio_reset_emulator(dev);
+	}
+
+	__virtio_doorbell_quiesce(dev);
+
+	dev->features = 0;
+	rc = __virtio_reset_emulator(dev);
+
+	__virtio_doorbell_resume(dev);
+
+	return rc;
 }
 VMM_EXPORT_SYMBOL(vmm_virtio_reset);
 
+#ifdef CONFIG_VIRTIO_DOORBELL
+
+static int __virtio_doorbell_worker(void *data)
+{
+	u32 vq;
+	u64 pending;
+	irq_flags_t flags;
+	struct vmm_virtio_device *dev = data;
+
+	while (1) {
+		vmm_completion_wait(&dev->db_avail);
+
+		/* Doorbell lock keeps reset away from notify_vq() */
+		vmm_spin_lock(&dev->db_lock);
+
+		vmm_spin_lock_irqsave(&dev->db_pending_lock, flags);
+		pending = dev->db_pending;
+		dev->db_pending = 0;
+		vmm_spin_unlock_irqrestore(&dev->db_pending_lock, flags);
+
+		for (vq = 0; pending && (vq < VMM_VIRTIO_DOORBELL_MAX_VQ); vq++) {
+			if (!(pending & (1ULL << vq))) {
+				continue;
+			}
+			pending &= ~(1ULL << vq);
+			if (dev->emu && dev->emu->notify_vq) {
+				dev->emu->notify_vq(dev, vq);
+			}
+		}
+
+		vmm_spin_unlock(&dev->db_lock);
+	}
+
+	return VMM_OK;
+}
+
+static int __virtio_doorbell_init(struct vmm_virtio_device *dev)
+{
+	INIT_COMPLETION(&dev->db_avail);
+	INIT_SPIN_LOCK(&dev->db_lock);
+	INIT_SPIN_LOCK(&dev->db_pending_lock);
+	dev->db_pending = 0;
+
+	dev->db_worker = vmm_threads_create(dev->name,
+					    __virtio_doorbell_worker, dev,
+					    VMM_THREAD_DEF_PRIORITY,
+					    VMM_THREAD_DEF_TIME_SLICE);
+	if (!dev->db_worker) {
+		return VMM_ENOMEM;
+	}
+
+	return vmm_threads_start(dev->db_worker);
+}
+
+static void __virtio_doorbell_cleanup(struct vmm_virtio_device *dev)
+{
+	if (!dev->db_worker) {
+		return;
+	}
+
+	/* Worker holds doorbell lock with preemption disabled
+	 * so it is never stopped in middle of notify_vq()
+	 */
+	vmm_threads_stop(dev->db_worker);
+
+	__virtio_doorbell_quiesce(dev);
+	__virtio_doorbell_resume(dev);
+
+	vmm_threads_destroy(dev->db_worker);
+	dev->db_worker = NULL;
+}
+
+int vmm_virtio_doorbell(struct vmm_virtio_device *dev, u32 vq)
+{
+	irq_flags_t flags;
+
+	if (!dev) {
+		return VMM_EINVALID;
+	}
+
+	if (!dev->db_worker || (VMM_VIRTIO_DOORBELL_MAX_VQ <= vq)) {
+		if (dev->emu && dev->emu->notify_vq) {
+			return dev->emu->notify_vq(dev, vq);
+		}
+		return VMM_OK;
+	}
+
+	vmm_spin_lock_irqsave(&dev->db_pending_lock, flags);
+	dev->db_pending |= (1ULL << vq);
+	vmm_spin_unlock_irqrestore(&dev->db_pending_lock, flags);
+
+	vmm_completion_complete(&dev->db_avail);
+
+	return VMM_OK;
+}
+
+#else
+
+static int __virtio_doorbell_init(struct vmm_virtio_device *dev)
+{
+	return VMM_OK;
+}
+
+static void __virtio_doorbell_cleanup(struct vmm_virtio_device *dev)
+{
+}
+
+int vmm_virtio_doorbell(struct vmm_virtio_device *dev, u32 vq)
+{
+	if (dev && dev->emu && dev->emu->notify_vq) {
+		return dev->emu->notify_vq(dev, vq);
+	}
+
+	return VMM_OK;
+}
+
+#endif
+VMM_EXPORT_SYMBOL(vmm_virtio_doorbell);
+
 int vmm_virtio_register_device(struct vmm_virtio_device *dev)
 {
 	int rc = VMM_OK;
@@ -700,6 +1487,11 @@ int vmm_virtio_register_device(struct vmm_virtio_device *dev)
 	dev->emu = NULL;
 	dev->emu_data = NULL;
 
+	if ((rc = __virtio_doorbell_init(dev))) {
+		__virtio_doorbell_cleanup(dev);
+		return rc;
+	}
+
 	vmm_mutex_lock(&virtio_mutex);
 
 	list_add_tail(&dev->node, &virtio_dev_list);
@@ -717,6 +1509,8 @@ void vmm_virtio_unregister_device(struct vmm_virtio_device *dev)
 		return;
 	}
 
+	__virtio_doorbell_cleanup(dev);
+
 	vmm_mutex_lock(&virtio_mutex);
 
 	__virtio_disconnect_emulator(dev);
@@ -65,7 +65,7 @@ void vmm_vmsg_ref(struct vmm_vmsg *msg)
 		arch_atomic_add(&msg->ref_count, 1);
 	}
 }
-VMM_EXPORT_SYMBOL(vmm_vmsg_unregister_client);
+VMM_EXPORT_SYMBOL(vmm_vmsg_ref);
 
 void vmm_vmsg_dref(struct vmm_vmsg *msg)
 {
@@ -85,6 +85,9 @@ VMM_EXPORT_SYMBOL(vmm_vmsg_dref);
 
 static void vmsg_release(struct vmm_vmsg *msg)
 {
+	if (msg->shm) {
+		vmm_shmem_dref(msg->shm);
+	}
 	vmm_free(msg);
 }
 
@@ -103,17 +106,41 @@ struct vmm_vmsg *vmm_vmsg_alloc(u32 dst, u32 src, void *data, size_t len)
 }
 VMM_EXPORT_SYMBOL(vmm_vmsg_alloc);
 
+struct vmm_vmsg *vmm_vmsg_alloc_shmem(u32 dst, u32 src,
+				      struct vmm_shmem *shm,
+				      physical_addr_t off, size_t len)
+{
+	struct vmm_vmsg *msg;
+
+	if (!shm || !len ||
+	    (vmm_shmem_get_size(shm) < off) ||
+	    ((vmm_shmem_get_size(shm) - off) < len)) {
+		return NULL;
+	}
+
+	msg = vmm_zalloc(sizeof(*msg));
+	if (!msg) {
+		return NULL;
+	}
+
+	INIT_VMSG(msg, dst, src, NULL, len, NULL, vmsg_release);
+	vmm_shmem_ref(shm);
+	msg->shm = shm;
+	msg->shm_off = off;
+
+	return msg;
+}
+VMM_EXPORT_SYMBOL(vmm_vmsg_alloc_shmem);
+
 struct vmsg_work {
 	struct dlist head;
 	struct vmm_vmsg_domain *domain;
-	struct vmm_vmsg *msg;
 	char name[VMM_FIELD_NAME_SIZE];
 	u32 addr;
 	void (*func) (struct vmsg_work *work);
 };
 
 static int vmsg_domain_enqueue_work(struct vmm_vmsg_domain *domain,
-				    struct vmm_vmsg *msg,
 				    const char *name, u32 addr,
 				    void (*func) (struct vmsg_work *))
 {
@@ -131,7 +158,6 @@ static int vmsg_domain_enqueue_work(struct vmm_vmsg_domain *domain,
 
 	INIT_LIST_HEAD(&work->head);
 	work->domain = domain;
-	work->msg = msg;
 	strncpy(work->name, name, sizeof(work->name));
 	work->addr = addr;
 	work->func = func;
@@ -145,32 +171,70 @@ static int vmsg_domain_enqueue_work(struct vmm_vmsg_domain *domain,
 	return VMM_OK;
 }
 
+static int vmsg_domain_enqueue_msg(struct vmm_vmsg_domain *domain,
+				   struct vmm_vmsg *msg)
+{
+	irq_flags_t flags;
+
+	if (!domain) {
+		return VMM_EINVALID;
+	}
+
+	/* Messages are queued using their own list head so that
+	 * sending does not need any allocation.
+	 */
+	vmm_spin_lock_irqsave(&domain->work_lock, flags);
+	if (!list_empty(&msg->head)) {
+		vmm_spin_unlock_irqrestore(&domain->work_lock, flags);
+		return VMM_EBUSY;
+	}
+	vmm_vmsg_ref(msg);
+	list_add_tail(&msg->head, &domain->msg_list);
+	vmm_spin_unlock_irqrestore(&domain->work_lock, flags);
+
+	vmm_completion_complete(&domain->work_avail);
+
+	return VMM_OK;
+}
+
+static void vmsg_domain_deliver_msg(struct vmm_vmsg_domain *domain,
+				    struct vmm_vmsg *msg);
+
 static int vmsg_domain_worker_main(void *data)
 {
 	irq_flags_t flags;
 	struct vmm_vmsg_domain *vmd = data;
 	struct vmsg_work *work;
+	struct vmm_vmsg *msg;
 
 	while (1) {
 		vmm_completion_wait(&vmd->work_avail);
 
 		work = NULL;
+		msg = NULL;
 		vmm_spin_lock_irqsave(&vmd->work_lock, flags);
 		if (!list_empty(&vmd->work_list)) {
 			work = list_first_entry(&vmd->work_list,
 						struct vmsg_work, head);
 			list_del(&work->head);
+		} else if (!list_empty(&vmd->msg_list)) {
+			msg = list_first_entry(&vmd->msg_list,
+					       struct vmm_vmsg, head);
+			list_del_init(&msg->head);
 		}
 		vmm_spin_unlock_irqrestore(&vmd->work_lock, flags);
-		if (!work) {
-			continue;
-		}
 
-		if (work->func) {
-			work->func(work);
+		if (work) {
+			if (work->func) {
+				work->func(work);
+			}
+			vmm_free(work);
 		}
 
-		vmm_free(work);
+		if (msg) {
+			vmsg_domain_deliver_msg(vmd, msg);
+			vmm_vmsg_dref(msg);
+		}
 	}
 
 	return VMM_OK;
@@ -203,8 +267,7 @@ static int vmsg_node_peer_down(struct vmm_vmsg_node *node)
 	struct vmm_vmsg_domain *domain = node->domain;
 
 	if (arch_atomic_cmpxchg(&node->is_ready, 1, 0)) {
-		err = vmsg_domain_enqueue_work(domain, NULL,
-					       node->name, node->addr,
+		err = vmsg_domain_enqueue_work(domain, node->name, node->addr,
 					       vmsg_node_peer_down_func);
 		if (err) {
 			return err;
@@ -256,8 +319,7 @@ static int vmsg_node_peer_up(struct vmm_vmsg_node *node)
 	struct vmm_vmsg_domain *domain = node->domain;
 
 	if (!arch_atomic_cmpxchg(&node->is_ready, 0, 1)) {
-		err = vmsg_domain_enqueue_work(domain, NULL,
-					       node->name, node->addr,
+		err = vmsg_domain_enqueue_work(domain, node->name, node->addr,
 					       vmsg_node_peer_up_func);
 		if (err) {
 			return err;
@@ -267,11 +329,10 @@ static int vmsg_node_peer_up(struct vmm_vmsg_node *node)
 	return VMM_OK;
 }
 
-static void vmsg_node_send_func(struct vmsg_work *work)
+static void vmsg_domain_deliver_msg(struct vmm_vmsg_domain *domain,
+				    struct vmm_vmsg *msg)
 {
 	struct vmm_vmsg_node *node;
-	struct vmm_vmsg *msg = work->msg;
-	struct vmm_vmsg_domain *domain = work->domain;
 
 	vmm_mutex_lock(&domain->node_lock);
 
@@ -292,15 +353,13 @@ static void vmsg_node_send_func(struct vmsg_work *work)
 
 static int vmsg_node_send(struct vmm_vmsg_node *node, struct vmm_vmsg *msg)
 {
-	if (!node || !msg || !msg->data || !msg->len ||
+	if (!node || !msg || (!msg->data && !msg->shm) || !msg->len ||
 	    (msg->src != node->addr) ||
 	    (msg->dst == msg->src)) {
 		return VMM_EINVALID;
 	}
 
-	return vmsg_domain_enqueue_work(node->domain, msg,
-					node->name, node->addr,
-					vmsg_node_send_func);
+	return vmsg_domain_enqueue_msg(node->domain, msg);
 }
 
 struct vmm_vmsg_domain *vmm_vmsg_domain_create(const char *name, void *priv)
@@ -340,6 +399,7 @@ struct vmm_vmsg_domain *vmm_vmsg_domain_create(const char *name, void *priv)
 	INIT_COMPLETION(&new_vmd->work_avail);
 	INIT_SPIN_LOCK(&new_vmd->work_lock);
 	INIT_LIST_HEAD(&new_vmd->work_list);
+	INIT_LIST_HEAD(&new_vmd->msg_list);
 	INIT_MUTEX(&new_vmd->node_lock);
 	INIT_LIST_HEAD(&new_vmd->node_list);
 
@@ -370,6 +430,7 @@ VMM_EXPORT_SYMBOL(vmm_vmsg_domain_create);
 int vmm_vmsg_domain_destroy(struct vmm_vmsg_domain *domain)
 {
 	bool found;
+	struct vmm_vmsg *msg;
 	struct vmm_vmsg_event event;
 	struct vmm_vmsg_domain *vmd;
 
@@ -406,6 +467,12 @@ int vmm_vmsg_domain_destroy(struct vmm_vmsg_domain *domain)
 
 	list_del(&domain->head);
 	vmm_threads_destroy(domain->worker);
+	while (!list_empty(&domain->msg_list)) {
+		msg = list_first_entry(&domain->msg_list,
+				       struct vmm_vmsg, head);
+		list_del_init(&msg->head);
+		vmm_vmsg_dref(msg);
+	}
 	vmm_free(domain);
 
 	vmm_mutex_unlock(&vmctrl.lock);
@@ -738,7 +805,8 @@ VMM_EXPORT_SYMBOL(vmm_vmsg_node_count);
 
 int vmm_vmsg_node_send(struct vmm_vmsg_node *node, struct vmm_vmsg *msg)
 {
-	if (!node || !msg || !msg->data || (msg->dst == node->addr)) {
+	if (!node || !msg || (!msg->data && !msg->shm) ||
+	    (msg->dst == node->addr)) {
 		return VMM_EINVALID;
 	}
 
@@ -26,6 +26,7 @@
 #include <vmm_spinlocks.h>
 #include <vmm_stdio.h>
 #include <vmm_clocksource.h>
+#include <arch_barrier.h>
 #include <arch_timer.h>
 #include <libs/stringlib.h>
 
@@ -62,6 +63,28 @@ u64 __notrace vmm_timecounter_read_for_profile(struct vmm_timecounter *tc)
 }
 #endif
 
+u64 vmm_timecounter_max_nsecs(struct vmm_timecounter *tc)
+{
+	u64 max_cycles;
+
+	if (!tc || !tc->cs || !tc->cs->mult) {
+		return 0;
+	}
+
+	/* Largest delta for which (delta * mult) does not overflow
+	 * and which is not ambiguous due to counter wrap around.
+	 * We use half of it to leave room for late updates.
+	 */
+	max_cycles = udiv64(~0ULL, tc->cs->mult);
+	if (tc->cs->mask < max_cycles) {
+		max_cycles = tc->cs->mask;
+	}
+	max_cycles >>= 1;
+
+	return vmm_clocksource_delta2nsecs(max_cycles,
+					   tc->cs->mult, tc->cs->shift);
+}
+
 u64 vmm_timecounter_read(struct vmm_timecounter *tc)
 {
 	u64 cycles_now, cycles_delta;
@@ -73,15 +96,45 @@ u64 vmm_timecounter_read(struct vmm_timecounter *tc)
 
 	cycles_now = tc->cs->read(tc->cs);
 	cycles_delta = (cycles_now - tc->cycles_last) & tc->cs->mask;
-	tc->cycles_last = cycles_now;
-
 	ns_offset = vmm_clocksource_delta2nsecs(cycles_delta,
 						tc->cs->mult, tc->cs->shift);
+
+	/* Readers retry while sequence count is odd or has changed */
+	*(volatile u32 *)&tc->seq = tc->seq + 1;
+	arch_smp_wmb();
+	tc->cycles_last = cycles_now;
 	tc->nsec += ns_offset;
+	arch_smp_wmb();
+	*(volatile u32 *)&tc->seq = tc->seq + 1;
 
 	return tc->nsec;
 }
 
+u64 vmm_timecounter_peek(struct vmm_timecounter *tc)
+{
+	u32 seq;
+	u64 cycles_last, nsec, cycles_delta;
+
+	if (!tc || !tc->cs) {
+		return 0;
+	}
+
+	do {
+		while ((seq = *(volatile u32 *)&tc->seq) & 0x1) {
+			arch_cpu_relax();
+		}
+		arch_smp_rmb();
+		cycles_last = tc->cycles_last;
+		nsec = tc->nsec;
+		arch_smp_rmb();
+	} while (seq != *(volatile u32 *)&tc->seq);
+
+	cycles_delta = (tc->cs->read(tc->cs) - cycles_last) & tc->cs->mask;
+
+	return nsec + vmm_clocksource_delta2nsecs(cycles_delta,
+						  tc->cs->mult, tc->cs->shift);
+}
+
 int vmm_timecounter_start(struct vmm_timecounter *tc)
 {
 	if (!tc || !tc->cs) {
@@ -117,6 +170,7 @@ int vmm_timecounter_init(struct vmm_timecounter *tc,
 	}
 
 	tc->cs = cs;
+	tc->seq = 0;
 	tc->cycles_last = cs->read(cs);
 	tc->nsec = start_nsec;
 
@@ -27,9 +27,14 @@
 #include <vmm_host_io.h>
 #include <vmm_host_irq.h>
 #include <vmm_mutex.h>
+#include <vmm_timer.h>
+#include <vmm_scheduler.h>
+#include <vmm_workqueue.h>
 #include <vmm_guest_aspace.h>
 #include <vmm_devemu.h>
 #include <vmm_devemu_debug.h>
+#include <arch_atomic.h>
+#include <arch_barrier.h>
 #include <libs/stringlib.h>
 
 struct vmm_devemu_guest_irq {
@@ -38,9 +43,33 @@ struct vmm_devemu_guest_irq {
 	void *opaque;
 };
 
+struct vmm_devemu_coalesced_entry {
+	struct vmm_emudev *edev;
+	physical_addr_t offset;
+	u64 data;
+	u32 len;
+	enum vmm_devemu_endianness endian;
+};
+
+struct vmm_devemu_guest_context;
+
+struct vmm_devemu_coalesced_ring {
+	struct vmm_devemu_guest_context *eg;
+	vmm_spinlock_t lock;
+	bool busy;
+	u32 head;
+	u32 count;
+	struct vmm_devemu_coalesced_entry ent[CONFIG_DEVEMU_COALESCED_RING_SIZE];
+	struct vmm_timer_event flush_ev;
+	struct vmm_work flush_work;
+};
+
 struct vmm_devemu_guest_context {
 	u32 g_irq_count;
 	struct dlist *g_irq;
+	atomic_t c_pending;
+	u32 c_ring_count;
+	struct vmm_devemu_coalesced_ring *c_ring;
 };
 
 struct vmm_devemu_ctrl {
@@ -118,6 +147,19 @@ static inline void debug_write(const struct vmm_emudev *edev,
 	}
 }
 
+static inline void debug_write_coalesced(const struct vmm_emudev *edev,
+					 physical_addr_t offset,
+					 int bytes,
+					 u64 val)
+{
+	if (vmm_devemu_debug_write(edev)) {
+		vmm_linfo(NULL, "[%s/%s] Buffered %i bytes at "
+			  "0x%"PRIPADDR": 0x%"PRIx64"\n",
+			  get_guest_name(edev), edev->node->name,
+			  bytes, offset + edev->reg->gphys_addr, val);
+	}
+}
+
 static int devemu_doread(struct vmm_emudev *edev,
 			 physical_addr_t offset,
 			 void *dst, u32 dst_len,
@@ -412,6 +454,282 @@ static int devemu_dowrite(struct vmm_emudev *edev,
 	return rc;
 }
 
+static bool devemu_coalesced_match(struct vmm_emudev *edev,
+				   physical_addr_t offset, u32 len)
+{
+	const struct vmm_devemu_coalesced_range *cr;
+
+	if (!edev || !edev->emu->coalesced_table) {
+		return FALSE;
+	}
+
+	for (cr = edev->emu->coalesced_table; cr->size; cr++) {
+		if ((cr->offset <= offset) &&
+		    ((offset + len) <= (cr->offset + cr->size))) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static void devemu_coalesced_flush_ring(struct vmm_devemu_coalesced_ring *r)
+{
+	irq_flags_t flags;
+	struct vmm_devemu_coalesced_entry e;
+
+	/* Emulators take their own locks so writes are applied
+	 * without ring lock. Only one flusher applies writes of
+	 * a ring at a time so that concurrent flushers can't
+	 * reorder them. Preemption is disabled so that a flusher
+	 * waiting for busy ring can't starve the busy flusher.
+	 */
+	vmm_scheduler_preempt_disable();
+	vmm_spin_lock_irqsave_lite(&r->lock, flags);
+	while (r->busy) {
+		vmm_spin_unlock_irqrestore_lite(&r->lock, flags);
+		arch_cpu_relax();
+		vmm_spin_lock_irqsave_lite(&r->lock, flags);
+	}
+	r->busy = TRUE;
+	while (r->count) {
+		memcpy(&e, &r->ent[r->head], sizeof(e));
+		r->head++;
+		if (r->head == CONFIG_DEVEMU_COALESCED_RING_SIZE) {
+			r->head = 0;
+		}
+		r->count--;
+		vmm_spin_unlock_irqrestore_lite(&r->lock, flags);
+
+		devemu_dowrite(e.edev, e.offset, &e.data, e.len, e.endian);
+
+		/* Write is pending until applied */
+		arch_atomic_sub(&r->eg->c_pending, 1);
+		vmm_spin_lock_irqsave_lite(&r->lock, flags);
+	}
+	r->busy = FALSE;
+	vmm_spin_unlock_irqrestore_lite(&r->lock, flags);
+	vmm_scheduler_preempt_enable();
+}
+
+static void devemu_coalesced_flush_work(struct vmm_work *work)
+{
+	struct vmm_devemu_coalesced_ring *r =
+		container_of(work, struct vmm_devemu_coalesced_ring,
+			     flush_work);
+
+	devemu_coalesced_flush_ring(r);
+}
+
+static void devemu_coalesced_flush_event(struct vmm_timer_event *ev)
+{
+	struct vmm_devemu_coalesced_ring *r = ev->priv;
+
+	/* Emulators are not called from timer context */
+	vmm_workqueue_schedule_work(NULL, &r->flush_work);
+}
+
+static void devemu_coalesced_flush(struct vmm_devemu_guest_context *eg)
+{
+	u32 i;
+
+	if (!eg || !arch_atomic_read(&eg->c_pending)) {
+		return;
+	}
+
+	for (i = 0; i < eg->c_ring_count; i++) {
+		devemu_coalesced_flush_ring(&eg->c_ring[i]);
+	}
+}
+
+static int devemu_coalesced_write(struct vmm_vcpu *vcpu,
+				  struct vmm_emudev *edev,
+				  physical_addr_t offset,
+				  void *src, u32 src_len,
+				  enum vmm_devemu_endianness src_endian)
+{
+	u32 pos;
+	bool start_ev;
+	irq_flags_t flags;
+	struct vmm_devemu_coalesced_ring *r;
+	struct vmm_devemu_coalesced_entry *e;
+	struct vmm_devemu_guest_context *eg = vcpu->guest->aspace.devemu_priv;
+
+	if (!eg || (eg->c_ring_count <= vcpu->subid) ||
+	    (sizeof(e->data) < src_len)) {
+		return VMM_ENOTAVAIL;
+	}
+	r = &eg->c_ring[vcpu->subid];
+
+	/* Only this VCPU adds to its ring so flushing
+	 * a full ring guarantees space for new entry.
+	 */
+	if (r->count == CONFIG_DEVEMU_COALESCED_RING_SIZE) {
+		devemu_coalesced_flush_ring(r);
+	}
+
+	vmm_spin_lock_irqsave_lite(&r->lock, flags);
+	pos = r->head + r->count;
+	if (CONFIG_DEVEMU_COALESCED_RING_SIZE <= pos) {
+		pos -= CONFIG_DEVEMU_COALESCED_RING_SIZE;
+	}
+	e = &r->ent[pos];
+	e->edev = edev;
+	e->offset = offset;
+	e->data = 0;
+	memcpy(&e->data, src, src_len);
+	e->len = src_len;
+	e->endian = src_endian;
+	debug_write_coalesced(edev, offset, src_len, e->data);
+	start_ev = (r->count == 0) ? TRUE : FALSE;
+	r->count++;
+	arch_atomic_add(&eg->c_pending, 1);
+	vmm_spin_unlock_irqrestore_lite(&r->lock, flags);
+
+	if (start_ev && !vmm_timer_event_pending(&r->flush_ev)) {
+		vmm_timer_event_start(&r->flush_ev,
+			(u64)CONFIG_DEVEMU_COALESCED_FLUSH_USECS * 1000ULL);
+	}
+
+	return VMM_OK;
+}
+
+static bool devemu_doorbell_write(struct vmm_devemu_guest_context *eg,
+				  struct vmm_emudev *edev,
+				  physical_addr_t offset,
+				  void *src, u32 src_len,
+				  enum vmm_devemu_endianness src_endian)
+{
+	u64 val;
+	irq_flags_t f;
+	struct vmm_devemu_doorbell *db, *found = NULL;
+
+	if (!edev || list_empty(&edev->doorbell_list)) {
+		return FALSE;
+	}
+
+	vmm_read_lock_irqsave_lite(&edev->doorbell_lock, f);
+	list_for_each_entry(db, &edev->doorbell_list, head) {
+		if ((db->offset == offset) && (db->len == src_len)) {
+			found = db;
+			break;
+		}
+	}
+	vmm_read_unlock_irqrestore_lite(&edev->doorbell_lock, f);
+	if (!found) {
+		return FALSE;
+	}
+
+	switch (src_len) {
+	case 1:
+		val = *(u8 *)src;
+		break;
+	case 2:
+		val = *(u16 *)src;
+		if (src_endian == VMM_DEVEMU_LITTLE_ENDIAN) {
+			val = vmm_le16_to_cpu(val);
+		} else if (src_endian == VMM_DEVEMU_BIG_ENDIAN) {
+			val = vmm_be16_to_cpu(val);
+		}
+		break;
+	case 4:
+		val = *(u32 *)src;
+		if (src_endian == VMM_DEVEMU_LITTLE_ENDIAN) {
+			val = vmm_le32_to_cpu(val);
+		} else if (src_endian == VMM_DEVEMU_BIG_ENDIAN) {
+			val = vmm_be32_to_cpu(val);
+		}
+		break;
+	case 8:
+		val = *(u64 *)src;
+		if (src_endian == VMM_DEVEMU_LITTLE_ENDIAN) {
+			val = vmm_le64_to_cpu(val);
+		} else if (src_endian == VMM_DEVEMU_BIG_ENDIAN) {
+			val = vmm_be64_to_cpu(val);
+		}
+		break;
+	default:
+		return FALSE;
+	};
+
+	/* Doorbell is ordered after buffered coalesced writes */
+	devemu_coalesced_flush(eg);
+
+	debug_write(edev, offset, src_len, val);
+	found->ring(found, val);
+
+	return TRUE;
+}
+
+int vmm_devemu_register_doorbell(struct vmm_emudev *edev,
+				 struct vmm_devemu_doorbell *db)
+{
+	irq_flags_t f;
+	struct vmm_devemu_doorbell *d;
+
+	if (!edev || !db || !db->ring ||
+	    ((db->len != 1) && (db->len != 2) &&
+	     (db->len != 4) && (db->len != 8))) {
+		return VMM_EINVALID;
+	}
+
+	vmm_write_lock_irqsave_lite(&edev->doorbell_lock, f);
+
+	list_for_each_entry(d, &edev->doorbell_list, head) {
+		if ((d == db) ||
+		    ((d->offset == db->offset) && (d->len == db->len))) {
+			vmm_write_unlock_irqrestore_lite(&edev->doorbell_lock, f);
+			return VMM_EEXIST;
+		}
+	}
+
+	INIT_LIST_HEAD(&db->head);
+	list_add_tail(&db->head, &edev->doorbell_list);
+
+	vmm_write_unlock_irqrestore_lite(&edev->doorbell_lock, f);
+
+	return VMM_OK;
+}
+
+int vmm_devemu_unregister_doorbell(struct vmm_emudev *edev,
+				   struct vmm_devemu_doorbell *db)
+{
+	irq_flags_t f;
+	bool found = FALSE;
+	struct vmm_devemu_doorbell *d;
+
+	if (!edev || !db) {
+		return VMM_EINVALID;
+	}
+
+	vmm_write_lock_irqsave_lite(&edev->doorbell_lock, f);
+
+	list_for_each_entry(d, &edev->doorbell_list, head) {
+		if (d == db) {
+			found = TRUE;
+			break;
+		}
+	}
+	if (found) {
+		list_del(&db->head);
+	}
+
+	vmm_write_unlock_irqrestore_lite(&edev->doorbell_lock, f);
+
+	return (found) ? VMM_OK : VMM_ENOTAVAIL;
+}
+
+int vmm_devemu_flush_coalesced(struct vmm_guest *guest)
+{
+	if (!guest) {
+		return VMM_EFAIL;
+	}
+
+	devemu_coalesced_flush(guest->aspace.devemu_priv);
+
+	return VMM_OK;
+}
+
 int vmm_devemu_emulate_read(struct vmm_vcpu *vcpu,
 			    physical_addr_t gphys_addr,
 			    void *dst, u32 dst_len,
@@ -431,6 +749,9 @@ int vmm_devemu_emulate_read(struct vmm_vcpu *vcpu,
 		goto skip;
 	}
 
+	/* Reads must observe all buffered coalesced writes */
+	devemu_coalesced_flush(vcpu->guest->aspace.devemu_priv);
+
 	rc = devemu_doread(reg->devemu_priv,
 			   gphys_addr - reg->gphys_addr,
 			   dst, dst_len, dst_endian);
@@ -464,6 +785,26 @@ int vmm_devemu_emulate_write(struct vmm_vcpu *vcpu,
 		goto skip;
 	}
 
+	/* Doorbell writes only wake up the device worker */
+	if (devemu_doorbell_write(vcpu->guest->aspace.devemu_priv,
+				  reg->devemu_priv,
+				  gphys_addr - reg->gphys_addr,
+				  src, src_len, src_endian)) {
+		return VMM_OK;
+	}
+
+	/* Buffer writes to coalesced registers */
+	if (devemu_coalesced_match(reg->devemu_priv,
+				   gphys_addr - reg->gphys_addr, src_len) &&
+	    !devemu_coalesced_write(vcpu, reg->devemu_priv,
+				    gphys_addr - reg->gphys_addr,
+				    src, src_len, src_endian)) {
+		return VMM_OK;
+	}
+
+	/* Other writes are ordered after buffered coalesced writes */
+	devemu_coalesced_flush(vcpu->guest->aspace.devemu_priv);
+
 	rc = devemu_dowrite(reg->devemu_priv,
 			    gphys_addr - reg->gphys_addr,
 			    src, src_len, src_endian);
@@ -497,6 +838,9 @@ int vmm_devemu_emulate_ioread(struct vmm_vcpu *vcpu,
 		goto skip;
 	}
 
+	/* Reads must observe all buffered coalesced writes */
+	devemu_coalesced_flush(vcpu->guest->aspace.devemu_priv);
+
 	rc = devemu_doread(reg->devemu_priv,
 			   gphys_addr - reg->gphys_addr,
 			   dst, dst_len, dst_endian);
@@ -530,6 +874,26 @@ int vmm_devemu_emulate_iowrite(struct vmm_vcpu *vcpu,
 		goto skip;
 	}
 
+	/* Doorbell writes only wake up the device worker */
+	if (devemu_doorbell_write(vcpu->guest->aspace.devemu_priv,
+				  reg->devemu_priv,
+				  gphys_addr - reg->gphys_addr,
+				  src, src_len, src_endian)) {
+		return VMM_OK;
+	}
+
+	/* Buffer writes to coalesced registers */
+	if (devemu_coalesced_match(reg->devemu_priv,
+				   gphys_addr - reg->gphys_addr, src_len) &&
+	    !devemu_coalesced_write(vcpu, reg->devemu_priv,
+				    gphys_addr - reg->gphys_addr,
+				    src, src_len, src_endian)) {
+		return VMM_OK;
+	}
+
+	/* Other writes are ordered after buffered coalesced writes */
+	devemu_coalesced_flush(vcpu->guest->aspace.devemu_priv);
+
 	rc = devemu_dowrite(reg->devemu_priv,
 			    gphys_addr - reg->gphys_addr,
 			    src, src_len, src_endian);
@@ -1059,11 +1423,28 @@ int vmm_devemu_sync_parent(struct vmm_guest *guest,
 
 int vmm_devemu_reset_context(struct vmm_guest *guest)
 {
+	u32 i;
+	irq_flags_t flags;
+	struct vmm_devemu_coalesced_ring *r;
+	struct vmm_devemu_guest_context *eg;
+
 	if (!guest) {
 		return VMM_EFAIL;
 	}
+	eg = guest->aspace.devemu_priv;
+	if (!eg) {
+		return VMM_OK;
+	}
 
-	/* For now nothing to do here. */
+	/* Drop buffered coalesced writes because emulators are reset */
+	for (i = 0; i < eg->c_ring_count; i++) {
+		r = &eg->c_ring[i];
+		vmm_spin_lock_irqsave_lite(&r->lock, flags);
+		arch_atomic_sub(&eg->c_pending, r->count);
+		r->head = 0;
+		r->count = 0;
+		vmm_spin_unlock_irqrestore_lite(&r->lock, flags);
+	}
 
 	return VMM_OK;
 }
@@ -1203,6 +1584,9 @@ int vmm_devemu_remove_region(struct vmm_guest *guest,
 	if (reg->devemu_priv) {
 		edev = reg->devemu_priv;
 
+		/* Buffered coalesced writes must not outlive emulator */
+		devemu_coalesced_flush(guest->aspace.devemu_priv);
+
 		rc = devemu_remove_edev(guest, edev);
 		if (rc) {
 			return rc;
@@ -1272,6 +1656,8 @@ static struct vmm_emudev *devemu_probe_edev(struct vmm_guest *guest,
 		INIT_LIST_HEAD(&edev->head);
 		INIT_RW_LOCK(&edev->child_list_lock);
 		INIT_LIST_HEAD(&edev->child_list);
+		INIT_RW_LOCK(&edev->doorbell_lock);
+		INIT_LIST_HEAD(&edev->doorbell_list);
 		edev->priv = NULL;
 		set_debug_info(edev);
 
@@ -1379,6 +1765,7 @@ int vmm_devemu_init_context(struct vmm_guest *guest)
 {
 	u32 ite;
 	int rc = VMM_OK;
+	struct vmm_devemu_coalesced_ring *r;
 	struct vmm_devemu_guest_context *eg;
 
 	if (!guest) {
@@ -1413,10 +1800,29 @@ int vmm_devemu_init_context(struct vmm_guest *guest)
 		INIT_LIST_HEAD(&eg->g_irq[ite]);
 	}
 
+	ARCH_ATOMIC_INIT(&eg->c_pending, 0);
+	eg->c_ring_count = guest->vcpu_count;
+	eg->c_ring = vmm_zalloc(sizeof(*eg->c_ring) * eg->c_ring_count);
+	if (!eg->c_ring) {
+		rc = VMM_ENOMEM;
+		goto devemu_init_context_free_irq;
+	}
+	for (ite = 0; ite < eg->c_ring_count; ite++) {
+		r = &eg->c_ring[ite];
+		r->eg = eg;
+		INIT_SPIN_LOCK(&r->lock);
+		r->busy = FALSE;
+		INIT_TIMER_EVENT(&r->flush_ev,
+				 devemu_coalesced_flush_event, r);
+		INIT_WORK(&r->flush_work, devemu_coalesced_flush_work);
+	}
+
 	guest->aspace.devemu_priv = eg;
 
 	goto devemu_init_context_done;
 
+devemu_init_context_free_irq:
+	vmm_free(eg->g_irq);
 devemu_init_context_free:
 	vmm_free(eg);
 devemu_init_context_done:
@@ -1425,6 +1831,7 @@ devemu_init_context_done:
 
 int vmm_devemu_deinit_context(struct vmm_guest *guest)
 {
+	u32 i;
 	int rc = VMM_OK;
 	struct vmm_devemu_guest_context *eg;
 
@@ -1436,6 +1843,17 @@ int vmm_devemu_deinit_context(struct vmm_guest *guest)
 	guest->aspace.devemu_priv = NULL;
 
 	if (eg) {
+		if (eg->c_ring) {
+			for (i = 0; i < eg->c_ring_count; i++) {
+				vmm_timer_event_stop(&eg->c_ring[i].flush_ev);
+				vmm_workqueue_stop_work(
+						&eg->c_ring[i].flush_work);
+			}
+			vmm_free(eg->c_ring);
+			eg->c_ring = NULL;
+			eg->c_ring_count = 0;
+		}
+
 		if (eg->g_irq) {
 			vmm_free(eg->g_irq);
 			eg->g_irq = NULL;
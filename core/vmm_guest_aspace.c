@@ -32,8 +32,12 @@
 #include <vmm_host_ram.h>
 #include <vmm_host_aspace.h>
 #include <vmm_guest_aspace.h>
+#include <vmm_guest_file.h>
 #include <vmm_stdio.h>
+#include <vmm_mutex.h>
 #include <vmm_notifier.h>
+#include <vmm_scheduler.h>
+#include <arch_barrier.h>
 #include <arch_guest.h>
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
@@ -315,6 +319,244 @@ int vmm_guest_overwrite_real_device_mapping(struct vmm_guest *guest,
 	return VMM_OK;
 }
 
+/* Serializes population of file-backed region mappings */
+static DEFINE_MUTEX(region_file_lock);
+
+static bool region_file_populated(struct vmm_guest *guest,
+				  struct vmm_region *reg,
+				  physical_addr_t gphys_addr)
+{
+	struct vmm_region_mapping *map;
+
+	map = mapping_find(guest, reg, NULL, gphys_addr);
+	if (!map || !(map->flags & VMM_REGION_MAPPING_ISPOPULATED)) {
+		return FALSE;
+	}
+
+	/* Read mapping address only after populated flag */
+	arch_smp_rmb();
+
+	return TRUE;
+}
+
+/*
+ * Populate mapping of file-backed region from backing file. The
+ * read-only mappings share host RAM with other guests using same
+ * file whereas writeable mappings get private copy of file contents.
+ *
+ * Note: Must be called from orphan context
+ */
+static int region_file_populate(struct vmm_guest *guest,
+				struct vmm_region *reg,
+				physical_addr_t gphys_addr)
+{
+	int rc = VMM_OK;
+	u32 i;
+	u64 off;
+	physical_size_t size;
+	physical_addr_t hphys;
+	struct vmm_region_mapping *map;
+
+	map = mapping_find(guest, reg, &i, gphys_addr);
+	if (!map) {
+		return VMM_EINVALID;
+	}
+
+	vmm_mutex_lock(&region_file_lock);
+
+	if (map->flags & VMM_REGION_MAPPING_ISPOPULATED) {
+		goto done;
+	}
+
+	off = reg->file_offset + mapping_gphys_offset(reg, i);
+	size = mapping_phys_size(reg, i);
+
+	if (reg->flags & VMM_REGION_READONLY) {
+		rc = vmm_guest_file_get_page(reg->file, off, size,
+					     reg->align_order, &hphys);
+		if (rc) {
+			goto done;
+		}
+		map->hphys_addr = hphys;
+		map->flags |= VMM_REGION_MAPPING_ISFILEPAGE;
+	} else {
+		if (!vmm_host_ram_alloc(&hphys, size, reg->align_order)) {
+			rc = VMM_ENOMEM;
+			goto done;
+		}
+		rc = vmm_guest_file_read(reg->file, off, hphys, size);
+		if (rc) {
+			vmm_host_ram_free(hphys, size);
+			goto done;
+		}
+		map->hphys_addr = hphys;
+		map->flags |= VMM_REGION_MAPPING_ISHOSTRAM;
+	}
+
+	/* Mapping address must be visible before populated flag */
+	arch_smp_wmb();
+	map->flags |= VMM_REGION_MAPPING_ISPOPULATED;
+
+done:
+	vmm_mutex_unlock(&region_file_lock);
+
+	if (rc) {
+		vmm_printf("%s: Failed to populate %s/%s from %s "
+			   "(error %d)\n", __func__, guest->name,
+			   reg->node->name,
+			   vmm_guest_file_path(reg->file), rc);
+	}
+
+	return rc;
+}
+
+/*
+ * Drop private copies of file contents so that writeable file-backed
+ * regions start with fresh file contents after guest reset. The arch
+ * code removes these mappings from stage2 when notified about reset
+ * which happens after this hence populated flag must be cleared here.
+ */
+static void region_file_reset(struct vmm_guest *guest,
+			      struct vmm_region *reg,
+			      void *priv)
+{
+	u32 i;
+	struct vmm_region_mapping *map;
+
+	if (!(reg->flags & VMM_REGION_ISFILE) ||
+	    (reg->flags & VMM_REGION_READONLY)) {
+		return;
+	}
+
+	vmm_mutex_lock(&region_file_lock);
+
+	for (i = 0; i < reg->maps_count; i++) {
+		map = &reg->maps[i];
+		if (!(map->flags & VMM_REGION_MAPPING_ISHOSTRAM)) {
+			continue;
+		}
+		vmm_host_ram_free(map->hphys_addr, mapping_phys_size(reg, i));
+		map->hphys_addr = 0;
+		map->flags &= ~(VMM_REGION_MAPPING_ISHOSTRAM |
+				VMM_REGION_MAPPING_ISPOPULATED);
+	}
+
+	vmm_mutex_unlock(&region_file_lock);
+}
+
+struct region_populate_req {
+	struct vmm_vcpu *vcpu;
+	physical_addr_t gphys_addr;
+};
+
+static void region_populate_work(struct vmm_guest *guest, void *data)
+{
+	int rc = VMM_EINVALID;
+	struct region_populate_req *req = data;
+	physical_addr_t gphys_addr = req->gphys_addr;
+	struct vmm_region *reg;
+
+	reg = vmm_guest_find_region(guest, gphys_addr,
+				    VMM_REGION_MEMORY, FALSE);
+	while (reg && (reg->flags & VMM_REGION_ALIAS)) {
+		gphys_addr = VMM_REGION_GPHYS_TO_APHYS(reg, gphys_addr);
+		reg = vmm_guest_find_region(guest, gphys_addr,
+					    VMM_REGION_MEMORY, FALSE);
+	}
+	if (reg && (reg->flags & VMM_REGION_ISFILE)) {
+		rc = region_file_populate(guest, reg, gphys_addr);
+	}
+
+	/* Resume VCPU waiting for this population (if any) */
+	if (req->vcpu) {
+		if (rc) {
+			vmm_manager_vcpu_halt(req->vcpu);
+		} else if (vmm_manager_vcpu_get_state(req->vcpu) ==
+							VMM_VCPU_STATE_PAUSED) {
+			vmm_manager_vcpu_resume(req->vcpu);
+		}
+	}
+
+	vmm_free(req);
+}
+
+/*
+ * Device emulators access guest memory from contexts where backing
+ * file cannot be read so we only populate the mapping they touched
+ * in orphan context and let them retry later. Duplicate requests for
+ * same mapping are cheap because populated mappings are skipped.
+ */
+static void region_file_populate_async(struct vmm_guest *guest,
+				       physical_addr_t gphys_addr)
+{
+	struct region_populate_req *req;
+
+	req = vmm_malloc(sizeof(*req));
+	if (!req) {
+		return;
+	}
+	req->vcpu = NULL;
+	req->gphys_addr = gphys_addr;
+
+	if (vmm_manager_guest_request(guest, region_populate_work, req)) {
+		vmm_free(req);
+	}
+}
+
+/* Check whether guest memory at given address can be accessed now
+ * and populate file-backed mapping if required.
+ */
+static bool region_file_access(struct vmm_guest *guest,
+			       struct vmm_region *reg,
+			       physical_addr_t gphys_addr)
+{
+	if (!(reg->flags & VMM_REGION_ISFILE) ||
+	    region_file_populated(guest, reg, gphys_addr)) {
+		return TRUE;
+	}
+
+	if (!vmm_scheduler_orphan_context()) {
+		region_file_populate_async(guest, gphys_addr);
+		return FALSE;
+	}
+
+	return (region_file_populate(guest, reg, gphys_addr)) ? FALSE : TRUE;
+}
+
+int vmm_guest_physical_populate(struct vmm_vcpu *vcpu,
+				physical_addr_t gphys_addr)
+{
+	int rc;
+	struct region_populate_req *req;
+
+	if (!vcpu || !vcpu->is_normal || !vcpu->guest) {
+		return VMM_EINVALID;
+	}
+
+	req = vmm_malloc(sizeof(*req));
+	if (!req) {
+		return VMM_ENOMEM;
+	}
+	req->vcpu = vcpu;
+	req->gphys_addr = gphys_addr;
+
+	/* VCPU retries the access after it is resumed */
+	rc = vmm_manager_vcpu_pause(vcpu);
+	if (rc) {
+		vmm_free(req);
+		return rc;
+	}
+
+	rc = vmm_manager_guest_request(vcpu->guest,
+				       region_populate_work, req);
+	if (rc) {
+		vmm_manager_vcpu_resume(vcpu);
+		vmm_free(req);
+	}
+
+	return rc;
+}
+
 u32 vmm_guest_memory_read(struct vmm_guest *guest,
 			  physical_addr_t gphys_addr,
 			  void *dst, u32 len, bool cacheable)
@@ -335,6 +577,10 @@ u32 vmm_guest_memory_read(struct vmm_guest *guest,
 			break;
 		}
 
+		if (!region_file_access(guest, reg, gphys_addr)) {
+			break;
+		}
+
 		vmm_guest_find_mapping(guest, reg, gphys_addr,
 				       &hphys_addr, &avail_size);
 		to_read = (avail_size < U32_MAX) ? avail_size : U32_MAX;
@@ -375,6 +621,13 @@ u32 vmm_guest_memory_write(struct vmm_guest *guest,
 			break;
 		}
 
+		/* Read-only file pages are shared with other guests */
+		if ((reg->flags & VMM_REGION_ISFILE) &&
+		    ((reg->flags & VMM_REGION_READONLY) ||
+		     !region_file_access(guest, reg, gphys_addr))) {
+			break;
+		}
+
 		vmm_guest_find_mapping(guest, reg, gphys_addr,
 				       &hphys_addr, &avail_size);
 		to_write = (avail_size < U32_MAX) ? avail_size : U32_MAX;
@@ -424,6 +677,12 @@ int vmm_guest_physical_map(struct vmm_guest *guest,
 		}
 	}
 
+	/* File-backed mapping not populated yet */
+	if ((reg->flags & VMM_REGION_ISFILE) &&
+	    !region_file_populated(guest, reg, gphys_addr)) {
+		return VMM_EAGAIN;
+	}
+
 	vmm_guest_find_mapping(guest, reg, gphys_addr, &hphys, &size);
 
 	if (gphys_size < size) {
@@ -464,6 +723,7 @@ bool is_region_node_valid(struct vmm_devtree_node *rnode)
 	bool is_alloced = FALSE;
 	bool is_colored = FALSE;
 	bool is_shared = FALSE;
+	bool is_file = FALSE;
 	physical_size_t size = 0;
 	bool shm_available = FALSE;
 	physical_size_t shm_size = 0;
@@ -512,13 +772,31 @@ bool is_region_node_valid(struct vmm_devtree_node *rnode)
 	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_ROM)) {
 		is_shared = TRUE;
 	}
+	if (!strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_FILE_RAM) ||
+	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_FILE_ROM)) {
+		is_file = TRUE;
+	}
+
+	if (is_file) {
+#ifndef CONFIG_ARCH_HAS_GUEST_FILE
+		/* Arch can't retry guest access on VMM_EAGAIN */
+		return FALSE;
+#endif
+		if (!is_real) {
+			return FALSE;
+		}
+		if (vmm_devtree_read_string(rnode,
+				VMM_DEVTREE_FILE_ATTR_NAME, &aval)) {
+			return FALSE;
+		}
+	}
 
 	if (vmm_devtree_read_physaddr(rnode,
 			VMM_DEVTREE_GUEST_PHYS_ATTR_NAME, &gphys_addr)) {
 		return FALSE;
 	}
 
-	if (is_real && !is_alloced && !is_colored && !is_shared) {
+	if (is_real && !is_alloced && !is_colored && !is_shared && !is_file) {
 		if (vmm_devtree_read_physaddr(rnode,
 			VMM_DEVTREE_HOST_PHYS_ATTR_NAME, &hphys_addr)) {
 			return FALSE;
@@ -598,6 +876,9 @@ bool is_region_node_valid(struct vmm_devtree_node *rnode)
 	if (BITS_PER_LONG <= align_order) {
 		return FALSE;
 	}
+	if (is_file && (align_order < VMM_PAGE_SHIFT)) {
+		align_order = VMM_PAGE_SHIFT;
+	}
 	if (size & order_mask(align_order)) {
 		return FALSE;
 	}
@@ -755,12 +1036,14 @@ static int region_add(struct vmm_guest *guest,
 	if (!strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_RAM) ||
 	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_ALLOCED_RAM) ||
 	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_COLORED_RAM) ||
-	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_RAM)) {
+	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_RAM) ||
+	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_FILE_RAM)) {
 		reg->flags |= VMM_REGION_ISRAM;
 	} else if (!strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_ROM) ||
 		   !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_ALLOCED_ROM) ||
 		   !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_COLORED_ROM) ||
-		   !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_ROM)) {
+		   !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_ROM) ||
+		   !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_FILE_ROM)) {
 		reg->flags |= VMM_REGION_READONLY;
 		reg->flags |= VMM_REGION_ISROM;
 	} else {
@@ -782,6 +1065,10 @@ static int region_add(struct vmm_guest *guest,
 	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_ROM)) {
 		reg->flags |= VMM_REGION_ISSHARED;
 	}
+	if (!strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_FILE_RAM) ||
+	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_FILE_ROM)) {
+		reg->flags |= VMM_REGION_ISFILE;
+	}
 	if ((reg->flags & VMM_REGION_REAL) &&
 	    (reg->flags & VMM_REGION_MEMORY) &&
 	    (reg->flags & VMM_REGION_ISRAM)) {
@@ -861,6 +1148,27 @@ static int region_add(struct vmm_guest *guest,
 		reg->shm = NULL;
 	}
 
+	/* Determine backing file of file-backed regions */
+	reg->file = NULL;
+	reg->file_offset = 0;
+	if (reg->flags & VMM_REGION_ISFILE) {
+		rc = vmm_devtree_read_string(reg->node,
+				VMM_DEVTREE_FILE_ATTR_NAME, &aval);
+		if (rc) {
+			goto region_dref_shm_fail;
+		}
+		reg->file = vmm_guest_file_get(aval);
+		if (!reg->file) {
+			rc = VMM_ENOMEM;
+			goto region_dref_shm_fail;
+		}
+		if (vmm_devtree_read_u64(reg->node,
+				VMM_DEVTREE_FILE_OFFSET_ATTR_NAME,
+				&reg->file_offset)) {
+			reg->file_offset = 0;
+		}
+	}
+
 	/* Determine region align_order */
 	if (reg->flags & (VMM_REGION_ISCOLORED | VMM_REGION_ISSHARED)) {
 		if (reg->flags & VMM_REGION_ISCOLORED) {
@@ -914,6 +1222,27 @@ static int region_add(struct vmm_guest *guest,
 		}
 	}
 
+	/*
+	 * Overwrite mapping order for file-backed RAM/ROM regions
+	 * because mappings are populated on-demand from file
+	 */
+	if (reg->flags & VMM_REGION_ISFILE) {
+		if (VMM_GUEST_FILE_DEF_MAP_ORDER < reg->map_order) {
+			reg->map_order = VMM_GUEST_FILE_DEF_MAP_ORDER;
+		}
+		if ((VMM_PAGE_SHIFT <= reg->align_order) &&
+		    (reg->align_order < reg->map_order)) {
+			reg->map_order = reg->align_order;
+		}
+
+		i = 0;
+		rc = vmm_devtree_read_u32(reg->node,
+				VMM_DEVTREE_MAP_ORDER_ATTR_NAME, &i);
+		if (!rc && (VMM_PAGE_SHIFT <= i) && (i < reg->map_order)) {
+			reg->map_order = i;
+		}
+	}
+
 	/* Overwrite mapping order for colored RAM/ROM regions */
 	if (!(reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL)) &&
 	    (reg->flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) &&
@@ -921,6 +1250,33 @@ static int region_add(struct vmm_guest *guest,
 		reg->map_order = reg->align_order;
 	}
 
+	/*
+	 * Determine stage2 population policy for RAM/ROM regions
+	 * based on populate and fault_around_order DT attributes
+	 */
+	reg->fault_around_order = VMM_REGION_DEF_FAULT_AROUND_ORDER;
+	if (!(reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL)) &&
+	    (reg->flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) &&
+	    !vmm_devtree_read_string(reg->node,
+				VMM_DEVTREE_POPULATE_ATTR_NAME, &aval)) {
+		if (!strcmp(aval, VMM_DEVTREE_POPULATE_VAL_EAGER)) {
+			reg->flags |= VMM_REGION_POPULATE_EAGER;
+		} else if (!strcmp(aval,
+				VMM_DEVTREE_POPULATE_VAL_FAULT_AROUND)) {
+			reg->flags |= VMM_REGION_POPULATE_FAULT_AROUND;
+		} else if (strcmp(aval, VMM_DEVTREE_POPULATE_VAL_LAZY)) {
+			rc = VMM_EINVALID;
+			goto region_dref_shm_fail;
+		}
+
+		i = 0;
+		rc = vmm_devtree_read_u32(reg->node,
+				VMM_DEVTREE_FAULT_AROUND_ORDER_ATTR_NAME, &i);
+		if (!rc && (VMM_PAGE_SHIFT <= i) && (i < 64)) {
+			reg->fault_around_order = i;
+		}
+	}
+
 	/* Compute number of mappings for guest region */
 	reg->maps_count = reg->phys_size >> reg->map_order;
 	if ((((physical_size_t)reg->maps_count) << reg->map_order)
@@ -960,7 +1316,8 @@ static int region_add(struct vmm_guest *guest,
 	if ((reg->flags & VMM_REGION_REAL) &&
 	    !(reg->flags & VMM_REGION_ISALLOCED) &&
 	    !(reg->flags & VMM_REGION_ISCOLORED) &&
-	    !(reg->flags & VMM_REGION_ISSHARED)) {
+	    !(reg->flags & VMM_REGION_ISSHARED) &&
+	    !(reg->flags & VMM_REGION_ISFILE)) {
 		rc = vmm_devtree_read_physaddr(reg->node,
 					VMM_DEVTREE_HOST_PHYS_ATTR_NAME,
 					&reg->maps[0].hphys_addr);
@@ -1129,6 +1486,10 @@ region_ram_free_fail:
 region_free_maps_fail:
 	vmm_free(reg->maps);
 region_dref_shm_fail:
+	if (reg->file) {
+		vmm_guest_file_put(reg->file);
+		reg->file = NULL;
+	}
 	if (reg->shm) {
 		vmm_shmem_dref(reg->shm);
 		reg->shm = NULL;
@@ -1212,6 +1573,19 @@ static int region_del(struct vmm_guest *guest,
 		}
 	}
 
+	/* Release shared file pages and backing file */
+	if (reg->file) {
+		for (i = 0; i < reg->maps_count; i++) {
+			if (reg->maps[i].flags & VMM_REGION_MAPPING_ISFILEPAGE) {
+				vmm_guest_file_put_page(reg->file,
+						reg->maps[i].hphys_addr);
+			}
+			reg->maps[i].flags = 0;
+		}
+		vmm_guest_file_put(reg->file);
+		reg->file = NULL;
+	}
+
 	/* Free region mappings */
 	vmm_free(reg->maps);
 
@@ -1273,6 +1647,14 @@ int vmm_guest_aspace_reset(struct vmm_guest *guest)
 	}
 	vmm_read_unlock_irqrestore_lite(root_lock, flags);
 
+	/* Drop private copies of file-backed RAM regions before
+	 * listeners re-populate stage2 so that they don't map
+	 * freed host RAM.
+	 */
+	vmm_guest_iterate_region(guest,
+			VMM_REGION_MEMORY | VMM_REGION_ISFILE | VMM_REGION_ISRAM,
+			region_file_reset, NULL);
+
 	/*
 	 * Notify the listeners about reset event.
 	 * No locks taken at this point.
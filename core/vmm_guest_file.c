@@ -0,0 +1,342 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_guest_file.c
+ * @author agent (agent@local)
+ * @brief source file for files backing guest RAM/ROM regions
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_stdio.h>
+#include <vmm_mutex.h>
+#include <vmm_scheduler.h>
+#include <vmm_host_ram.h>
+#include <vmm_host_aspace.h>
+#include <vmm_guest_file.h>
+#include <libs/stringlib.h>
+
+/** Shared read-only copy of file contents */
+struct vmm_guest_file_page {
+	struct dlist head;
+	u64 off;
+	physical_size_t len;
+	physical_addr_t hphys_addr;
+	u32 ref;
+};
+
+struct vmm_guest_file {
+	struct dlist head;
+	u32 ref;
+	char *path;
+	void *priv;
+	struct vmm_guest_file_backend *be;
+	struct dlist page_list;
+};
+
+struct vmm_guest_file_ctrl {
+	struct vmm_mutex lock;
+	struct dlist file_list;
+	struct vmm_guest_file_backend *be;
+};
+
+static struct vmm_guest_file_ctrl gfctrl;
+
+int vmm_guest_file_register_backend(struct vmm_guest_file_backend *be)
+{
+	int rc = VMM_OK;
+
+	if (!be || !be->open || !be->close || !be->read) {
+		return VMM_EINVALID;
+	}
+
+	vmm_mutex_lock(&gfctrl.lock);
+	if (gfctrl.be) {
+		rc = VMM_EEXIST;
+	} else {
+		gfctrl.be = be;
+	}
+	vmm_mutex_unlock(&gfctrl.lock);
+
+	return rc;
+}
+
+int vmm_guest_file_unregister_backend(struct vmm_guest_file_backend *be)
+{
+	struct vmm_guest_file *f;
+
+	if (!be) {
+		return VMM_EINVALID;
+	}
+
+	vmm_mutex_lock(&gfctrl.lock);
+
+	if (gfctrl.be != be) {
+		vmm_mutex_unlock(&gfctrl.lock);
+		return VMM_EINVALID;
+	}
+
+	/* Shared copies remain valid but files are re-opened
+	 * using next backend (if any) on next access.
+	 */
+	list_for_each_entry(f, &gfctrl.file_list, head) {
+		if (f->be == be) {
+			be->close(f->priv);
+			f->priv = NULL;
+			f->be = NULL;
+		}
+	}
+	gfctrl.be = NULL;
+
+	vmm_mutex_unlock(&gfctrl.lock);
+
+	return VMM_OK;
+}
+
+struct vmm_guest_file *vmm_guest_file_get(const char *path)
+{
+	struct vmm_guest_file *f;
+
+	if (!path) {
+		return NULL;
+	}
+
+	vmm_mutex_lock(&gfctrl.lock);
+
+	list_for_each_entry(f, &gfctrl.file_list, head) {
+		if (!strcmp(f->path, path)) {
+			f->ref++;
+			vmm_mutex_unlock(&gfctrl.lock);
+			return f;
+		}
+	}
+
+	f = vmm_zalloc(sizeof(*f));
+	if (!f) {
+		vmm_mutex_unlock(&gfctrl.lock);
+		return NULL;
+	}
+	f->path = vmm_zalloc(strlen(path) + 1);
+	if (!f->path) {
+		vmm_free(f);
+		vmm_mutex_unlock(&gfctrl.lock);
+		return NULL;
+	}
+	strcpy(f->path, path);
+	INIT_LIST_HEAD(&f->head);
+	INIT_LIST_HEAD(&f->page_list);
+	f->ref = 1;
+	f->priv = NULL;
+	f->be = NULL;
+	list_add_tail(&f->head, &gfctrl.file_list);
+
+	vmm_mutex_unlock(&gfctrl.lock);
+
+	return f;
+}
+
+void vmm_guest_file_put(struct vmm_guest_file *f)
+{
+	if (!f) {
+		return;
+	}
+
+	vmm_mutex_lock(&gfctrl.lock);
+
+	f->ref--;
+	if (f->ref) {
+		vmm_mutex_unlock(&gfctrl.lock);
+		return;
+	}
+
+	/* All users of shared copies also hold file reference */
+	WARN_ON(!list_empty(&f->page_list));
+
+	list_del(&f->head);
+	if (f->be) {
+		f->be->close(f->priv);
+	}
+
+	vmm_mutex_unlock(&gfctrl.lock);
+
+	vmm_free(f->path);
+	vmm_free(f);
+}
+
+const char *vmm_guest_file_path(struct vmm_guest_file *f)
+{
+	return (f) ? f->path : NULL;
+}
+
+/* Must be called with guest file lock held */
+static int __guest_file_read(struct vmm_guest_file *f, u64 off,
+			     physical_addr_t hphys_addr, physical_size_t len)
+{
+	int rc;
+	size_t rd;
+	virtual_addr_t va;
+
+	if (!f->be) {
+		if (!gfctrl.be) {
+			return VMM_ENODEV;
+		}
+		rc = gfctrl.be->open(f->path, &f->priv);
+		if (rc) {
+			return rc;
+		}
+		f->be = gfctrl.be;
+	}
+
+	/* Host RAM allocated by us so map it and read directly */
+	va = vmm_host_memmap(hphys_addr, len, VMM_MEMORY_FLAGS_NORMAL);
+	if (!va) {
+		return VMM_ENOMEM;
+	}
+
+	rc = f->be->read(f->priv, off, (void *)va, len, &rd);
+	if (!rc && (rd < len)) {
+		/* Zero fill beyond end of file */
+		memset((void *)(va + rd), 0, len - rd);
+	}
+
+	vmm_host_memunmap(va);
+
+	return rc;
+}
+
+int vmm_guest_file_read(struct vmm_guest_file *f, u64 off,
+			physical_addr_t hphys_addr, physical_size_t len)
+{
+	int rc;
+
+	BUG_ON(!vmm_scheduler_orphan_context());
+
+	if (!f || !len) {
+		return VMM_EINVALID;
+	}
+
+	vmm_mutex_lock(&gfctrl.lock);
+	rc = __guest_file_read(f, off, hphys_addr, len);
+	vmm_mutex_unlock(&gfctrl.lock);
+
+	return rc;
+}
+
+int vmm_guest_file_get_page(struct vmm_guest_file *f, u64 off,
+			    physical_size_t len, u32 align_order,
+			    physical_addr_t *hphys_addr)
+{
+	int rc;
+	struct vmm_guest_file_page *p;
+
+	BUG_ON(!vmm_scheduler_orphan_context());
+
+	if (!f || !len || !hphys_addr) {
+		return VMM_EINVALID;
+	}
+
+	vmm_mutex_lock(&gfctrl.lock);
+
+	list_for_each_entry(p, &f->page_list, head) {
+		if ((p->off == off) && (p->len == len) &&
+		    !(p->hphys_addr & ((1ULL << align_order) - 1))) {
+			p->ref++;
+			*hphys_addr = p->hphys_addr;
+			vmm_mutex_unlock(&gfctrl.lock);
+			return VMM_OK;
+		}
+	}
+
+	p = vmm_zalloc(sizeof(*p));
+	if (!p) {
+		vmm_mutex_unlock(&gfctrl.lock);
+		return VMM_ENOMEM;
+	}
+	INIT_LIST_HEAD(&p->head);
+	p->off = off;
+	p->len = len;
+	p->ref = 1;
+
+	if (!vmm_host_ram_alloc(&p->hphys_addr, len, align_order)) {
+		vmm_mutex_unlock(&gfctrl.lock);
+		vmm_free(p);
+		return VMM_ENOMEM;
+	}
+
+	rc = __guest_file_read(f, off, p->hphys_addr, len);
+	if (rc) {
+		vmm_mutex_unlock(&gfctrl.lock);
+		vmm_host_ram_free(p->hphys_addr, len);
+		vmm_free(p);
+		return rc;
+	}
+
+	list_add_tail(&p->head, &f->page_list);
+	*hphys_addr = p->hphys_addr;
+
+	vmm_mutex_unlock(&gfctrl.lock);
+
+	return VMM_OK;
+}
+
+void vmm_guest_file_put_page(struct vmm_guest_file *f,
+			     physical_addr_t hphys_addr)
+{
+	bool found = FALSE;
+	struct vmm_guest_file_page *p;
+
+	if (!f) {
+		return;
+	}
+
+	vmm_mutex_lock(&gfctrl.lock);
+
+	list_for_each_entry(p, &f->page_list, head) {
+		if (p->hphys_addr == hphys_addr) {
+			found = TRUE;
+			break;
+		}
+	}
+	if (!found) {
+		vmm_mutex_unlock(&gfctrl.lock);
+		return;
+	}
+
+	p->ref--;
+	if (p->ref) {
+		vmm_mutex_unlock(&gfctrl.lock);
+		return;
+	}
+	list_del(&p->head);
+
+	vmm_mutex_unlock(&gfctrl.lock);
+
+	vmm_host_ram_free(p->hphys_addr, p->len);
+	vmm_free(p);
+}
+
+int __init vmm_guest_file_init(void)
+{
+	memset(&gfctrl, 0, sizeof(gfctrl));
+
+	INIT_MUTEX(&gfctrl.lock);
+	INIT_LIST_HEAD(&gfctrl.file_list);
+	gfctrl.be = NULL;
+
+	return VMM_OK;
+}
@@ -27,9 +27,13 @@
 #include <vmm_error.h>
 #include <vmm_cache.h>
 #include <vmm_heap.h>
+#include <vmm_limits.h>
 #include <vmm_stdio.h>
+#include <vmm_spinlocks.h>
 #include <vmm_host_aspace.h>
+#include <arch_barrier.h>
 #include <libs/stringlib.h>
+#include <libs/list.h>
 #include <libs/buddy.h>
 
 struct vmm_heap_control {
@@ -41,6 +45,7 @@ struct vmm_heap_control {
 	void *heap_start;
 	physical_addr_t heap_start_pa;
 	unsigned long heap_size;
+	bool need_sync;
 };
 
 static struct vmm_heap_control normal_heap;
@@ -103,13 +108,20 @@ static void heap_free(struct vmm_heap_control *heap, void *ptr)
 	}
 }
 
+static inline bool heap_contains(struct vmm_heap_control *heap,
+				 virtual_addr_t start, virtual_addr_t end)
+{
+	return ((virtual_addr_t)heap->heap_start <= start) &&
+	       (end <= ((virtual_addr_t)heap->heap_start + heap->heap_size));
+}
+
 static int heap_pa2va(struct vmm_heap_control *heap,
 		      physical_addr_t pa, virtual_addr_t *va)
 {
 	int rc = VMM_OK;
 
-	if ((heap->heap_start_pa <= pa) &&
-	    (pa < (heap->heap_start_pa + heap->heap_size))) {
+	if (likely((heap->heap_start_pa <= pa) &&
+		   (pa < (heap->heap_start_pa + heap->heap_size)))) {
 		*va = (virtual_addr_t)heap->heap_start + (pa - heap->heap_start_pa);
 	} else {
 		rc = vmm_host_pa2va(pa, va);
@@ -123,8 +135,9 @@ static int heap_va2pa(struct vmm_heap_control *heap,
 {
 	int rc = VMM_OK;
 
-	if (((virtual_addr_t)heap->heap_start <= va) &&
-	    (va < ((virtual_addr_t)heap->heap_start + heap->heap_size))) {
+	if (likely(((virtual_addr_t)heap->heap_start <= va) &&
+		   (va < ((virtual_addr_t)heap->heap_start +
+			  heap->heap_size)))) {
 		*pa = (physical_addr_t)(va - (virtual_addr_t)heap->heap_start) +
 			heap->heap_start_pa;
 	} else {
@@ -170,6 +183,8 @@ static int heap_init(struct vmm_heap_control *heap,
 	memset(heap, 0, sizeof(*heap));
 
 	heap->heap_size = size_kb * 1024;
+	heap->need_sync = (mem_flags & VMM_MEMORY_CACHEABLE) &&
+			  !(mem_flags & VMM_MEMORY_DMA_COHERENT);
 	heap->heap_start = (void *)vmm_host_alloc_pages(
 					VMM_SIZE_TO_PAGE(heap->heap_size),
 					mem_flags);
@@ -342,8 +357,8 @@ int vmm_is_dma(void *va)
 		(va < (dma_heap.heap_start + dma_heap.heap_size)));
 }
 
-void vmm_dma_sync_for_device(virtual_addr_t start, virtual_addr_t end,
-			     enum vmm_dma_direction dir)
+static void dma_sync_for_device(virtual_addr_t start, virtual_addr_t end,
+				enum vmm_dma_direction dir)
 {
 	if (dir == DMA_FROM_DEVICE) {
 		vmm_inv_dcache_range(start, end);
@@ -354,8 +369,8 @@ void vmm_dma_sync_for_device(virtual_addr_t start, virtual_addr_t end,
 	}
 }
 
-void vmm_dma_sync_for_cpu(virtual_addr_t start, virtual_addr_t end,
-			  enum vmm_dma_direction dir)
+static void dma_sync_for_cpu(virtual_addr_t start, virtual_addr_t end,
+			     enum vmm_dma_direction dir)
 {
 	if (dir == DMA_FROM_DEVICE || dir == DMA_BIDIRECTIONAL) {
 		/* Cache prefetching */
@@ -364,6 +379,30 @@ void vmm_dma_sync_for_cpu(virtual_addr_t start, virtual_addr_t end,
 	}
 }
 
+void vmm_dma_sync_for_device(virtual_addr_t start, virtual_addr_t end,
+			     enum vmm_dma_direction dir)
+{
+	/* DMA heap is not cached so only order CPU writes */
+	if (!dma_heap.need_sync && heap_contains(&dma_heap, start, end)) {
+		arch_wmb();
+		return;
+	}
+
+	dma_sync_for_device(start, end, dir);
+}
+
+void vmm_dma_sync_for_cpu(virtual_addr_t start, virtual_addr_t end,
+			  enum vmm_dma_direction dir)
+{
+	/* DMA heap is not cached so only order CPU reads */
+	if (!dma_heap.need_sync && heap_contains(&dma_heap, start, end)) {
+		arch_rmb();
+		return;
+	}
+
+	dma_sync_for_cpu(start, end, dir);
+}
+
 physical_addr_t vmm_dma_map(virtual_addr_t vaddr, virtual_size_t size,
 			    enum vmm_dma_direction dir)
 {
@@ -380,6 +419,79 @@ void vmm_dma_unmap(physical_addr_t dma_addr, physical_size_t size,
 	vmm_dma_sync_for_cpu(vaddr, vaddr + size, dir);
 }
 
+static void dma_sync_sg(struct vmm_dma_sg *sg, u32 nents,
+			enum vmm_dma_direction dir,
+			void (*sync)(virtual_addr_t start, virtual_addr_t end,
+				     enum vmm_dma_direction dir))
+{
+	u32 i;
+	virtual_addr_t start, end, rstart = 0, rend = 0;
+
+	/* Merge buffers sharing or touching cache lines into
+	 * one range so that each cache line is maintained once
+	 * and there is only one barrier per range.
+	 */
+	for (i = 0; i < nents; i++) {
+		start = sg[i].vaddr;
+		end = sg[i].vaddr + sg[i].len;
+		if (!dma_heap.need_sync && heap_contains(&dma_heap, start, end)) {
+			continue;
+		}
+
+		start &= ~((virtual_addr_t)VMM_CACHE_LINE_SIZE - 1);
+		end = VMM_CACHE_ALIGN(end);
+		if ((rstart < rend) && (start <= rend) && (rstart <= end)) {
+			rstart = min(rstart, start);
+			rend = max(rend, end);
+			continue;
+		}
+
+		if (rstart < rend) {
+			sync(rstart, rend, dir);
+		}
+		rstart = start;
+		rend = end;
+	}
+
+	if (rstart < rend) {
+		sync(rstart, rend, dir);
+	}
+}
+
+int vmm_dma_map_sg(struct vmm_dma_sg *sg, u32 nents,
+		   enum vmm_dma_direction dir)
+{
+	int rc;
+	u32 i;
+
+	if (!sg || !nents) {
+		return VMM_EINVALID;
+	}
+
+	for (i = 0; i < nents; i++) {
+		rc = heap_va2pa(&dma_heap, sg[i].vaddr, &sg[i].daddr);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	dma_sync_sg(sg, nents, dir, dma_sync_for_device);
+	arch_wmb();
+
+	return VMM_OK;
+}
+
+void vmm_dma_unmap_sg(struct vmm_dma_sg *sg, u32 nents,
+		      enum vmm_dma_direction dir)
+{
+	if (!sg || !nents) {
+		return;
+	}
+
+	dma_sync_sg(sg, nents, dir, dma_sync_for_cpu);
+	arch_rmb();
+}
+
 virtual_size_t vmm_dma_alloc_size(const void *ptr)
 {
 	return heap_alloc_size(&dma_heap, ptr);
@@ -390,6 +502,164 @@ void vmm_dma_free(void *ptr)
 	heap_free(&dma_heap, ptr);
 }
 
+struct vmm_dma_pool_chunk {
+	struct dlist head;
+	void *va;
+};
+
+struct vmm_dma_pool {
+	char name[VMM_FIELD_NAME_SIZE];
+	vmm_spinlock_t lock;
+	virtual_size_t blk_size;
+	virtual_size_t align;
+	virtual_size_t chunk_size;
+	struct dlist chunk_list;
+	/* Free blocks are linked using their first word */
+	void *free_blk;
+};
+
+struct vmm_dma_pool *vmm_dma_pool_create(const char *name,
+					 virtual_size_t size,
+					 virtual_size_t align)
+{
+	struct vmm_dma_pool *pool;
+
+	if (!name || !size || (align & (align - 1))) {
+		return NULL;
+	}
+
+	pool = vmm_zalloc(sizeof(*pool));
+	if (!pool) {
+		return NULL;
+	}
+
+	strlcpy(pool->name, name, sizeof(pool->name));
+	INIT_SPIN_LOCK(&pool->lock);
+	INIT_LIST_HEAD(&pool->chunk_list);
+	pool->free_blk = NULL;
+
+	/* DMA heap allocations are always cache line aligned */
+	pool->align = max(align, (virtual_size_t)VMM_CACHE_LINE_SIZE);
+	pool->blk_size = align(max(size, (virtual_size_t)sizeof(void *)),
+			       pool->align);
+	pool->chunk_size = align(pool->blk_size, VMM_PAGE_SIZE);
+	if (pool->align > VMM_CACHE_LINE_SIZE) {
+		pool->chunk_size += pool->align;
+	}
+
+	return pool;
+}
+
+void vmm_dma_pool_destroy(struct vmm_dma_pool *pool)
+{
+	struct vmm_dma_pool_chunk *c, *nc;
+
+	if (!pool) {
+		return;
+	}
+
+	list_for_each_entry_safe(c, nc, &pool->chunk_list, head) {
+		list_del(&c->head);
+		heap_free(&dma_heap, c->va);
+		vmm_free(c);
+	}
+
+	vmm_free(pool);
+}
+
+static int dma_pool_grow(struct vmm_dma_pool *pool)
+{
+	irq_flags_t flags;
+	virtual_addr_t blk, end;
+	void *first = NULL, *last = NULL;
+	struct vmm_dma_pool_chunk *c;
+
+	c = vmm_zalloc(sizeof(*c));
+	if (!c) {
+		return VMM_ENOMEM;
+	}
+	INIT_LIST_HEAD(&c->head);
+
+	c->va = heap_malloc(&dma_heap, pool->chunk_size);
+	if (!c->va) {
+		vmm_free(c);
+		return VMM_ENOMEM;
+	}
+
+	/* Carve chunk into blocks outside pool lock */
+	blk = align((virtual_addr_t)c->va, pool->align);
+	end = (virtual_addr_t)c->va + pool->chunk_size;
+	for (; (blk + pool->blk_size) <= end; blk += pool->blk_size) {
+		*(void **)blk = NULL;
+		if (last) {
+			*(void **)last = (void *)blk;
+		} else {
+			first = (void *)blk;
+		}
+		last = (void *)blk;
+	}
+
+	vmm_spin_lock_irqsave(&pool->lock, flags);
+	list_add_tail(&c->head, &pool->chunk_list);
+	*(void **)last = pool->free_blk;
+	pool->free_blk = first;
+	vmm_spin_unlock_irqrestore(&pool->lock, flags);
+
+	return VMM_OK;
+}
+
+void *vmm_dma_pool_alloc(struct vmm_dma_pool *pool, physical_addr_t *daddr)
+{
+	void *blk;
+	irq_flags_t flags;
+
+	if (!pool) {
+		return NULL;
+	}
+
+	vmm_spin_lock_irqsave(&pool->lock, flags);
+	while (!pool->free_blk) {
+		vmm_spin_unlock_irqrestore(&pool->lock, flags);
+		if (dma_pool_grow(pool)) {
+			vmm_printf("%s: pool=%s failed to grow\n",
+				   __func__, pool->name);
+			return NULL;
+		}
+		vmm_spin_lock_irqsave(&pool->lock, flags);
+	}
+	blk = pool->free_blk;
+	pool->free_blk = *(void **)blk;
+	vmm_spin_unlock_irqrestore(&pool->lock, flags);
+
+	memset(blk, 0, pool->blk_size);
+
+	/* Blocks are always on DMA heap so this is simple arithmetic */
+	if (daddr) {
+		*daddr = (physical_addr_t)((virtual_addr_t)blk -
+			 (virtual_addr_t)dma_heap.heap_start) +
+			 dma_heap.heap_start_pa;
+	}
+
+	return blk;
+}
+
+void vmm_dma_pool_free(struct vmm_dma_pool *pool, void *vaddr)
+{
+	irq_flags_t flags;
+
+	if (!pool || !vaddr) {
+		return;
+	}
+
+	BUG_ON(!heap_contains(&dma_heap, (virtual_addr_t)vaddr,
+			      (virtual_addr_t)vaddr + pool->blk_size));
+
+	vmm_spin_lock_irqsave(&pool->lock, flags);
+	*(void **)vaddr = pool->free_blk;
+	pool->free_blk = vaddr;
+	vmm_spin_unlock_irqrestore(&pool->lock, flags);
+}
+
 virtual_addr_t vmm_dma_heap_start_va(void)
 {
 	return (virtual_addr_t)dma_heap.heap_start;
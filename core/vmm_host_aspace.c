@@ -39,11 +39,13 @@ static virtual_addr_t host_mem_rw_va[CONFIG_CPU_COUNT];
 
 struct host_mhash_entry {
 	struct rb_node rb;
+	struct dlist free_head;
 	physical_addr_t pa;
 	virtual_addr_t va;
 	virtual_size_t sz;
 	u32 mem_flags;
 	u32 ref_count;
+	bool blocks;	/* mapped using block (or section) mappings */
 };
 
 struct host_mhash_ctrl {
@@ -52,6 +54,7 @@ struct host_mhash_ctrl {
 	virtual_size_t size;
 	u32 count;
 	struct rb_root root;
+	struct dlist free_list;
 	struct host_mhash_entry *entry;
 };
 
@@ -60,20 +63,27 @@ static struct host_mhash_ctrl host_mhash;
 /* NOTE: Must be called with write lock held on host_mhash.lock */
 static struct host_mhash_entry *__host_mhash_alloc(void)
 {
-	u32 i;
-	struct host_mhash_entry *e = NULL;
+	struct host_mhash_entry *e;
 
-	for (i = 0; i < host_mhash.count; i++) {
-		if (!host_mhash.entry[i].ref_count) {
-			e = &host_mhash.entry[i];
-			e->ref_count = 1;
-			break;
-		}
+	if (list_empty(&host_mhash.free_list)) {
+		return NULL;
 	}
 
+	e = list_entry(list_pop(&host_mhash.free_list),
+		       struct host_mhash_entry, free_head);
+	e->ref_count = 1;
+
 	return e;
 }
 
+/* NOTE: Must be called with write lock held on host_mhash.lock */
+static void __host_mhash_free(struct host_mhash_entry *e)
+{
+	memset(e, 0, sizeof(*e));
+	RB_CLEAR_NODE(&e->rb);
+	list_add(&e->free_head, &host_mhash.free_list);
+}
+
 /* NOTE: Must be called with read/write lock held on host_mhash.lock */
 static struct host_mhash_entry *__host_mhash_find(physical_addr_t pa)
 {
@@ -103,7 +113,8 @@ static struct host_mhash_entry *__host_mhash_find(physical_addr_t pa)
 static int host_mhash_add(physical_addr_t pa,
 			  virtual_addr_t va,
 			  virtual_size_t sz,
-			  u32 mem_flags)
+			  u32 mem_flags,
+			  bool blocks)
 {
 	int rc = VMM_OK;
 	irq_flags_t flags;
@@ -135,6 +146,7 @@ static int host_mhash_add(physical_addr_t pa,
 		e->va = va;
 		e->sz = sz;
 		e->mem_flags = mem_flags;
+		e->blocks = blocks;
 
 		new = &(host_mhash.root.rb_node);
 		while (*new) {
@@ -188,6 +200,13 @@ static int host_mhash_del(physical_addr_t pa,
 		goto done;
 	}
 
+	/* Unmapping part of a block would also unmap the residue */
+	if ((e->ref_count == 1) && e->blocks &&
+	    ((va != e->va) || (sz != e->sz))) {
+		rc = VMM_ENOTSUPP;
+		goto done;
+	}
+
 	e->ref_count--;
 	if (e->ref_count) {
 		rc = VMM_EBUSY;
@@ -204,21 +223,22 @@ static int host_mhash_del(physical_addr_t pa,
 	rsz[1] = (e->va + e->sz) - (va + sz);
 	rflags = e->mem_flags;
 
-	memset(e, 0, sizeof(*e));
-	RB_CLEAR_NODE(&e->rb);
+	__host_mhash_free(e);
 
 done:
 	vmm_write_unlock_irqrestore(&host_mhash.lock, flags);
 
 	if (rsz[0]) {
-		if ((rc = host_mhash_add(rpa[0], rva[0], rsz[0], rflags))) {
+		if ((rc = host_mhash_add(rpa[0], rva[0], rsz[0],
+					     rflags, FALSE))) {
 			vmm_panic("%s: can't add left residue error=%d\n",
 				  __func__, rc);
 		}
 	}
 
 	if (rsz[1]) {
-		if ((rc = host_mhash_add(rpa[1], rva[1], rsz[1], rflags))) {
+		if ((rc = host_mhash_add(rpa[1], rva[1], rsz[1],
+					     rflags, FALSE))) {
 			vmm_panic("%s: can't add right residue error=%d\n",
 				  __func__, rc);
 		}
@@ -273,6 +293,7 @@ static int host_mhash_init(virtual_addr_t mhash_start,
 	host_mhash.size = mhash_size;
 	host_mhash.count = mhash_size / sizeof(struct host_mhash_entry);
 	host_mhash.root = RB_ROOT;
+	INIT_LIST_HEAD(&host_mhash.free_list);
 	host_mhash.entry = (struct host_mhash_entry *)host_mhash.start;
 
 	if (!host_mhash.count) {
@@ -281,8 +302,7 @@ static int host_mhash_init(virtual_addr_t mhash_start,
 
 	for (i = 0; i < host_mhash.count; i++) {
 		e = &host_mhash.entry[i];
-		memset(e, 0, sizeof(*e));
-		RB_CLEAR_NODE(&e->rb);
+		__host_mhash_free(e);
 	}
 
 	return VMM_OK;
@@ -292,9 +312,11 @@ static virtual_addr_t host_memmap(physical_addr_t pa,
 				  virtual_size_t sz,
 				  u32 mem_flags)
 {
-	int rc, ite;
+	int rc;
+	bool blocks = FALSE;
 	virtual_addr_t va = 0;
 	virtual_addr_t tsz = 0;
+	virtual_size_t off, psz;
 	physical_addr_t tpa = 0;
 	u32 tmem_flags = 0;
 
@@ -327,20 +349,36 @@ static virtual_addr_t host_memmap(physical_addr_t pa,
 				  __func__, rc);
 		}
 
-		for (ite = 0; ite < (sz >> VMM_PAGE_SHIFT); ite++) {
-			rc = arch_cpu_aspace_map(va + ite * VMM_PAGE_SIZE,
-						tpa + ite * VMM_PAGE_SIZE,
-						mem_flags);
+		/* Use block (or section) mappings wherever possible
+		 * so that large areas need fewer page table entries
+		 * and TLB entries. The block mapping can fail if page
+		 * table already exists for the block so we fallback
+		 * to normal page mapping in this case.
+		 */
+		for (off = 0; off < sz; off += psz) {
+			psz = arch_cpu_aspace_best_page_size(va + off,
+							     tpa + off,
+							     sz - off);
+			rc = arch_cpu_aspace_map(va + off, psz,
+						 tpa + off, mem_flags);
+			if (rc && (psz != VMM_PAGE_SIZE)) {
+				psz = VMM_PAGE_SIZE;
+				rc = arch_cpu_aspace_map(va + off, psz,
+							 tpa + off, mem_flags);
+			}
 			if (rc) {
 				/* We were not able to map physical address */
 				vmm_panic("%s: failed to create VA->PA "
 					  "mapping error=%d\n",
 					  __func__, rc);
 			}
+			if (psz != VMM_PAGE_SIZE) {
+				blocks = TRUE;
+			}
 		}
 	}
 
-	if ((rc = host_mhash_add(tpa, va, sz, mem_flags))) {
+	if ((rc = host_mhash_add(tpa, va, sz, mem_flags, blocks))) {
 		/* Failed to update MEMMAP HASH */
 		vmm_panic("%s: failed to add memmap hash entry error=%d\n",
 			  __func__, rc);
@@ -351,7 +389,8 @@ static virtual_addr_t host_memmap(physical_addr_t pa,
 
 static int host_memunmap(virtual_addr_t va, virtual_size_t sz)
 {
-	int rc, ite;
+	int rc;
+	virtual_size_t off, psz;
 	physical_addr_t pa = 0x0;
 
 	sz = VMM_ROUNDUP2_PAGE_SIZE(sz);
@@ -364,12 +403,15 @@ static int host_memunmap(virtual_addr_t va, virtual_size_t sz)
 	rc = host_mhash_del(pa, va, sz);
 	if (rc == VMM_EBUSY) {
 		return VMM_OK;
+	} else if (rc == VMM_ENOTSUPP) {
+		/* Partial unmap of block mapped area */
+		return rc;
 	} else if (rc != VMM_OK) {
 		vmm_panic("%s: unhandled error=%d\n", __func__, rc);
 	}
 
-	for (ite = 0; ite < (sz >> VMM_PAGE_SHIFT); ite++) {
-		rc = arch_cpu_aspace_unmap(va + ite * VMM_PAGE_SIZE);
+	for (off = 0; off < sz; off += psz) {
+		rc = arch_cpu_aspace_unmap(va + off, &psz);
 		if (rc) {
 			return rc;
 		}
@@ -499,7 +541,8 @@ u32 vmm_host_memory_read(physical_addr_t hpa,
 		arch_cpu_irq_save(flags);
 
 #if !defined(ARCH_HAS_MEMORY_READWRITE)
-		rc = arch_cpu_aspace_map(tmp_va, hpa & ~VMM_PAGE_MASK,
+		rc = arch_cpu_aspace_map(tmp_va, VMM_PAGE_SIZE,
+					 hpa & ~VMM_PAGE_MASK,
 					 (cacheable) ?
 					 VMM_MEMORY_FLAGS_NORMAL :
 					 VMM_MEMORY_FLAGS_NORMAL_NOCACHE);
@@ -509,7 +552,7 @@ u32 vmm_host_memory_read(physical_addr_t hpa,
 
 		memcpy(dst, (void *)(tmp_va + page_offset), page_read);
 
-		rc = arch_cpu_aspace_unmap(tmp_va);
+		rc = arch_cpu_aspace_unmap(tmp_va, NULL);
 		if (rc) {
 			break;
 		}
@@ -552,7 +595,8 @@ u32 vmm_host_memory_write(physical_addr_t hpa,
 		arch_cpu_irq_save(flags);
 
 #if !defined(ARCH_HAS_MEMORY_READWRITE)
-		rc = arch_cpu_aspace_map(tmp_va, hpa & ~VMM_PAGE_MASK,
+		rc = arch_cpu_aspace_map(tmp_va, VMM_PAGE_SIZE,
+					 hpa & ~VMM_PAGE_MASK,
 					 (cacheable) ?
 					 VMM_MEMORY_FLAGS_NORMAL :
 					 VMM_MEMORY_FLAGS_NORMAL_NOCACHE);
@@ -562,7 +606,7 @@ u32 vmm_host_memory_write(physical_addr_t hpa,
 
 		memcpy((void *)(tmp_va + page_offset), src, page_write);
 
-		rc = arch_cpu_aspace_unmap(tmp_va);
+		rc = arch_cpu_aspace_unmap(tmp_va, NULL);
 		if (rc) {
 			break;
 		}
@@ -803,10 +847,11 @@ int __cpuinit vmm_host_aspace_init(void)
 				       core_resv_sz))) {
 		return rc;
 	}
+	/* Arch may have used block mappings for reserved area */
 	if ((rc = host_mhash_add(core_resv_pa,
 				 core_resv_va,
 				 core_resv_sz,
-				 VMM_MEMORY_FLAGS_NORMAL))) {
+				 VMM_MEMORY_FLAGS_NORMAL, TRUE))) {
 		return rc;
 	}
 
@@ -0,0 +1,410 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_lockstat.c
+ * @author agent (agent@local)
+ * @brief Lock contention statistics
+ *
+ * Lock classes are allocated from a static pool so that lock
+ * operations can be accounted from the very first lock taken at boot
+ * time, well before heap is available. The class lookup is done only
+ * once per lock instance and cached in the lock itself.
+ *
+ * Everything here uses raw arch locks because vmm_spinlock_t is
+ * itself accounted by this code.
+ */
+
+#include <vmm_error.h>
+#include <vmm_smp.h>
+#include <vmm_timer.h>
+#include <vmm_spinlocks.h>
+#include <vmm_lockstat.h>
+#include <arch_cpu_irq.h>
+#include <arch_locks.h>
+#include <libs/stringlib.h>
+
+#define LOCKSTAT_HASH_BITS		7
+#define LOCKSTAT_HASH_SIZE		(1 << LOCKSTAT_HASH_BITS)
+
+struct vmm_lockstat_class {
+	const char *name;
+	const char *site;
+	enum vmm_lockstat_types type;
+	struct vmm_lockstat_class *hash_next;
+	struct vmm_lockstat_counters cpu[CONFIG_CPU_COUNT];
+};
+
+struct vmm_lockstat_ctrl {
+	arch_spinlock_t lock;
+	u32 class_count;
+	u32 overflow;
+	struct vmm_lockstat_class *hash[LOCKSTAT_HASH_SIZE];
+	struct vmm_lockstat_class catchall[VMM_LOCKSTAT_MAX_TYPES];
+	struct vmm_lockstat_class classes[CONFIG_LOCKSTAT_MAX_CLASSES];
+};
+
+static struct vmm_lockstat_ctrl lsctrl = {
+	.lock = ARCH_SPIN_LOCK_INITIALIZER,
+	.class_count = 0,
+	.overflow = 0,
+};
+
+static const char *lockstat_type_names[VMM_LOCKSTAT_MAX_TYPES] = {
+	"spinlock", "rwlock", "mutex",
+};
+
+static u32 __notrace lockstat_hash(const char *site,
+				   enum vmm_lockstat_types type)
+{
+	u32 h = 5381 + type;
+
+	while (*site) {
+		h = (h << 5) + h + (u8)(*site);
+		site++;
+	}
+
+	return h & (LOCKSTAT_HASH_SIZE - 1);
+}
+
+static struct vmm_lockstat_class * __notrace lockstat_class_find(
+					struct vmm_lockstat_lock *ls,
+					enum vmm_lockstat_types type)
+{
+	u32 h;
+	irq_flags_t flags;
+	struct vmm_lockstat_class *c;
+
+	if (!ls->site) {
+		c = &lsctrl.catchall[type];
+		ls->class = c;
+		return c;
+	}
+
+	h = lockstat_hash(ls->site, type);
+
+	arch_cpu_irq_save(flags);
+	arch_spin_lock(&lsctrl.lock);
+
+	for (c = lsctrl.hash[h]; c; c = c->hash_next) {
+		if (c->type == type && !strcmp(c->site, ls->site)) {
+			break;
+		}
+	}
+
+	if (!c) {
+		if (lsctrl.class_count < CONFIG_LOCKSTAT_MAX_CLASSES) {
+			c = &lsctrl.classes[lsctrl.class_count];
+			c->name = ls->name;
+			c->site = ls->site;
+			c->type = type;
+			c->hash_next = lsctrl.hash[h];
+			lsctrl.hash[h] = c;
+			lsctrl.class_count++;
+		} else {
+			lsctrl.overflow++;
+			c = &lsctrl.catchall[type];
+		}
+	}
+
+	arch_spin_unlock(&lsctrl.lock);
+	arch_cpu_irq_restore(flags);
+
+	ls->class = c;
+
+	return c;
+}
+
+static inline struct vmm_lockstat_class *lockstat_class(
+					struct vmm_lockstat_lock *ls,
+					enum vmm_lockstat_types type)
+{
+	return (ls->class) ? ls->class : lockstat_class_find(ls, type);
+}
+
+static void __notrace lockstat_acquired(struct vmm_lockstat_lock *ls,
+					enum vmm_lockstat_types type,
+					bool contended, u64 wait_start,
+					u64 now, bool track_hold)
+{
+	u64 wait;
+	irq_flags_t flags;
+	struct vmm_lockstat_counters *cnt;
+	struct vmm_lockstat_class *c = lockstat_class(ls, type);
+
+	if (track_hold) {
+		ls->acquire_tstamp = now;
+	}
+
+	arch_cpu_irq_save(flags);
+
+	cnt = &c->cpu[vmm_smp_processor_id()];
+	cnt->acquired++;
+	if (contended) {
+		wait = (wait_start < now) ? (now - wait_start) : 0;
+		cnt->contended++;
+		cnt->wait_total += wait;
+		if (cnt->wait_max < wait) {
+			cnt->wait_max = wait;
+		}
+	}
+
+	arch_cpu_irq_restore(flags);
+}
+
+static void __notrace lockstat_released(struct vmm_lockstat_lock *ls,
+					enum vmm_lockstat_types type)
+{
+	u64 hold, now;
+	irq_flags_t flags;
+	struct vmm_lockstat_counters *cnt;
+	struct vmm_lockstat_class *c = lockstat_class(ls, type);
+
+	now = vmm_timer_timestamp();
+	hold = (ls->acquire_tstamp < now) ? (now - ls->acquire_tstamp) : 0;
+
+	arch_cpu_irq_save(flags);
+
+	cnt = &c->cpu[vmm_smp_processor_id()];
+	cnt->held++;
+	cnt->hold_total += hold;
+	if (cnt->hold_max < hold) {
+		cnt->hold_max = hold;
+	}
+
+	arch_cpu_irq_restore(flags);
+}
+
+void __notrace vmm_lockstat_spin_lock(arch_spinlock_t *tlock,
+				      struct vmm_lockstat_lock *ls)
+{
+	u64 start;
+
+	if (arch_spin_trylock(tlock)) {
+		lockstat_acquired(ls, VMM_LOCKSTAT_SPINLOCK, FALSE, 0,
+				  vmm_timer_timestamp(), TRUE);
+		return;
+	}
+
+	start = vmm_timer_timestamp();
+	arch_spin_lock(tlock);
+	lockstat_acquired(ls, VMM_LOCKSTAT_SPINLOCK, TRUE, start,
+			  vmm_timer_timestamp(), TRUE);
+}
+
+int __notrace vmm_lockstat_spin_trylock(arch_spinlock_t *tlock,
+					struct vmm_lockstat_lock *ls)
+{
+	if (!arch_spin_trylock(tlock)) {
+		return 0;
+	}
+
+	lockstat_acquired(ls, VMM_LOCKSTAT_SPINLOCK, FALSE, 0,
+			  vmm_timer_timestamp(), TRUE);
+
+	return 1;
+}
+
+void __notrace vmm_lockstat_spin_unlock(arch_spinlock_t *tlock,
+					struct vmm_lockstat_lock *ls)
+{
+	lockstat_released(ls, VMM_LOCKSTAT_SPINLOCK);
+	arch_spin_unlock(tlock);
+}
+
+void __notrace vmm_lockstat_write_lock(arch_rwlock_t *tlock,
+				       struct vmm_lockstat_lock *ls)
+{
+	u64 start;
+
+	if (arch_write_trylock(tlock)) {
+		lockstat_acquired(ls, VMM_LOCKSTAT_RWLOCK, FALSE, 0,
+				  vmm_timer_timestamp(), TRUE);
+		return;
+	}
+
+	start = vmm_timer_timestamp();
+	arch_write_lock(tlock);
+	lockstat_acquired(ls, VMM_LOCKSTAT_RWLOCK, TRUE, start,
+			  vmm_timer_timestamp(), TRUE);
+}
+
+int __notrace vmm_lockstat_write_trylock(arch_rwlock_t *tlock,
+					 struct vmm_lockstat_lock *ls)
+{
+	if (!arch_write_trylock(tlock)) {
+		return 0;
+	}
+
+	lockstat_acquired(ls, VMM_LOCKSTAT_RWLOCK, FALSE, 0,
+			  vmm_timer_timestamp(), TRUE);
+
+	return 1;
+}
+
+void __notrace vmm_lockstat_write_unlock(arch_rwlock_t *tlock,
+					 struct vmm_lockstat_lock *ls)
+{
+	lockstat_released(ls, VMM_LOCKSTAT_RWLOCK);
+	arch_write_unlock(tlock);
+}
+
+void __notrace vmm_lockstat_read_lock(arch_rwlock_t *tlock,
+				      struct vmm_lockstat_lock *ls)
+{
+	u64 start;
+
+	/* Readers share the lock so only wait time is accounted */
+	if (arch_read_trylock(tlock)) {
+		lockstat_acquired(ls, VMM_LOCKSTAT_RWLOCK, FALSE, 0, 0, FALSE);
+		return;
+	}
+
+	start = vmm_timer_timestamp();
+	arch_read_lock(tlock);
+	lockstat_acquired(ls, VMM_LOCKSTAT_RWLOCK, TRUE, start,
+			  vmm_timer_timestamp(), FALSE);
+}
+
+int __notrace vmm_lockstat_read_trylock(arch_rwlock_t *tlock,
+					struct vmm_lockstat_lock *ls)
+{
+	if (!arch_read_trylock(tlock)) {
+		return 0;
+	}
+
+	lockstat_acquired(ls, VMM_LOCKSTAT_RWLOCK, FALSE, 0, 0, FALSE);
+
+	return 1;
+}
+
+void __notrace vmm_lockstat_mutex_acquired(struct vmm_lockstat_lock *ls,
+					   bool contended, u64 wait_start)
+{
+	lockstat_acquired(ls, VMM_LOCKSTAT_MUTEX, contended, wait_start,
+			  vmm_timer_timestamp(), TRUE);
+}
+
+void __notrace vmm_lockstat_mutex_released(struct vmm_lockstat_lock *ls)
+{
+	lockstat_released(ls, VMM_LOCKSTAT_MUTEX);
+}
+
+u64 vmm_lockstat_timestamp(void)
+{
+	return vmm_timer_timestamp();
+}
+
+u32 vmm_lockstat_class_count(void)
+{
+	return lsctrl.class_count + VMM_LOCKSTAT_MAX_TYPES;
+}
+
+static int lockstat_class_info(struct vmm_lockstat_class *c,
+			       struct vmm_lockstat_info *info)
+{
+	u32 cpu;
+	struct vmm_lockstat_counters *cnt, *sum = &info->counters;
+
+	memset(info, 0, sizeof(*info));
+	info->name = c->name;
+	info->site = c->site;
+	info->type = c->type;
+
+	for (cpu = 0; cpu < CONFIG_CPU_COUNT; cpu++) {
+		cnt = &c->cpu[cpu];
+		sum->acquired += cnt->acquired;
+		sum->contended += cnt->contended;
+		sum->wait_total += cnt->wait_total;
+		if (sum->wait_max < cnt->wait_max) {
+			sum->wait_max = cnt->wait_max;
+		}
+		sum->held += cnt->held;
+		sum->hold_total += cnt->hold_total;
+		if (sum->hold_max < cnt->hold_max) {
+			sum->hold_max = cnt->hold_max;
+		}
+	}
+
+	return (sum->acquired) ? VMM_OK : VMM_ENOENT;
+}
+
+int vmm_lockstat_iterate(int (*iter)(struct vmm_lockstat_info *info,
+				     void *priv),
+			 void *priv)
+{
+	int rc;
+	u32 i, count;
+	struct vmm_lockstat_info info;
+	struct vmm_lockstat_class *c;
+
+	if (!iter) {
+		return VMM_EINVALID;
+	}
+
+	for (i = 0; i < VMM_LOCKSTAT_MAX_TYPES; i++) {
+		c = &lsctrl.catchall[i];
+		if (lockstat_class_info(c, &info)) {
+			continue;
+		}
+		info.name = "(other)";
+		info.site = (lsctrl.overflow) ?
+			    "(class pool exhausted)" : "(unknown)";
+		info.type = i;
+		if ((rc = iter(&info, priv))) {
+			return rc;
+		}
+	}
+
+	/* Classes are never freed so a snapshot of count is enough */
+	count = lsctrl.class_count;
+	for (i = 0; i < count; i++) {
+		if (lockstat_class_info(&lsctrl.classes[i], &info)) {
+			continue;
+		}
+		if ((rc = iter(&info, priv))) {
+			return rc;
+		}
+	}
+
+	return VMM_OK;
+}
+
+const char *vmm_lockstat_type_name(enum vmm_lockstat_types type)
+{
+	if (VMM_LOCKSTAT_MAX_TYPES <= type) {
+		return "unknown";
+	}
+
+	return lockstat_type_names[type];
+}
+
+void vmm_lockstat_reset(void)
+{
+	u32 i, count;
+
+	for (i = 0; i < VMM_LOCKSTAT_MAX_TYPES; i++) {
+		memset(lsctrl.catchall[i].cpu, 0,
+		       sizeof(lsctrl.catchall[i].cpu));
+	}
+
+	count = lsctrl.class_count;
+	for (i = 0; i < count; i++) {
+		memset(lsctrl.classes[i].cpu, 0,
+		       sizeof(lsctrl.classes[i].cpu));
+	}
+}
@@ -36,6 +36,7 @@
 #include <vmm_timer.h>
 #include <vmm_delay.h>
 #include <vmm_shmem.h>
+#include <vmm_guest_file.h>
 #include <vmm_manager.h>
 #include <vmm_scheduler.h>
 #include <vmm_loadbal.h>
@@ -461,6 +462,13 @@ static void __init init_bootcpu(void)
 		goto init_bootcpu_fail;
 	}
 
+	/* Initialize guest file-backed regions */
+	vmm_printf("init: guest file-backed regions\n");
+	ret = vmm_guest_file_init();
+	if (ret) {
+		goto init_bootcpu_fail;
+	}
+
 	/* Initialize hypervisor manager */
 	vmm_printf("init: hypervisor manager\n");
 	ret = vmm_manager_init();
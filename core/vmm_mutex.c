@@ -40,6 +40,9 @@ void __vmm_mutex_cleanup(struct vmm_vcpu *vcpu,
 	vmm_spin_lock_irqsave(&mut->wq.lock, flags);
 
 	if (mut->lock && mut->owner == vcpu) {
+#if defined(CONFIG_LOCKSTAT)
+		vmm_lockstat_mutex_released(&mut->ls);
+#endif
 		mut->lock = 0;
 		mut->owner = NULL;
 		__vmm_waitqueue_wakeall(&mut->wq);
@@ -90,6 +93,9 @@ int vmm_mutex_unlock(struct vmm_mutex *mut)
 	if (mut->lock && mut->owner == current_vcpu) {
 		mut->lock--;
 		if (!mut->lock) {
+#if defined(CONFIG_LOCKSTAT)
+			vmm_lockstat_mutex_released(&mut->ls);
+#endif
 			mut->owner = NULL;
 			vmm_manager_vcpu_resource_remove(current_vcpu,
 							 &mut->res);
@@ -121,6 +127,9 @@ int vmm_mutex_trylock(struct vmm_mutex *mut)
 		mut->lock++;
 		vmm_manager_vcpu_resource_add(current_vcpu, &mut->res);
 		mut->owner = current_vcpu;
+#if defined(CONFIG_LOCKSTAT)
+		vmm_lockstat_mutex_acquired(&mut->ls, FALSE, 0);
+#endif
 		ret = 1;
 	} else if (mut->owner == current_vcpu) {
 		/*
@@ -140,6 +149,10 @@ static int mutex_lock_common(struct vmm_mutex *mut, u64 *timeout)
 {
 	int rc = VMM_OK;
 	irq_flags_t flags;
+#if defined(CONFIG_LOCKSTAT)
+	bool contended = FALSE;
+	u64 wait_start = 0;
+#endif
 	struct vmm_vcpu *current_vcpu = vmm_scheduler_current_vcpu();
 
 	BUG_ON(!mut);
@@ -155,6 +168,12 @@ static int mutex_lock_common(struct vmm_mutex *mut, u64 *timeout)
 		if (mut->owner == current_vcpu) {
 			break;
 		}
+#if defined(CONFIG_LOCKSTAT)
+		if (!contended) {
+			contended = TRUE;
+			wait_start = vmm_lockstat_timestamp();
+		}
+#endif
 		rc = __vmm_waitqueue_sleep(&mut->wq, timeout);
 		if (rc) {
 			/* Timeout or some other failure */
@@ -167,6 +186,10 @@ static int mutex_lock_common(struct vmm_mutex *mut, u64 *timeout)
 			vmm_manager_vcpu_resource_add(current_vcpu,
 						      &mut->res);
 			mut->owner = current_vcpu;
+#if defined(CONFIG_LOCKSTAT)
+			vmm_lockstat_mutex_acquired(&mut->ls,
+						    contended, wait_start);
+#endif
 		} else {
 			mut->lock++;
 		}
@@ -35,6 +35,7 @@
 /** Control structure for Timer Subsystem */
 struct vmm_timer_local_ctrl {
 	struct vmm_timecounter tc;
+	u64 tc_max_nsecs;
 	struct vmm_clockchip *cc;
 	bool started;
 	bool inprocess;
@@ -55,14 +56,12 @@ u64 __notrace vmm_timer_timestamp_for_profile(void)
 
 u64 vmm_timer_timestamp(void)
 {
-	u64 ret;
-	irq_flags_t flags;
-
-	arch_cpu_irq_save(flags);
-	ret = vmm_timecounter_read(&this_cpu(tlc).tc);
-	arch_cpu_irq_restore(flags);
-
-	return ret;
+	/* The timecounter base is only updated by owner CPU from
+	 * timer interrupt so we can peek it from anywhere without
+	 * disabling interrupts. Timecounters of all CPUs are in
+	 * sync hence it does not matter if we get migrated.
+	 */
+	return vmm_timecounter_peek(&this_cpu(tlc).tc);
 }
 
 /* Note: This function must be called with tlcp->event_list_lock held. */
@@ -76,8 +75,16 @@ static void __timer_schedule_next_event(struct vmm_timer_local_ctrl *tlcp)
 		return;
 	}
 
-	/* If no events, we give up */
+	tstamp = vmm_timer_timestamp();
+
+	/* If no events, we still need an interrupt before
+	 * timecounter base becomes too old to be peeked
+	 */
 	if (list_empty(&tlcp->event_list)) {
+		tlcp->curr = NULL;
+		tlcp->next_event = tstamp + tlcp->tc_max_nsecs;
+		vmm_clockchip_program_event(tlcp->cc,
+				    tstamp, tlcp->next_event);
 		return;
 	}
 
@@ -88,11 +95,13 @@ static void __timer_schedule_next_event(struct vmm_timer_local_ctrl *tlcp)
 
 	/* Configure clockevent device for first event */
 	tlcp->curr = e;
-	tstamp = vmm_timer_timestamp();
 	if (tstamp < e->expiry_tstamp) {
 		tlcp->next_event = e->expiry_tstamp;
+		if ((tstamp + tlcp->tc_max_nsecs) < tlcp->next_event) {
+			tlcp->next_event = tstamp + tlcp->tc_max_nsecs;
+		}
 		vmm_clockchip_program_event(tlcp->cc, 
-				    tstamp, e->expiry_tstamp);
+				    tstamp, tlcp->next_event);
 	} else {
 		tlcp->next_event = tstamp;
 		vmm_clockchip_program_event(tlcp->cc, tstamp, tstamp);
@@ -129,6 +138,9 @@ static void timer_clockchip_event_handler(struct vmm_clockchip *cc)
 	struct vmm_timer_event *e;
 	struct vmm_timer_local_ctrl *tlcp = &this_cpu(tlc);
 
+	/* Update timecounter base for lockless timestamp */
+	vmm_timecounter_read(&tlcp->tc);
+
 	vmm_read_lock_irqsave_lite(&tlcp->event_list_lock, flags);
 
 	tlcp->inprocess = TRUE;
@@ -281,11 +293,15 @@ bool vmm_timer_started(void)
 void vmm_timer_start(void)
 {
 	u64 tstamp;
+	irq_flags_t flags;
 	struct vmm_timer_local_ctrl *tlcp = &this_cpu(tlc);
 
 	vmm_clockchip_set_mode(tlcp->cc, VMM_CLOCKCHIP_MODE_ONESHOT);
 
-	tstamp = vmm_timer_timestamp();
+	/* Timecounter base might be old if we were stopped */
+	arch_cpu_irq_save(flags);
+	tstamp = vmm_timecounter_read(&tlcp->tc);
+	arch_cpu_irq_restore(flags);
 
 	tlcp->next_event = tstamp + tlcp->cc->min_delta_ns;
 
@@ -357,10 +373,13 @@ int __cpuinit vmm_timer_init(void)
 		 */
 		if ((rc = vmm_timecounter_init(&tlcp->tc, 
 			per_cpu(tlc, 0).tc.cs, 
-			vmm_timecounter_read(&per_cpu(tlc, 0).tc)))) {
+			vmm_timecounter_peek(&per_cpu(tlc, 0).tc)))) {
 			return rc;
 		}
 	}
 
+	/* Interval after which timecounter base must be updated */
+	tlcp->tc_max_nsecs = vmm_timecounter_max_nsecs(&tlcp->tc);
+
 	return VMM_OK;
 }
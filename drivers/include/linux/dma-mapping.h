@@ -50,6 +50,13 @@ static inline unsigned int dma_set_max_seg_size(struct device *dev,
 #define dma_free_coherent(d, s, c, h) dma_free_attrs(d, s, c, h, NULL)
 #define dma_free_attrs(d, s, c, h, a) vmm_dma_free(c)
 
+#define dma_pool vmm_dma_pool
+#define dma_pool_create(n, d, s, a, b) vmm_dma_pool_create(n, s, a)
+#define dma_pool_destroy(p) vmm_dma_pool_destroy(p)
+#define dma_pool_alloc(p, f, h) vmm_dma_pool_alloc(p, h)
+#define dma_pool_zalloc(p, f, h) vmm_dma_pool_alloc(p, h)
+#define dma_pool_free(p, v, h) vmm_dma_pool_free(p, v)
+
 #define dma_map_single(d, a, s, r) dma_map_single_attrs(d, a, s, r, NULL)
 #define dma_map_single_attrs(d, a, s, r, attrs)		\
 	vmm_dma_map((virtual_addr_t)a, s, r)
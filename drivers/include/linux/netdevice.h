@@ -28,6 +28,7 @@
 #include <vmm_types.h>
 #include <vmm_devdrv.h>
 #include <vmm_error.h>
+#include <vmm_workqueue.h>
 #include <net/vmm_protocol.h>
 #include <net/vmm_net.h>
 #include <net/vmm_netport.h>
@@ -45,6 +46,13 @@
 #define	net_ratelimit()	1
 #define NETIF_MSG_LINK	0
 
+typedef u64 netdev_features_t;
+
+/* Net device features (should be defined as bits) */
+#define NETIF_F_SG	0x1	/* Scatter/gather IO: start_xmit takes
+				 * mbuf chains (see skb_nr_frags())
+				 */
+
 enum netdev_status {
 	NETDEV_UNINITIALIZED = 0x1,
 	NETDEV_REGISTERED = 0x2,
@@ -124,6 +132,7 @@ struct net_device {
 	const struct ethtool_ops *ethtool_ops;
 	unsigned int state;
 	unsigned int link_state;
+	netdev_features_t features;
 	void *priv;		/* Driver specific private data */
 	void *nsw_priv;		/* VMM virtual packet switching layer
 				 * specific private data.
@@ -160,9 +169,11 @@ struct napi_struct {
 	 * can remove from the list right before clearing the bit.
 	 */
 	struct list_head	poll_list;
+#endif /* 0 */
 
 	unsigned long		state;
 	int			weight;
+#if 0
 	unsigned int		gro_count;
 #endif /* 0 */
 	int			(*poll)(struct napi_struct *, int);
@@ -180,10 +191,16 @@ struct napi_struct {
 	struct hlist_node	napi_hash_node;
 	unsigned int		napi_id;
 #else /* 0 */
-	struct vmm_netport_xfer	xfer;
+	struct vmm_mbuf_gro	gro;
+	struct vmm_work		work;	/* poll when bottom-half is busy */
 #endif /* 0 */
 };
 
+enum {
+	NAPI_STATE_SCHED,	/* Poll is scheduled */
+	NAPI_STATE_DISABLE,	/* Disable pending */
+};
+
 enum gro_result {
 	GRO_MERGED,
 	GRO_MERGED_FREE,
@@ -485,6 +502,30 @@ void napi_disable(struct napi_struct *n);
  */
 void napi_enable(struct napi_struct *n);
 
+/**
+ *	napi_schedule_prep - check if NAPI can be scheduled
+ *	@n: napi context
+ *
+ * Test if NAPI routine is already running, and if not mark
+ * it as running.  This is used as a condition variable to
+ * insure only one NAPI poll instance runs.  We also make
+ * sure there is no pending NAPI disable.
+ */
+static inline bool napi_schedule_prep(struct napi_struct *n)
+{
+	return !test_bit(NAPI_STATE_DISABLE, &n->state) &&
+		!test_and_set_bit(NAPI_STATE_SCHED, &n->state);
+}
+
+/**
+ *	__napi_schedule - schedule for receive
+ *	@n: entry to schedule
+ *
+ * The entry's receive function will be scheduled to run.
+ * Caller must have done napi_schedule_prep() successfully.
+ */
+void __napi_schedule(struct napi_struct *n);
+
 /**
  *	napi_schedule - schedule NAPI poll
  *	@n: napi context
@@ -494,10 +535,20 @@ void napi_enable(struct napi_struct *n);
  */
 void napi_schedule(struct napi_struct *n);
 
-static inline gro_result_t napi_gro_receive(struct napi_struct *napi,
-					    struct sk_buff *skb)
-{
-	return netif_rx(skb, napi->dev);
-}
+/**
+ *	napi_gro_flush - deliver all frames held by GRO
+ *	@n: napi context
+ */
+void napi_gro_flush(struct napi_struct *n);
+
+/**
+ *	napi_gro_receive - pass received frame through GRO
+ *	@n: napi context
+ *	@skb: received frame
+ *
+ * Coalesce in-order TCP segments of a flow before passing them
+ * to the netswitch. Must be called from NAPI poll routine.
+ */
+gro_result_t napi_gro_receive(struct napi_struct *n, struct sk_buff *skb);
 
 #endif /* __LINUX_NETDEVICE_H_ */
@@ -71,6 +71,25 @@
 #define skb_data(skb)	((skb)->m_data)
 #define skb_len(skb)	((skb)->m_len)
 
+/*
+ * Fragments of a scatter/gather skb are the mbufs chained after
+ * the head mbuf. Each fragment covers skb_len(frag) bytes starting
+ * at skb_data(frag).
+ */
+#define skb_for_each_frag(skb, frag)	\
+	for ((frag) = (skb)->m_next; (frag); (frag) = (frag)->m_next)
+
+static inline int skb_nr_frags(const struct sk_buff *skb)
+{
+	int nr = 0;
+	const struct vmm_mbuf *m;
+
+	for (m = skb->m_next; m; m = m->m_next)
+		nr++;
+
+	return nr;
+}
+
 static inline struct sk_buff *__alloc_skb(unsigned int size,
 					  u8 dummy_priority,
 					  int ext_how)
@@ -23,124 +23,228 @@
  * @brief NET3 Protocol independent device support routines.
  */
 
+#include <linux/kernel.h>
+#include <linux/bug.h>
+#include <linux/delay.h>
 #include <linux/netdevice.h>
 #include <linux/phy.h>
 
 int netdev_budget __read_mostly = 300;
 
+static void napi_gro_deliver(struct napi_struct *n, struct dlist *out)
+{
+	struct vmm_mbuf *mb;
+
+	while (!list_empty(out)) {
+		mb = m_list_entry(list_pop(out));
+		netif_rx(mb, n->dev);
+	}
+}
+
+void napi_gro_flush(struct napi_struct *n)
+{
+	struct dlist out;
+
+	INIT_LIST_HEAD(&out);
+	m_gro_flush(&n->gro, &out);
+	napi_gro_deliver(n, &out);
+}
+EXPORT_SYMBOL(napi_gro_flush);
+
+gro_result_t napi_gro_receive(struct napi_struct *n, struct sk_buff *skb)
+{
+	bool held;
+	struct dlist out;
+
+	INIT_LIST_HEAD(&out);
+	held = m_gro_receive(&n->gro, skb, &out);
+	napi_gro_deliver(n, &out);
+
+	return (held) ? GRO_HELD : GRO_NORMAL;
+}
+EXPORT_SYMBOL(napi_gro_receive);
+
+/*
+ * NAPI poll runs as lazy xfer in netswitch bottom-half with the
+ * SCHED bit held. A driver which has not exhausted its budget has
+ * called napi_complete() and re-enabled its interrupts. Otherwise
+ * we requeue the poll behind other pending xfers so that one busy
+ * device cannot starve the bottom-half.
+ */
 static void lazy_xfer2napi_poll(struct vmm_netport *port, void *arg, int budget)
 {
-	struct napi_struct *napi = arg;
+	int work;
+	struct napi_struct *n = arg;
+
+	while (1) {
+		work = n->poll(n, n->weight);
+		WARN_ON_ONCE(work > n->weight);
+		if (work < n->weight)
+			return;
+
+		if (unlikely(test_bit(NAPI_STATE_DISABLE, &n->state))) {
+			napi_complete(n);
+			return;
+		}
 
-	napi->poll(napi, budget);
+		napi_gro_flush(n);
+
+		if (!vmm_port2switch_xfer_lazy(port, lazy_xfer2napi_poll,
+					       n, n->weight))
+			return;
+
+		/* Failed to requeue hence keep polling from here */
+	}
+}
+
+static void napi_poll_work(struct vmm_work *work)
+{
+	int w;
+	struct napi_struct *n = container_of(work, struct napi_struct, work);
+
+	while (1) {
+		w = n->poll(n, n->weight);
+		WARN_ON_ONCE(w > n->weight);
+		if (w < n->weight)
+			return;
+
+		if (unlikely(test_bit(NAPI_STATE_DISABLE, &n->state))) {
+			napi_complete(n);
+			return;
+		}
+
+		napi_gro_flush(n);
+	}
 }
 
 void netif_napi_add(struct net_device *dev, struct napi_struct *napi,
 		    int (*poll)(struct napi_struct *, int), int weight)
 {
-	struct vmm_netport *port = dev->nsw_priv;
-
 	if (weight > NAPI_POLL_WEIGHT)
 		pr_err_once("netif_napi_add() called with weight %d on "
 			    "device %s\n", weight, dev->name);
 	napi->dev = dev;
 	napi->poll = poll;
-	INIT_LIST_HEAD(&napi->xfer.head);
-	napi->xfer.port = port;
-	napi->xfer.type = VMM_NETPORT_XFER_LAZY;
-	napi->xfer.mbuf = NULL;
-	napi->xfer.lazy_budget = netdev_budget;
-	napi->xfer.lazy_arg = NULL;
-	napi->xfer.lazy_xfer = lazy_xfer2napi_poll;
+	napi->weight = weight;
+	m_gro_init(&napi->gro);
+	INIT_WORK(&napi->work, napi_poll_work);
+	/* Poll stays off until driver calls napi_enable() */
+	napi->state = 0;
+	set_bit(NAPI_STATE_SCHED, &napi->state);
 }
 EXPORT_SYMBOL(netif_napi_add);
 
 void napi_disable(struct napi_struct *n)
 {
-#if 0
 	might_sleep();
 	set_bit(NAPI_STATE_DISABLE, &n->state);
 	while (test_and_set_bit(NAPI_STATE_SCHED, &n->state))
 		msleep(1);
 	clear_bit(NAPI_STATE_DISABLE, &n->state);
-#endif
 }
+EXPORT_SYMBOL(napi_disable);
 
 void napi_enable(struct napi_struct *n)
 {
-#if 0
 	BUG_ON(!test_bit(NAPI_STATE_SCHED, &n->state));
-	smp_mb__before_clear_bit();
+	smp_mb();
 	clear_bit(NAPI_STATE_SCHED, &n->state);
-#endif
 }
+EXPORT_SYMBOL(napi_enable);
 
 void napi_schedule(struct napi_struct *n)
 {
-	struct vmm_netport *port = n->dev->nsw_priv;
-
-	if (!port) {
-		vmm_printf("%s Net dev %s has no switch attached\n",
-			   __func__, n->dev->name);
-		return;
-	}
-
-	vmm_port2switch_xfer_lazy(port, lazy_xfer2napi_poll, n, n->xfer.lazy_budget);
+	if (napi_schedule_prep(n))
+		__napi_schedule(n);
 }
+EXPORT_SYMBOL(napi_schedule);
 
 void netif_napi_del(struct napi_struct *napi)
 {
-	list_del_init(&napi->xfer.head);
+	struct dlist out;
+	struct vmm_mbuf *mb;
+
+	vmm_workqueue_stop_work(&napi->work);
+
+	INIT_LIST_HEAD(&out);
+	m_gro_flush(&napi->gro, &out);
+	while (!list_empty(&out)) {
+		mb = m_list_entry(list_pop(&out));
+		m_freem(mb);
+	}
 }
 EXPORT_SYMBOL(netif_napi_del);
 
 void __napi_complete(struct napi_struct *n)
 {
-#if 0
 	BUG_ON(!test_bit(NAPI_STATE_SCHED, &n->state));
-	BUG_ON(n->gro_list);
+	BUG_ON(!list_empty(&n->gro.flows));
 
-	list_del(&n->poll_list);
-	smp_mb__before_clear_bit();
+	smp_mb();
 	clear_bit(NAPI_STATE_SCHED, &n->state);
-#endif
 }
 EXPORT_SYMBOL(__napi_complete);
 
 void napi_complete(struct napi_struct *n)
 {
-#if 0
-	unsigned long flags;
-
-	/*
-	 * don't let napi dequeue from the cpu poll list
-	 * just in case its running on a different cpu
-	 */
-	if (unlikely(test_bit(NAPI_STATE_NPSVC, &n->state)))
-		return;
-
-	napi_gro_flush(n, false);
-	local_irq_save(flags);
+	napi_gro_flush(n);
 	__napi_complete(n);
-	local_irq_restore(flags);
-#endif
 }
 EXPORT_SYMBOL(napi_complete);
 
-/**
- * __napi_schedule - schedule for receive
- * @n: entry to schedule
- *
- * The entry's receive function will be scheduled to run
+/* Maximum poll passes done from interrupt context */
+#define NAPI_INLINE_MAX_PASSES	2
+
+/*
+ * Poll from the caller context when the poll cannot be deferred to
+ * netswitch bottom-half because driver has already masked its
+ * interrupts and waits for the poll. Only a few passes are done
+ * here and remaining work is handed over to bottom-half (or to
+ * system workqueue if bottom-half is still busy).
  */
+static void napi_poll_inline(struct napi_struct *n)
+{
+	int pass, work;
+	struct vmm_netport *port = n->dev->nsw_priv;
+
+	for (pass = 0; pass < NAPI_INLINE_MAX_PASSES; pass++) {
+		work = n->poll(n, n->weight);
+		WARN_ON_ONCE(work > n->weight);
+		if (work < n->weight)
+			return;
+
+		if (unlikely(test_bit(NAPI_STATE_DISABLE, &n->state))) {
+			napi_complete(n);
+			return;
+		}
+
+		napi_gro_flush(n);
+	}
+
+	if (port && !vmm_port2switch_xfer_lazy(port, lazy_xfer2napi_poll,
+					       n, n->weight))
+		return;
+
+	vmm_workqueue_schedule_work(NULL, &n->work);
+}
+
 void __napi_schedule(struct napi_struct *n)
 {
-#if 0
-	unsigned long flags;
+	struct vmm_netport *port = n->dev->nsw_priv;
+
+	if (!port) {
+		vmm_printf("%s Net dev %s has no switch attached\n",
+			   __func__, n->dev->name);
+		goto fail;
+	}
+
+	if (vmm_port2switch_xfer_lazy(port, lazy_xfer2napi_poll,
+				      n, n->weight))
+		goto fail;
+
+	return;
 
-	local_irq_save(flags);
-	____napi_schedule(&__get_cpu_var(softnet_data), n);
-	local_irq_restore(flags);
-#endif
+fail:
+	napi_poll_inline(n);
 }
 EXPORT_SYMBOL(__napi_schedule);
@@ -542,6 +542,78 @@ dma_mapping_error:
 	}
 	return NETDEV_TX_OK;
 }
+#else /* 0 */
+static int
+fec_enet_txq_submit_frag_skb(struct fec_enet_priv_tx_q *txq,
+			     struct sk_buff *skb,
+			     struct net_device *ndev)
+{
+	struct fec_enet_private *fep = netdev_priv(ndev);
+	const struct platform_device_id *id_entry = fep->id_entry;
+	struct bufdesc *bdp = txq->cur_tx;
+	unsigned short queue = skb_get_queue_mapping(skb);
+	int frag, frag_len;
+	unsigned short status;
+	struct sk_buff *this_frag;
+	unsigned int index;
+	void *bufaddr;
+	dma_addr_t addr;
+	int i;
+
+	frag = 0;
+	skb_for_each_frag(skb, this_frag) {
+		bdp = fec_enet_get_nextdesc(bdp, fep, queue);
+
+		status = bdp->cbd_sc;
+		status &= ~BD_ENET_TX_STATS;
+		status |= (BD_ENET_TX_TC | BD_ENET_TX_READY);
+		frag_len = skb_len(this_frag);
+
+		/* Handle the last BD specially */
+		if (!this_frag->m_next)
+			status |= (BD_ENET_TX_INTR | BD_ENET_TX_LAST);
+
+		bufaddr = skb_data(this_frag);
+
+		index = fec_enet_get_bd_index(txq->tx_bd_base, bdp, fep);
+		if (((unsigned long) bufaddr) & fep->tx_align ||
+			id_entry->driver_data & FEC_QUIRK_SWAP_FRAME) {
+			memcpy(txq->tx_bounce[index], bufaddr, frag_len);
+			bufaddr = txq->tx_bounce[index];
+
+			if (id_entry->driver_data & FEC_QUIRK_SWAP_FRAME)
+				swap_buffer(bufaddr, frag_len);
+		}
+
+		addr = dma_map_single(fep->dev, bufaddr, frag_len,
+				      DMA_TO_DEVICE);
+		if (dma_mapping_error(fep->dev, addr)) {
+			if (net_ratelimit())
+				netdev_err(ndev, "Tx DMA memory map failed\n");
+			goto dma_mapping_error;
+		}
+
+		bdp->cbd_bufaddr = addr;
+		bdp->cbd_datlen = frag_len;
+		bdp->cbd_sc = status;
+		frag++;
+	}
+
+	txq->cur_tx = bdp;
+
+	return 0;
+
+dma_mapping_error:
+	bdp = txq->cur_tx;
+	for (i = 0; i < frag; i++) {
+		bdp = fec_enet_get_nextdesc(bdp, fep, queue);
+		bdp->cbd_sc &= ~BD_ENET_TX_READY;
+		dma_unmap_single(fep->dev, bdp->cbd_bufaddr,
+				bdp->cbd_datlen, DMA_TO_DEVICE);
+		bdp->cbd_bufaddr = 0;
+	}
+	return -ENOMEM;
+}
 #endif /* 0 */
 
 static int fec_enet_txq_submit_skb(struct fec_enet_priv_tx_q *txq,
@@ -554,6 +626,7 @@ static int fec_enet_txq_submit_skb(struct fec_enet_priv_tx_q *txq,
 	int nr_frags = skb_shinfo(skb)->nr_frags;
 #else /* 0 */
 	const struct platform_device_id *id_entry = fep->id_entry;
+	int nr_frags = skb_nr_frags(skb);
 #endif /* 0 */
 	struct bufdesc *bdp, *last_bdp;
 	void *bufaddr;
@@ -566,9 +639,7 @@ static int fec_enet_txq_submit_skb(struct fec_enet_priv_tx_q *txq,
 #endif /* 0 */
 	unsigned int index;
 	int entries_free;
-#if 0
 	int ret;
-#endif /* 0 */
 
 	entries_free = fec_enet_get_free_txdesc_num(fep, txq);
 #if 0
@@ -579,7 +650,7 @@ static int fec_enet_txq_submit_skb(struct fec_enet_priv_tx_q *txq,
 		return NETDEV_TX_OK;
 	}
 #else /* 0 */
-	if (entries_free < 1) {
+	if (entries_free < nr_frags + 1) {
 		dev_kfree_skb_any(skb);
 		if (net_ratelimit())
 			netdev_err(ndev, "NOT enough BD for SG!\n");
@@ -643,13 +714,15 @@ static int fec_enet_txq_submit_skb(struct fec_enet_priv_tx_q *txq,
 	}
 #endif /* 0 */
 
-#if 0
 	if (nr_frags) {
 		ret = fec_enet_txq_submit_frag_skb(txq, skb, ndev);
-		if (ret)
-			return ret;
+		if (ret) {
+			dma_unmap_single(fep->dev, addr, buflen,
+					 DMA_TO_DEVICE);
+			dev_kfree_skb_any(skb);
+			return NETDEV_TX_OK;
+		}
 	} else {
-#endif /* 0 */
 		status |= (BD_ENET_TX_INTR | BD_ENET_TX_LAST);
 #if 0
 		if (fep->bufdesc_ex) {
@@ -658,8 +731,8 @@ static int fec_enet_txq_submit_skb(struct fec_enet_priv_tx_q *txq,
 				SKBTX_HW_TSTAMP && fep->hwts_tx_en))
 				estatus |= BD_ENET_TX_TS;
 		}
-	}
 #endif /* 0 */
+	}
 
 #if 0
 	if (fep->bufdesc_ex) {
@@ -3421,6 +3494,9 @@ static int fec_enet_init(struct net_device *ndev)
 				| NETIF_F_RXCSUM | NETIF_F_SG | NETIF_F_TSO);
 		fep->csum_flags |= FLAG_RX_CSUM_ENABLED;
 	}
+#else /* 0 */
+	/* Chained mbufs are mapped fragment by fragment */
+	ndev->features |= NETIF_F_SG;
 #endif /* 0 */
 
 	if (id_entry->driver_data & FEC_QUIRK_HAS_AVB) {
@@ -168,17 +168,17 @@ int netdev_switch2port_xfer(struct vmm_netport *port,
 {
 	int rc = VMM_OK;
 	struct net_device *dev = (struct net_device *) port->priv;
-	char *buf;
-	int len;
+	struct vmm_mbuf *flat;
 
-	if(mbuf->m_next) {
+	if (mbuf->m_next && !(dev->features & NETIF_F_SG)) {
 		/* Cannot avoid a copy in case of fragmented mbuf data */
-		len = min(dev->mtu, (unsigned int)mbuf->m_pktlen);
-		buf = vmm_malloc(len);
-		m_copydata(mbuf, 0, len, buf);
+		flat = m_dup(mbuf);
 		m_freem(mbuf);
-		MGETHDR(mbuf, 0, 0);
-		MEXTADD(mbuf, buf, len, 0, 0);
+		if (!flat) {
+			dev->stats.tx_dropped++;
+			return VMM_ENOMEM;
+		}
+		mbuf = flat;
 	}
 
 	dev->netdev_ops->ndo_start_xmit(mbuf, dev);
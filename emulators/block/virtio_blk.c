@@ -71,42 +71,43 @@ struct virtio_blk_dev {
 	struct vmm_virtio_queue 	vqs[VIRTIO_BLK_NUM_QUEUES];
 	struct vmm_virtio_iovec		iov[VIRTIO_BLK_QUEUE_SIZE];
 	struct virtio_blk_dev_req	reqs[VIRTIO_BLK_QUEUE_SIZE];
-	u32 				features;
+	u64 				features;
 
 	struct vmm_virtio_blk_config 	config;
 	struct vmm_vdisk		*vdisk;
 };
 
-static u32 virtio_blk_get_host_features(struct vmm_virtio_device *dev)
+static u64 virtio_blk_get_host_features(struct vmm_virtio_device *dev)
 {
 	return	1UL << VMM_VIRTIO_BLK_F_SEG_MAX
 		| 1UL << VMM_VIRTIO_BLK_F_BLK_SIZE
 		| 1UL << VMM_VIRTIO_BLK_F_FLUSH
-		| 1UL << VMM_VIRTIO_RING_F_EVENT_IDX;
-#if 0
+		| 1UL << VMM_VIRTIO_RING_F_EVENT_IDX
 		| 1UL << VMM_VIRTIO_RING_F_INDIRECT_DESC;
-#endif
 }
 
 static void virtio_blk_set_guest_features(struct vmm_virtio_device *dev,
-					  u32 features)
+					  u64 features)
 {
 	struct virtio_blk_dev *vbdev = dev->emu_data;
 
 	vbdev->features = features;
 }
 
-static int virtio_blk_init_vq(struct vmm_virtio_device *dev,
-			      u32 vq, u32 page_size, u32 align,
-			      u32 pfn)
+static int virtio_blk_init_vq(struct vmm_virtio_device *dev, u32 vq,
+			      struct vmm_virtio_queue_layout *layout)
 {
 	int rc;
 	struct virtio_blk_dev *vbdev = dev->emu_data;
 
 	switch (vq) {
 	case VIRTIO_BLK_IO_QUEUE:
+		if (VIRTIO_BLK_QUEUE_SIZE < layout->desc_count) {
+			rc = VMM_EINVALID;
+			break;
+		}
 		rc = vmm_virtio_queue_setup(&vbdev->vqs[vq], dev->guest,
-				pfn, page_size, VIRTIO_BLK_QUEUE_SIZE, align);
+					    layout);
 		break;
 	default:
 		rc = VMM_EINVALID;
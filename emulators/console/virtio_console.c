@@ -61,20 +61,21 @@ struct virtio_console_dev {
 	struct fifo *emerg_rd;
 };
 
-static u32 virtio_console_get_host_features(struct vmm_virtio_device *dev)
+static u64 virtio_console_get_host_features(struct vmm_virtio_device *dev)
 {
 	/* We support emergency write. */
-	return 1UL << VMM_VIRTIO_CONSOLE_F_EMERG_WRITE;
+	return 1UL << VMM_VIRTIO_CONSOLE_F_EMERG_WRITE
+		| 1UL << VMM_VIRTIO_RING_F_INDIRECT_DESC;
 }
 
 static void virtio_console_set_guest_features(struct vmm_virtio_device *dev,
-					      u32 features)
+					      u64 features)
 {
 	/* No host features so, ignore it. */
 }
 
-static int virtio_console_init_vq(struct vmm_virtio_device *dev,
-				  u32 vq, u32 page_size, u32 align, u32 pfn)
+static int virtio_console_init_vq(struct vmm_virtio_device *dev, u32 vq,
+				  struct vmm_virtio_queue_layout *layout)
 {
 	int rc;
 	struct virtio_console_dev *cdev = dev->emu_data;
@@ -82,8 +83,12 @@ static int virtio_console_init_vq(struct vmm_virtio_device *dev,
 	switch (vq) {
 	case VIRTIO_CONSOLE_RX_QUEUE:
 	case VIRTIO_CONSOLE_TX_QUEUE:
-		rc = vmm_virtio_queue_setup(&cdev->vqs[vq], dev->guest, 
-			pfn, page_size, VIRTIO_CONSOLE_QUEUE_SIZE, align);
+		if (VIRTIO_CONSOLE_QUEUE_SIZE < layout->desc_count) {
+			rc = VMM_EINVALID;
+			break;
+		}
+		rc = vmm_virtio_queue_setup(&cdev->vqs[vq], dev->guest,
+					    layout);
 		break;
 	default:
 		rc = VMM_EINVALID;
@@ -781,9 +781,16 @@ static struct vmm_devtree_nodeid pl110_emuid_table[] = {
 	{ /* end of list */ },
 };
 
+/* Palette writes only update internal lookup tables */
+static const struct vmm_devemu_coalesced_range pl110_coalesced_table[] = {
+	{ .offset = 0x200, .size = 0x200 },
+	{ /* end of list */ },
+};
+
 static struct vmm_emulator pl110_emulator = {
 	.name = "pl110",
 	.match_table = pl110_emuid_table,
+	.coalesced_table = pl110_coalesced_table,
 	.endian = VMM_DEVEMU_LITTLE_ENDIAN,
 	.probe = pl110_emulator_probe,
 	.read8 = pl110_emulator_read8,
@@ -25,6 +25,11 @@
 #include <vmm_heap.h>
 #include <vmm_modules.h>
 #include <vmm_devemu.h>
+#include <vmm_guest_aspace.h>
+#include <vmm_host_aspace.h>
+#include <vmm_spinlocks.h>
+#include <vmm_smp.h>
+#include <arch_atomic.h>
 #include <vio/vmm_virtio.h>
 #include <vio/vmm_virtio_net.h>
 
@@ -33,7 +38,8 @@
 #include <net/vmm_net.h>
 #include <net/vmm_netswitch.h>
 #include <net/vmm_netport.h>
-#include <net/vmm_mbuf.h>
+#include <libs/mathlib.h>
+#include <libs/stringlib.h>
 
 #define MODULE_DESC			"VirtIO Net Emulator"
 #define MODULE_AUTHOR			"Pranav Sawargaonkar"
@@ -51,69 +57,297 @@
 
 #define VIRTIO_NET_MTU			1514
 
+/* Largest GSO super frame: 64KB IP datagram with ethernet + VLAN header */
+#define VIRTIO_NET_GSO_MAX_LEN		(65535 + ETHER_HLEN + 4)
+
 #define VIRTIO_NET_TX_LAZY_BUDGET	(VIRTIO_NET_QUEUE_SIZE / 4)
 
+#ifdef CONFIG_EMU_NET_VIRTIO_ZEROCOPY
+/* Frames with less payload than this are cheaper to copy than map */
+#define VIRTIO_NET_ZC_MIN_LEN		256
+/* Leading bytes copied so that protocol headers are linear */
+#define VIRTIO_NET_ZC_COPY_LEN		128
+
+struct virtio_net_queue;
+
+/* In-flight zero-copy TX frame, indexed by descriptor head */
+struct virtio_net_zc_tx {
+	struct virtio_net_queue *q;
+	atomic_t refs;
+	bool publish;
+	u32 gen;
+	u16 head;
+	u32 len;
+};
+#endif
+
 struct virtio_net_queue {
 	int num;
 	int valid;
 	int type;
+	u32 hcpu;	/* Host CPU processing TX of this queue */
 	struct vmm_virtio_queue vq;
 	struct vmm_virtio_iovec iov[VIRTIO_NET_QUEUE_SIZE];
+	u16 mrg_heads[VIRTIO_NET_QUEUE_SIZE];
+	u16 mrg_iov_cnt[VIRTIO_NET_QUEUE_SIZE];
+	u32 mrg_len[VIRTIO_NET_QUEUE_SIZE];
+	struct vmm_virtio_iovec mrg_iov[VIRTIO_NET_QUEUE_SIZE];
 	struct virtio_net_dev *ndev;
+	vmm_spinlock_t used_lock;
+#ifdef CONFIG_EMU_NET_VIRTIO_ZEROCOPY
+	u32 zc_gen;
+	struct virtio_net_zc_tx zc[VIRTIO_NET_QUEUE_SIZE];
+#endif
 };
 
 struct virtio_net_dev {
 	struct vmm_virtio_device *vdev;
+	atomic_t refs;	/* In-flight zero-copy frames + one for device */
 
 	struct virtio_net_queue *vqs;
 	u32 cq;		/* Configuration queue number */
 	u32 max_queues;
+	u32 curr_queue_pairs;
 	u32 can_receive;
 	struct vmm_virtio_net_config config;
-	u32 features;
+	u64 features;
 
 	int mode;
 	struct vmm_netport *port;
 	char name[VMM_VIRTIO_DEVICE_MAX_NAME_LEN];
 };
 
-static u32 virtio_net_get_host_features(struct vmm_virtio_device *dev)
+static u64 virtio_net_get_host_features(struct vmm_virtio_device *dev)
 {
 	return 1UL << VMM_VIRTIO_NET_F_MAC
-#if 0
 		| 1UL << VMM_VIRTIO_NET_F_CSUM
+		| 1UL << VMM_VIRTIO_NET_F_GUEST_CSUM
 		| 1UL << VMM_VIRTIO_NET_F_HOST_UFO
 		| 1UL << VMM_VIRTIO_NET_F_HOST_TSO4
 		| 1UL << VMM_VIRTIO_NET_F_HOST_TSO6
+		| 1UL << VMM_VIRTIO_NET_F_HOST_ECN
 		| 1UL << VMM_VIRTIO_NET_F_GUEST_UFO
 		| 1UL << VMM_VIRTIO_NET_F_GUEST_TSO4
 		| 1UL << VMM_VIRTIO_NET_F_GUEST_TSO6
-#endif
+		| 1UL << VMM_VIRTIO_NET_F_GUEST_ECN
+		| 1UL << VMM_VIRTIO_NET_F_MRG_RXBUF
 		| 1UL << VMM_VIRTIO_RING_F_EVENT_IDX
-#if 0
 		| 1UL << VMM_VIRTIO_RING_F_INDIRECT_DESC
-#endif
 		| 1UL << VMM_VIRTIO_NET_F_MQ
 		| 1UL << VMM_VIRTIO_NET_F_CTRL_VQ
 		;
 }
 
 static void virtio_net_set_guest_features(struct vmm_virtio_device *dev,
-					  u32 features)
+					  u64 features)
 {
+	u32 port_features = 0;
 	struct virtio_net_dev *ndev = dev->emu_data;
 
 	ndev->features = features;
+
+	/* Offloads towards guest require guest checksum support */
+	if (features & (1UL << VMM_VIRTIO_NET_F_GUEST_CSUM)) {
+		port_features |= VMM_NETPORT_F_CSUM;
+		if (features & (1UL << VMM_VIRTIO_NET_F_GUEST_TSO4)) {
+			port_features |= VMM_NETPORT_F_TSO4;
+		}
+		if (features & (1UL << VMM_VIRTIO_NET_F_GUEST_TSO6)) {
+			port_features |= VMM_NETPORT_F_TSO6;
+		}
+		if (features & (1UL << VMM_VIRTIO_NET_F_GUEST_ECN)) {
+			port_features |= VMM_NETPORT_F_TSO_ECN;
+		}
+		if (features & (1UL << VMM_VIRTIO_NET_F_GUEST_UFO)) {
+			port_features |= VMM_NETPORT_F_UFO;
+		}
+	}
+	ndev->port->features = port_features;
+}
+
+static u32 virtio_net_hdr_len(struct virtio_net_dev *ndev)
+{
+	/* Virtio 1.x always has num_buffers field in header */
+	if (ndev->features & ((1ULL << VMM_VIRTIO_NET_F_MRG_RXBUF) |
+			      (1ULL << VMM_VIRTIO_F_VERSION_1))) {
+		return sizeof(struct vmm_virtio_net_hdr_mrg_rxbuf);
+	}
+
+	return sizeof(struct vmm_virtio_net_hdr);
+}
+
+static u32 virtio_net_tx_max_len(struct virtio_net_dev *ndev)
+{
+	if (ndev->features & ((1UL << VMM_VIRTIO_NET_F_HOST_TSO4) |
+			      (1UL << VMM_VIRTIO_NET_F_HOST_TSO6) |
+			      (1UL << VMM_VIRTIO_NET_F_HOST_UFO))) {
+		return VIRTIO_NET_GSO_MAX_LEN;
+	}
+
+	return VIRTIO_NET_MTU;
+}
+
+static int virtio_net_hdr_to_mbuf(struct vmm_virtio_net_hdr *hdr,
+				  struct vmm_mbuf *mb)
+{
+	if (hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+		if ((hdr->csum_start + hdr->csum_offset + 2) > mb->m_pktlen) {
+			return VMM_EINVALID;
+		}
+		mb->m_csum_flags |= M_CSUM_PARTIAL;
+		mb->m_csum_start = hdr->csum_start;
+		mb->m_csum_offset = hdr->csum_offset;
+	}
+
+	switch (hdr->gso_type & ~VIRTIO_NET_HDR_GSO_ECN) {
+	case VIRTIO_NET_HDR_GSO_NONE:
+		/* Only GSO frames may exceed the MTU */
+		if (VIRTIO_NET_MTU < mb->m_pktlen) {
+			return VMM_EINVALID;
+		}
+		return VMM_OK;
+	case VIRTIO_NET_HDR_GSO_TCPV4:
+		mb->m_gso_type = M_GSO_TCPV4;
+		break;
+	case VIRTIO_NET_HDR_GSO_TCPV6:
+		mb->m_gso_type = M_GSO_TCPV6;
+		break;
+	case VIRTIO_NET_HDR_GSO_UDP:
+		mb->m_gso_type = M_GSO_UDP;
+		break;
+	default:
+		return VMM_EINVALID;
+	};
+
+	if (!hdr->gso_size) {
+		return VMM_EINVALID;
+	}
+	if (hdr->gso_type & VIRTIO_NET_HDR_GSO_ECN) {
+		mb->m_gso_type |= M_GSO_ECN;
+	}
+	mb->m_gso_size = hdr->gso_size;
+	mb->m_hdr_len = hdr->hdr_len;
+
+	return VMM_OK;
+}
+
+static void virtio_net_mbuf_to_hdr(struct virtio_net_dev *ndev,
+				   struct vmm_mbuf *mb,
+				   struct vmm_virtio_net_hdr *hdr)
+{
+	memset(hdr, 0, sizeof(*hdr));
+
+	if (mb->m_csum_flags & M_CSUM_PARTIAL) {
+		hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+		hdr->csum_start = mb->m_csum_start;
+		hdr->csum_offset = mb->m_csum_offset;
+	} else if ((mb->m_csum_flags & M_CSUM_VALID) &&
+		   (ndev->features & (1UL << VMM_VIRTIO_NET_F_GUEST_CSUM))) {
+		hdr->flags = VIRTIO_NET_HDR_F_DATA_VALID;
+	}
+
+	switch (M_GSO_TYPE(mb)) {
+	case M_GSO_TCPV4:
+		hdr->gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+		break;
+	case M_GSO_TCPV6:
+		hdr->gso_type = VIRTIO_NET_HDR_GSO_TCPV6;
+		break;
+	case M_GSO_UDP:
+		hdr->gso_type = VIRTIO_NET_HDR_GSO_UDP;
+		break;
+	default:
+		return;
+	};
+
+	if (mb->m_gso_type & M_GSO_ECN) {
+		hdr->gso_type |= VIRTIO_NET_HDR_GSO_ECN;
+	}
+	hdr->gso_size = mb->m_gso_size;
+	hdr->hdr_len = mb->m_hdr_len;
+}
+
+/* Write buffer to guest IO vectors starting at given byte offset */
+static u32 virtio_net_iovec_write(struct vmm_virtio_device *dev,
+				  struct vmm_virtio_iovec *iov, u32 iov_cnt,
+				  u32 offset, void *buf, u32 buf_len)
+{
+	u32 i, len, pos = 0;
+
+	for (i = 0; (i < iov_cnt) && (pos < buf_len); i++) {
+		if (iov[i].len <= offset) {
+			offset -= iov[i].len;
+			continue;
+		}
+
+		len = iov[i].len - offset;
+		len = (len < (buf_len - pos)) ? len : (buf_len - pos);
+		len = vmm_guest_memory_write(dev->guest, iov[i].addr + offset,
+					     buf + pos, len, TRUE);
+		if (!len) {
+			break;
+		}
+
+		pos += len;
+		offset = 0;
+	}
+
+	return pos;
 }
 
-static int virtio_net_init_vq(struct vmm_virtio_device *dev,
-			      u32 vq, u32 page_size, u32 align, u32 pfn)
+/* Write bytes [off, off + len) of virtio net header followed by
+ * packet data to guest IO vectors.
+ */
+static u32 virtio_net_rx_write(struct vmm_virtio_device *dev,
+			       struct vmm_virtio_iovec *iov, u32 iov_cnt,
+			       void *hdr, u32 hdr_len,
+			       struct vmm_mbuf *mb, u32 off, u32 len)
+{
+	u32 n, w, doff, pos = 0;
+
+	if (off < hdr_len) {
+		n = ((hdr_len - off) < len) ? (hdr_len - off) : len;
+		pos = virtio_net_iovec_write(dev, iov, iov_cnt, 0,
+					     hdr + off, n);
+		if (pos < n) {
+			return pos;
+		}
+	}
+
+	/* Packet data might be spread over a mbuf chain */
+	doff = off + pos - hdr_len;
+	while (mb && (mb->m_len <= doff)) {
+		doff -= mb->m_len;
+		mb = mb->m_next;
+	}
+	while (mb && (pos < len)) {
+		n = mb->m_len - doff;
+		n = (n < (len - pos)) ? n : (len - pos);
+		w = virtio_net_iovec_write(dev, iov, iov_cnt, pos,
+					   mtod(mb, u8 *) + doff, n);
+		pos += w;
+		if (w < n) {
+			break;
+		}
+		doff = 0;
+		mb = mb->m_next;
+	}
+
+	return pos;
+}
+
+static int virtio_net_init_vq(struct vmm_virtio_device *dev, u32 vq,
+			      struct vmm_virtio_queue_layout *layout)
 {
 	int rc;
 	struct virtio_net_dev *ndev = dev->emu_data;
 
-	rc = vmm_virtio_queue_setup(&ndev->vqs[vq].vq, dev->guest,
-				pfn, page_size, VIRTIO_NET_QUEUE_SIZE, align);
+	if ((ndev->max_queues <= vq) ||
+	    (VIRTIO_NET_QUEUE_SIZE < layout->desc_count)) {
+		return VMM_EINVALID;
+	}
+
+	rc = vmm_virtio_queue_setup(&ndev->vqs[vq].vq, dev->guest, layout);
 	if (rc == VMM_OK) {
 		ndev->vqs[vq].valid = 1;
 		if (!ndev->can_receive &&
@@ -140,7 +374,9 @@ static int virtio_net_get_pfn_vq(struct vmm_virtio_device *dev, u32 vq)
 
 static int virtio_net_get_size_vq(struct vmm_virtio_device *dev, u32 vq)
 {
-	return VIRTIO_NET_QUEUE_SIZE;
+	struct virtio_net_dev *ndev = dev->emu_data;
+
+	return (vq < ndev->max_queues) ? VIRTIO_NET_QUEUE_SIZE : 0;
 }
 
 static int virtio_net_set_size_vq(struct vmm_virtio_device *dev,
@@ -152,41 +388,280 @@ static int virtio_net_set_size_vq(struct vmm_virtio_device *dev,
 
 static void virtio_net_tx_poke(struct virtio_net_dev *ndev, u32 vq);
 
+/* Drop reference to device, the last one frees it */
+static void virtio_net_put(struct virtio_net_dev *ndev)
+{
+	if (arch_atomic_sub_return(&ndev->refs, 1)) {
+		return;
+	}
+
+	vmm_free(ndev->vqs);
+	vmm_free(ndev);
+}
+
+/* Return TX buffer to guest. This can race with zero-copy completion
+ * of other TX buffers of same queue hence the lock.
+ * Note: must be called with used_lock held
+ */
+static void __virtio_net_tx_done(struct virtio_net_queue *q,
+				 u16 head, u32 len, bool signal)
+{
+	struct vmm_virtio_device *dev = q->ndev->vdev;
+
+	vmm_virtio_queue_set_used_elem(&q->vq, head, len);
+	if (signal && vmm_virtio_queue_should_signal(&q->vq)) {
+		dev->tra->notify(dev, q->num);
+	}
+}
+
+static void virtio_net_tx_done(struct virtio_net_queue *q,
+			       u16 head, u32 len, bool signal)
+{
+	irq_flags_t flags;
+
+	vmm_spin_lock_irqsave_lite(&q->used_lock, flags);
+	__virtio_net_tx_done(q, head, len, signal);
+	vmm_spin_unlock_irqrestore_lite(&q->used_lock, flags);
+}
+
+#ifdef CONFIG_EMU_NET_VIRTIO_ZEROCOPY
+static void virtio_net_zc_put(struct virtio_net_zc_tx *zc)
+{
+	irq_flags_t flags;
+	struct virtio_net_queue *q = zc->q;
+
+	if (arch_atomic_sub_return(&zc->refs, 1)) {
+		return;
+	}
+
+	/* Buffers of a reset queue no longer belong to us. The
+	 * generation is bumped under used_lock on reset and disconnect
+	 * so checking it under the same lock is enough.
+	 */
+	vmm_spin_lock_irqsave_lite(&q->used_lock, flags);
+	if (zc->publish && (zc->gen == q->zc_gen)) {
+		__virtio_net_tx_done(q, zc->head, zc->len, TRUE);
+	}
+	vmm_spin_unlock_irqrestore_lite(&q->used_lock, flags);
+
+	/* Frame held device memory alive till here */
+	virtio_net_put(q->ndev);
+}
+
+/* Stop in-flight frames from returning buffers to the current ring */
+static void virtio_net_zc_detach(struct virtio_net_queue *q)
+{
+	irq_flags_t flags;
+
+	vmm_spin_lock_irqsave_lite(&q->used_lock, flags);
+	q->zc_gen++;
+	vmm_spin_unlock_irqrestore_lite(&q->used_lock, flags);
+}
+
+static void virtio_net_zc_ext_free(struct vmm_mbuf *m,
+				   void *buf, u32 size, void *arg)
+{
+	vmm_host_memunmap((virtual_addr_t)buf);
+	virtio_net_zc_put(arg);
+}
+
+/* Create mbuf referencing guest memory directly. Only the host page
+ * backing the guest buffer is mapped, hence the mbuf covers less than
+ * requested when the guest buffer crosses a page boundary. Pages are
+ * mapped one at a time so that overlapping mappings of other frames
+ * are shared instead of conflicting.
+ */
+static struct vmm_mbuf *virtio_net_zc_map(struct virtio_net_dev *ndev,
+					  struct virtio_net_zc_tx *zc,
+					  physical_addr_t gphys, u32 len)
+{
+	u32 reg_flags;
+	virtual_addr_t va;
+	physical_addr_t hphys;
+	physical_size_t avail;
+	struct vmm_mbuf *m;
+
+	avail = VMM_PAGE_SIZE - (gphys & VMM_PAGE_MASK);
+	len = (avail < len) ? avail : len;
+
+	/* Only plain RAM is referenced, anything else is copied */
+	if (vmm_guest_physical_map(ndev->vdev->guest, gphys, len,
+				   &hphys, &avail, &reg_flags) ||
+	    !(reg_flags & VMM_REGION_REAL) ||
+	    (reg_flags & VMM_REGION_ISFILE) ||
+	    (avail < len)) {
+		return NULL;
+	}
+
+	MGET(m, 0, 0);
+	if (!m) {
+		return NULL;
+	}
+	va = vmm_host_memmap(hphys & ~VMM_PAGE_MASK, VMM_PAGE_SIZE,
+			     VMM_MEMORY_FLAGS_NORMAL);
+	va += hphys & VMM_PAGE_MASK;
+	arch_atomic_inc(&zc->refs);
+	MEXTADD(m, va, len, virtio_net_zc_ext_free, zc);
+	/* Guest owns the buffer so nobody should write to it */
+	m->m_flags &= ~M_EXT_RW;
+	m->m_len = len;
+
+	return m;
+}
+
+/* Build mbuf chain for a TX frame where everything except the leading
+ * bytes references guest memory. The guest buffer is returned to the
+ * guest when the last mbuf of the chain is freed.
+ */
+static struct vmm_mbuf *virtio_net_tx_zerocopy(struct virtio_net_queue *q,
+					       u16 head,
+					       struct vmm_virtio_iovec *iov,
+					       u32 iov_cnt, u32 total_len,
+					       u32 hdr_len)
+{
+	u32 i, off, len, copy_len;
+	physical_addr_t gphys;
+	struct vmm_virtio_net_hdr hdr;
+	struct vmm_mbuf *mb, *m, **tail;
+	struct virtio_net_zc_tx *zc;
+	struct vmm_virtio_device *dev = q->ndev->vdev;
+
+	if (((total_len - hdr_len) < VIRTIO_NET_ZC_MIN_LEN) ||
+	    (VIRTIO_NET_QUEUE_SIZE <= head)) {
+		return NULL;
+	}
+
+	/* Slot still referenced by frame from before queue reset */
+	zc = &q->zc[head];
+	if (arch_atomic_read(&zc->refs)) {
+		return NULL;
+	}
+
+	copy_len = hdr_len + VIRTIO_NET_ZC_COPY_LEN;
+	MGETHDR(mb, 0, 0);
+	if (!mb) {
+		return NULL;
+	}
+	if (!m_ext_get(mb, copy_len, VMM_MBUF_ALLOC_DEFAULT) ||
+	    (vmm_virtio_iovec_to_buf_read(dev, iov, iov_cnt,
+				M_BUFADDR(mb), copy_len) != copy_len)) {
+		m_freem(mb);
+		return NULL;
+	}
+	memcpy(&hdr, M_BUFADDR(mb), sizeof(hdr));
+	mb->m_data += hdr_len;
+	mb->m_len = VIRTIO_NET_ZC_COPY_LEN;
+	mb->m_pktlen = total_len - hdr_len;
+	if (virtio_net_hdr_to_mbuf(&hdr, mb)) {
+		m_freem(mb);
+		return NULL;
+	}
+
+	zc->q = q;
+	zc->head = head;
+	zc->len = total_len;
+	zc->gen = q->zc_gen;
+	zc->publish = FALSE;
+	arch_atomic_write(&zc->refs, 1);
+	arch_atomic_inc(&q->ndev->refs);
+
+	tail = &mb->m_next;
+	off = copy_len;
+	for (i = 0; i < iov_cnt; i++) {
+		if (iov[i].len <= off) {
+			off -= iov[i].len;
+			continue;
+		}
+		gphys = iov[i].addr + off;
+		len = iov[i].len - off;
+		off = 0;
+		while (len) {
+			m = virtio_net_zc_map(q->ndev, zc, gphys, len);
+			if (!m) {
+				/* Caller falls back to copying */
+				m_freem(mb);
+				virtio_net_zc_put(zc);
+				return NULL;
+			}
+			*tail = m;
+			tail = &m->m_next;
+			gphys += m->m_len;
+			len -= m->m_len;
+		}
+	}
+
+	/* Drop our reference, mbufs of the chain hold the rest */
+	zc->publish = TRUE;
+	virtio_net_zc_put(zc);
+
+	return mb;
+}
+#endif
+
 static void virtio_net_tx_lazy(struct vmm_netport *port, void *arg, int budget)
 {
 	u16 head = 0;
-	u32 iov_cnt = 0, pkt_len = 0, total_len = 0;
+	u32 iov_cnt = 0, pkt_len = 0, total_len = 0, hdr_len;
 	struct virtio_net_queue *q = arg;
 	struct virtio_net_dev *ndev = q->ndev;
 	struct vmm_virtio_queue *vq = &q->vq;
 	struct vmm_virtio_device *dev = ndev->vdev;
 	struct vmm_virtio_iovec *iov = q->iov;
+	struct vmm_virtio_net_hdr hdr;
 	struct vmm_mbuf *mb;
+	irq_flags_t flags;
+
+	hdr_len = virtio_net_hdr_len(ndev);
 
 	while ((budget > 0) && vmm_virtio_queue_available(vq)) {
 		head = vmm_virtio_queue_get_iovec(vq, iov, &iov_cnt, &total_len);
+		budget--;
 
-		/* iov[0] is offload info */
-		pkt_len = total_len - iov[0].len;
+		/* Packet is preceded by virtio net header which
+		 * may or may not be in a separate IO vector.
+		 */
+		pkt_len = (total_len > hdr_len) ? (total_len - hdr_len) : 0;
 
-		if (pkt_len <= VIRTIO_NET_MTU) {
-			MGETHDR(mb, 0, 0);
-			MEXTMALLOC(mb, pkt_len, 0);
-			vmm_virtio_iovec_to_buf_read(dev, 
-						 &iov[1], iov_cnt - 1,
-						 M_BUFADDR(mb), pkt_len);
-			mb->m_len = mb->m_pktlen = pkt_len;
+		if (!pkt_len || (virtio_net_tx_max_len(ndev) < pkt_len)) {
+			virtio_net_tx_done(q, head, total_len, FALSE);
+			continue;
+		}
+
+#ifdef CONFIG_EMU_NET_VIRTIO_ZEROCOPY
+		mb = virtio_net_tx_zerocopy(q, head, iov, iov_cnt,
+					    total_len, hdr_len);
+		if (mb) {
 			vmm_port2switch_xfer_mbuf(ndev->port, mb);
+			continue;
 		}
+#endif
 
-		vmm_virtio_queue_set_used_elem(vq, head, total_len);
+		MGETHDR(mb, 0, 0);
+		if (mb && !m_ext_get(mb, total_len, VMM_MBUF_ALLOC_DEFAULT)) {
+			m_freem(mb);
+			mb = NULL;
+		}
+		if (mb) {
+			vmm_virtio_iovec_to_buf_read(dev, iov, iov_cnt,
+						     M_BUFADDR(mb), total_len);
+			memcpy(&hdr, M_BUFADDR(mb), sizeof(hdr));
+			mb->m_data += hdr_len;
+			mb->m_len = mb->m_pktlen = pkt_len;
+			if (virtio_net_hdr_to_mbuf(&hdr, mb)) {
+				m_freem(mb);
+			} else {
+				vmm_port2switch_xfer_mbuf(ndev->port, mb);
+			}
+		}
 
-		budget--;
+		virtio_net_tx_done(q, head, total_len, FALSE);
 	}
 
+	vmm_spin_lock_irqsave_lite(&q->used_lock, flags);
 	if (vmm_virtio_queue_should_signal(vq)) {
 		dev->tra->notify(dev, q->num);
 	}
+	vmm_spin_unlock_irqrestore_lite(&q->used_lock, flags);
 
 	virtio_net_tx_poke(ndev, q->num);
 }
@@ -196,37 +671,81 @@ static void virtio_net_tx_poke(struct virtio_net_dev *ndev, u32 vq)
 	struct virtio_net_queue *q = &ndev->vqs[vq];
 
 	if (vmm_virtio_queue_available(&q->vq)) {
-		vmm_port2switch_xfer_lazy(ndev->port, virtio_net_tx_lazy, 
-					  q, VIRTIO_NET_TX_LAZY_BUDGET);
+		vmm_port2switch_xfer_lazy_on(ndev->port, q->hcpu,
+					     virtio_net_tx_lazy, q,
+					     VIRTIO_NET_TX_LAZY_BUDGET);
 	}
 }
 
+static vmm_virtio_net_ctrl_ack_t virtio_net_ctrl_mq(struct virtio_net_dev *ndev,
+						   u8 cmd, void *data, u32 len)
+{
+	struct vmm_virtio_net_ctrl_mq mq;
+
+	if ((cmd != VMM_VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET) ||
+	    (len < sizeof(mq))) {
+		return VMM_VIRTIO_NET_ERR;
+	}
+
+	memcpy(&mq, data, sizeof(mq));
+	if ((mq.virtqueue_pairs < VMM_VIRTIO_NET_CTRL_MQ_VQ_PAIRS_MIN) ||
+	    (ndev->config.max_virtqueue_pairs < mq.virtqueue_pairs)) {
+		return VMM_VIRTIO_NET_ERR;
+	}
+
+	/* RX steering picks up new value for next frame */
+	ndev->curr_queue_pairs = mq.virtqueue_pairs;
+
+	return VMM_VIRTIO_NET_OK;
+}
+
 static void virtio_net_handle_comp(struct virtio_net_dev *ndev, u32 qnum)
 {
 	struct virtio_net_queue *q = &ndev->vqs[qnum];
 	struct vmm_virtio_queue *vq = &q->vq;
 	struct vmm_virtio_iovec *iov = q->iov;
 	struct vmm_virtio_device *dev = ndev->vdev;
-	struct vmm_virtio_net_ctrl_hdr ctrl;
-	vmm_virtio_net_ctrl_ack_t status = VMM_VIRTIO_NET_ERR;
+	struct vmm_virtio_net_ctrl_hdr *ctrl;
+	vmm_virtio_net_ctrl_ack_t status;
+	u8 buf[sizeof(*ctrl) + sizeof(struct vmm_virtio_net_ctrl_mq)];
 	u16 head = 0;
-	u32 iov_cnt = 0, total_len = 0;
+	u32 iov_cnt = 0, total_len = 0, len;
 
-	if (vmm_virtio_queue_available(vq)) {
+	while (vmm_virtio_queue_available(vq)) {
 		head = vmm_virtio_queue_get_iovec(vq, iov,
 						  &iov_cnt, &total_len);
 
-		if (total_len < sizeof(status) || total_len < sizeof(ctrl)) {
-			vmm_printf("%s: virtio-net ctrl missing"
-					" headers", __func__);
+		/* Command header first and ack status last */
+		if (!iov_cnt ||
+		    (total_len < (sizeof(*ctrl) + sizeof(status)))) {
+			vmm_printf("%s: virtio-net ctrl missing headers\n",
+				   __func__);
+			vmm_virtio_queue_set_used_elem(vq, head, 0);
+			continue;
+		}
+
+		len = total_len - sizeof(status);
+		len = (len < sizeof(buf)) ? len : sizeof(buf);
+		len = vmm_virtio_iovec_to_buf_read(dev, iov, iov_cnt,
+						   buf, len);
+		ctrl = (struct vmm_virtio_net_ctrl_hdr *)buf;
+
+		status = VMM_VIRTIO_NET_ERR;
+		if ((sizeof(*ctrl) <= len) &&
+		    (ctrl->class == VMM_VIRTIO_NET_CTRL_MQ)) {
+			status = virtio_net_ctrl_mq(ndev, ctrl->cmd,
+						    buf + sizeof(*ctrl),
+						    len - sizeof(*ctrl));
 		}
 
-		vmm_virtio_iovec_to_buf_read(dev, &iov[0], 1,
-					     &ctrl, sizeof(ctrl));
+		virtio_net_iovec_write(dev, iov, iov_cnt,
+				       total_len - sizeof(status),
+				       &status, sizeof(status));
+		vmm_virtio_queue_set_used_elem(vq, head, sizeof(status));
+	}
 
-		vmm_printf("%s: IOV Class %d is not handled\n", __func__,
-				ctrl.class);
-		vmm_virtio_queue_set_used_elem(vq, head, total_len);
+	if (vmm_virtio_queue_should_signal(vq)) {
+		dev->tra->notify(dev, qnum);
 	}
 }
 
@@ -264,35 +783,130 @@ static int virtio_net_can_receive(struct vmm_netport *p)
 	return ndev->can_receive;
 }
 
-static int virtio_net_switch2port_xfer(struct vmm_netport *p,
-				       struct vmm_mbuf *mb)
+static void virtio_net_rx_mergeable(struct virtio_net_dev *ndev,
+				    struct virtio_net_queue *q,
+				    struct vmm_mbuf *mb)
 {
-	u16 head = 0;
-	u32 iov_cnt = 0, total_len = 0, pkt_len = 0;
-	struct virtio_net_dev *ndev = p->priv;
-	/* FIXME: Select correct RX queue here  */
-	struct virtio_net_queue *q = &ndev->vqs[0];
+	u16 head;
+	u32 b, nbufs, iov_cnt, iov_used, total_len, len, off, space, need;
 	struct vmm_virtio_queue *vq = &q->vq;
 	struct vmm_virtio_iovec *iov = q->iov;
 	struct vmm_virtio_device *dev = ndev->vdev;
+	struct vmm_virtio_net_hdr_mrg_rxbuf hdr;
 
-	pkt_len = min(VIRTIO_NET_MTU, mb->m_pktlen);
+	need = sizeof(hdr) + mb->m_pktlen;
 
-	if (vmm_virtio_queue_available(vq)) {
+	/* Collect enough guest buffers to hold the whole frame. The
+	 * IO vectors are saved because guest can rewrite descriptors
+	 * while we are still filling buffers.
+	 */
+	nbufs = space = iov_used = 0;
+	while (space < need) {
+		if ((nbufs == VIRTIO_NET_QUEUE_SIZE) ||
+		    !vmm_virtio_queue_available(vq)) {
+			vmm_virtio_queue_discard(vq, nbufs);
+			return;
+		}
 		head = vmm_virtio_queue_get_iovec(vq, iov,
 						  &iov_cnt, &total_len);
+		if (!iov_cnt || !total_len ||
+		    ((VIRTIO_NET_QUEUE_SIZE - iov_used) < iov_cnt)) {
+			vmm_virtio_queue_discard(vq, nbufs + 1);
+			return;
+		}
+		memcpy(&q->mrg_iov[iov_used], iov, iov_cnt * sizeof(*iov));
+		iov_used += iov_cnt;
+		q->mrg_heads[nbufs] = head;
+		q->mrg_iov_cnt[nbufs] = iov_cnt;
+		q->mrg_len[nbufs] = total_len;
+		nbufs++;
+		space += total_len;
+	}
+
+	virtio_net_mbuf_to_hdr(ndev, mb, &hdr.hdr);
+	hdr.num_buffers = nbufs;
+
+	/* Fill all buffers and make them visible to guest at once */
+	iov = q->mrg_iov;
+	for (b = 0, off = 0; b < nbufs; b++) {
+		total_len = q->mrg_len[b];
+		len = ((need - off) < total_len) ? (need - off) : total_len;
+		len = virtio_net_rx_write(dev, iov, q->mrg_iov_cnt[b],
+					  &hdr, sizeof(hdr), mb, off, len);
+		iov += q->mrg_iov_cnt[b];
+		vmm_virtio_queue_fill_used_elem(vq, q->mrg_heads[b], len, b);
+		off += len;
 	}
+	vmm_virtio_queue_flush_used(vq, nbufs);
+}
 
-	if (iov_cnt > 1) {
-		vmm_virtio_iovec_fill_zeros(dev, &iov[0], 1);
-		vmm_virtio_buf_to_iovec_write(dev, &iov[1], 1,
-						M_BUFADDR(mb), pkt_len);
-		vmm_virtio_queue_set_used_elem(vq, head, iov[0].len + pkt_len);
+static void virtio_net_rx_single(struct virtio_net_dev *ndev,
+				 struct virtio_net_queue *q,
+				 struct vmm_mbuf *mb)
+{
+	u16 head;
+	u32 iov_cnt = 0, total_len = 0, len = 0;
+	u32 hdr_len = virtio_net_hdr_len(ndev);
+	struct vmm_virtio_queue *vq = &q->vq;
+	struct vmm_virtio_iovec *iov = q->iov;
+	struct vmm_virtio_device *dev = ndev->vdev;
+	struct vmm_virtio_net_hdr_mrg_rxbuf hdr;
 
-		if (vmm_virtio_queue_should_signal(vq)) {
-			/* FIXME: Select correct RX queue here  */
-			dev->tra->notify(dev, 0);
-		}
+	if (!vmm_virtio_queue_available(vq)) {
+		return;
+	}
+
+	head = vmm_virtio_queue_get_iovec(vq, iov, &iov_cnt, &total_len);
+	if (!iov_cnt) {
+		return;
+	}
+
+	/* Frames not fitting guest buffer are dropped */
+	if ((hdr_len + mb->m_pktlen) <= total_len) {
+		virtio_net_mbuf_to_hdr(ndev, mb, &hdr.hdr);
+		hdr.num_buffers = 1;
+		len = virtio_net_rx_write(dev, iov, iov_cnt,
+					  &hdr, hdr_len, mb,
+					  0, hdr_len + mb->m_pktlen);
+	}
+
+	vmm_virtio_queue_set_used_elem(vq, head, len);
+}
+
+/* Steer frames of a flow to same RX queue so that guest can
+ * process different flows on different vCPUs.
+ */
+static struct virtio_net_queue *virtio_net_rx_queue(struct virtio_net_dev *ndev,
+						    struct vmm_mbuf *mb)
+{
+	u32 pair = 0;
+	struct virtio_net_queue *q;
+
+	if (1 < ndev->curr_queue_pairs) {
+		pair = umod32(m_flow_hash(mb), ndev->curr_queue_pairs);
+	}
+
+	/* RX queue of pair 'n' is virtqueue '2n' */
+	q = &ndev->vqs[pair * 2];
+
+	return (q->valid) ? q : &ndev->vqs[0];
+}
+
+static int virtio_net_switch2port_xfer(struct vmm_netport *p,
+				       struct vmm_mbuf *mb)
+{
+	struct virtio_net_dev *ndev = p->priv;
+	struct virtio_net_queue *q = virtio_net_rx_queue(ndev, mb);
+	struct vmm_virtio_device *dev = ndev->vdev;
+
+	if (ndev->features & (1UL << VMM_VIRTIO_NET_F_MRG_RXBUF)) {
+		virtio_net_rx_mergeable(ndev, q, mb);
+	} else {
+		virtio_net_rx_single(ndev, q, mb);
+	}
+
+	if (vmm_virtio_queue_should_signal(&q->vq)) {
+		dev->tra->notify(dev, q->num);
 	}
 
 	m_freem(mb);
@@ -334,6 +948,10 @@ static int virtio_net_reset(struct vmm_virtio_device *dev)
 	struct virtio_net_dev *ndev = dev->emu_data;
 
 	for (i = 0; i < ndev->max_queues; i++) {
+#ifdef CONFIG_EMU_NET_VIRTIO_ZEROCOPY
+		/* In-flight zero-copy frames must not touch new ring */
+		virtio_net_zc_detach(&ndev->vqs[i]);
+#endif
 		if (ndev->vqs[i].valid) {
 			rc = vmm_virtio_queue_cleanup(&ndev->vqs[i].vq);
 			if (rc) {
@@ -343,10 +961,27 @@ static int virtio_net_reset(struct vmm_virtio_device *dev)
 		ndev->vqs[i].valid = 0;
 	}
 	ndev->can_receive = 0;
+	ndev->curr_queue_pairs = 1;
+	ndev->features = 0;
+	ndev->port->features = 0;
 
 	return VMM_OK;
 }
 
+/* Spread TX processing of queue pairs over online host CPUs */
+static u32 virtio_net_pair_hcpu(u32 pair)
+{
+	u32 cpu, n = umod32(pair, vmm_num_online_cpus());
+
+	for_each_online_cpu(cpu) {
+		if (!n--) {
+			return cpu;
+		}
+	}
+
+	return vmm_smp_processor_id();
+}
+
 static int virtio_net_connect(struct vmm_virtio_device *dev, 
 			      struct vmm_virtio_emulator *emu)
 {
@@ -362,6 +997,7 @@ static int virtio_net_connect(struct vmm_virtio_device *dev,
 	}
 
 	ndev->vdev = dev;
+	arch_atomic_write(&ndev->refs, 1);
 	vmm_snprintf(ndev->name, VMM_VIRTIO_DEVICE_MAX_NAME_LEN,
 		     "%s", dev->name);
 	ndev->port = vmm_netport_alloc(ndev->name, VIRTIO_NET_QUEUE_SIZE);
@@ -389,12 +1025,15 @@ static int virtio_net_connect(struct vmm_virtio_device *dev,
 	ndev->config.status = VMM_VIRTIO_NET_S_LINK_UP;
 	ndev->cq = ndev->config.max_virtqueue_pairs * 2;
 	ndev->max_queues = ndev->config.max_virtqueue_pairs * 2 + 1;
+	ndev->curr_queue_pairs = 1;
 	dev->emu_data = ndev;
 
 	for (i = 0; i < ndev->max_queues; i++) {
 		ndev->vqs[i].num = i;
 		ndev->vqs[i].valid = 0;
 		ndev->vqs[i].ndev = ndev;
+		ndev->vqs[i].hcpu = virtio_net_pair_hcpu(i / 2);
+		INIT_SPIN_LOCK(&ndev->vqs[i].used_lock);
 		if (i == ndev->cq) {
 			ndev->vqs[i].type = VIRTIO_NET_CTRL_QUEUE;
 		} else {
@@ -435,11 +1074,20 @@ static int virtio_net_connect(struct vmm_virtio_device *dev,
 static void virtio_net_disconnect(struct vmm_virtio_device *dev)
 {
 	struct virtio_net_dev *ndev = dev->emu_data;
+#ifdef CONFIG_EMU_NET_VIRTIO_ZEROCOPY
+	int i;
+
+	/* In-flight frames must not touch device going away. They
+	 * still hold a reference so queues stay valid for them.
+	 */
+	for (i = 0; i < ndev->max_queues; i++) {
+		virtio_net_zc_detach(&ndev->vqs[i]);
+	}
+#endif
 
 	vmm_netport_unregister(ndev->port);
-	vmm_free(ndev->vqs);
 	vmm_netport_free(ndev->port);
-	vmm_free(ndev);
+	virtio_net_put(ndev);
 }
 
 struct vmm_virtio_device_id virtio_net_emu_id[] = {
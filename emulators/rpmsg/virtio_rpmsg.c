@@ -0,0 +1,741 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file virtio_rpmsg.c
+ * @author agent (agent@local)
+ * @brief VirtIO based RPMSG Emulator.
+ *
+ * Each VirtIO RPMSG device is a virtual messaging node. Other nodes
+ * of the same virtual messaging domain are announced to the guest as
+ * name service channels where the remote endpoint address of channel
+ * is the virtual messaging address of peer node. The guest endpoint
+ * address for replies is learned from messages sent by the guest.
+ *
+ * If a shared memory instance is specified using the "shmem" attribute
+ * then guest can send messages which only carry an offset and length
+ * within the shared memory window. Such messages are passed as
+ * zero-copy virtual messages and delivered as descriptors to peers
+ * having the same shared memory window.
+ */
+
+#include <vmm_error.h>
+#include <vmm_macros.h>
+#include <vmm_heap.h>
+#include <vmm_stdio.h>
+#include <vmm_spinlocks.h>
+#include <vmm_shmem.h>
+#include <vmm_manager.h>
+#include <vmm_guest_aspace.h>
+#include <vmm_modules.h>
+#include <vmm_devemu.h>
+#include <vio/vmm_vmsg.h>
+#include <vio/vmm_virtio.h>
+#include <vio/vmm_virtio_rpmsg.h>
+#include <libs/list.h>
+#include <libs/stringlib.h>
+
+#define MODULE_DESC			"VirtIO RPMSG Emulator"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(VMM_VMSG_IPRIORITY + \
+					 VMM_VIRTIO_IPRIORITY + 1)
+#define MODULE_INIT			virtio_rpmsg_init
+#define MODULE_EXIT			virtio_rpmsg_exit
+
+#define VIRTIO_RPMSG_QUEUE_SIZE		128
+#define VIRTIO_RPMSG_NUM_QUEUES		2
+#define VIRTIO_RPMSG_RX_QUEUE		0
+#define VIRTIO_RPMSG_TX_QUEUE		1
+
+#define VIRTIO_RPMSG_BUF_SIZE		512
+#define VIRTIO_RPMSG_HDR_SIZE		sizeof(struct vmm_virtio_rpmsg_hdr)
+#define VIRTIO_RPMSG_MAX_PAYLOAD	(VIRTIO_RPMSG_BUF_SIZE - \
+					 VIRTIO_RPMSG_HDR_SIZE)
+/* IO vectors of a buffer used for copying, rpmsg buffers are
+ * normally a single descriptor.
+ */
+#define VIRTIO_RPMSG_MAX_IOV		4
+
+struct virtio_rpmsg_peer {
+	struct dlist head;
+	char name[VMM_VIRTIO_RPMSG_NAME_SIZE];
+	u32 addr;
+	u32 guest_addr;
+};
+
+struct virtio_rpmsg_dev {
+	struct vmm_virtio_device *vdev;
+
+	struct vmm_virtio_queue vqs[VIRTIO_RPMSG_NUM_QUEUES];
+	struct vmm_virtio_iovec rx_iov[VIRTIO_RPMSG_QUEUE_SIZE];
+	struct vmm_virtio_iovec tx_iov[VIRTIO_RPMSG_QUEUE_SIZE];
+	struct vmm_virtio_rpmsg_config config;
+	u64 features;
+
+	/* Shared memory window (optional) */
+	struct vmm_shmem *shm;
+	physical_addr_t shm_base;
+
+	/* Protects peers and queue indexes, guest buffers are
+	 * copied without holding it.
+	 */
+	vmm_spinlock_t lock;
+	struct dlist peer_list;
+
+	char name[VMM_VIRTIO_DEVICE_MAX_NAME_LEN];
+	struct vmm_vmsg_node *node;
+};
+
+struct virtio_rpmsg_msg {
+	struct vmm_vmsg msg;
+	u8 data[0];
+};
+
+static void virtio_rpmsg_msg_release(struct vmm_vmsg *msg)
+{
+	vmm_free(container_of(msg, struct virtio_rpmsg_msg, msg));
+}
+
+static struct virtio_rpmsg_peer *virtio_rpmsg_find_peer(
+					struct virtio_rpmsg_dev *rdev,
+					const char *name, u32 addr)
+{
+	struct virtio_rpmsg_peer *peer;
+
+	list_for_each_entry(peer, &rdev->peer_list, head) {
+		if (name && !strncmp(peer->name, name, sizeof(peer->name))) {
+			return peer;
+		}
+		if (!name && (peer->addr == addr)) {
+			return peer;
+		}
+	}
+
+	return NULL;
+}
+
+static u64 virtio_rpmsg_get_host_features(struct vmm_virtio_device *dev)
+{
+	struct virtio_rpmsg_dev *rdev = dev->emu_data;
+	u64 features = 1UL << VMM_VIRTIO_RPMSG_F_NS;
+
+	if (rdev->shm) {
+		features |= 1UL << VMM_VIRTIO_RPMSG_F_SHMEM;
+	}
+
+	return features;
+}
+
+static void virtio_rpmsg_set_guest_features(struct vmm_virtio_device *dev,
+					    u64 features)
+{
+	struct virtio_rpmsg_dev *rdev = dev->emu_data;
+
+	rdev->features = features;
+}
+
+static int virtio_rpmsg_init_vq(struct vmm_virtio_device *dev, u32 vq,
+				struct vmm_virtio_queue_layout *layout)
+{
+	int rc;
+	struct virtio_rpmsg_dev *rdev = dev->emu_data;
+
+	switch (vq) {
+	case VIRTIO_RPMSG_RX_QUEUE:
+	case VIRTIO_RPMSG_TX_QUEUE:
+		if (VIRTIO_RPMSG_QUEUE_SIZE < layout->desc_count) {
+			rc = VMM_EINVALID;
+			break;
+		}
+		rc = vmm_virtio_queue_setup(&rdev->vqs[vq], dev->guest,
+					    layout);
+		break;
+	default:
+		rc = VMM_EINVALID;
+		break;
+	};
+
+	return rc;
+}
+
+static int virtio_rpmsg_get_pfn_vq(struct vmm_virtio_device *dev, u32 vq)
+{
+	int rc;
+	struct virtio_rpmsg_dev *rdev = dev->emu_data;
+
+	switch (vq) {
+	case VIRTIO_RPMSG_RX_QUEUE:
+	case VIRTIO_RPMSG_TX_QUEUE:
+		rc = vmm_virtio_queue_guest_pfn(&rdev->vqs[vq]);
+		break;
+	default:
+		rc = VMM_EINVALID;
+		break;
+	};
+
+	return rc;
+}
+
+static int virtio_rpmsg_get_size_vq(struct vmm_virtio_device *dev, u32 vq)
+{
+	int rc;
+
+	switch (vq) {
+	case VIRTIO_RPMSG_RX_QUEUE:
+	case VIRTIO_RPMSG_TX_QUEUE:
+		rc = VIRTIO_RPMSG_QUEUE_SIZE;
+		break;
+	default:
+		rc = 0;
+		break;
+	};
+
+	return rc;
+}
+
+static int virtio_rpmsg_set_size_vq(struct vmm_virtio_device *dev,
+				    u32 vq, int size)
+{
+	/* FIXME: dynamic */
+	return size;
+}
+
+/* Pop next available buffer of a queue and keep private copy of its
+ * IO vectors so that buffer can be accessed after dropping the lock.
+ * Returns FALSE when nothing could be popped, including a malformed
+ * descriptor chain, so that caller stops processing the queue.
+ * Must be called with rdev->lock held.
+ */
+static bool virtio_rpmsg_pop_locked(struct vmm_virtio_queue *vq,
+				    struct vmm_virtio_iovec *vq_iov,
+				    struct vmm_virtio_iovec *iov,
+				    u16 *head, u32 *iov_cnt, u32 *total_len)
+{
+	if (!vmm_virtio_queue_available(vq)) {
+		return FALSE;
+	}
+
+	*head = vmm_virtio_queue_get_iovec(vq, vq_iov, iov_cnt, total_len);
+	if (!*iov_cnt) {
+		return FALSE;
+	}
+	if (VIRTIO_RPMSG_MAX_IOV < *iov_cnt) {
+		*iov_cnt = VIRTIO_RPMSG_MAX_IOV;
+	}
+	memcpy(iov, vq_iov, *iov_cnt * sizeof(*iov));
+
+	return TRUE;
+}
+
+static int virtio_rpmsg_rx(struct virtio_rpmsg_dev *rdev,
+			   u32 src, u32 dst, u16 flags,
+			   void *data, u32 len,
+			   struct vmm_shmem *shm, physical_addr_t off)
+{
+	int rc = VMM_OK;
+	u16 head = 0;
+	irq_flags_t f;
+	u32 iov_cnt = 0, total_len = 0;
+	struct vmm_virtio_device *dev = rdev->vdev;
+	struct vmm_virtio_queue *vq = &rdev->vqs[VIRTIO_RPMSG_RX_QUEUE];
+	struct vmm_virtio_iovec iov[VIRTIO_RPMSG_MAX_IOV];
+	u8 buf[VIRTIO_RPMSG_BUF_SIZE];
+	struct vmm_virtio_rpmsg_hdr *hdr = (void *)buf;
+
+	if (VIRTIO_RPMSG_MAX_PAYLOAD < len) {
+		return VMM_EINVALID;
+	}
+
+	hdr->src = src;
+	hdr->dst = dst;
+	hdr->reserved = 0;
+	hdr->len = len;
+	hdr->flags = flags;
+	if (shm) {
+		if (vmm_shmem_read(shm, off, hdr->data, len, TRUE) != len) {
+			return VMM_EIO;
+		}
+	} else if (len) {
+		memcpy(hdr->data, data, len);
+	}
+	len += VIRTIO_RPMSG_HDR_SIZE;
+
+	vmm_spin_lock_irqsave(&rdev->lock, f);
+	if (!virtio_rpmsg_pop_locked(vq, rdev->rx_iov, iov,
+				     &head, &iov_cnt, &total_len)) {
+		vmm_spin_unlock_irqrestore(&rdev->lock, f);
+		return VMM_ENOSPC;
+	}
+	vmm_spin_unlock_irqrestore(&rdev->lock, f);
+
+	if (total_len < len) {
+		rc = VMM_ENOSPC;
+		len = 0;
+	} else {
+		len = vmm_virtio_buf_to_iovec_write(dev, iov, iov_cnt,
+						    buf, len);
+	}
+
+	vmm_spin_lock_irqsave(&rdev->lock, f);
+	vmm_virtio_queue_set_used_elem(vq, head, len);
+	if (vmm_virtio_queue_should_signal(vq)) {
+		dev->tra->notify(dev, VIRTIO_RPMSG_RX_QUEUE);
+	}
+	vmm_spin_unlock_irqrestore(&rdev->lock, f);
+
+	return rc;
+}
+
+static void virtio_rpmsg_ns_announce(struct virtio_rpmsg_dev *rdev,
+				     const char *name, u32 addr, u32 flags)
+{
+	struct vmm_virtio_rpmsg_ns_msg ns;
+
+	memset(&ns, 0, sizeof(ns));
+	strncpy(ns.name, name, sizeof(ns.name) - 1);
+	ns.addr = addr;
+	ns.flags = flags;
+
+	virtio_rpmsg_rx(rdev, addr, VMM_VIRTIO_RPMSG_NS_ADDR, 0,
+			&ns, sizeof(ns), NULL, 0);
+}
+
+static int virtio_rpmsg_tx_msg(struct virtio_rpmsg_dev *rdev,
+			       struct vmm_virtio_rpmsg_hdr *hdr)
+{
+	int rc;
+	irq_flags_t f;
+	struct vmm_vmsg *msg;
+	struct virtio_rpmsg_msg *cmsg;
+	struct virtio_rpmsg_peer *peer;
+	struct vmm_virtio_rpmsg_ns_msg *ns;
+	struct vmm_virtio_rpmsg_shmem_desc *desc;
+
+	/* Guest name service announcement binds guest endpoint */
+	if (hdr->dst == VMM_VIRTIO_RPMSG_NS_ADDR) {
+		if (hdr->len < sizeof(*ns)) {
+			return VMM_EINVALID;
+		}
+		ns = (void *)hdr->data;
+		vmm_spin_lock_irqsave(&rdev->lock, f);
+		peer = virtio_rpmsg_find_peer(rdev, ns->name, 0);
+		if (peer) {
+			peer->guest_addr = (ns->flags == VMM_VIRTIO_RPMSG_NS_CREATE) ?
+					   ns->addr : VMM_VIRTIO_RPMSG_ADDR_ANY;
+		}
+		vmm_spin_unlock_irqrestore(&rdev->lock, f);
+		return VMM_OK;
+	}
+
+	/* Replies to the peer go to the last guest endpoint used */
+	vmm_spin_lock_irqsave(&rdev->lock, f);
+	peer = virtio_rpmsg_find_peer(rdev, NULL, hdr->dst);
+	if (peer) {
+		peer->guest_addr = hdr->src;
+	}
+	vmm_spin_unlock_irqrestore(&rdev->lock, f);
+	if (!peer && (hdr->dst != VMM_VMSG_NODE_ADDR_ANY)) {
+		return VMM_ENOENT;
+	}
+
+	if (hdr->flags & VMM_VIRTIO_RPMSG_HDR_F_SHMEM) {
+		if (!rdev->shm || (hdr->len < sizeof(*desc))) {
+			return VMM_EINVALID;
+		}
+		desc = (void *)hdr->data;
+		if (!desc->len ||
+		    (rdev->config.shmem_size < desc->offset) ||
+		    ((rdev->config.shmem_size - desc->offset) < desc->len)) {
+			return VMM_EINVALID;
+		}
+		msg = vmm_vmsg_alloc_shmem(hdr->dst,
+				vmm_vmsg_node_get_addr(rdev->node), rdev->shm,
+				rdev->shm_base + desc->offset, desc->len);
+		if (!msg) {
+			return VMM_ENOMEM;
+		}
+	} else {
+		if (!hdr->len) {
+			return VMM_EINVALID;
+		}
+		cmsg = vmm_malloc(sizeof(*cmsg) + hdr->len);
+		if (!cmsg) {
+			return VMM_ENOMEM;
+		}
+		memcpy(cmsg->data, hdr->data, hdr->len);
+		msg = &cmsg->msg;
+		INIT_VMSG(msg, hdr->dst, vmm_vmsg_node_get_addr(rdev->node),
+			  cmsg->data, hdr->len, NULL, virtio_rpmsg_msg_release);
+	}
+
+	rc = vmm_vmsg_node_send(rdev->node, msg);
+	vmm_vmsg_free(msg);
+
+	return rc;
+}
+
+static int virtio_rpmsg_do_tx(struct vmm_virtio_device *dev,
+			      struct virtio_rpmsg_dev *rdev)
+{
+	u16 head = 0;
+	irq_flags_t f;
+	bool popped;
+	u32 len, iov_cnt = 0, total_len = 0;
+	struct vmm_virtio_queue *vq = &rdev->vqs[VIRTIO_RPMSG_TX_QUEUE];
+	struct vmm_virtio_iovec iov[VIRTIO_RPMSG_MAX_IOV];
+	struct vmm_virtio_rpmsg_hdr *hdr;
+	u8 buf[VIRTIO_RPMSG_BUF_SIZE];
+
+	while (1) {
+		vmm_spin_lock_irqsave(&rdev->lock, f);
+		popped = virtio_rpmsg_pop_locked(vq, rdev->tx_iov, iov,
+						 &head, &iov_cnt, &total_len);
+		vmm_spin_unlock_irqrestore(&rdev->lock, f);
+		if (!popped) {
+			break;
+		}
+
+		len = vmm_virtio_iovec_to_buf_read(dev, iov, iov_cnt,
+						   buf, sizeof(buf));
+
+		/* Device wrote nothing to TX buffer */
+		vmm_spin_lock_irqsave(&rdev->lock, f);
+		vmm_virtio_queue_set_used_elem(vq, head, 0);
+		vmm_spin_unlock_irqrestore(&rdev->lock, f);
+
+		hdr = (void *)buf;
+		if ((len < VIRTIO_RPMSG_HDR_SIZE) ||
+		    ((len - VIRTIO_RPMSG_HDR_SIZE) < hdr->len)) {
+			continue;
+		}
+
+		virtio_rpmsg_tx_msg(rdev, hdr);
+	}
+
+	if (vmm_virtio_queue_should_signal(vq)) {
+		dev->tra->notify(dev, VIRTIO_RPMSG_TX_QUEUE);
+	}
+
+	return VMM_OK;
+}
+
+static int virtio_rpmsg_notify_vq(struct vmm_virtio_device *dev, u32 vq)
+{
+	int rc = VMM_OK;
+	struct virtio_rpmsg_dev *rdev = dev->emu_data;
+
+	switch (vq) {
+	case VIRTIO_RPMSG_TX_QUEUE:
+		rc = virtio_rpmsg_do_tx(dev, rdev);
+		break;
+	case VIRTIO_RPMSG_RX_QUEUE:
+		/* Guest has posted rx buffers so we are ready */
+		if (!vmm_vmsg_node_is_ready(rdev->node)) {
+			vmm_vmsg_node_ready(rdev->node);
+		}
+		break;
+	default:
+		rc = VMM_EINVALID;
+		break;
+	}
+
+	return rc;
+}
+
+static void virtio_rpmsg_peer_up(struct vmm_vmsg_node *node,
+				 const char *peer_name, u32 peer_addr)
+{
+	irq_flags_t f;
+	struct virtio_rpmsg_peer *peer;
+	struct virtio_rpmsg_dev *rdev = vmm_vmsg_node_priv(node);
+
+	peer = vmm_zalloc(sizeof(*peer));
+	if (!peer) {
+		return;
+	}
+
+	INIT_LIST_HEAD(&peer->head);
+	strncpy(peer->name, peer_name, sizeof(peer->name) - 1);
+	peer->addr = peer_addr;
+	peer->guest_addr = VMM_VIRTIO_RPMSG_ADDR_ANY;
+
+	vmm_spin_lock_irqsave(&rdev->lock, f);
+	list_add_tail(&peer->head, &rdev->peer_list);
+	vmm_spin_unlock_irqrestore(&rdev->lock, f);
+
+	virtio_rpmsg_ns_announce(rdev, peer_name, peer_addr,
+				 VMM_VIRTIO_RPMSG_NS_CREATE);
+}
+
+static void virtio_rpmsg_peer_down(struct vmm_vmsg_node *node,
+				   const char *peer_name, u32 peer_addr)
+{
+	irq_flags_t f;
+	struct virtio_rpmsg_peer *peer;
+	struct virtio_rpmsg_dev *rdev = vmm_vmsg_node_priv(node);
+
+	vmm_spin_lock_irqsave(&rdev->lock, f);
+	peer = virtio_rpmsg_find_peer(rdev, NULL, peer_addr);
+	if (peer) {
+		list_del(&peer->head);
+	}
+	vmm_spin_unlock_irqrestore(&rdev->lock, f);
+
+	if (peer) {
+		vmm_free(peer);
+		virtio_rpmsg_ns_announce(rdev, peer_name, peer_addr,
+					 VMM_VIRTIO_RPMSG_NS_DESTROY);
+	}
+}
+
+static void virtio_rpmsg_recv_msg(struct vmm_vmsg_node *node,
+				  struct vmm_vmsg *msg)
+{
+	irq_flags_t f;
+	u32 guest_addr = VMM_VIRTIO_RPMSG_ADDR_ANY;
+	struct virtio_rpmsg_peer *peer;
+	struct vmm_virtio_rpmsg_shmem_desc desc;
+	struct virtio_rpmsg_dev *rdev = vmm_vmsg_node_priv(node);
+
+	vmm_spin_lock_irqsave(&rdev->lock, f);
+	peer = virtio_rpmsg_find_peer(rdev, NULL, msg->src);
+	if (peer) {
+		guest_addr = peer->guest_addr;
+	}
+	vmm_spin_unlock_irqrestore(&rdev->lock, f);
+
+	if (guest_addr == VMM_VIRTIO_RPMSG_ADDR_ANY) {
+		/* Guest has no endpoint for this peer so drop */
+		return;
+	}
+
+	if (msg->shm && (msg->shm == rdev->shm) &&
+	    (rdev->shm_base <= msg->shm_off) &&
+	    ((msg->shm_off + msg->len) <=
+	     (rdev->shm_base + rdev->config.shmem_size))) {
+		/* Payload already visible to guest so pass descriptor */
+		desc.offset = msg->shm_off - rdev->shm_base;
+		desc.len = msg->len;
+		virtio_rpmsg_rx(rdev, msg->src, guest_addr,
+				VMM_VIRTIO_RPMSG_HDR_F_SHMEM,
+				&desc, sizeof(desc), NULL, 0);
+	} else {
+		virtio_rpmsg_rx(rdev, msg->src, guest_addr, 0,
+				msg->data, msg->len, msg->shm, msg->shm_off);
+	}
+}
+
+static struct vmm_vmsg_node_ops virtio_rpmsg_ops = {
+	.peer_up = virtio_rpmsg_peer_up,
+	.peer_down = virtio_rpmsg_peer_down,
+	.recv_msg = virtio_rpmsg_recv_msg,
+};
+
+static int virtio_rpmsg_read_config(struct vmm_virtio_device *dev,
+				    u32 offset, void *dst, u32 dst_len)
+{
+	struct virtio_rpmsg_dev *rdev = dev->emu_data;
+	u8 *src = (u8 *)&rdev->config;
+	u32 i, src_len = sizeof(rdev->config);
+
+	for (i = 0; (i < dst_len) && ((offset + i) < src_len); i++) {
+		*((u8 *)dst + i) = src[offset + i];
+	}
+
+	return VMM_OK;
+}
+
+static int virtio_rpmsg_write_config(struct vmm_virtio_device *dev,
+				     u32 offset, void *src, u32 src_len)
+{
+	/* Config space is read-only */
+	return VMM_OK;
+}
+
+static int virtio_rpmsg_reset(struct vmm_virtio_device *dev)
+{
+	int rc;
+	irq_flags_t f;
+	struct virtio_rpmsg_peer *peer;
+	struct virtio_rpmsg_dev *rdev = dev->emu_data;
+
+	vmm_vmsg_node_notready(rdev->node);
+
+	vmm_spin_lock_irqsave(&rdev->lock, f);
+	while (!list_empty(&rdev->peer_list)) {
+		peer = list_first_entry(&rdev->peer_list,
+					struct virtio_rpmsg_peer, head);
+		list_del(&peer->head);
+		vmm_free(peer);
+	}
+
+	rc = vmm_virtio_queue_cleanup(&rdev->vqs[VIRTIO_RPMSG_RX_QUEUE]);
+	if (!rc) {
+		rc = vmm_virtio_queue_cleanup(
+					&rdev->vqs[VIRTIO_RPMSG_TX_QUEUE]);
+	}
+	vmm_spin_unlock_irqrestore(&rdev->lock, f);
+
+	return rc;
+}
+
+struct virtio_rpmsg_region_find {
+	struct vmm_shmem *shm;
+	struct vmm_region *reg;
+};
+
+static void virtio_rpmsg_region_iter(struct vmm_guest *guest,
+				     struct vmm_region *reg, void *priv)
+{
+	struct virtio_rpmsg_region_find *find = priv;
+
+	if (!find->reg && (reg->shm == find->shm)) {
+		find->reg = reg;
+	}
+}
+
+static int virtio_rpmsg_connect(struct vmm_virtio_device *dev,
+				struct vmm_virtio_emulator *emu)
+{
+	const char *attr;
+	struct virtio_rpmsg_dev *rdev;
+	struct vmm_vmsg_domain *domain = NULL;
+	struct virtio_rpmsg_region_find find;
+
+	rdev = vmm_zalloc(sizeof(struct virtio_rpmsg_dev));
+	if (!rdev) {
+		vmm_printf("Failed to allocate virtio rpmsg device....\n");
+		return VMM_ENOMEM;
+	}
+	rdev->vdev = dev;
+	INIT_SPIN_LOCK(&rdev->lock);
+	INIT_LIST_HEAD(&rdev->peer_list);
+
+	if (vmm_devtree_read_string(dev->edev->node,
+				    "domain", &attr) == VMM_OK) {
+		domain = vmm_vmsg_domain_find(attr);
+		if (!domain) {
+			vmm_printf("%s: vmsg domain %s not found\n",
+				   dev->name, attr);
+			vmm_free(rdev);
+			return VMM_ENOTAVAIL;
+		}
+	}
+
+	if (vmm_devtree_read_string(dev->edev->node,
+				    "shmem", &attr) == VMM_OK) {
+		find.shm = vmm_shmem_find_byname(attr);
+		find.reg = NULL;
+		if (find.shm) {
+			vmm_guest_iterate_region(dev->guest,
+						 VMM_REGION_ISSHARED,
+						 virtio_rpmsg_region_iter,
+						 &find);
+		}
+		if (!find.reg) {
+			vmm_printf("%s: shmem %s not mapped in guest\n",
+				   dev->name, attr);
+			vmm_free(rdev);
+			return VMM_ENOTAVAIL;
+		}
+		vmm_shmem_ref(find.shm);
+		rdev->shm = find.shm;
+		rdev->shm_base = find.reg->aphys_addr -
+				 vmm_shmem_get_addr(find.shm);
+		rdev->config.shmem_addr = VMM_REGION_GPHYS_START(find.reg);
+		rdev->config.shmem_size = VMM_REGION_PHYS_SIZE(find.reg);
+	}
+
+	vmm_snprintf(rdev->name, VMM_VIRTIO_DEVICE_MAX_NAME_LEN,
+		     "%s", dev->name);
+	dev->emu_data = rdev;
+
+	rdev->node = vmm_vmsg_node_create(rdev->name, &virtio_rpmsg_ops,
+					  domain, rdev);
+	if (!rdev->node) {
+		dev->emu_data = NULL;
+		if (rdev->shm) {
+			vmm_shmem_dref(rdev->shm);
+		}
+		vmm_free(rdev);
+		return VMM_EFAIL;
+	}
+
+	return VMM_OK;
+}
+
+static void virtio_rpmsg_disconnect(struct vmm_virtio_device *dev)
+{
+	struct virtio_rpmsg_peer *peer;
+	struct virtio_rpmsg_dev *rdev = dev->emu_data;
+
+	vmm_vmsg_node_destroy(rdev->node);
+	while (!list_empty(&rdev->peer_list)) {
+		peer = list_first_entry(&rdev->peer_list,
+					struct virtio_rpmsg_peer, head);
+		list_del(&peer->head);
+		vmm_free(peer);
+	}
+	if (rdev->shm) {
+		vmm_shmem_dref(rdev->shm);
+	}
+	vmm_free(rdev);
+}
+
+struct vmm_virtio_device_id virtio_rpmsg_emu_id[] = {
+	{ .type = VMM_VIRTIO_ID_RPMSG },
+	{ },
+};
+
+struct vmm_virtio_emulator virtio_rpmsg = {
+	.name = "virtio_rpmsg",
+	.id_table = virtio_rpmsg_emu_id,
+
+	/* VirtIO operations */
+	.get_host_features      = virtio_rpmsg_get_host_features,
+	.set_guest_features     = virtio_rpmsg_set_guest_features,
+	.init_vq                = virtio_rpmsg_init_vq,
+	.get_pfn_vq             = virtio_rpmsg_get_pfn_vq,
+	.get_size_vq            = virtio_rpmsg_get_size_vq,
+	.set_size_vq            = virtio_rpmsg_set_size_vq,
+	.notify_vq              = virtio_rpmsg_notify_vq,
+
+	/* Emulator operations */
+	.read_config = virtio_rpmsg_read_config,
+	.write_config = virtio_rpmsg_write_config,
+	.reset = virtio_rpmsg_reset,
+	.connect = virtio_rpmsg_connect,
+	.disconnect = virtio_rpmsg_disconnect,
+};
+
+static int __init virtio_rpmsg_init(void)
+{
+	return vmm_virtio_register_emulator(&virtio_rpmsg);
+}
+
+static void __exit virtio_rpmsg_exit(void)
+{
+	vmm_virtio_unregister_emulator(&virtio_rpmsg);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
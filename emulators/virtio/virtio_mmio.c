@@ -28,6 +28,7 @@
 #include <vmm_devemu.h>
 #include <vio/vmm_virtio.h>
 #include <vio/vmm_virtio_mmio.h>
+#include <libs/stringlib.h>
 
 #define MODULE_DESC			"VirtIO MMIO Transport"
 #define MODULE_AUTHOR			"Pranav Sawargaonkar"
@@ -36,11 +37,24 @@
 #define	MODULE_INIT			virtio_mmio_init
 #define	MODULE_EXIT			virtio_mmio_exit
 
+struct virtio_mmio_queue {
+	u32 num;
+	u32 ready;
+	u64 desc;
+	u64 avail;
+	u64 used;
+};
+
 struct virtio_mmio_dev {
 	struct vmm_guest *guest;
 	struct vmm_virtio_device dev;
 	struct vmm_virtio_mmio_config config;
+	struct virtio_mmio_queue queues[VMM_VIRTIO_MMIO_QUEUE_MAX];
+	u32 guest_features[2];
 	u32 irq;
+#ifdef CONFIG_VIRTIO_DOORBELL
+	struct vmm_devemu_doorbell db;
+#endif
 };
 
 static int virtio_mmio_notify(struct vmm_virtio_device *dev, u32 vq)
@@ -54,11 +68,39 @@ static int virtio_mmio_notify(struct vmm_virtio_device *dev, u32 vq)
 	return VMM_OK;
 }
 
+static struct virtio_mmio_queue *virtio_mmio_cur_queue(
+					struct virtio_mmio_dev *m)
+{
+	if (VMM_VIRTIO_MMIO_QUEUE_MAX <= m->config.queue_sel) {
+		return NULL;
+	}
+
+	return &m->queues[m->config.queue_sel];
+}
+
+static void virtio_mmio_set_addr(u64 *addr, u32 val, bool high)
+{
+	if (high) {
+		*addr = (*addr & 0xFFFFFFFFULL) | ((u64)val << 32);
+	} else {
+		*addr = (*addr & ~0xFFFFFFFFULL) | val;
+	}
+}
+
+static void virtio_mmio_queues_clear(struct virtio_mmio_dev *m)
+{
+	memset(m->queues, 0, sizeof(m->queues));
+	m->guest_features[0] = 0;
+	m->guest_features[1] = 0;
+}
+
 int virtio_mmio_config_read(struct virtio_mmio_dev *m,
 			    u32 offset, void *dst,
 			    u32 dst_len)
 {
 	int rc = VMM_OK;
+	u64 features;
+	struct virtio_mmio_queue *q = virtio_mmio_cur_queue(m);
 
 	switch (offset) {
 	case VMM_VIRTIO_MMIO_MAGIC_VALUE:
@@ -70,7 +112,14 @@ int virtio_mmio_config_read(struct virtio_mmio_dev *m,
 		*(u32 *)dst = (*(u32 *)(((void *)&m->config) + offset));
 		break;
 	case VMM_VIRTIO_MMIO_HOST_FEATURES:
-		*(u32 *)dst = m->dev.emu->get_host_features(&m->dev);
+		features = vmm_virtio_get_host_features(&m->dev);
+		if (m->config.host_features_sel == 0) {
+			*(u32 *)dst = (u32)features;
+		} else if (m->config.host_features_sel == 1) {
+			*(u32 *)dst = (u32)(features >> 32);
+		} else {
+			*(u32 *)dst = 0;
+		}
 		break;
 	case VMM_VIRTIO_MMIO_QUEUE_PFN:
 		*(u32 *)dst = m->dev.emu->get_pfn_vq(&m->dev,
@@ -80,6 +129,12 @@ int virtio_mmio_config_read(struct virtio_mmio_dev *m,
 		*(u32 *)dst = m->dev.emu->get_size_vq(&m->dev,
 					      m->config.queue_sel);
 		break;
+	case VMM_VIRTIO_MMIO_QUEUE_READY:
+		*(u32 *)dst = (m->dev.modern && q) ? q->ready : 0;
+		break;
+	case VMM_VIRTIO_MMIO_CONFIG_GENERATION:
+		*(u32 *)dst = 0;
+		break;
 	default:
 		break;
 	}
@@ -105,24 +160,52 @@ static int virtio_mmio_config_write(struct virtio_mmio_dev *m,
 {
 	int rc = VMM_OK;
 	u32 val = *(u32 *)(src);
+	struct virtio_mmio_queue *q = virtio_mmio_cur_queue(m);
 
 	switch (offset) {
 	case VMM_VIRTIO_MMIO_HOST_FEATURES_SEL:
 	case VMM_VIRTIO_MMIO_GUEST_FEATURES_SEL:
 	case VMM_VIRTIO_MMIO_QUEUE_SEL:
-	case VMM_VIRTIO_MMIO_STATUS:
 		*(u32 *)(((void *)&m->config) + offset) = val;
 		break;
+	case VMM_VIRTIO_MMIO_STATUS:
+		if (m->dev.modern && !val) {
+			m->config.status = 0;
+			m->config.interrupt_state = 0x0;
+			vmm_devemu_emulate_irq(m->guest, m->irq, 0);
+			virtio_mmio_queues_clear(m);
+			rc = vmm_virtio_reset(&m->dev);
+			break;
+		}
+		/* Modern devices can't operate without VERSION_1 */
+		if (m->dev.modern &&
+		    (val & VMM_VIRTIO_CONFIG_S_FEATURES_OK) &&
+		    !vmm_virtio_has_feature(&m->dev, VMM_VIRTIO_F_VERSION_1)) {
+			val &= ~VMM_VIRTIO_CONFIG_S_FEATURES_OK;
+		}
+		m->config.status = val;
+		break;
 	case VMM_VIRTIO_MMIO_GUEST_FEATURES:
 		if (m->config.guest_features_sel == 0)  {
-			m->dev.emu->set_guest_features(&m->dev, val);
+			m->guest_features[0] = val;
+		} else if (m->dev.modern &&
+			   (m->config.guest_features_sel == 1)) {
+			m->guest_features[1] = val;
+		} else {
+			break;
 		}
+		vmm_virtio_set_guest_features(&m->dev,
+				((u64)m->guest_features[1] << 32) |
+				m->guest_features[0]);
 		break;
 	case VMM_VIRTIO_MMIO_GUEST_PAGE_SIZE:
 		m->config.guest_page_size = val;
 		break;
 	case VMM_VIRTIO_MMIO_QUEUE_NUM:
 		m->config.queue_num = val;
+		if (q) {
+			q->num = val;
+		}
 		m->dev.emu->set_size_vq(&m->dev, 
 					m->config.queue_sel,
 					m->config.queue_num);
@@ -131,14 +214,58 @@ static int virtio_mmio_config_write(struct virtio_mmio_dev *m,
 		m->config.queue_align = val;
 		break;
 	case VMM_VIRTIO_MMIO_QUEUE_PFN:
-		m->dev.emu->init_vq(&m->dev, 
-				    m->config.queue_sel,
-				    m->config.guest_page_size,
-				    m->config.queue_align,
-				    val);
+		if (m->dev.modern) {
+			break;
+		}
+		vmm_virtio_init_vq_legacy(&m->dev,
+				m->config.queue_sel,
+				(q && q->num) ? q->num :
+				m->dev.emu->get_size_vq(&m->dev,
+						m->config.queue_sel),
+				m->config.guest_page_size,
+				m->config.queue_align,
+				val);
+		break;
+	case VMM_VIRTIO_MMIO_QUEUE_READY:
+		if (!m->dev.modern || !q) {
+			break;
+		}
+		if (val & 0x1) {
+			rc = vmm_virtio_init_vq(&m->dev,
+				m->config.queue_sel,
+				(q->num) ? q->num :
+				m->dev.emu->get_size_vq(&m->dev,
+						m->config.queue_sel),
+				q->desc, q->avail, q->used);
+			q->ready = (rc) ? 0 : 1;
+			rc = VMM_OK;
+		} else {
+			q->ready = 0;
+		}
+		break;
+	case VMM_VIRTIO_MMIO_QUEUE_DESC_LOW:
+	case VMM_VIRTIO_MMIO_QUEUE_DESC_HIGH:
+		if (m->dev.modern && q) {
+			virtio_mmio_set_addr(&q->desc, val,
+				offset == VMM_VIRTIO_MMIO_QUEUE_DESC_HIGH);
+		}
+		break;
+	case VMM_VIRTIO_MMIO_QUEUE_AVAIL_LOW:
+	case VMM_VIRTIO_MMIO_QUEUE_AVAIL_HIGH:
+		if (m->dev.modern && q) {
+			virtio_mmio_set_addr(&q->avail, val,
+				offset == VMM_VIRTIO_MMIO_QUEUE_AVAIL_HIGH);
+		}
+		break;
+	case VMM_VIRTIO_MMIO_QUEUE_USED_LOW:
+	case VMM_VIRTIO_MMIO_QUEUE_USED_HIGH:
+		if (m->dev.modern && q) {
+			virtio_mmio_set_addr(&q->used, val,
+				offset == VMM_VIRTIO_MMIO_QUEUE_USED_HIGH);
+		}
 		break;
 	case VMM_VIRTIO_MMIO_QUEUE_NOTIFY:
-		m->dev.emu->notify_vq(&m->dev, val);
+		vmm_virtio_doorbell(&m->dev, val);
 		break;
 	case VMM_VIRTIO_MMIO_INTERRUPT_ACK:
 		m->config.interrupt_state &= ~val;
@@ -228,11 +355,22 @@ static int virtio_mmio_reset(struct vmm_emudev *edev)
 	struct virtio_mmio_dev *m = edev->priv;
 
 	m->config.interrupt_state = 0x0;
+	m->config.status = 0x0;
 	vmm_devemu_emulate_irq(m->guest, m->irq, 0);
+	virtio_mmio_queues_clear(m);
 
 	return vmm_virtio_reset(&m->dev);
 }
 
+#ifdef CONFIG_VIRTIO_DOORBELL
+static void virtio_mmio_doorbell(struct vmm_devemu_doorbell *db, u64 val)
+{
+	struct virtio_mmio_dev *m = db->priv;
+
+	vmm_virtio_doorbell(&m->dev, (u32)val);
+}
+#endif
+
 static struct vmm_virtio_transport mmio_tra = {
 	.name = "virtio_mmio",
 	.notify = virtio_mmio_notify,
@@ -243,6 +381,7 @@ static int virtio_mmio_probe(struct vmm_guest *guest,
 			     const struct vmm_devtree_nodeid *eid)
 {
 	int rc = VMM_OK;
+	u32 version = 1;
 	struct virtio_mmio_dev *m;
 
 	m = vmm_zalloc(sizeof(struct virtio_mmio_dev));
@@ -275,6 +414,16 @@ static int virtio_mmio_probe(struct vmm_guest *guest,
 
 	m->dev.id.type = m->config.device_id;
 
+	/* Legacy (version 1) register layout unless asked otherwise */
+	vmm_devtree_read_u32(edev->node, "virtio_version", &version);
+	if (version == 2) {
+		m->dev.modern = TRUE;
+		m->config.version = 2;
+	} else if (version != 1) {
+		rc = VMM_EINVALID;
+		goto virtio_mmio_probe_freestate_fail;
+	}
+
 	rc = vmm_devtree_read_u32_atindex(edev->node,
 					  VMM_DEVTREE_INTERRUPTS_ATTR_NAME,
 					  &m->irq, 0);
@@ -283,13 +432,25 @@ static int virtio_mmio_probe(struct vmm_guest *guest,
 	}
 
 	if ((rc = vmm_virtio_register_device(&m->dev))) {
-		goto virtio_mmio_probe_freestate_fail;
+		goto virtio_mmio_probe_unregister_fail;
+	}
+
+#ifdef CONFIG_VIRTIO_DOORBELL
+	m->db.offset = VMM_VIRTIO_MMIO_QUEUE_NOTIFY;
+	m->db.len = sizeof(u32);
+	m->db.ring = virtio_mmio_doorbell;
+	m->db.priv = m;
+	if ((rc = vmm_devemu_register_doorbell(edev, &m->db))) {
+		goto virtio_mmio_probe_unregister_fail;
 	}
+#endif
 
 	edev->priv = m;
 
 	goto virtio_mmio_probe_done;
 
+virtio_mmio_probe_unregister_fail:
+	vmm_virtio_unregister_device(&m->dev);
 virtio_mmio_probe_freestate_fail:
 	vmm_free(m);
 virtio_mmio_probe_done:
@@ -301,6 +462,9 @@ static int virtio_mmio_remove(struct vmm_emudev *edev)
 	struct virtio_mmio_dev *m = edev->priv;
 
 	if (m) {
+#ifdef CONFIG_VIRTIO_DOORBELL
+		vmm_devemu_unregister_doorbell(edev, &m->db);
+#endif
 		vmm_virtio_unregister_device(&m->dev);
 		vmm_free(m);
 		edev->priv = NULL;
@@ -29,6 +29,7 @@
 #include <vio/vmm_virtio.h>
 #include <vio/vmm_virtio_pci.h>
 #include <emu/pci/pci_emu_core.h>
+#include <libs/stringlib.h>
 
 
 #define VIRTIO_PCI_EMU_IPRIORITY	(PCI_EMU_CORE_IPRIORITY +	\
@@ -41,13 +42,88 @@
 #define	MODULE_INIT			virtio_pci_emulator_init
 #define	MODULE_EXIT			virtio_pci_emulator_exit
 
+struct virtio_pci_queue {
+	u16 num;
+	u16 enable;
+	u64 desc;
+	u64 avail;
+	u64 used;
+};
+
 struct virtio_pci_dev {
 	struct vmm_guest *guest;
 	struct vmm_virtio_device dev;
 	struct vmm_virtio_pci_config config;
 	u32 irq;
+	/* Modern transport state */
+	u32 host_features_sel;
+	u32 guest_features_sel;
+	u32 guest_features[2];
+	struct virtio_pci_queue queues[VMM_VIRTIO_PCI_QUEUE_MAX];
+};
+
+struct virtio_pci_modern_caps {
+	struct vmm_virtio_pci_cap common;
+	struct vmm_virtio_pci_notify_cap notify;
+	struct vmm_virtio_pci_cap isr;
+	struct vmm_virtio_pci_cap device;
+} __attribute__((packed));
+
+#define VIRTIO_PCI_CAP_OFFSET(__field)	\
+	(VMM_VIRTIO_PCI_MODERN_CAP_START + \
+	 offsetof(struct virtio_pci_modern_caps, __field))
+
+static const struct virtio_pci_modern_caps virtio_pci_caps = {
+	.common = {
+		.cap_vndr = VMM_VIRTIO_PCI_CAP_ID_VNDR,
+		.cap_next = VIRTIO_PCI_CAP_OFFSET(notify),
+		.cap_len = sizeof(struct vmm_virtio_pci_cap),
+		.cfg_type = VMM_VIRTIO_PCI_CAP_COMMON_CFG,
+		.bar = 0,
+		.offset = VMM_VIRTIO_PCI_MODERN_COMMON_OFFSET,
+		.length = VMM_VIRTIO_PCI_MODERN_COMMON_SIZE,
+	},
+	.notify = {
+		.cap = {
+			.cap_vndr = VMM_VIRTIO_PCI_CAP_ID_VNDR,
+			.cap_next = VIRTIO_PCI_CAP_OFFSET(isr),
+			.cap_len = sizeof(struct vmm_virtio_pci_notify_cap),
+			.cfg_type = VMM_VIRTIO_PCI_CAP_NOTIFY_CFG,
+			.bar = 0,
+			.offset = VMM_VIRTIO_PCI_MODERN_NOTIFY_OFFSET,
+			.length = VMM_VIRTIO_PCI_MODERN_NOTIFY_SIZE,
+		},
+		.notify_off_multiplier = VMM_VIRTIO_PCI_MODERN_NOTIFY_MULT,
+	},
+	.isr = {
+		.cap_vndr = VMM_VIRTIO_PCI_CAP_ID_VNDR,
+		.cap_next = VIRTIO_PCI_CAP_OFFSET(device),
+		.cap_len = sizeof(struct vmm_virtio_pci_cap),
+		.cfg_type = VMM_VIRTIO_PCI_CAP_ISR_CFG,
+		.bar = 0,
+		.offset = VMM_VIRTIO_PCI_MODERN_ISR_OFFSET,
+		.length = VMM_VIRTIO_PCI_MODERN_ISR_SIZE,
+	},
+	.device = {
+		.cap_vndr = VMM_VIRTIO_PCI_CAP_ID_VNDR,
+		.cap_next = 0,
+		.cap_len = sizeof(struct vmm_virtio_pci_cap),
+		.cfg_type = VMM_VIRTIO_PCI_CAP_DEVICE_CFG,
+		.bar = 0,
+		.offset = VMM_VIRTIO_PCI_MODERN_DEVICE_OFFSET,
+		.length = VMM_VIRTIO_PCI_MODERN_DEVICE_SIZE,
+	},
 };
 
+static bool virtio_pci_node_is_modern(struct vmm_devtree_node *node)
+{
+	u32 version = 1;
+
+	vmm_devtree_read_u32(node, "virtio_version", &version);
+
+	return (version == 2) ? TRUE : FALSE;
+}
+
 static int virtio_pci_notify(struct vmm_virtio_device *dev, u32 vq)
 {
 	struct virtio_pci_dev *m = dev->tra_data;
@@ -67,7 +143,7 @@ int virtio_pci_config_read(struct virtio_pci_dev *m,
 
 	switch (offset) {
 	case VMM_VIRTIO_PCI_HOST_FEATURES:
-		*(u32 *)dst = m->dev.emu->get_host_features(&m->dev);
+		*(u32 *)dst = (u32)vmm_virtio_get_host_features(&m->dev);
 		break;
 	case VMM_VIRTIO_PCI_QUEUE_PFN:
 		*(u32 *)dst = m->dev.emu->get_pfn_vq(&m->dev,
@@ -94,9 +170,248 @@ int virtio_pci_config_read(struct virtio_pci_dev *m,
 	return rc;
 }
 
+static void virtio_pci_modern_clear(struct virtio_pci_dev *m)
+{
+	m->host_features_sel = 0;
+	m->guest_features_sel = 0;
+	m->guest_features[0] = 0;
+	m->guest_features[1] = 0;
+	m->config.queue_sel = 0;
+	m->config.status = 0;
+	memset(m->queues, 0, sizeof(m->queues));
+}
+
+static void virtio_pci_set_addr(u64 *addr, u32 val, bool high)
+{
+	if (high) {
+		*addr = (*addr & 0xFFFFFFFFULL) | ((u64)val << 32);
+	} else {
+		*addr = (*addr & ~0xFFFFFFFFULL) | val;
+	}
+}
+
+static int virtio_pci_common_read(struct virtio_pci_dev *m,
+				  u32 offset, u32 *dst)
+{
+	u64 features;
+	struct virtio_pci_queue *q = &m->queues[m->config.queue_sel];
+
+	switch (offset) {
+	case VMM_VIRTIO_PCI_COMMON_DFSELECT:
+		*dst = m->host_features_sel;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_DF:
+		features = vmm_virtio_get_host_features(&m->dev);
+		if (m->host_features_sel == 0) {
+			*dst = (u32)features;
+		} else if (m->host_features_sel == 1) {
+			*dst = (u32)(features >> 32);
+		} else {
+			*dst = 0;
+		}
+		break;
+	case VMM_VIRTIO_PCI_COMMON_GFSELECT:
+		*dst = m->guest_features_sel;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_GF:
+		*dst = (m->guest_features_sel < 2) ?
+			m->guest_features[m->guest_features_sel] : 0;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_MSIX:
+	case VMM_VIRTIO_PCI_COMMON_Q_MSIX:
+		*dst = VMM_VIRTIO_MSI_NO_VECTOR;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_NUMQ:
+		*dst = VMM_VIRTIO_PCI_QUEUE_MAX;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_STATUS:
+		*dst = m->config.status;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_CFGGENERATION:
+		*dst = 0;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_SELECT:
+		*dst = m->config.queue_sel;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_SIZE:
+		*dst = (q->num) ? q->num :
+			m->dev.emu->get_size_vq(&m->dev, m->config.queue_sel);
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_ENABLE:
+		*dst = q->enable;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_NOFF:
+		*dst = m->config.queue_sel;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_DESCLO:
+		*dst = (u32)q->desc;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_DESCHI:
+		*dst = (u32)(q->desc >> 32);
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_AVAILLO:
+		*dst = (u32)q->avail;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_AVAILHI:
+		*dst = (u32)(q->avail >> 32);
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_USEDLO:
+		*dst = (u32)q->used;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_USEDHI:
+		*dst = (u32)(q->used >> 32);
+		break;
+	default:
+		*dst = 0;
+		break;
+	}
+
+	return VMM_OK;
+}
+
+static int virtio_pci_common_write(struct virtio_pci_dev *m,
+				   u32 offset, u32 val)
+{
+	int rc = VMM_OK;
+	struct virtio_pci_queue *q = &m->queues[m->config.queue_sel];
+
+	switch (offset) {
+	case VMM_VIRTIO_PCI_COMMON_DFSELECT:
+		m->host_features_sel = val;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_GFSELECT:
+		m->guest_features_sel = val;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_GF:
+		if (m->guest_features_sel < 2) {
+			m->guest_features[m->guest_features_sel] = val;
+			vmm_virtio_set_guest_features(&m->dev,
+				((u64)m->guest_features[1] << 32) |
+				m->guest_features[0]);
+		}
+		break;
+	case VMM_VIRTIO_PCI_COMMON_STATUS:
+		val &= 0xFF;
+		if (!val) {
+			m->config.interrupt_state = 0x0;
+			vmm_devemu_emulate_irq(m->guest, m->irq, 0);
+			virtio_pci_modern_clear(m);
+			rc = vmm_virtio_reset(&m->dev);
+			break;
+		}
+		/* Modern devices can't operate without VERSION_1 */
+		if ((val & VMM_VIRTIO_CONFIG_S_FEATURES_OK) &&
+		    !vmm_virtio_has_feature(&m->dev, VMM_VIRTIO_F_VERSION_1)) {
+			val &= ~VMM_VIRTIO_CONFIG_S_FEATURES_OK;
+		}
+		m->config.status = val;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_SELECT:
+		if (val < VMM_VIRTIO_PCI_QUEUE_MAX) {
+			m->config.queue_sel = val;
+		}
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_SIZE:
+		q->num = val;
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_ENABLE:
+		if (!(val & 0x1) || q->enable) {
+			break;
+		}
+		if (!vmm_virtio_init_vq(&m->dev, m->config.queue_sel,
+			(q->num) ? q->num :
+			m->dev.emu->get_size_vq(&m->dev, m->config.queue_sel),
+			q->desc, q->avail, q->used)) {
+			q->enable = 1;
+		}
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_DESCLO:
+	case VMM_VIRTIO_PCI_COMMON_Q_DESCHI:
+		virtio_pci_set_addr(&q->desc, val,
+				offset == VMM_VIRTIO_PCI_COMMON_Q_DESCHI);
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_AVAILLO:
+	case VMM_VIRTIO_PCI_COMMON_Q_AVAILHI:
+		virtio_pci_set_addr(&q->avail, val,
+				offset == VMM_VIRTIO_PCI_COMMON_Q_AVAILHI);
+		break;
+	case VMM_VIRTIO_PCI_COMMON_Q_USEDLO:
+	case VMM_VIRTIO_PCI_COMMON_Q_USEDHI:
+		virtio_pci_set_addr(&q->used, val,
+				offset == VMM_VIRTIO_PCI_COMMON_Q_USEDHI);
+		break;
+	default:
+		/* MSI-X vectors and read-only fields are ignored */
+		break;
+	}
+
+	return rc;
+}
+
+static int virtio_pci_modern_read(struct virtio_pci_dev *m,
+				  u32 offset, u32 *dst)
+{
+	if (offset < (VMM_VIRTIO_PCI_MODERN_COMMON_OFFSET +
+		      VMM_VIRTIO_PCI_MODERN_COMMON_SIZE)) {
+		return virtio_pci_common_read(m,
+			offset - VMM_VIRTIO_PCI_MODERN_COMMON_OFFSET, dst);
+	}
+
+	if (offset == VMM_VIRTIO_PCI_MODERN_ISR_OFFSET) {
+		/* reading from the ISR also clears it. */
+		*dst = m->config.interrupt_state;
+		m->config.interrupt_state = 0;
+		vmm_devemu_emulate_irq(m->guest, m->irq, 0);
+		return VMM_OK;
+	}
+
+	if ((VMM_VIRTIO_PCI_MODERN_DEVICE_OFFSET <= offset) &&
+	    (offset < (VMM_VIRTIO_PCI_MODERN_DEVICE_OFFSET +
+		       VMM_VIRTIO_PCI_MODERN_DEVICE_SIZE))) {
+		return vmm_virtio_config_read(&m->dev,
+			offset - VMM_VIRTIO_PCI_MODERN_DEVICE_OFFSET, dst, 4);
+	}
+
+	*dst = 0;
+
+	return VMM_OK;
+}
+
+static int virtio_pci_modern_write(struct virtio_pci_dev *m,
+				   u32 offset, u32 val)
+{
+	if (offset < (VMM_VIRTIO_PCI_MODERN_COMMON_OFFSET +
+		      VMM_VIRTIO_PCI_MODERN_COMMON_SIZE)) {
+		return virtio_pci_common_write(m,
+			offset - VMM_VIRTIO_PCI_MODERN_COMMON_OFFSET, val);
+	}
+
+	if ((VMM_VIRTIO_PCI_MODERN_NOTIFY_OFFSET <= offset) &&
+	    (offset < (VMM_VIRTIO_PCI_MODERN_NOTIFY_OFFSET +
+		       VMM_VIRTIO_PCI_MODERN_NOTIFY_SIZE))) {
+		vmm_virtio_doorbell(&m->dev,
+			(offset - VMM_VIRTIO_PCI_MODERN_NOTIFY_OFFSET) /
+			VMM_VIRTIO_PCI_MODERN_NOTIFY_MULT);
+		return VMM_OK;
+	}
+
+	if ((VMM_VIRTIO_PCI_MODERN_DEVICE_OFFSET <= offset) &&
+	    (offset < (VMM_VIRTIO_PCI_MODERN_DEVICE_OFFSET +
+		       VMM_VIRTIO_PCI_MODERN_DEVICE_SIZE))) {
+		return vmm_virtio_config_write(&m->dev,
+			offset - VMM_VIRTIO_PCI_MODERN_DEVICE_OFFSET, &val, 4);
+	}
+
+	return VMM_OK;
+}
+
 static int virtio_pci_read(struct virtio_pci_dev *m,
 			   u32 offset, u32 *dst)
 {
+	if (m->dev.modern) {
+		return virtio_pci_modern_read(m, offset, dst);
+	}
+
 	/* Device specific config write */
 	if (offset >= VMM_VIRTIO_PCI_CONFIG) {
 		offset -= VMM_VIRTIO_PCI_CONFIG;
@@ -115,14 +430,16 @@ static int virtio_pci_config_write(struct virtio_pci_dev *m,
 
 	switch (offset) {
 	case VMM_VIRTIO_PCI_GUEST_FEATURES:
-		m->dev.emu->set_guest_features(&m->dev, val);
+		vmm_virtio_set_guest_features(&m->dev, val);
 		break;
 	case VMM_VIRTIO_PCI_QUEUE_PFN:
-		m->dev.emu->init_vq(&m->dev,
-				    m->config.queue_sel,
-				    VMM_VIRTIO_PCI_PAGE_SIZE,
-				    VMM_VIRTIO_PCI_PAGE_SIZE,
-				    val);
+		vmm_virtio_init_vq_legacy(&m->dev,
+				m->config.queue_sel,
+				m->dev.emu->get_size_vq(&m->dev,
+						m->config.queue_sel),
+				VMM_VIRTIO_PCI_PAGE_SIZE,
+				VMM_VIRTIO_PCI_PAGE_SIZE,
+				val);
 		break;
 	case VMM_VIRTIO_PCI_QUEUE_SEL:
 		if (val < VMM_VIRTIO_PCI_QUEUE_MAX)
@@ -130,7 +447,7 @@ static int virtio_pci_config_write(struct virtio_pci_dev *m,
 		break;
 	case VMM_VIRTIO_PCI_QUEUE_NOTIFY:
 		if (val < VMM_VIRTIO_PCI_QUEUE_MAX) {
-			m->dev.emu->notify_vq(&m->dev, val);
+			vmm_virtio_doorbell(&m->dev, val);
 		}
 		break;
 	case VMM_VIRTIO_PCI_STATUS:
@@ -152,6 +469,10 @@ static int virtio_pci_write(struct virtio_pci_dev *m,
 {
 	src = src & ~src_mask;
 
+	if (m->dev.modern) {
+		return virtio_pci_modern_write(m, offset, src);
+	}
+
 	/* Device specific config write */
 	if (offset >= VMM_VIRTIO_PCI_CONFIG) {
 		offset -= VMM_VIRTIO_PCI_CONFIG;
@@ -171,16 +492,62 @@ static int virtio_pci_emulator_reset(struct pci_device *pdev)
 	return VMM_OK;
 }
 
+static u32 virtio_pci_emulator_config_read(struct pci_class *class,
+					   u16 reg_offset)
+{
+	u32 ret = 0, off, len;
+
+	if ((reg_offset < VMM_VIRTIO_PCI_MODERN_CAP_START) ||
+	    ((VMM_VIRTIO_PCI_MODERN_CAP_START + sizeof(virtio_pci_caps)) <=
+							reg_offset)) {
+		return 0;
+	}
+
+	off = reg_offset - VMM_VIRTIO_PCI_MODERN_CAP_START;
+	len = sizeof(virtio_pci_caps) - off;
+	memcpy(&ret, ((const u8 *)&virtio_pci_caps) + off,
+	       (len < sizeof(ret)) ? len : sizeof(ret));
+
+	return ret;
+}
+
+static int virtio_pci_emulator_config_write(struct pci_class *class,
+					    u16 reg_offset, u32 data)
+{
+	/* Capabilities are read-only */
+	return VMM_OK;
+}
+
 static int virtio_pci_emulator_probe(struct pci_device *pdev,
 				     struct vmm_guest *guest,
 				     const struct vmm_devtree_nodeid *eid)
 {
+	int rc;
+	u32 type;
 	struct pci_class *class = (struct pci_class *)pdev;
 
 	/* Virtio device */
 	class->conf_header.vendor_id = 0x1af4;
-	/* Block Device */
-	class->conf_header.device_id = 0x1001;
+
+	if (virtio_pci_node_is_modern(pdev->node)) {
+		rc = vmm_devtree_read_u32(pdev->node, "virtio_type", &type);
+		if (rc) {
+			return rc;
+		}
+
+		/* Modern-only device advertising vendor capabilities */
+		class->conf_header.device_id =
+			VMM_VIRTIO_PCI_MODERN_DEVICE_ID_BASE + type;
+		class->conf_header.revision = 1;
+		class->conf_header.status |= PCI_STATUS_CAP_LIST;
+		class->conf_header.cap_pointer =
+			VMM_VIRTIO_PCI_MODERN_CAP_START;
+		class->config_read = virtio_pci_emulator_config_read;
+		class->config_write = virtio_pci_emulator_config_write;
+	} else {
+		/* Block Device */
+		class->conf_header.device_id = 0x1001;
+	}
 
 	pdev->priv = NULL;
 
@@ -256,6 +623,7 @@ static int virtio_pci_bar_reset(struct vmm_emudev *edev)
 
 	m->config.interrupt_state = 0x0;
 	vmm_devemu_emulate_irq(m->guest, m->irq, 0);
+	virtio_pci_modern_clear(m);
 
 	return vmm_virtio_reset(&m->dev);
 }
@@ -299,6 +667,8 @@ static int virtio_pci_bar_probe(struct vmm_guest *guest,
 		.queue_num  = 256,
 	};
 
+	vdev->dev.modern = virtio_pci_node_is_modern(edev->node);
+
 	rc = vmm_devtree_read_u32(edev->node, "virtio_type",
 				  &vdev->dev.id.type);
 	if (rc) {
@@ -63,6 +63,16 @@ struct netstack_socket {
 	void *priv;
 };
 
+/**
+ * Socket notifier called whenever socket has new events
+ * (incoming data, incoming connection, close, send space, or error)
+ * Note: socket notifier is called from network stack context
+ * with internal lock held so it must not sleep or call any
+ * other netstack API.
+ */
+typedef void (*netstack_socket_notifier_t)(struct netstack_socket *sk,
+					   void *priv);
+
 /** 
  * Generic socket buffer wrapper 
  * Note: sometimes incoming data in fragment to chain of buffer and
@@ -279,6 +289,34 @@ int netstack_socket_nextbuf(struct netstack_socket_buf *buf);
  */
 void netstack_socket_freebuf(struct netstack_socket_buf *buf);
 
+/**
+ *  Set or clear (notify == NULL) notifier of a socket.
+ *  Note: For accepted sockets events which arrived before
+ *  setting notifier are not lost and can be checked using
+ *  netstack_socket_readable().
+ *
+ *  @sk - pointer to socket
+ *  @notify - socket notifier
+ *  @priv - private data for socket notifier
+ *
+ *  returns 
+ *    VMM_OK - success
+ *    VMM_Exxxx - failure
+ */
+int netstack_socket_set_notifier(struct netstack_socket *sk,
+				 netstack_socket_notifier_t notify,
+				 void *priv);
+
+/**
+ *  Check whether netstack_socket_accept() or netstack_socket_recv()
+ *  can be called on a socket without blocking.
+ *
+ *  @sk - pointer to socket
+ *
+ *  returns TRUE if socket has pending receive events else FALSE
+ */
+bool netstack_socket_readable(struct netstack_socket *sk);
+
 /**
  *  Write data to a socket
  *
@@ -292,5 +330,23 @@ void netstack_socket_freebuf(struct netstack_socket_buf *buf);
  */
 int netstack_socket_write(struct netstack_socket *sk, void *data, u16 len);
 
+/**
+ *  Write data to a socket without blocking
+ *  Note: Socket notifier is called when send space is
+ *  available again after a partial write.
+ *
+ *  @sk - pointer to socket
+ *  @data - pointer to data
+ *  @len  - length of data
+ *  @written - number of bytes written (less than len when
+ *  send buffer of socket is full)
+ *
+ *  returns 
+ *    VMM_OK - success
+ *    VMM_Exxxx - failure
+ */
+int netstack_socket_write_partial(struct netstack_socket *sk,
+				  void *data, u16 len, u16 *written);
+
 #endif  /* __VMM_NETSTACK_H_ */
 
@@ -32,6 +32,7 @@
 #define VFS_MAX_PATH		(256)
 #define	VFS_MAX_NAME		(64)
 #define VFS_MAX_FD		(32)
+#define VFS_LOAD_CHUNK_SIZE	(256 * 1024)
 
 /** file type bits */
 #define	S_IFDIR			(1<<0)
@@ -213,6 +214,13 @@ struct vnode {
 					 * (updated by filesystem read/write) 
 					 */
 	void *v_data;			/* private data for fs */
+
+	struct dlist v_pages;		/* cached pages of this vnode
+					 * (used internally by vfs page cache)
+					 */
+	u32 v_npages;			/* number of cached pages
+					 * (used internally by vfs page cache)
+					 */
 };
 
 /** filesystem structure */
@@ -286,6 +294,20 @@ size_t vfs_read(int fd, void *buf, size_t len);
  */
 size_t vfs_write(int fd, void *buf, size_t len);
 
+struct vmm_guest;
+
+/** Load part of a file to guest physical memory or to host physical
+ *  memory (if guest is NULL) and return number of bytes loaded
+ *  Note: Must be called from Orphan (or Thread) context.
+ *  Note: File is read in large chunks by a read-ahead thread so that
+ *  reading next chunk overlaps with writing current chunk to memory.
+ *  Ranges of upto VFS_LOAD_CHUNK_SIZE bytes are read synchronously
+ *  whereas larger ranges are read without using the page cache.
+ *  Note: Current position of file is not changed.
+ */
+size_t vfs_load(int fd, loff_t off, size_t len,
+		struct vmm_guest *guest, physical_addr_t pa);
+
 /** Set current position of a file 
  *  Note: Must be called from Orphan (or Thread) context.
  */
@@ -44,7 +44,11 @@ struct vsdaemon_transport {
 	/* transport name */
 	char name[VMM_FIELD_NAME_SIZE];
 
-	/* operations */
+	/* operations
+	 * Note: main_loop is optional. If not available then no thread
+	 * is created for vsdaemon instance and the transport is expected
+	 * to serve all its instances from its own context.
+	 */
 	int (*setup) (struct vsdaemon *vsd, int argc, char **argv);
 	void (*cleanup) (struct vsdaemon *vsd);
 	int (*main_loop) (struct vsdaemon *vsd);
@@ -64,7 +68,7 @@ struct vsdaemon {
 	/* vserial port */
 	struct vmm_vserial *vser;
 
-	/* underlying thread */
+	/* underlying thread (NULL if transport has no main_loop) */
 	struct vmm_thread *thread;
 
 	/* transport specific data */
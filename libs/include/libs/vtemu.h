@@ -61,6 +61,17 @@ struct vtemu_cell {
 	u32 fc, bc;
 };
 
+struct vtemu_glyph {
+	/* rendered char value */
+	u32 ch;
+
+	/* rendered foreground color and background color */
+	u32 fc, bc;
+};
+
+#define VTEMU_GLYPH_INVALID		0xFFFFFFFF
+#define VTEMU_SCREEN_CELL_NONE		0xFFFFFFFF
+
 #define VTEMU_KEYFLAG_LEFTCTRL		0x00000001
 #define VTEMU_KEYFLAG_RIGHTCTRL		0x00000002
 #define VTEMU_KEYFLAG_LEFTALT		0x00000004
@@ -125,12 +136,23 @@ struct vtemu {
 	u32 cell_len;
 	u8 *cursor_bkp;
 	u32 cursor_bkp_size;
+	bool cursor_on;
+	u32 *screen;
 	u8 esc_cmd[VTEMU_ESCMD_SIZE];
 	u16 esc_attrib[VTEMU_ESC_NPAR];
 	u8 esc_cmd_count;
 	u8 esc_attrib_count;
 	bool esc_cmd_active;
 
+	/* glyph tiles in frame buffer pixel format */
+	u32 glyph_Bpp;
+	u32 glyph_pitch;
+	u32 glyph_tile_sz;
+	u32 glyph_count;
+	struct vtemu_glyph *glyph;
+	u8 *glyph_tiles;
+	u8 *line_buf;
+
 	/* input data */
 	struct fifo *in_fifo;
 	u32 in_key_flags;
@@ -83,6 +83,22 @@ void wboxtest_run_tests(struct vmm_chardev *cdev, u32 iterations,
 /** Run all wboxtests */
 void wboxtest_run_all(struct vmm_chardev *cdev, u32 iterations);
 
+/** Report benchmark latency samples of a wboxtest
+ *  Note: samples are sorted in-place and printed as one line of
+ *  "wboxbench: test=<name> metric=<metric> key=value ..." with
+ *  count, min, avg, p50, p90, p99 and max values.
+ */
+void wboxtest_bench_report(struct vmm_chardev *cdev, struct wboxtest *test,
+			   const char *metric, u64 *samples, u32 count);
+
+/** Report benchmark throughput of a wboxtest
+ *  Note: printed as one line of "wboxbench: test=<name> metric=<metric>
+ *  ops=<ops> nsecs=<nsecs> ops_per_sec=<rate>"
+ */
+void wboxtest_bench_report_rate(struct vmm_chardev *cdev,
+				struct wboxtest *test, const char *metric,
+				u64 ops, u64 nsecs);
+
 /** Register wboxtest */
 int wboxtest_register(const char *group_name, struct wboxtest *test);
 
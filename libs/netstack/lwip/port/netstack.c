@@ -27,6 +27,7 @@
 #include <vmm_timer.h>
 #include <vmm_devtree.h>
 #include <vmm_mutex.h>
+#include <vmm_spinlocks.h>
 #include <vmm_completion.h>
 #include <vmm_modules.h>
 #include <libs/netstack.h>
@@ -72,9 +73,23 @@
 /** ping identifier - must fit on a u16_t */
 #define PING_ID				0xAFAF
 
+/* Notifier state of netconn created by netstack APIs. The slot
+ * index is saved in netconn->socket which is not used otherwise
+ * for such netconns. Like lwIP sockets layer, the netconn->socket
+ * of a not yet accepted netconn counts receive events (-1 = none).
+ */
+struct lwip_socket_slot {
+	struct netstack_socket *sk;
+	netstack_socket_notifier_t notify;
+	void *notify_priv;
+	int rcvevent;
+};
+
 struct lwip_netstack {
 	struct netif nif;
 	struct vmm_netport *port;
+	vmm_spinlock_t slot_lock;
+	struct lwip_socket_slot slot[MEMP_NUM_NETCONN];
 #if !defined(PING_USE_SOCKETS)
 	struct vmm_mutex ping_lock;
 	ip_addr_t ping_addr;
@@ -402,6 +417,88 @@ void netstack_prefetch_arp_mapping(u8 *ipaddr)
 }
 VMM_EXPORT_SYMBOL(netstack_prefetch_arp_mapping);
 
+static void lwip_netconn_event(struct netconn *conn,
+			       enum netconn_evt evt, u16_t len)
+{
+	irq_flags_t flags;
+	struct lwip_socket_slot *slot;
+
+	vmm_spin_lock_irqsave(&lns.slot_lock, flags);
+
+	if (conn->socket < 0) {
+		/* Data can arrive on accepted netconn even before
+		 * we know about it so just count receive events.
+		 */
+		if (evt == NETCONN_EVT_RCVPLUS) {
+			conn->socket--;
+		}
+		vmm_spin_unlock_irqrestore(&lns.slot_lock, flags);
+		return;
+	}
+
+	slot = &lns.slot[conn->socket];
+	switch (evt) {
+	case NETCONN_EVT_RCVPLUS:
+		slot->rcvevent++;
+		break;
+	case NETCONN_EVT_RCVMINUS:
+		slot->rcvevent--;
+		break;
+	default:
+		break;
+	};
+
+	if (slot->notify &&
+	    (evt != NETCONN_EVT_RCVMINUS) &&
+	    (evt != NETCONN_EVT_SENDMINUS)) {
+		slot->notify(slot->sk, slot->notify_priv);
+	}
+
+	vmm_spin_unlock_irqrestore(&lns.slot_lock, flags);
+}
+
+static int lwip_socket_slot_alloc(struct netstack_socket *sk,
+				  struct netconn *conn)
+{
+	int i;
+	irq_flags_t flags;
+	struct lwip_socket_slot *slot;
+
+	vmm_spin_lock_irqsave(&lns.slot_lock, flags);
+
+	for (i = 0; i < array_size(lns.slot); i++) {
+		slot = &lns.slot[i];
+		if (slot->sk) {
+			continue;
+		}
+		slot->sk = sk;
+		slot->notify = NULL;
+		slot->notify_priv = NULL;
+		slot->rcvevent = -1 - conn->socket;
+		conn->socket = i;
+		vmm_spin_unlock_irqrestore(&lns.slot_lock, flags);
+		return VMM_OK;
+	}
+
+	vmm_spin_unlock_irqrestore(&lns.slot_lock, flags);
+
+	return VMM_ENOSPC;
+}
+
+static void lwip_socket_slot_free(struct netconn *conn)
+{
+	irq_flags_t flags;
+
+	vmm_spin_lock_irqsave(&lns.slot_lock, flags);
+
+	if (0 <= conn->socket) {
+		memset(&lns.slot[conn->socket], 0, sizeof(lns.slot[0]));
+		conn->socket = -1;
+	}
+
+	vmm_spin_unlock_irqrestore(&lns.slot_lock, flags);
+}
+
 struct netstack_socket *netstack_socket_alloc(enum netstack_socket_type type)
 {
 	struct netstack_socket *sk;
@@ -414,10 +511,12 @@ struct netstack_socket *netstack_socket_alloc(enum netstack_socket_type type)
 
 	switch (type) {
 	case NETSTACK_SOCKET_TCP:
-		conn = netconn_new(NETCONN_TCP);
+		conn = netconn_new_with_callback(NETCONN_TCP,
+						 lwip_netconn_event);
 		break;
 	case NETSTACK_SOCKET_UDP:
-		conn = netconn_new(NETCONN_UDP);
+		conn = netconn_new_with_callback(NETCONN_UDP,
+						 lwip_netconn_event);
 		break;
 	default:
 		conn = NULL;
@@ -428,6 +527,12 @@ struct netstack_socket *netstack_socket_alloc(enum netstack_socket_type type)
 		return NULL;
 	}
 
+	if (lwip_socket_slot_alloc(sk, conn)) {
+		netconn_delete(conn);
+		vmm_free(sk);
+		return NULL;
+	}
+
 	sk->priv = conn;
 
 	return sk;
@@ -562,6 +667,12 @@ int netstack_socket_accept(struct netstack_socket *sk,
 		return VMM_EFAIL;
 	}
 
+	if (lwip_socket_slot_alloc(tsk, newconn)) {
+		netconn_delete(newconn);
+		vmm_free(tsk);
+		return VMM_ENOSPC;
+	}
+
 	tsk->priv = newconn;
 
 	*new_sk = tsk;
@@ -593,6 +704,7 @@ void netstack_socket_free(struct netstack_socket *sk)
 		return;
 	}
 
+	lwip_socket_slot_free(sk->priv);
 	netconn_delete(sk->priv);
 	vmm_free(sk);	
 }
@@ -669,6 +781,57 @@ void netstack_socket_freebuf(struct netstack_socket_buf *buf)
 }
 VMM_EXPORT_SYMBOL(netstack_socket_freebuf);
 
+int netstack_socket_set_notifier(struct netstack_socket *sk,
+				 netstack_socket_notifier_t notify,
+				 void *priv)
+{
+	int rc = VMM_OK;
+	irq_flags_t flags;
+	struct netconn *conn;
+
+	if (!sk || !sk->priv) {
+		return VMM_EINVALID;
+	}
+	conn = sk->priv;
+
+	vmm_spin_lock_irqsave(&lns.slot_lock, flags);
+
+	if (0 <= conn->socket) {
+		lns.slot[conn->socket].notify = notify;
+		lns.slot[conn->socket].notify_priv = (notify) ? priv : NULL;
+	} else {
+		rc = VMM_EINVALID;
+	}
+
+	vmm_spin_unlock_irqrestore(&lns.slot_lock, flags);
+
+	return rc;
+}
+VMM_EXPORT_SYMBOL(netstack_socket_set_notifier);
+
+bool netstack_socket_readable(struct netstack_socket *sk)
+{
+	bool ret = FALSE;
+	irq_flags_t flags;
+	struct netconn *conn;
+
+	if (!sk || !sk->priv) {
+		return FALSE;
+	}
+	conn = sk->priv;
+
+	vmm_spin_lock_irqsave(&lns.slot_lock, flags);
+
+	if (0 <= conn->socket) {
+		ret = (0 < lns.slot[conn->socket].rcvevent) ? TRUE : FALSE;
+	}
+
+	vmm_spin_unlock_irqrestore(&lns.slot_lock, flags);
+
+	return ret;
+}
+VMM_EXPORT_SYMBOL(netstack_socket_readable);
+
 int netstack_socket_write(struct netstack_socket *sk, void *data, u16 len)
 {
 	err_t err;
@@ -686,6 +849,31 @@ int netstack_socket_write(struct netstack_socket *sk, void *data, u16 len)
 }
 VMM_EXPORT_SYMBOL(netstack_socket_write);
 
+int netstack_socket_write_partial(struct netstack_socket *sk,
+				  void *data, u16 len, u16 *written)
+{
+	err_t err;
+	size_t wr = 0;
+
+	if (!sk || !sk->priv || !data || !written) {
+		return VMM_EINVALID;
+	}
+
+	err = netconn_write_partly(sk->priv, data, len,
+				   NETCONN_COPY | NETCONN_DONTBLOCK, &wr);
+	if ((err == ERR_WOULDBLOCK) || (err == ERR_MEM)) {
+		/* No send space, retry after SENDPLUS event */
+		wr = 0;
+	} else if (err != ERR_OK) {
+		return VMM_EFAIL;
+	}
+
+	*written = wr;
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(netstack_socket_write_partial);
+
 static void lwip_set_link(struct vmm_netport *port)
 {
 	struct lwip_netstack *lns = port->priv;
@@ -833,6 +1021,7 @@ static int __init lwip_netstack_init(void)
 
 	/* Clear lwIP state */
 	memset(&lns, 0, sizeof(lns));
+	INIT_SPIN_LOCK(&lns.slot_lock);
 
 	/* Get netstack device tree node if available */
 	node = vmm_devtree_getnode(VMM_DEVTREE_PATH_SEPARATOR_STRING
@@ -132,6 +132,7 @@ struct ext2_sblock {
 #define EXT3_FEAT_INCOMPAT_RECOVER	0x0004	 
 #define EXT3_FEAT_INCOMPAT_JOURNAL_DEV	0x0008	 
 #define EXT2_FEAT_INCOMPAT_META_BG	0x0010
+#define EXT4_FEAT_INCOMPAT_EXTENTS	0x0040	/* Extent based files */
 
 /* Feature Read-Only Compatibility */
 #define EXT2_FEAT_RO_COMPAT_SPARS_SUPER	0x0001	/* Sparse Superblock */
@@ -232,8 +233,42 @@ struct ext2_inode {
 #define EXT2_INDEX_FL			0x00001000	/* hash indexed directory */
 #define EXT2_IMAGIC_FL			0x00002000	/* AFS directory */
 #define EXT3_JOURNAL_DATA_FL		0x00004000	/* journal file data */
+#define EXT4_EXTENTS_FL			0x00080000	/* inode uses extents */
 #define EXT2_RESERVED_FL		0x80000000	/* reserved for ext2 library */
 
+/* Extent tree magic (stored in each extent tree node header) */
+#define EXT4_EXT_MAGIC			0xF30A
+
+/* Extents longer than this are uninitialized (read as zeros) */
+#define EXT4_EXT_INIT_MAX_LEN		32768
+
+/* The ext4 extent tree node header.
+ * Root node is stored in-place of block map in the inode.
+ */
+struct ext4_extent_header {
+	u16 magic;
+	u16 entries;
+	u16 max;
+	u16 depth;	/* 0 for leaf nodes */
+	u32 generation;
+}__packed;
+
+/* The ext4 extent (leaf node entry). */
+struct ext4_extent {
+	u32 block;	/* First file block covered */
+	u16 len;	/* Number of blocks covered */
+	u16 start_hi;	/* High 16 bits of physical block */
+	u32 start_lo;	/* Low 32 bits of physical block */
+}__packed;
+
+/* The ext4 extent index (internal node entry). */
+struct ext4_extent_idx {
+	u32 block;	/* First file block covered */
+	u32 leaf_lo;	/* Low 32 bits of next level node block */
+	u16 leaf_hi;	/* High 16 bits of next level node block */
+	u16 unused;
+}__packed;
+
 /* The ext2 directory entry. */
 struct ext2_dirent {
 	u32 inode;
@@ -204,6 +204,154 @@ int ext4fs_node_sync(struct ext4fs_node *node)
 	return VMM_OK;
 }
 
+static inline bool ext4fs_node_has_extents(struct ext4fs_node *node)
+{
+	return (__le32(node->inode.flags) & EXT4_EXTENTS_FL) ? TRUE : FALSE;
+}
+
+/* Walk extent tree to find extent (or hole) covering given file block */
+static int ext4fs_node_extent_lookup(struct ext4fs_node *node, u32 blkpos,
+				     struct ext4fs_node_extent *ext)
+{
+	int rc;
+	bool uninit;
+	u32 i, entries, limit, blkno, start, len, next = 0xFFFFFFFF;
+	struct ext4_extent_header *hdr;
+	struct ext4_extent_idx *idx;
+	struct ext4_extent *ex;
+	struct ext4fs_control *ctrl = node->ctrl;
+
+	/* Root of extent tree is in-place of block map */
+	hdr = (struct ext4_extent_header *)&node->inode.b;
+	limit = (sizeof(node->inode.b) - sizeof(*hdr)) /
+						sizeof(struct ext4_extent);
+
+	while (1) {
+		entries = __le16(hdr->entries);
+		if ((__le16(hdr->magic) != EXT4_EXT_MAGIC) ||
+		    (limit < entries)) {
+			return VMM_EINVALID;
+		}
+		if (!__le16(hdr->depth)) {
+			break;
+		}
+
+		/* Find last index starting at or before blkpos */
+		idx = (struct ext4_extent_idx *)(hdr + 1);
+		for (i = 0; i < entries; i++) {
+			if (blkpos < __le32(idx[i].block)) {
+				break;
+			}
+		}
+		if (i < entries) {
+			next = __le32(idx[i].block);
+		}
+		if (!i) {
+			goto hole;
+		}
+		i--;
+		if (__le16(idx[i].leaf_hi)) {
+			return VMM_ENOTSUPP;
+		}
+		blkno = __le32(idx[i].leaf_lo);
+
+		if (!node->extent_block) {
+			node->extent_block = vmm_malloc(ctrl->block_size);
+			if (!node->extent_block) {
+				return VMM_ENOMEM;
+			}
+			node->extent_blkno = 0;
+		}
+		if (node->extent_blkno != blkno) {
+			rc = ext4fs_devread(ctrl, blkno, 0, ctrl->block_size,
+					    (char *)node->extent_block);
+			if (rc) {
+				node->extent_blkno = 0;
+				return rc;
+			}
+			node->extent_blkno = blkno;
+		}
+
+		hdr = (struct ext4_extent_header *)node->extent_block;
+		limit = (ctrl->block_size - sizeof(*hdr)) /
+						sizeof(struct ext4_extent);
+	}
+
+	/* Find last extent starting at or before blkpos */
+	ex = (struct ext4_extent *)(hdr + 1);
+	for (i = 0; i < entries; i++) {
+		if (blkpos < __le32(ex[i].block)) {
+			break;
+		}
+	}
+	if (i < entries) {
+		next = __le32(ex[i].block);
+	}
+	if (i) {
+		i--;
+		start = __le32(ex[i].block);
+		len = __le16(ex[i].len);
+		uninit = FALSE;
+		if (EXT4_EXT_INIT_MAX_LEN < len) {
+			len -= EXT4_EXT_INIT_MAX_LEN;
+			uninit = TRUE;
+		}
+		if ((blkpos - start) < len) {
+			if (__le16(ex[i].start_hi)) {
+				return VMM_ENOTSUPP;
+			}
+			ext->blkpos = start;
+			ext->blkno = (uninit) ? 0 : __le32(ex[i].start_lo);
+			ext->blkcnt = len;
+			return VMM_OK;
+		}
+	}
+
+hole:
+	ext->blkpos = blkpos;
+	ext->blkno = 0;
+	ext->blkcnt = next - blkpos;
+
+	return VMM_OK;
+}
+
+static int ext4fs_node_extent_map(struct ext4fs_node *node, u32 blkpos,
+				  u32 *blkno, u32 *blkcnt)
+{
+	int rc;
+	u32 i, off;
+	struct ext4fs_node_extent *ext = NULL;
+
+	for (i = 0; i < EXT4_NODE_EXTENT_CACHE_SIZE; i++) {
+		ext = &node->extent_cache[i];
+		if (ext->blkcnt && (ext->blkpos <= blkpos) &&
+		    ((blkpos - ext->blkpos) < ext->blkcnt)) {
+			break;
+		}
+	}
+
+	if (i == EXT4_NODE_EXTENT_CACHE_SIZE) {
+		ext = &node->extent_cache[node->extent_victim];
+		rc = ext4fs_node_extent_lookup(node, blkpos, ext);
+		if (rc) {
+			ext->blkcnt = 0;
+			return rc;
+		}
+		node->extent_victim++;
+		if (node->extent_victim == EXT4_NODE_EXTENT_CACHE_SIZE) {
+			node->extent_victim = 0;
+		}
+	}
+
+	off = blkpos - ext->blkpos;
+	*blkno = (ext->blkno) ? ext->blkno + off : 0;
+	if (blkcnt) {
+		*blkcnt = ext->blkcnt - off;
+	}
+
+	return VMM_OK;
+}
+
 int ext4fs_node_read_blkno(struct ext4fs_node *node, u32 blkpos, u32 *blkno)
 {
 	int rc;
@@ -211,6 +359,10 @@ int ext4fs_node_read_blkno(struct ext4fs_node *node, u32 blkpos, u32 *blkno)
 	struct ext2_inode *inode = &node->inode;
 	struct ext4fs_control *ctrl = node->ctrl;
 
+	if (ext4fs_node_has_extents(node)) {
+		return ext4fs_node_extent_map(node, blkpos, blkno, NULL);
+	}
+
 	if (blkpos < ctrl->dir_blklast) {
 		/* Direct blocks.  */
 		*blkno = __le32(inode->b.blocks.dir_blocks[blkpos]);
@@ -292,6 +444,11 @@ int ext4fs_node_write_blkno(struct ext4fs_node *node, u32 blkpos, u32 blkno)
 	struct ext2_inode *inode = &node->inode;
 	struct ext4fs_control *ctrl = node->ctrl;
 
+	/* Updating extent tree is not supported */
+	if (ext4fs_node_has_extents(node)) {
+		return VMM_ENOTSUPP;
+	}
+
 	if (blkpos < ctrl->dir_blklast) {
 		/* Direct blocks.  */
 		inode->b.blocks.dir_blocks[blkpos] = __le32(blkno);
@@ -382,14 +539,46 @@ int ext4fs_node_write_blkno(struct ext4fs_node *node, u32 blkpos, u32 blkno)
 	return VMM_OK;
 }
 
+int ext4fs_node_read_blkrun(struct ext4fs_node *node, u32 blkpos,
+			    u32 maxcnt, u32 *blkno, u32 *blkcnt)
+{
+	int rc;
+	u32 cnt, next;
+
+	if (ext4fs_node_has_extents(node)) {
+		rc = ext4fs_node_extent_map(node, blkpos, blkno, &cnt);
+		if (rc) {
+			return rc;
+		}
+		*blkcnt = (cnt < maxcnt) ? cnt : maxcnt;
+		return VMM_OK;
+	}
+
+	rc = ext4fs_node_read_blkno(node, blkpos, blkno);
+	if (rc) {
+		return rc;
+	}
+
+	/* Probe block map for physically contiguous blocks */
+	for (cnt = 1; cnt < maxcnt; cnt++) {
+		if (ext4fs_node_read_blkno(node, blkpos + cnt, &next)) {
+			break;
+		}
+		if ((*blkno) ? (next != (*blkno + cnt)) : (next != 0)) {
+			break;
+		}
+	}
+	*blkcnt = cnt;
+
+	return VMM_OK;
+}
+
 /* Note: Node position has to be 64-bit */
 u32 ext4fs_node_read(struct ext4fs_node *node, u64 pos, u32 len, char *buf)
 {
 	int rc;
 	u64 filesize = ext4fs_node_get_size(node);
-	u32 i, rlen, blkno, blkoff, blklen;
-	u32 last_blkpos, last_blklen;
-	u32 first_blkpos, first_blkoff, first_blklen;
+	u32 rlen, blkpos, blkoff, blklen, blkno, blkcnt;
 	struct ext4fs_control *ctrl = node->ctrl;
 
 	if (filesize <= pos) {
@@ -400,48 +589,60 @@ u32 ext4fs_node_read(struct ext4fs_node *node, u64 pos, u32 len, char *buf)
 	}
 
 	/* Note: div result < 32-bit */
-	first_blkpos = udiv64(pos, ctrl->block_size); 
-	first_blkoff = pos - (first_blkpos * ctrl->block_size);
-	first_blklen = ctrl->block_size - first_blkoff;
-	if (len < first_blklen) {
-		first_blklen = len;
-	}
-
-	/* Note: div result < 32-bit */
-	last_blkpos = udiv64((len + pos), ctrl->block_size); 
-	last_blklen = (len + pos) - (last_blkpos * ctrl->block_size);
+	blkpos = udiv64(pos, ctrl->block_size); 
+	blkoff = pos - ((u64)blkpos * ctrl->block_size);
 
 	rlen = len;
-	i = first_blkpos;
 	while (rlen) {
-		rc = ext4fs_node_read_blkno(node, i, &blkno);
+		blklen = ctrl->block_size - blkoff;
+		if (rlen < blklen) {
+			blklen = rlen;
+		}
+
+		/* Whole blocks are read directly into caller buffer
+		 * using one device read per physically contiguous run
+		 */
+		blkcnt = (blkoff || (blklen < ctrl->block_size)) ? 1 :
+			 rlen >> (ctrl->log2_block_size + EXT2_SECTOR_BITS);
+		rc = ext4fs_node_read_blkrun(node, blkpos, blkcnt,
+					     &blkno, &blkcnt);
 		if (rc) {
 			goto done;
 		}
 
-		if (i == first_blkpos) {
-			/* First block.  */
-			blkoff = first_blkoff;
-			blklen = first_blklen;
-		} else if (i == last_blkpos) {
-			/* Last block.  */
-			blkoff = 0;
-			blklen = last_blklen;
+		if (blkoff || (blklen < ctrl->block_size) || !blkno) {
+			/* Partial block or hole via cached block */
+			rc = ext4fs_node_read_blk(node, blkno,
+						  blkoff, blklen, buf);
+			if (rc) {
+				goto done;
+			}
+			blkcnt = 1;
 		} else {
-			/* Middle block. */
-			blkoff = 0;
-			blklen = ctrl->block_size;
-		}
+			/* Write back cached block if it is part of run */
+			if (node->cached_dirty &&
+			    (blkno <= node->cached_blkno) &&
+			    (node->cached_blkno < (blkno + blkcnt))) {
+				rc = ext4fs_devwrite(ctrl, node->cached_blkno,
+						0, ctrl->block_size,
+						(char *)node->cached_block);
+				if (rc) {
+					goto done;
+				}
+				node->cached_dirty = FALSE;
+			}
 
-		/* Read cached block */
-		rc = ext4fs_node_read_blk(node, blkno, blkoff, blklen, buf);
-		if (rc) {
-			goto done;
+			blklen = blkcnt * ctrl->block_size;
+			rc = ext4fs_devread(ctrl, blkno, 0, blklen, buf);
+			if (rc) {
+				goto done;
+			}
 		}
 
 		buf += blklen;
 		rlen -= blklen;
-		i++;
+		blkpos += blkcnt;
+		blkoff = 0;
 	}
 
 done:
@@ -506,6 +707,11 @@ u32 ext4fs_node_write(struct ext4fs_node *node, u64 pos, u32 len, char *buf)
 		}
 
 		if (!blkno) {
+			/* Allocating blocks in extent tree not supported */
+			if (ext4fs_node_has_extents(node)) {
+				goto done;
+			}
+
 			rc = ext4fs_control_alloc_block(ctrl, 
 						node->inode_no, &blkno);
 			if (rc) {
@@ -569,6 +775,11 @@ int ext4fs_node_truncate(struct ext4fs_node *node, u64 pos)
 		return VMM_OK;
 	}
 
+	/* Freeing blocks of extent tree not supported */
+	if (ext4fs_node_has_extents(node)) {
+		return VMM_ENOTSUPP;
+	}
+
 	/* Note: div result < 32-bit */
 	first_blkpos = udiv64(pos, ctrl->block_size); 
 	first_blkoff = pos - (first_blkpos * ctrl->block_size);
@@ -651,6 +862,11 @@ int ext4fs_node_load(struct ext4fs_control *ctrl,
 	node->dindir2_blkno = 0;
 	node->dindir2_dirty = FALSE;
 
+	node->extent_block = NULL;
+	node->extent_blkno = 0;
+	node->extent_victim = 0;
+	memset(node->extent_cache, 0, sizeof(node->extent_cache));
+
 	return VMM_OK;
 }
 
@@ -677,6 +893,11 @@ int ext4fs_node_init(struct ext4fs_node *node)
 	node->dindir2_blkno = 0;
 	node->dindir2_dirty = FALSE;
 
+	node->extent_block = NULL;
+	node->extent_blkno = 0;
+	node->extent_victim = 0;
+	memset(node->extent_cache, 0, sizeof(node->extent_cache));
+
 	node->lookup_victim = 0;
 	for (idx = 0; idx < EXT4_NODE_LOOKUP_SIZE; idx++) {
 		node->lookup_name[idx][0] = '\0';
@@ -703,6 +924,10 @@ int ext4fs_node_exit(struct ext4fs_node *node)
 		vmm_free(node->dindir2_block);
 	}
 
+	if (node->extent_block) {
+		vmm_free(node->extent_block);
+	}
+
 	return VMM_OK;
 }
 
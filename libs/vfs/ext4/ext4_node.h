@@ -28,6 +28,16 @@
 #include "ext4_common.h"
 
 #define EXT4_NODE_LOOKUP_SIZE		4
+#define EXT4_NODE_EXTENT_CACHE_SIZE	8
+
+/* Cached mapping of file blocks to contiguous disk blocks
+ * (disk block zero means hole or uninitialized blocks)
+ */
+struct ext4fs_node_extent {
+	u32 blkpos;
+	u32 blkno;
+	u32 blkcnt;
+};
 
 /* Information for accessing a ext4fs file/directory. */
 struct ext4fs_node {
@@ -67,6 +77,16 @@ struct ext4fs_node {
 	u32 dindir2_blkno;
 	bool dindir2_dirty;
 
+	/* Extent tree node block
+	 * Allocated on demand. Must be freed in vput()
+	 */
+	u8 *extent_block;
+	u32 extent_blkno;
+
+	/* Recently used extents */
+	u32 extent_victim;
+	struct ext4fs_node_extent extent_cache[EXT4_NODE_EXTENT_CACHE_SIZE];
+
 	/* Child directory entry lookup table */
 	u32 lookup_victim;
 	char lookup_name[EXT4_NODE_LOOKUP_SIZE][VFS_MAX_NAME];
@@ -89,6 +109,9 @@ int ext4fs_node_read_blkno(struct ext4fs_node *node, u32 blkpos, u32 *blkno);
 
 int ext4fs_node_write_blkno(struct ext4fs_node *node, u32 blkpos, u32 blkno);
 
+int ext4fs_node_read_blkrun(struct ext4fs_node *node, u32 blkpos,
+			    u32 maxcnt, u32 *blkno, u32 *blkcnt);
+
 u32 ext4fs_node_read(struct ext4fs_node *node, u64 pos, u32 len, char *buf);
 
 u32 ext4fs_node_write(struct ext4fs_node *node, u64 pos, u32 len, char *buf);
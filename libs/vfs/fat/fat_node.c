@@ -112,6 +112,165 @@ static void fatfs_node_del_lookup_dirent(struct fatfs_node *dnode,
 	}
 }
 
+static void fatfs_node_runs_invalidate(struct fatfs_node *node)
+{
+	node->runs_count = 0;
+	node->runs_clusters = 0;
+	node->runs_hint = 0;
+	node->runs_complete = FALSE;
+}
+
+static int fatfs_node_runs_add(struct fatfs_node *node, u32 clust)
+{
+	u32 max;
+	struct fatfs_node_run *run, *runs;
+
+	if (node->runs_count) {
+		run = &node->runs[node->runs_count - 1];
+		if ((run->clust + run->count) == clust) {
+			run->count++;
+			node->runs_clusters++;
+			return VMM_OK;
+		}
+	}
+
+	if (node->runs_count == node->runs_max) {
+		max = (node->runs_max) ? 2 * node->runs_max : FAT_NODE_RUNS_MIN;
+		runs = vmm_malloc(max * sizeof(*runs));
+		if (!runs) {
+			return VMM_ENOMEM;
+		}
+		if (node->runs) {
+			memcpy(runs, node->runs,
+			       node->runs_count * sizeof(*runs));
+			vmm_free(node->runs);
+		}
+		node->runs = runs;
+		node->runs_max = max;
+	}
+
+	run = &node->runs[node->runs_count];
+	run->pos = node->runs_clusters;
+	run->clust = clust;
+	run->count = 1;
+	node->runs_count++;
+	node->runs_clusters++;
+
+	return VMM_OK;
+}
+
+/* Walk cluster chain till cluster run map covers cluster index cl_pos */
+static int fatfs_node_runs_extend(struct fatfs_node *node, u32 cl_pos)
+{
+	int rc;
+	u32 clust;
+	struct fatfs_node_run *run;
+	struct fatfs_control *ctrl = node->ctrl;
+
+	while (node->runs_clusters <= cl_pos) {
+		if (node->runs_complete) {
+			return VMM_EINVALID;
+		}
+
+		if (!node->runs_count) {
+			clust = node->first_cluster;
+			if (!fatfs_control_valid_cluster(ctrl, clust)) {
+				node->runs_complete = TRUE;
+				return VMM_EINVALID;
+			}
+		} else {
+			run = &node->runs[node->runs_count - 1];
+			rc = fatfs_control_nth_cluster(ctrl,
+					run->clust + run->count - 1, 1, &clust);
+			if (rc) {
+				if (!fatfs_control_valid_cluster(ctrl, clust)) {
+					node->runs_complete = TRUE;
+				}
+				return rc;
+			}
+		}
+
+		rc = fatfs_node_runs_add(node, clust);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	return VMM_OK;
+}
+
+/* Map cluster index cl_pos to cluster number and number of
+ * contiguous clusters starting from it.
+ */
+static int fatfs_node_map_cluster(struct fatfs_node *node, u32 cl_pos,
+				  u32 *clust, u32 *contig)
+{
+	int rc;
+	u32 i, lo, hi;
+	struct fatfs_node_run *run;
+
+	rc = fatfs_node_runs_extend(node, cl_pos);
+	if (rc) {
+		return rc;
+	}
+
+	/* Sequential access mostly hits the last used run or next one */
+	i = (node->runs_hint < node->runs_count) ? node->runs_hint : 0;
+	run = &node->runs[i];
+	if ((run->pos + run->count) <= cl_pos &&
+	    (i + 1) < node->runs_count &&
+	    cl_pos < (run[1].pos + run[1].count)) {
+		i++;
+	} else if ((cl_pos < run->pos) ||
+		   ((run->pos + run->count) <= cl_pos)) {
+		lo = 0;
+		hi = node->runs_count - 1;
+		while (lo < hi) {
+			i = lo + ((hi - lo + 1) >> 1);
+			if (node->runs[i].pos <= cl_pos) {
+				lo = i;
+			} else {
+				hi = i - 1;
+			}
+		}
+		i = lo;
+	}
+	node->runs_hint = i;
+	run = &node->runs[i];
+
+	*clust = run->clust + (cl_pos - run->pos);
+	if (contig) {
+		*contig = run->count - (cl_pos - run->pos);
+	}
+
+	return VMM_OK;
+}
+
+/* Find cluster index and cluster number of last cluster in chain */
+static int fatfs_node_last_cluster(struct fatfs_node *node,
+				   u32 *cl_pos, u32 *clust)
+{
+	int rc;
+	struct fatfs_node_run *run;
+
+	while (!node->runs_complete) {
+		rc = fatfs_node_runs_extend(node, node->runs_clusters);
+		if (rc && !node->runs_complete) {
+			return rc;
+		}
+	}
+
+	if (!node->runs_count) {
+		return VMM_ENOENT;
+	}
+
+	run = &node->runs[node->runs_count - 1];
+	*cl_pos = run->pos + run->count - 1;
+	*clust = run->clust + run->count - 1;
+
+	return VMM_OK;
+}
+
 static int fatfs_node_sync_cached_cluster(struct fatfs_node *node)
 {
 	u64 wlen, woff;
@@ -176,9 +335,8 @@ u32 fatfs_node_get_size(struct fatfs_node *node)
 
 u32 fatfs_node_read(struct fatfs_node *node, u32 pos, u32 len, u8 *buf)
 {
-	int rc;
 	u64 rlen, roff;
-	u32 r, cl_pos, cl_off, cl_num, cl_len;
+	u32 r, cl_pos, cl_off, cl_num, cl_len, cl_cnt;
 	struct fatfs_control *ctrl = node->ctrl;
 
 	if (!node->parent && ctrl->type != FAT_TYPE_32) {
@@ -206,34 +364,45 @@ u32 fatfs_node_read(struct fatfs_node *node, u32 pos, u32 len, u8 *buf)
 
 	r = 0;
 	while (r < len) {
-		/* Get the next cluster */
-		if (r == 0) {
-			cl_pos = udiv32(pos, ctrl->bytes_per_cluster); 
-			cl_off = pos - cl_pos * ctrl->bytes_per_cluster;
-			rc = fatfs_control_nth_cluster(ctrl, 
-							node->first_cluster,
-							cl_pos, &cl_num);
-			if (rc) {
-				return 0;
+		/* Get the next cluster and size of its contiguous run */
+		cl_pos = udiv32(pos + r, ctrl->bytes_per_cluster);
+		cl_off = (pos + r) - cl_pos * ctrl->bytes_per_cluster;
+		if (fatfs_node_map_cluster(node, cl_pos, &cl_num, &cl_cnt)) {
+			return r;
+		}
+
+		/* Read whole clusters of contiguous run directly */
+		if (!cl_off && (ctrl->bytes_per_cluster <= (len - r))) {
+			cl_len = udiv32(len - r, ctrl->bytes_per_cluster);
+			cl_cnt = (cl_len < cl_cnt) ? cl_len : cl_cnt;
+			cl_len = cl_cnt * ctrl->bytes_per_cluster;
+
+			if ((cl_num <= node->cached_clust) &&
+			    (node->cached_clust < (cl_num + cl_cnt)) &&
+			    fatfs_node_sync_cached_cluster(node)) {
+				return r;
 			}
-			cl_len = ctrl->bytes_per_cluster - cl_off;
-			cl_len = (cl_len < len) ? cl_len : len;
-		} else {
-			cl_pos++;
-			cl_off = 0;
-			rc = fatfs_control_nth_cluster(ctrl, 
-							cl_num, 1, &cl_num);
-			if (rc) {
+
+			roff = (u64)ctrl->first_data_sector *
+						ctrl->bytes_per_sector;
+			roff += (u64)(cl_num - 2) * ctrl->bytes_per_cluster;
+			rlen = vmm_blockdev_read(ctrl->bdev, buf, roff, cl_len);
+			if (rlen != cl_len) {
 				return r;
 			}
-			cl_len = (ctrl->bytes_per_cluster < (len - r)) ? 
-					ctrl->bytes_per_cluster : (len - r);
+
+			r += cl_len;
+			buf += cl_len;
+			continue;
 		}
 
+		cl_len = ctrl->bytes_per_cluster - cl_off;
+		cl_len = (cl_len < (len - r)) ? cl_len : (len - r);
+
 		/* Make sure cached cluster is updated */
 		if (node->cached_clust != cl_num) {
 			if (fatfs_node_sync_cached_cluster(node)) {
-				return 0;
+				return r;
 			}
 
 			node->cached_clust = cl_num;
@@ -245,6 +414,7 @@ u32 fatfs_node_read(struct fatfs_node *node, u32 pos, u32 len, u8 *buf)
 						node->cached_data, 
 						roff, ctrl->bytes_per_cluster);
 			if (rlen != ctrl->bytes_per_cluster) {
+				node->cached_clust = 0;
 				return r;
 			}
 		}
@@ -309,6 +479,7 @@ u32 fatfs_node_write(struct fatfs_node *node, u32 pos, u32 len, u8 *buf)
 			return 0;
 		}
 		node->first_cluster = cl_num;
+		fatfs_node_runs_invalidate(node);
 
 		/* Update the first cluster */
 		node->parent_dent.first_cluster_hi = 
@@ -318,21 +489,17 @@ u32 fatfs_node_write(struct fatfs_node *node, u32 pos, u32 len, u8 *buf)
 	}
 
 	/* Make room for new data by appending free clusters */
-	cl_num = node->first_cluster;
-	for (w = 0; w <= (wendcl - wstartcl); w++) {
-		if (w == 0) {
-			rc = fatfs_control_nth_cluster(ctrl, cl_num,
-							wstartcl, &cl_num);
-			if (!rc) {
-				continue;
-			}
-		} else {
-			rc = fatfs_control_nth_cluster(ctrl, cl_num, 1, &cl_num);
-			if (!rc) {
-				continue;
-			}
+	if (fatfs_node_map_cluster(node, wendcl, &cl_num, NULL)) {
+		rc = fatfs_node_last_cluster(node, &w, &cl_num);
+		if (rc) {
+			return 0;
 		}
-
+		/* Appended clusters are mapped on next lookup */
+		node->runs_complete = FALSE;
+	} else {
+		w = wendcl;
+	}
+	for (; w < wendcl; w++) {
 		/* Add new cluster */
 		rc = fatfs_control_append_free_cluster(ctrl, cl_num, &cl_num);
 		if (rc) {
@@ -352,8 +519,7 @@ u32 fatfs_node_write(struct fatfs_node *node, u32 pos, u32 len, u8 *buf)
 
 	/* Write data to required location */
 	w = 0;
-	rc = fatfs_control_nth_cluster(ctrl, node->first_cluster, 
-					wstartcl, &cl_num);
+	rc = fatfs_node_map_cluster(node, wstartcl, &cl_num, NULL);
 	if (rc) {
 		goto done;
 	}
@@ -418,6 +584,9 @@ int fatfs_node_truncate(struct fatfs_node *node, u32 pos)
 		return VMM_OK;
 	}
 
+	/* Cluster chain is changing so forget cluster runs */
+	fatfs_node_runs_invalidate(node);
+
 	/* Determine last cluster after truncation */
 	cl_pos = udiv32(pos, ctrl->bytes_per_cluster);
 	cl_off = pos - cl_pos * ctrl->bytes_per_cluster;
@@ -504,6 +673,10 @@ int fatfs_node_init(struct fatfs_control *ctrl, struct fatfs_node *node)
 	node->parent_dent_dirty = FALSE;
 	node->first_cluster = 0;
 
+	node->runs = NULL;
+	node->runs_max = 0;
+	fatfs_node_runs_invalidate(node);
+
 	node->cached_clust = 0;
 	node->cached_data = NULL;
 	node->cached_dirty = FALSE;
@@ -520,6 +693,13 @@ int fatfs_node_init(struct fatfs_control *ctrl, struct fatfs_node *node)
 
 int fatfs_node_exit(struct fatfs_node *node)
 {
+	if (node->runs) {
+		vmm_free(node->runs);
+		node->runs = NULL;
+		node->runs_max = 0;
+		fatfs_node_runs_invalidate(node);
+	}
+
 	if (node->cached_data) {
 		vmm_free(node->cached_data);
 		node->cached_clust = 0;
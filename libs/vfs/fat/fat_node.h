@@ -28,6 +28,17 @@
 #include "fat_common.h"
 
 #define FAT_NODE_LOOKUP_SIZE		4
+#define FAT_NODE_RUNS_MIN		8
+
+/* Run of contiguous clusters in cluster chain of a FAT node */
+struct fatfs_node_run {
+	/* Index of first cluster of run within the file */
+	u32 pos;
+	/* First cluster number of run */
+	u32 clust;
+	/* Number of clusters in run */
+	u32 count;
+};
 
 /* Information for accessing a FAT file/directory. */
 struct fatfs_node {
@@ -44,6 +55,14 @@ struct fatfs_node {
 	/* First cluster */
 	u32 first_cluster;
 
+	/* Cluster run map (built lazily from cluster chain) */
+	struct fatfs_node_run *runs;
+	u32 runs_count;
+	u32 runs_max;
+	u32 runs_clusters;
+	u32 runs_hint;
+	bool runs_complete;
+
 	/* Cached clusters */
 	u8 *cached_data;
 	u32 cached_clust;
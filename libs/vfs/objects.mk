@@ -22,4 +22,4 @@
 # */
 
 libs-objs-$(CONFIG_VFS)+= vfs/vfs.o
-
+libs-objs-$(CONFIG_VFS_GUEST_FILE)+= vfs/vfs_guest_file.o
@@ -26,6 +26,10 @@
 #include <vmm_stdio.h>
 #include <vmm_scheduler.h>
 #include <vmm_modules.h>
+#include <vmm_threads.h>
+#include <vmm_completion.h>
+#include <vmm_host_aspace.h>
+#include <vmm_guest_aspace.h>
 #include <arch_atomic.h>
 #include <libs/stringlib.h>
 #include <libs/bitmap.h>
@@ -38,17 +42,56 @@
 #define	MODULE_INIT			vfs_init
 #define	MODULE_EXIT			vfs_exit
 
+/** read-ahead state of sequential reader */
+struct vfs_readahead {
+	u64 next;			/* expected next page index */
+	u32 pages;			/* current read-ahead window */
+};
+
 /** file descriptor structure */
 struct file {
 	struct vmm_mutex f_lock;	/* file lock */
 	u32 f_flags;			/* open flag */
 	loff_t f_offset;		/* current position in file */
 	struct vnode *f_vnode;		/* vnode */
+	struct vfs_readahead f_ra;	/* read-ahead state */
 };
 
 /* size of vnode hash table, must power 2 */
 #define VFS_VNODE_HASH_SIZE		(32)
 
+#ifdef CONFIG_VFS_PCACHE
+/* page cache page size and size of page hash table (must power 2) */
+#define VFS_PCACHE_PAGE_SHIFT		(12)
+#define VFS_PCACHE_PAGE_SIZE		(1 << VFS_PCACHE_PAGE_SHIFT)
+#define VFS_PCACHE_PAGE_MASK		(VFS_PCACHE_PAGE_SIZE - 1)
+#define VFS_PCACHE_HASH_SIZE		(256)
+
+/* read-ahead window limits (in pages) */
+#define VFS_PCACHE_RA_MIN		(4)
+#define VFS_PCACHE_RA_MAX		\
+		(VFS_LOAD_CHUNK_SIZE >> VFS_PCACHE_PAGE_SHIFT)
+
+/** page cache page
+ *
+ * A page is shared by all readers of the vnode. It holds one reference
+ * for being in the cache (hash) and one reference for every reader
+ * copying data out of it. Pages are only filled with the vnode lock
+ * held and never modified afterwards; writes invalidate them instead.
+ */
+struct vfs_page {
+	struct dlist hash_head;
+	struct dlist lru_head;
+	struct dlist vnode_head;
+	struct vnode *v;
+	u64 index;
+	u32 len;			/* valid bytes (< page size at EOF) */
+	u32 ref;
+	bool vput;			/* drop vnode reference on free */
+	u8 data[VFS_PCACHE_PAGE_SIZE];
+};
+#endif
+
 struct vfs_ctrl {
 	struct vmm_mutex fs_list_lock;
 	struct dlist fs_list;
@@ -60,6 +103,13 @@ struct vfs_ctrl {
 	unsigned long *fd_bmap;
 	struct file fd[VFS_MAX_FD];
 	struct vmm_notifier_block bdev_client;
+#ifdef CONFIG_VFS_PCACHE
+	struct vmm_mutex pcache_lock;
+	struct dlist pcache_hash[VFS_PCACHE_HASH_SIZE];
+	struct dlist pcache_lru;
+	u32 pcache_pages;
+	u32 pcache_max_pages;
+#endif
 };
 
 static struct vfs_ctrl vfsc;
@@ -198,6 +248,7 @@ static struct vnode *vfs_vnode_vget(struct mount *m, const char *path)
 
 	INIT_LIST_HEAD(&v->v_link);
 	INIT_MUTEX(&v->v_lock);
+	INIT_LIST_HEAD(&v->v_pages);
 	v->v_mount = m;
 	arch_atomic_write(&v->v_refcnt, 1);
 	if (strlcpy(v->v_path, path, sizeof(v->v_path)) >=
@@ -282,6 +333,404 @@ static void vfs_vnode_vput(struct vnode *v)
 	vmm_free(v);
 }
 
+#ifdef CONFIG_VFS_PCACHE
+
+static inline u32 vfs_pcache_hash(struct vnode *v, u64 index)
+{
+	u32 val = (u32)((unsigned long)v >> 4) ^ (u32)index ^ (u32)(index >> 32);
+
+	return (val ^ (val >> 8)) & (VFS_PCACHE_HASH_SIZE - 1);
+}
+
+/* Must be called with page cache lock held */
+static struct vfs_page *__vfs_pcache_find(struct vnode *v, u64 index)
+{
+	struct vfs_page *p;
+
+	list_for_each_entry(p, &vfsc.pcache_hash[vfs_pcache_hash(v, index)],
+			    hash_head) {
+		if ((p->v == v) && (p->index == index)) {
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+/* Remove page from cache and move it to given list if it is not
+ * used by any reader. Must be called with page cache lock held.
+ */
+static void __vfs_pcache_detach(struct vfs_page *p, struct dlist *free_list)
+{
+	list_del(&p->hash_head);
+	list_del(&p->lru_head);
+	list_del(&p->vnode_head);
+	vfsc.pcache_pages--;
+	p->v->v_npages--;
+	p->vput = (p->v->v_npages == 0) ? TRUE : FALSE;
+
+	p->ref--;
+	if (!p->ref) {
+		list_add_tail(&p->lru_head, free_list);
+	}
+}
+
+/* Free pages detached from cache. Must be called without page cache
+ * lock and without any vnode lock held.
+ */
+static void vfs_pcache_free(struct dlist *free_list)
+{
+	struct vfs_page *p;
+
+	while (!list_empty(free_list)) {
+		p = list_first_entry(free_list, struct vfs_page, lru_head);
+		list_del(&p->lru_head);
+		if (p->vput) {
+			vfs_vnode_vput(p->v);
+		}
+		vmm_free(p);
+	}
+}
+
+static bool vfs_pcache_present(struct vnode *v, u64 index)
+{
+	bool ret;
+
+	vmm_mutex_lock(&vfsc.pcache_lock);
+	ret = (__vfs_pcache_find(v, index)) ? TRUE : FALSE;
+	vmm_mutex_unlock(&vfsc.pcache_lock);
+
+	return ret;
+}
+
+static struct vfs_page *vfs_pcache_get(struct vnode *v, u64 index)
+{
+	struct vfs_page *p;
+
+	vmm_mutex_lock(&vfsc.pcache_lock);
+	p = __vfs_pcache_find(v, index);
+	if (p) {
+		p->ref++;
+		list_del(&p->lru_head);
+		list_add_tail(&p->lru_head, &vfsc.pcache_lru);
+	}
+	vmm_mutex_unlock(&vfsc.pcache_lock);
+
+	return p;
+}
+
+static void vfs_pcache_put(struct vfs_page *p)
+{
+	LIST_HEAD(free_list);
+
+	vmm_mutex_lock(&vfsc.pcache_lock);
+	p->ref--;
+	if (!p->ref) {
+		list_add_tail(&p->lru_head, &free_list);
+	}
+	vmm_mutex_unlock(&vfsc.pcache_lock);
+
+	vfs_pcache_free(&free_list);
+}
+
+/* Must be called with vnode lock held */
+static void vfs_pcache_insert(struct vnode *v, u64 index,
+			      const void *data, u32 len)
+{
+	bool vref = FALSE;
+	struct vfs_page *p;
+
+	p = vmm_malloc(sizeof(*p));
+	if (!p) {
+		return;
+	}
+	INIT_LIST_HEAD(&p->hash_head);
+	INIT_LIST_HEAD(&p->lru_head);
+	INIT_LIST_HEAD(&p->vnode_head);
+	p->v = v;
+	p->index = index;
+	p->len = len;
+	p->ref = 1;
+	p->vput = FALSE;
+	memcpy(p->data, data, len);
+
+	vmm_mutex_lock(&vfsc.pcache_lock);
+	if (__vfs_pcache_find(v, index)) {
+		vmm_mutex_unlock(&vfsc.pcache_lock);
+		vmm_free(p);
+		return;
+	}
+	list_add_tail(&p->hash_head,
+		      &vfsc.pcache_hash[vfs_pcache_hash(v, index)]);
+	list_add_tail(&p->lru_head, &vfsc.pcache_lru);
+	list_add_tail(&p->vnode_head, &v->v_pages);
+	vfsc.pcache_pages++;
+	if (!v->v_npages++) {
+		vref = TRUE;
+	}
+	vmm_mutex_unlock(&vfsc.pcache_lock);
+
+	/* Cached pages keep their vnode alive after last close */
+	if (vref) {
+		vfs_vnode_vref(v);
+	}
+}
+
+/* Evict least recently used pages till we are within budget */
+static void vfs_pcache_shrink(void)
+{
+	struct vfs_page *p, *pn;
+	LIST_HEAD(free_list);
+
+	vmm_mutex_lock(&vfsc.pcache_lock);
+	list_for_each_entry_safe(p, pn, &vfsc.pcache_lru, lru_head) {
+		if (vfsc.pcache_pages <= vfsc.pcache_max_pages) {
+			break;
+		}
+		/* Skip pages being copied by readers */
+		if (p->ref > 1) {
+			continue;
+		}
+		__vfs_pcache_detach(p, &free_list);
+	}
+	vmm_mutex_unlock(&vfsc.pcache_lock);
+
+	vfs_pcache_free(&free_list);
+}
+
+/* Drop cached pages of vnode in given page index range.
+ * The caller must have the vnode acquired so that dropping
+ * vnode reference held by cached pages never frees it.
+ */
+static void vfs_pcache_drop_range(struct vnode *v, u64 first, u64 last)
+{
+	u64 index;
+	struct vfs_page *p, *pn;
+	LIST_HEAD(free_list);
+
+	vmm_mutex_lock(&vfsc.pcache_lock);
+	if ((last - first) < v->v_npages) {
+		/* Range smaller than cached pages so lookup each page */
+		for (index = first; index <= last; index++) {
+			p = __vfs_pcache_find(v, index);
+			if (p) {
+				__vfs_pcache_detach(p, &free_list);
+			}
+		}
+	} else {
+		list_for_each_entry_safe(p, pn, &v->v_pages, vnode_head) {
+			if ((first <= p->index) && (p->index <= last)) {
+				__vfs_pcache_detach(p, &free_list);
+			}
+		}
+	}
+	vmm_mutex_unlock(&vfsc.pcache_lock);
+
+	vfs_pcache_free(&free_list);
+}
+
+static void vfs_pcache_invalidate(struct vnode *v, loff_t off, size_t len)
+{
+	if (len) {
+		vfs_pcache_drop_range(v, (u64)off >> VFS_PCACHE_PAGE_SHIFT,
+				((u64)off + len - 1) >> VFS_PCACHE_PAGE_SHIFT);
+	}
+}
+
+static void vfs_pcache_drop(struct vnode *v)
+{
+	vfs_pcache_drop_range(v, 0, ~0ULL);
+}
+
+/* Drop cached pages of all vnodes under given mount point (or all
+ * cached pages if mount point is NULL). The vnode references held
+ * by cached pages are not released when vput is FALSE.
+ */
+static void vfs_pcache_drop_mount(struct mount *m, bool vput)
+{
+	struct vfs_page *p, *pn;
+	LIST_HEAD(free_list);
+
+	vmm_mutex_lock(&vfsc.pcache_lock);
+	list_for_each_entry_safe(p, pn, &vfsc.pcache_lru, lru_head) {
+		if (m && (p->v->v_mount != m)) {
+			continue;
+		}
+		__vfs_pcache_detach(p, &free_list);
+		if (!vput) {
+			p->vput = FALSE;
+		}
+	}
+	vmm_mutex_unlock(&vfsc.pcache_lock);
+
+	vfs_pcache_free(&free_list);
+}
+
+/* Read pages starting from given page index into page cache.
+ * Returns VMM_OK if at least the first page is cached or beyond EOF.
+ */
+static int vfs_pcache_fill(struct vnode *v, u64 index, u32 npages)
+{
+	u32 i, len;
+	size_t rd;
+	u8 *buf;
+	loff_t pos, size;
+
+	vmm_mutex_lock(&v->v_lock);
+
+	pos = (loff_t)(index << VFS_PCACHE_PAGE_SHIFT);
+	size = v->v_size;
+	if ((pos >= size) || vfs_pcache_present(v, index)) {
+		vmm_mutex_unlock(&v->v_lock);
+		return VMM_OK;
+	}
+
+	/* Don't read beyond EOF or over pages already cached */
+	if ((size - pos) < ((loff_t)npages << VFS_PCACHE_PAGE_SHIFT)) {
+		npages = (u32)((size - pos + VFS_PCACHE_PAGE_MASK) >>
+			       VFS_PCACHE_PAGE_SHIFT);
+	}
+	for (i = 1; i < npages; i++) {
+		if (vfs_pcache_present(v, index + i)) {
+			npages = i;
+			break;
+		}
+	}
+
+	buf = vmm_malloc(npages << VFS_PCACHE_PAGE_SHIFT);
+	if (!buf) {
+		vmm_mutex_unlock(&v->v_lock);
+		return VMM_ENOMEM;
+	}
+
+	rd = v->v_mount->m_fs->read(v, pos, buf,
+				    npages << VFS_PCACHE_PAGE_SHIFT);
+
+	/* Partial page is only cached when it ends at EOF */
+	for (i = 0; i < npages; i++) {
+		if (rd <= ((size_t)i << VFS_PCACHE_PAGE_SHIFT)) {
+			break;
+		}
+		len = rd - ((size_t)i << VFS_PCACHE_PAGE_SHIFT);
+		if (len > VFS_PCACHE_PAGE_SIZE) {
+			len = VFS_PCACHE_PAGE_SIZE;
+		} else if ((len < VFS_PCACHE_PAGE_SIZE) &&
+			   ((pos + (loff_t)rd) < size)) {
+			break;
+		}
+		vfs_pcache_insert(v, index + i,
+				  buf + ((size_t)i << VFS_PCACHE_PAGE_SHIFT),
+				  len);
+	}
+
+	vmm_mutex_unlock(&v->v_lock);
+
+	vmm_free(buf);
+
+	return (i) ? VMM_OK : VMM_EIO;
+}
+
+#else
+
+static inline void vfs_pcache_invalidate(struct vnode *v,
+					 loff_t off, size_t len)
+{
+}
+
+static inline void vfs_pcache_drop(struct vnode *v)
+{
+}
+
+static inline void vfs_pcache_drop_mount(struct mount *m, bool vput)
+{
+}
+
+#endif
+
+/** Read from vnode using page cache and read-ahead (if available)
+ *  Note: Page cache is bypassed when read-ahead state is NULL.
+ */
+static size_t vfs_vnode_read(struct vnode *v, struct vfs_readahead *ra,
+			     loff_t off, void *buf, size_t len)
+{
+	size_t ret = 0;
+#ifdef CONFIG_VFS_PCACHE
+	u64 index;
+	u32 pgoff, cnt, npages;
+	bool eof;
+	struct vfs_page *p;
+
+	while (ra && vfsc.pcache_max_pages && (ret < len)) {
+		index = (u64)(off + ret) >> VFS_PCACHE_PAGE_SHIFT;
+		pgoff = (u32)(off + ret) & VFS_PCACHE_PAGE_MASK;
+
+		p = vfs_pcache_get(v, index);
+		if (!p) {
+			/* Pages needed by this read plus read-ahead window
+			 * which grows as long as the reader is sequential.
+			 */
+			npages = (u32)((len - ret + pgoff +
+					VFS_PCACHE_PAGE_MASK) >>
+				       VFS_PCACHE_PAGE_SHIFT);
+			if (index == ra->next) {
+				ra->pages = (ra->pages) ?
+					    (ra->pages << 1) : VFS_PCACHE_RA_MIN;
+				if (ra->pages > VFS_PCACHE_RA_MAX) {
+					ra->pages = VFS_PCACHE_RA_MAX;
+				}
+				if (npages < ra->pages) {
+					npages = ra->pages;
+				}
+			} else {
+				ra->pages = 0;
+			}
+			if (npages > VFS_PCACHE_RA_MAX) {
+				npages = VFS_PCACHE_RA_MAX;
+			}
+
+			if (vfs_pcache_fill(v, index, npages)) {
+				/* Read remaining data without page cache */
+				break;
+			}
+			vfs_pcache_shrink();
+
+			/* Beyond EOF or page could not be cached */
+			p = vfs_pcache_get(v, index);
+			if (!p) {
+				break;
+			}
+		}
+
+		ra->next = index + 1;
+
+		if (pgoff >= p->len) {
+			vfs_pcache_put(p);
+			return ret;
+		}
+		cnt = p->len - pgoff;
+		if ((len - ret) < cnt) {
+			cnt = len - ret;
+		}
+		memcpy((u8 *)buf + ret, p->data + pgoff, cnt);
+		ret += cnt;
+		eof = (p->len < VFS_PCACHE_PAGE_SIZE) ? TRUE : FALSE;
+		vfs_pcache_put(p);
+		if (eof) {
+			return ret;
+		}
+	}
+#endif
+
+	if (ret < len) {
+		vmm_mutex_lock(&v->v_lock);
+		ret += v->v_mount->m_fs->read(v, off + ret,
+					      (u8 *)buf + ret, len - ret);
+		vmm_mutex_unlock(&v->v_lock);
+	}
+
+	return ret;
+}
+
 /** Get stat from vnode pointer. */
 static int vfs_vnode_stat(struct vnode *v, struct stat *st)
 {
@@ -542,6 +991,9 @@ static void vfs_force_unmount(struct mount *m)
 	}
 	vmm_mutex_unlock(&vfsc.fd_bmap_lock);
 
+	/* Flush page cache (vnodes are freed below) */
+	vfs_pcache_drop_mount(m, FALSE);
+
 	/* Flush all vnodes from this mount point */
 	for (i = 0; i < VFS_VNODE_HASH_SIZE; i++) {
 		vmm_mutex_lock(&vfsc.vnode_list_lock[i]);
@@ -778,6 +1230,9 @@ int vfs_unmount(const char *path)
 		return VMM_EINVALID;
 	}
 
+	/* cached pages also hold vnode references */
+	vfs_pcache_drop_mount(m, TRUE);
+
 	/* mount point reference count should be 1 
 	 * otherwise it is busy.
 	 */
@@ -981,6 +1436,7 @@ int vfs_open(const char *path, u32 flags, u32 mode)
 		}
 		vmm_mutex_lock(&v->v_lock);
 		err = v->v_mount->m_fs->truncate(v, 0);
+		vfs_pcache_drop(v);
 		vmm_mutex_unlock(&v->v_lock);
 		if (err) {
 			vfs_vnode_release(v);
@@ -1002,6 +1458,8 @@ int vfs_open(const char *path, u32 flags, u32 mode)
 	f->f_vnode = v;
 	f->f_flags = flags;
 	f->f_offset = 0;
+	f->f_ra.next = 0;
+	f->f_ra.pages = 0;
 
 	vmm_mutex_unlock(&f->f_lock);
 
@@ -1082,9 +1540,7 @@ size_t vfs_read(int fd, void *buf, size_t len)
 		return 0;
 	}
 
-	vmm_mutex_lock(&v->v_lock);
-	ret = v->v_mount->m_fs->read(v, f->f_offset, buf, len);
-	vmm_mutex_unlock(&v->v_lock);
+	ret = vfs_vnode_read(v, &f->f_ra, f->f_offset, buf, len);
 
 	f->f_offset += ret;
 
@@ -1094,6 +1550,185 @@ size_t vfs_read(int fd, void *buf, size_t len)
 }
 VMM_EXPORT_SYMBOL(vfs_read);
 
+struct vfs_load_buf {
+	void *data;
+	size_t len;
+	struct vmm_completion filled;
+	struct vmm_completion empty;
+};
+
+struct vfs_load_ctx {
+	struct vnode *v;
+	loff_t off;
+	size_t len;
+	struct vfs_readahead ra;
+	bool abort;
+	size_t chunk;
+	u32 nbufs;
+	struct vfs_load_buf bufs[2];
+	struct vmm_completion done;
+};
+
+static void vfs_load_fill(struct vfs_load_ctx *ctx, struct vfs_load_buf *b)
+{
+	size_t rd = (ctx->len < ctx->chunk) ? ctx->len : ctx->chunk;
+
+	b->len = 0;
+	if (rd && !ctx->abort) {
+		b->len = vfs_vnode_read(ctx->v,
+					(ctx->nbufs > 1) ? NULL : &ctx->ra,
+					ctx->off, b->data, rd);
+	}
+
+	ctx->off += b->len;
+	ctx->len -= b->len;
+}
+
+static int vfs_load_readahead(void *data)
+{
+	u32 i = 0;
+	struct vfs_load_buf *b;
+	struct vfs_load_ctx *ctx = data;
+
+	do {
+		b = &ctx->bufs[i];
+		vmm_completion_wait(&b->empty);
+		vfs_load_fill(ctx, b);
+		vmm_completion_complete(&b->filled);
+		i ^= 1;
+	} while (b->len);
+
+	vmm_completion_complete(&ctx->done);
+
+	return VMM_OK;
+}
+
+size_t vfs_load(int fd, loff_t off, size_t len,
+		struct vmm_guest *guest, physical_addr_t pa)
+{
+	u32 i;
+	size_t wr, ret = 0;
+	struct file *f;
+	struct vnode *v;
+	struct vfs_load_buf *b;
+	struct vfs_load_ctx *ctx;
+	struct vmm_thread *rdahead;
+
+	BUG_ON(!vmm_scheduler_orphan_context());
+
+	if (!len) {
+		return 0;
+	}
+
+	f = vfs_fd_to_file(fd);
+	if (!f) {
+		return 0;
+	}
+
+	ctx = vmm_zalloc(sizeof(*ctx));
+	if (!ctx) {
+		return 0;
+	}
+
+	/*
+	 * Ranges up to one chunk gain nothing from read-ahead so
+	 * they are read synchronously using one buffer of the
+	 * required size. Larger ranges bypass the page cache so
+	 * that loading big images does not evict everything else.
+	 */
+	if (len <= VFS_LOAD_CHUNK_SIZE) {
+		ctx->chunk = len;
+		ctx->nbufs = 1;
+	} else {
+		ctx->chunk = VFS_LOAD_CHUNK_SIZE;
+		ctx->nbufs = array_size(ctx->bufs);
+	}
+	for (i = 0; i < ctx->nbufs; i++) {
+		ctx->bufs[i].data = vmm_malloc(ctx->chunk);
+		if (!ctx->bufs[i].data) {
+			goto done_free;
+		}
+		INIT_COMPLETION(&ctx->bufs[i].filled);
+		INIT_COMPLETION(&ctx->bufs[i].empty);
+		vmm_completion_complete(&ctx->bufs[i].empty);
+	}
+	INIT_COMPLETION(&ctx->done);
+	ctx->off = off;
+	ctx->len = len;
+	ctx->abort = FALSE;
+
+	vmm_mutex_lock(&f->f_lock);
+
+	v = f->f_vnode;
+	if (!v || (v->v_type != VREG) || !(f->f_flags & O_RDONLY)) {
+		goto done_unlock;
+	}
+	ctx->v = v;
+
+	/* Without read-ahead thread we simply read synchronously */
+	rdahead = NULL;
+	if (ctx->nbufs > 1) {
+		rdahead = vmm_threads_create("vfs_load", vfs_load_readahead,
+					     ctx, VMM_THREAD_DEF_PRIORITY,
+					     VMM_THREAD_DEF_TIME_SLICE);
+	}
+	if (rdahead && vmm_threads_start(rdahead)) {
+		vmm_threads_destroy(rdahead);
+		rdahead = NULL;
+	}
+
+	i = 0;
+	while (1) {
+		b = &ctx->bufs[i];
+		if (rdahead) {
+			vmm_completion_wait(&b->filled);
+		} else {
+			vfs_load_fill(ctx, b);
+		}
+		if (!b->len) {
+			break;
+		}
+
+		if (guest) {
+			wr = vmm_guest_memory_write(guest, pa,
+						    b->data, b->len, FALSE);
+		} else {
+			wr = vmm_host_memory_write(pa, b->data, b->len, FALSE);
+		}
+		ret += wr;
+		pa += wr;
+		if (wr != b->len) {
+			ctx->abort = TRUE;
+		}
+
+		if (rdahead) {
+			vmm_completion_complete(&b->empty);
+		}
+		if (ctx->abort) {
+			break;
+		}
+		i = (i + 1) % ctx->nbufs;
+	}
+
+	if (rdahead) {
+		vmm_completion_wait(&ctx->done);
+		vmm_threads_destroy(rdahead);
+	}
+
+done_unlock:
+	vmm_mutex_unlock(&f->f_lock);
+done_free:
+	for (i = 0; i < ctx->nbufs; i++) {
+		if (ctx->bufs[i].data) {
+			vmm_free(ctx->bufs[i].data);
+		}
+	}
+	vmm_free(ctx);
+
+	return ret;
+}
+VMM_EXPORT_SYMBOL(vfs_load);
+
 size_t vfs_write(int fd, void *buf, size_t len)
 {
 	size_t ret;
@@ -1130,6 +1765,7 @@ size_t vfs_write(int fd, void *buf, size_t len)
 
 	vmm_mutex_lock(&v->v_lock);
 	ret = v->v_mount->m_fs->write(v, f->f_offset, buf, len);
+	vfs_pcache_invalidate(v, f->f_offset, len);
 	vmm_mutex_unlock(&v->v_lock);
 
 	f->f_offset += ret;
@@ -1644,6 +2280,15 @@ int vfs_rename(const char *src, const char *dest)
 		goto fail1;
 	}
 
+	/* cached pages also hold reference to source and renaming
+	 * directory changes path of all cached vnodes below it
+	 */
+	if (v1->v_type == VDIR) {
+		vfs_pcache_drop_mount(v1->v_mount, TRUE);
+	} else {
+		vfs_pcache_drop(v1);
+	}
+
 	/* check if source is busy ? */
 	if (arch_atomic_read(&v1->v_refcnt) >= 2) {
 		err = VMM_EBUSY;
@@ -1737,6 +2382,9 @@ int vfs_unlink(const char *path)
 		return VMM_EINVALID;
 	}
 
+	/* cached pages also hold reference to vnode */
+	vfs_pcache_drop(v);
+
 	if ((v->v_flags == VROOT) || 
 	    (arch_atomic_read(&v->v_refcnt) >= 2)) {
 		vfs_vnode_release(v);
@@ -2048,6 +2696,17 @@ static int __init vfs_init(void)
 		INIT_LIST_HEAD(&vfsc.vnode_list[i]);
 	};
 
+#ifdef CONFIG_VFS_PCACHE
+	INIT_MUTEX(&vfsc.pcache_lock);
+	for (i = 0; i < VFS_PCACHE_HASH_SIZE; i++) {
+		INIT_LIST_HEAD(&vfsc.pcache_hash[i]);
+	}
+	INIT_LIST_HEAD(&vfsc.pcache_lru);
+	vfsc.pcache_pages = 0;
+	vfsc.pcache_max_pages =
+		(CONFIG_VFS_PCACHE_SIZE * 1024) >> VFS_PCACHE_PAGE_SHIFT;
+#endif
+
 	INIT_MUTEX(&vfsc.fd_bmap_lock);
 	vfsc.fd_bmap = vmm_zalloc(bitmap_estimate_size(VFS_MAX_FD));
 	if (!vfsc.fd_bmap) {
@@ -2069,6 +2728,7 @@ static int __init vfs_init(void)
 static void __exit vfs_exit(void)
 {
 	vmm_blockdev_unregister_client(&vfsc.bdev_client);
+	vfs_pcache_drop_mount(NULL, TRUE);
 	vmm_free(vfsc.fd_bmap);
 }
 
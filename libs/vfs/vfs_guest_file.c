@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vfs_guest_file.c
+ * @author agent (agent@local)
+ * @brief VFS backend for file-backed guest RAM/ROM regions
+ */
+
+#include <vmm_error.h>
+#include <vmm_modules.h>
+#include <vmm_guest_file.h>
+#include <libs/stringlib.h>
+#include <libs/vfs.h>
+
+#define MODULE_DESC			"VFS Guest File Backend"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(VFS_IPRIORITY + 1)
+#define	MODULE_INIT			vfs_guest_file_init
+#define	MODULE_EXIT			vfs_guest_file_exit
+
+static int vfs_guest_file_open(const char *path, void **priv)
+{
+	int fd;
+	struct stat st;
+
+	fd = vfs_open(path, O_RDONLY, 0);
+	if (fd < 0) {
+		return fd;
+	}
+
+	if (vfs_fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+		vfs_close(fd);
+		return VMM_ENOENT;
+	}
+
+	*priv = (void *)(unsigned long)fd;
+
+	return VMM_OK;
+}
+
+static void vfs_guest_file_close(void *priv)
+{
+	vfs_close((int)(unsigned long)priv);
+}
+
+static int vfs_guest_file_read(void *priv, u64 off,
+			       void *buf, size_t len, size_t *rd)
+{
+	size_t ret;
+	struct stat st;
+	int fd = (int)(unsigned long)priv;
+
+	*rd = 0;
+
+	if (vfs_fstat(fd, &st)) {
+		return VMM_EIO;
+	}
+
+	/* Only bytes beyond end of file are left unread */
+	if ((u64)st.st_size <= off) {
+		return VMM_OK;
+	}
+	if (((u64)st.st_size - off) < len) {
+		len = (u64)st.st_size - off;
+	}
+
+	if (vfs_lseek(fd, off, SEEK_SET) != (loff_t)off) {
+		return VMM_EIO;
+	}
+
+	while (*rd < len) {
+		ret = vfs_read(fd, buf + *rd, len - *rd);
+		if (!ret) {
+			return VMM_EIO;
+		}
+		*rd += ret;
+	}
+
+	return VMM_OK;
+}
+
+static struct vmm_guest_file_backend vfs_guest_file_backend = {
+	.name = "vfs",
+	.open = vfs_guest_file_open,
+	.close = vfs_guest_file_close,
+	.read = vfs_guest_file_read,
+};
+
+static int __init vfs_guest_file_init(void)
+{
+	return vmm_guest_file_register_backend(&vfs_guest_file_backend);
+}
+
+static void __exit vfs_guest_file_exit(void)
+{
+	vmm_guest_file_unregister_backend(&vfs_guest_file_backend);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
@@ -266,18 +266,23 @@ int vsdaemon_create(const char *transport_name,
 		goto fail3;
 	}
 
-	vsd->thread = vmm_threads_create(vsd->name, &vsdaemon_main, vsd, 
-					 VMM_THREAD_DEF_PRIORITY,
-					 VMM_THREAD_DEF_TIME_SLICE);
-	if (!vsd->thread) {
-		rc = VMM_EFAIL;
-		goto fail4;
+	if (vsd->trans->main_loop) {
+		vsd->thread = vmm_threads_create(vsd->name,
+						 &vsdaemon_main, vsd,
+						 VMM_THREAD_DEF_PRIORITY,
+						 VMM_THREAD_DEF_TIME_SLICE);
+		if (!vsd->thread) {
+			rc = VMM_EFAIL;
+			goto fail4;
+		}
 	}
 
 	list_add_tail(&vsd->head, &vsdc.vsd_list);
 	vsd->trans->use_count++;
 
-	vmm_threads_start(vsd->thread);
+	if (vsd->thread) {
+		vmm_threads_start(vsd->thread);
+	}
 
 	vmm_mutex_unlock(&vsdc.vsd_list_lock);
 
@@ -298,12 +303,16 @@ VMM_EXPORT_SYMBOL(vsdaemon_create);
 /* Note: must be called with vsd_list_lock held */
 static int __vsdaemon_destroy(struct vsdaemon *vsd)
 {
-	vmm_threads_stop(vsd->thread);
+	if (vsd->thread) {
+		vmm_threads_stop(vsd->thread);
+	}
 
 	vsd->trans->use_count--;
 	list_del(&vsd->head);
 
-	vmm_threads_destroy(vsd->thread);
+	if (vsd->thread) {
+		vmm_threads_destroy(vsd->thread);
+	}
 
 	vmm_vserial_unregister_receiver(vsd->vser, 
 					&vsdaemon_vserial_recv, vsd);
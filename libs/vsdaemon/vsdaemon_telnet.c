@@ -25,6 +25,9 @@
 #include <vmm_macros.h>
 #include <vmm_heap.h>
 #include <vmm_spinlocks.h>
+#include <vmm_mutex.h>
+#include <vmm_completion.h>
+#include <vmm_threads.h>
 #include <vmm_modules.h>
 #include <libs/stringlib.h>
 #include <libs/netstack.h>
@@ -38,12 +41,22 @@
 #define	MODULE_INIT			vsdaemon_telnet_init
 #define	MODULE_EXIT			vsdaemon_telnet_exit
 
-#define VSDAEMON_TXBUF_SIZE		4096
-#define VSDAEMON_RXTIMEOUT_MS		400
+#define VSDAEMON_HISTORY_SIZE		CONFIG_VSDAEMON_TELNET_HISTORY_SIZE
 
-#define VSDAEMON_MAX_FLUSH_SIZE		128
+#define VSDAEMON_MAX_FLUSH_SIZE		1024
 
+/* All telnet vsdaemon instances are served by one event loop thread
+ * which is woken up by socket notifiers and vserial receive callbacks.
+ * The console output of each instance is kept in a history ring which
+ * also serves as Tx buffer so, the history is replayed on connect.
+ */
 struct vsdaemon_telnet {
+	/* list head */
+	struct dlist head;
+
+	/* vsdaemon pointer */
+	struct vsdaemon *vsd;
+
 	/* tcp port number */
 	u32 port;
 
@@ -53,14 +66,31 @@ struct vsdaemon_telnet {
 	/* active connection */
 	struct netstack_socket *active_sk;
 
-	/* tx buffer */
-	u8 tx_buf[VSDAEMON_TXBUF_SIZE];
-	u32 tx_buf_head;
-	u32 tx_buf_tail;
-	u32 tx_buf_count;
-	vmm_spinlock_t tx_buf_lock;
+	/* pending work (protected by pending_lock of control) */
+	bool pending;
+	struct dlist pending_head;
+
+	/* history ring where last tx_count bytes are not yet sent */
+	u8 hist_buf[VSDAEMON_HISTORY_SIZE];
+	u32 hist_tail;
+	u32 hist_count;
+	u32 tx_count;
+	bool connected;
+	vmm_spinlock_t hist_lock;
+};
+
+struct vsdaemon_telnet_control {
+	struct vmm_mutex tnet_list_lock;
+	struct dlist tnet_list;
+	vmm_spinlock_t pending_lock;
+	struct dlist pending_list;
+	struct vmm_completion pending_avail;
+	struct vmm_thread *thread;
+	u8 tx_buf[VSDAEMON_MAX_FLUSH_SIZE];
 };
 
+static struct vsdaemon_telnet_control tctrl;
+
 static bool vsdaemon_valid_port(u32 port)
 {
 	if (port < 1024) {
@@ -76,107 +106,213 @@ static bool vsdaemon_valid_port(u32 port)
 	return TRUE;
 }
 
-static void vsdaemon_flush_tx_buffer(struct vsdaemon_telnet *tnet)
+static void vsdaemon_telnet_kick(struct vsdaemon_telnet *tnet)
 {
-	int rc;
-	u32 tx_count;
 	irq_flags_t flags;
-	u8 tx_buf[VSDAEMON_MAX_FLUSH_SIZE];
-
-	while (1) {
-		/* Lock connection state */
-		vmm_spin_lock_irqsave(&tnet->tx_buf_lock, flags);
-
-		/* Get data from Tx buffer */
-		tx_count = 0;
-		while (tnet->tx_buf_count &&
-		       (tx_count < VSDAEMON_MAX_FLUSH_SIZE)) {
-			tx_buf[tx_count] = tnet->tx_buf[tnet->tx_buf_head];
-			tnet->tx_buf_head++;
-			if (tnet->tx_buf_head >= VSDAEMON_TXBUF_SIZE) {
-				tnet->tx_buf_head = 0;
-			}
-			tnet->tx_buf_count--;
-			tx_count++;
-		}
 
-		/* Unlock connection state */
-		vmm_spin_unlock_irqrestore(&tnet->tx_buf_lock, flags);
+	vmm_spin_lock_irqsave(&tctrl.pending_lock, flags);
 
-		/* Transmit the pending Tx data */
-		if (tx_count && tnet->active_sk) {
-			rc = netstack_socket_write(tnet->active_sk, 
-						   &tx_buf[0], tx_count);
-			if (rc) {
-				return;
-			}
-		} else {
-			return;
-		}
+	if (!tnet->pending) {
+		tnet->pending = TRUE;
+		list_add_tail(&tnet->pending_head, &tctrl.pending_list);
+		vmm_completion_complete_once(&tctrl.pending_avail);
 	}
+
+	vmm_spin_unlock_irqrestore(&tctrl.pending_lock, flags);
+}
+
+static void vsdaemon_telnet_notifier(struct netstack_socket *sk, void *priv)
+{
+	vsdaemon_telnet_kick(priv);
 }
 
 static void vsdaemon_telnet_receive_char(struct vsdaemon *vsd, u8 ch)
 {
+	bool kick;
 	irq_flags_t flags;
 	struct vsdaemon_telnet *tnet = vsdaemon_transport_get_data(vsd);
 
-	vmm_spin_lock_irqsave(&tnet->tx_buf_lock, flags);
+	vmm_spin_lock_irqsave(&tnet->hist_lock, flags);
 
-	if (VSDAEMON_TXBUF_SIZE == tnet->tx_buf_count) {
-		tnet->tx_buf_head++;
-		if (tnet->tx_buf_head >= VSDAEMON_TXBUF_SIZE) {
-			tnet->tx_buf_head = 0;
-		}
-		tnet->tx_buf_count--;
+	tnet->hist_buf[tnet->hist_tail] = ch;
+
+	tnet->hist_tail++;
+	if (tnet->hist_tail >= VSDAEMON_HISTORY_SIZE) {
+		tnet->hist_tail = 0;
 	}
 
-	tnet->tx_buf[tnet->tx_buf_tail] = ch;
+	if (tnet->hist_count < VSDAEMON_HISTORY_SIZE) {
+		tnet->hist_count++;
+	}
 
-	tnet->tx_buf_tail++;
-	if (tnet->tx_buf_tail >= VSDAEMON_TXBUF_SIZE) {
-		tnet->tx_buf_tail = 0;
+	/* Only first pending byte needs to wake up the event loop */
+	kick = (tnet->connected && !tnet->tx_count) ? TRUE : FALSE;
+	if (tnet->tx_count < VSDAEMON_HISTORY_SIZE) {
+		tnet->tx_count++;
 	}
 
-	tnet->tx_buf_count++;
+	vmm_spin_unlock_irqrestore(&tnet->hist_lock, flags);
 
-	vmm_spin_unlock_irqrestore(&tnet->tx_buf_lock, flags);
+	if (kick) {
+		vsdaemon_telnet_kick(tnet);
+	}
 }
 
-static int vsdaemon_telnet_main_loop(struct vsdaemon *vsd)
+static void vsdaemon_telnet_set_connected(struct vsdaemon_telnet *tnet,
+					  bool connected)
+{
+	irq_flags_t flags;
+
+	vmm_spin_lock_irqsave(&tnet->hist_lock, flags);
+
+	tnet->connected = connected;
+
+	/* Replay whole history on new connection */
+	tnet->tx_count = (connected) ? tnet->hist_count : 0;
+
+	vmm_spin_unlock_irqrestore(&tnet->hist_lock, flags);
+}
+
+static void vsdaemon_telnet_disconnect(struct vsdaemon_telnet *tnet)
+{
+	vsdaemon_telnet_set_connected(tnet, FALSE);
+
+	netstack_socket_set_notifier(tnet->active_sk, NULL, NULL);
+	netstack_socket_close(tnet->active_sk);
+	netstack_socket_free(tnet->active_sk);
+	tnet->active_sk = NULL;
+}
+
+/* Note: Bytes not accepted by socket remain pending in history ring
+ * and we resume when socket notifier reports available send space.
+ */
+static int vsdaemon_telnet_flush(struct vsdaemon_telnet *tnet)
 {
 	int rc;
-	struct netstack_socket_buf buf;
-	struct vsdaemon_telnet *tnet = vsdaemon_transport_get_data(vsd);
+	u16 written;
+	u32 start, tx_count;
+	irq_flags_t flags;
 
 	while (1) {
-		rc = netstack_socket_accept(tnet->sk, &tnet->active_sk);
+		vmm_spin_lock_irqsave(&tnet->hist_lock, flags);
+
+		/* Get largest contiguous chunk of pending bytes */
+		if (tnet->tx_count <= tnet->hist_tail) {
+			start = tnet->hist_tail - tnet->tx_count;
+			tx_count = tnet->tx_count;
+		} else {
+			start = VSDAEMON_HISTORY_SIZE -
+				(tnet->tx_count - tnet->hist_tail);
+			tx_count = VSDAEMON_HISTORY_SIZE - start;
+		}
+		if (VSDAEMON_MAX_FLUSH_SIZE < tx_count) {
+			tx_count = VSDAEMON_MAX_FLUSH_SIZE;
+		}
+		memcpy(tctrl.tx_buf, &tnet->hist_buf[start], tx_count);
+
+		vmm_spin_unlock_irqrestore(&tnet->hist_lock, flags);
+
+		if (!tx_count) {
+			return VMM_OK;
+		}
+
+		rc = netstack_socket_write_partial(tnet->active_sk,
+						   tctrl.tx_buf, tx_count,
+						   &written);
 		if (rc) {
 			return rc;
 		}
 
-		while (1) {
-			vsdaemon_flush_tx_buffer(tnet);
+		vmm_spin_lock_irqsave(&tnet->hist_lock, flags);
+		tnet->tx_count -= (written < tnet->tx_count) ?
+				  written : tnet->tx_count;
+		vmm_spin_unlock_irqrestore(&tnet->hist_lock, flags);
+
+		if (written < tx_count) {
+			return VMM_OK;
+		}
+	}
+
+	return VMM_OK;
+}
 
-			rc = netstack_socket_recv(tnet->active_sk, &buf, 
-						  VSDAEMON_RXTIMEOUT_MS);
-			if (rc == VMM_ETIMEDOUT) {
-				continue;
-			} else if (rc) {
+/* Note: Must be called with tnet_list_lock held */
+static void vsdaemon_telnet_process(struct vsdaemon_telnet *tnet)
+{
+	int rc;
+	struct netstack_socket_buf buf;
+
+	/* Receive data from active connection */
+	while (tnet->active_sk && netstack_socket_readable(tnet->active_sk)) {
+		rc = netstack_socket_recv(tnet->active_sk, &buf, 0);
+		if (rc) {
+			vsdaemon_telnet_disconnect(tnet);
+			break;
+		}
+
+		do {
+			vmm_vserial_send(tnet->vsd->vser,
+					 (u8 *)buf.data, buf.len);
+		} while (!(rc = netstack_socket_nextbuf(&buf)));
+
+		netstack_socket_freebuf(&buf);
+	}
+
+	/* Accept new connection only when there is no active
+	 * connection. Other incoming connections remain pending
+	 * till active connection is closed.
+	 */
+	if (!tnet->active_sk && netstack_socket_readable(tnet->sk)) {
+		rc = netstack_socket_accept(tnet->sk, &tnet->active_sk);
+		if (rc) {
+			tnet->active_sk = NULL;
+			return;
+		}
+
+		netstack_socket_set_notifier(tnet->active_sk,
+					     vsdaemon_telnet_notifier, tnet);
+		vsdaemon_telnet_set_connected(tnet, TRUE);
+
+		/* Data might have arrived before setting notifier */
+		vsdaemon_telnet_kick(tnet);
+	}
+
+	/* Transmit pending console output in batches */
+	if (tnet->active_sk) {
+		if (vsdaemon_telnet_flush(tnet)) {
+			vsdaemon_telnet_disconnect(tnet);
+			/* Check for pending incoming connections */
+			vsdaemon_telnet_kick(tnet);
+		}
+	}
+}
+
+static int vsdaemon_telnet_event_loop(void *data)
+{
+	irq_flags_t flags;
+	struct vsdaemon_telnet *tnet;
+
+	while (1) {
+		vmm_completion_wait(&tctrl.pending_avail);
+
+		vmm_mutex_lock(&tctrl.tnet_list_lock);
+
+		while (1) {
+			vmm_spin_lock_irqsave(&tctrl.pending_lock, flags);
+			if (list_empty(&tctrl.pending_list)) {
+				vmm_spin_unlock_irqrestore(&tctrl.pending_lock,
+							   flags);
 				break;
 			}
+			tnet = list_entry(list_pop(&tctrl.pending_list),
+					  struct vsdaemon_telnet, pending_head);
+			tnet->pending = FALSE;
+			vmm_spin_unlock_irqrestore(&tctrl.pending_lock, flags);
 
-			do {
-				vmm_vserial_send(vsd->vser, 
-						(u8 *)buf.data, buf.len);
-			} while (!(rc = netstack_socket_nextbuf(&buf)));
-
-			netstack_socket_freebuf(&buf);
+			vsdaemon_telnet_process(tnet);
 		}
 
-		netstack_socket_close(tnet->active_sk);
-		netstack_socket_free(tnet->active_sk);
-		tnet->active_sk = NULL;
+		vmm_mutex_unlock(&tctrl.tnet_list_lock);
 	}
 
 	return VMM_OK;
@@ -202,6 +338,8 @@ static int vsdaemon_telnet_setup(struct vsdaemon *vsd, int argc, char **argv)
 		return VMM_ENOMEM;
 	}
 
+	INIT_LIST_HEAD(&tnet->head);
+	tnet->vsd = vsd;
 	tnet->port = port;
 
 	tnet->sk = netstack_socket_alloc(NETSTACK_SOCKET_TCP);
@@ -222,11 +360,25 @@ static int vsdaemon_telnet_setup(struct vsdaemon *vsd, int argc, char **argv)
 
 	tnet->active_sk = NULL;
 
-	tnet->tx_buf_head = tnet->tx_buf_tail = tnet->tx_buf_count = 0;
-	INIT_SPIN_LOCK(&tnet->tx_buf_lock);
+	tnet->pending = FALSE;
+	INIT_LIST_HEAD(&tnet->pending_head);
+
+	tnet->hist_tail = tnet->hist_count = tnet->tx_count = 0;
+	tnet->connected = FALSE;
+	INIT_SPIN_LOCK(&tnet->hist_lock);
 
 	vsdaemon_transport_set_data(vsd, tnet);
 
+	vmm_mutex_lock(&tctrl.tnet_list_lock);
+	list_add_tail(&tnet->head, &tctrl.tnet_list);
+	vmm_mutex_unlock(&tctrl.tnet_list_lock);
+
+	netstack_socket_set_notifier(tnet->sk,
+				     vsdaemon_telnet_notifier, tnet);
+
+	/* Connection might have arrived before setting notifier */
+	vsdaemon_telnet_kick(tnet);
+
 	return VMM_OK;
 
 fail3:
@@ -240,8 +392,32 @@ fail1:
 
 static void vsdaemon_telnet_cleanup(struct vsdaemon *vsd)
 {
+	irq_flags_t flags;
 	struct vsdaemon_telnet *tnet = vsdaemon_transport_get_data(vsd);
 
+	/* Event loop does not touch instance once it is removed
+	 * from instance list and pending list. The notifiers are
+	 * cleared first so that nobody can queue it again.
+	 */
+	netstack_socket_set_notifier(tnet->sk, NULL, NULL);
+
+	vmm_mutex_lock(&tctrl.tnet_list_lock);
+
+	if (tnet->active_sk) {
+		netstack_socket_set_notifier(tnet->active_sk, NULL, NULL);
+	}
+
+	list_del(&tnet->head);
+
+	vmm_spin_lock_irqsave(&tctrl.pending_lock, flags);
+	if (tnet->pending) {
+		list_del(&tnet->pending_head);
+		tnet->pending = FALSE;
+	}
+	vmm_spin_unlock_irqrestore(&tctrl.pending_lock, flags);
+
+	vmm_mutex_unlock(&tctrl.tnet_list_lock);
+
 	vsdaemon_transport_set_data(vsd, NULL);
 
 	if (tnet->active_sk) {
@@ -260,18 +436,46 @@ static struct vsdaemon_transport telnet = {
 	.name = "telnet",
 	.setup = vsdaemon_telnet_setup,
 	.cleanup = vsdaemon_telnet_cleanup,
-	.main_loop = vsdaemon_telnet_main_loop,
 	.receive_char = vsdaemon_telnet_receive_char,
 };
 
 static int __init vsdaemon_telnet_init(void)
 {
-	return vsdaemon_transport_register(&telnet);
+	int rc;
+
+	memset(&tctrl, 0, sizeof(tctrl));
+
+	INIT_MUTEX(&tctrl.tnet_list_lock);
+	INIT_LIST_HEAD(&tctrl.tnet_list);
+	INIT_SPIN_LOCK(&tctrl.pending_lock);
+	INIT_LIST_HEAD(&tctrl.pending_list);
+	INIT_COMPLETION(&tctrl.pending_avail);
+
+	tctrl.thread = vmm_threads_create("vsdaemon-telnet",
+					  &vsdaemon_telnet_event_loop, NULL,
+					  VMM_THREAD_DEF_PRIORITY,
+					  VMM_THREAD_DEF_TIME_SLICE);
+	if (!tctrl.thread) {
+		return VMM_EFAIL;
+	}
+
+	rc = vsdaemon_transport_register(&telnet);
+	if (rc) {
+		vmm_threads_destroy(tctrl.thread);
+		return rc;
+	}
+
+	vmm_threads_start(tctrl.thread);
+
+	return VMM_OK;
 }
 
 static void __exit vsdaemon_telnet_exit(void)
 {
 	vsdaemon_transport_unregister(&telnet);
+
+	vmm_threads_stop(tctrl.thread);
+	vmm_threads_destroy(tctrl.thread);
 }
 
 VMM_DECLARE_MODULE(MODULE_DESC, 
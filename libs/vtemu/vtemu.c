@@ -410,6 +410,9 @@ static void vtemu_blank_display(struct vtemu *v)
 {
 	struct fb_fillrect rect;
 
+	/* Blanking also wipes cursor */
+	v->cursor_on = FALSE;
+
 	/* Blank frame buffer */
 	rect.dx = 0;
 	rect.dy = 0;
@@ -423,8 +426,75 @@ static void vtemu_blank_display(struct vtemu *v)
 	}
 }
 
+static u32 vtemu_color2pixel(struct vtemu *v, u32 color)
+{
+	if (v->info->fix.visual == FB_VISUAL_TRUECOLOR ||
+	    v->info->fix.visual == FB_VISUAL_DIRECTCOLOR) {
+		return ((u32 *)v->info->pseudo_palette)[color];
+	}
+
+	return color;
+}
+
+static u8 *vtemu_glyph_get(struct vtemu *v, u32 ch, u32 fc, u32 bc)
+{
+	u8 *tile, *dst;
+	const u8 *src;
+	u32 idx, r, c, spitch, fpix, bpix, pix;
+	struct vtemu_glyph *g;
+
+	idx = (ch ^ (fc << 8) ^ (bc << 11)) & (v->glyph_count - 1);
+	g = &v->glyph[idx];
+	tile = v->glyph_tiles + idx * v->glyph_tile_sz;
+	if (g->ch == ch && g->fc == fc && g->bc == bc) {
+		return tile;
+	}
+
+	/* Render glyph from monochrome font bitmap */
+	fpix = vtemu_color2pixel(v, fc);
+	bpix = vtemu_color2pixel(v, bc);
+	spitch = udiv32(v->font_img_sz, v->font->height);
+	src = (const u8 *)v->font->data + v->font_img_sz * ch;
+	dst = tile;
+	for (r = 0; r < v->font->height; r++) {
+		for (c = 0; c < v->font->width; c++) {
+			pix = (src[c >> 3] & (0x80 >> (c & 0x7))) ? fpix : bpix;
+			switch (v->glyph_Bpp) {
+			case 1:
+				dst[c] = pix;
+				break;
+			case 2:
+				((u16 *)dst)[c] = pix;
+				break;
+			default:
+				((u32 *)dst)[c] = pix;
+				break;
+			};
+		}
+		src += spitch;
+		dst += v->glyph_pitch;
+	}
+
+	g->ch = ch;
+	g->fc = fc;
+	g->bc = bc;
+
+	return tile;
+}
+
+static void vtemu_glyph_invalidate(struct vtemu *v)
+{
+	u32 i;
+
+	for (i = 0; i < v->glyph_count; i++) {
+		v->glyph[i].ch = VTEMU_GLYPH_INVALID;
+	}
+}
+
 static void vtemu_cell_draw(struct vtemu *v, struct vtemu_cell *vcell)
 {
+	u8 *tile, *fbdst;
+	u32 r;
 	struct fb_image img;
 
 	if ((vcell->y < v->start_y) ||
@@ -434,6 +504,27 @@ static void vtemu_cell_draw(struct vtemu *v, struct vtemu_cell *vcell)
 
 	img.dx = vcell->x * v->font->width;
 	img.dy = (vcell->y - v->start_y) * v->font->height;
+
+	if (v->glyph_tiles) {
+		if (v->freeze) {
+			return;
+		}
+
+		tile = vtemu_glyph_get(v, vcell->ch, vcell->fc, vcell->bc);
+		fbdst = (u8 *)v->info->screen_base +
+			img.dy * v->info->fix.line_length +
+			img.dx * v->glyph_Bpp;
+		if (v->info->fbops->fb_sync) {
+			v->info->fbops->fb_sync(v->info);
+		}
+		for (r = 0; r < v->font->height; r++) {
+			fb_memcpy_tofb(fbdst, tile, v->glyph_pitch);
+			fbdst += v->info->fix.line_length;
+			tile += v->glyph_pitch;
+		}
+		return;
+	}
+
 	img.width = v->font->width;
 	img.height = v->font->height;
 	img.fg_color = vcell->fc;
@@ -457,6 +548,11 @@ static void vtemu_cursor_erase(struct vtemu *v)
 	u8 *fbdst;
 	u32 dx, dy, fboffset;
 
+	if (!v->cursor_on) {
+		return;
+	}
+	v->cursor_on = FALSE;
+
 	if ((v->start_y + v->h) <= v->y) {
 		return;
 	}
@@ -479,7 +575,7 @@ static void vtemu_cursor_draw(struct vtemu *v)
 	u32 fboffset;
 	struct fb_fillrect rect;
 
-	if ((v->start_y + v->h) <= v->y) {
+	if (v->cursor_on || ((v->start_y + v->h) <= v->y)) {
 		return;
 	}
 
@@ -498,6 +594,7 @@ static void vtemu_cursor_draw(struct vtemu *v)
 	if (!v->freeze) {
 		fb_memcpy_fromfb(v->cursor_bkp, fbsrc, v->cursor_bkp_size);
 		v->info->fbops->fb_fillrect(v->info, &rect);
+		v->cursor_on = TRUE;
 	}
 }
 
@@ -521,8 +618,6 @@ static void vtemu_cursor_clear_down(struct vtemu *v)
 		v->info->fbops->fb_fillrect(v->info, &rect);
 	}
 
-	vtemu_cursor_draw(v);
-
 	pos = v->cell_head;
 	for (c = 0; c < v->cell_count; c++) {
 		if ((v->x <= v->cell[pos].x) &&
@@ -538,7 +633,6 @@ static void vtemu_cursor_clear_down(struct vtemu *v)
 
 static void vtemu_scroll_down(struct vtemu *v, u32 lines)
 {
-	u32 c, pos;
 	struct fb_copyarea reg;
 	struct fb_fillrect rect;
 
@@ -548,7 +642,7 @@ static void vtemu_scroll_down(struct vtemu *v, u32 lines)
 
 	reg.dx = 0;
 	reg.dy = 0;
-	reg.width = (v->w - lines) * v->font->width;
+	reg.width = v->w * v->font->width;
 	reg.height = (v->h - lines) * v->font->height;
 	reg.sx = 0;
 	reg.sy = lines * v->font->height;
@@ -568,37 +662,103 @@ static void vtemu_scroll_down(struct vtemu *v, u32 lines)
 		v->info->fbops->fb_fillrect(v->info, &rect);
 	}
 
+	/* Cursor never goes below visible lines so newly
+	 * visible lines don't have any cells to draw.
+	 */
 	v->start_y += lines;
+}
 
-	pos = v->cell_head;
-	for (c = 0; c < v->cell_count; c++) {
-		if ((v->start_y + v->h - lines) <= v->cell[pos].y) {
-			vtemu_cell_draw(v, &v->cell[pos]);
+static void vtemu_redraw_line(struct vtemu *v, u32 l)
+{
+	u8 *tile, *dst, *fbdst;
+	u32 c, r, lpitch;
+	u32 *line = &v->screen[l * v->w];
+	struct vtemu_cell *vcell;
+
+	if (!v->line_buf) {
+		for (c = 0; c < v->w; c++) {
+			if (line[c] != VTEMU_SCREEN_CELL_NONE) {
+				vtemu_cell_draw(v, &v->cell[line[c]]);
+			}
 		}
-		pos++;
-		if (pos == v->cell_len) {
-			pos = 0;
+		return;
+	}
+
+	/* Compose whole line from glyph tiles */
+	lpitch = v->w * v->glyph_pitch;
+	for (c = 0; c < v->w; c++) {
+		if (line[c] != VTEMU_SCREEN_CELL_NONE) {
+			vcell = &v->cell[line[c]];
+			tile = vtemu_glyph_get(v, vcell->ch, vcell->fc, vcell->bc);
+		} else {
+			tile = vtemu_glyph_get(v, VTEMU_ERASE_CHAR, v->bc, v->bc);
+		}
+		dst = v->line_buf + c * v->glyph_pitch;
+		for (r = 0; r < v->font->height; r++) {
+			memcpy(dst, tile, v->glyph_pitch);
+			dst += lpitch;
+			tile += v->glyph_pitch;
 		}
 	}
+
+	/* Write composed line one scanline at a time */
+	fbdst = (u8 *)v->info->screen_base +
+		l * v->font->height * v->info->fix.line_length;
+	dst = v->line_buf;
+	for (r = 0; r < v->font->height; r++) {
+		fb_memcpy_tofb(fbdst, dst, lpitch);
+		fbdst += v->info->fix.line_length;
+		dst += lpitch;
+	}
 }
 
 static void vtemu_redraw_display(struct vtemu *v)
 {
-	u32 c, pos;
+	bool dirty;
+	u32 c, l, pos;
+	struct vtemu_cell *vcell;
 
 	/* Blank frame buffer */
 	vtemu_blank_display(v);
+	if (v->freeze) {
+		return;
+	}
 
-	/* Redraw all cells */
+	/* Find latest cell of each visible location */
+	for (c = 0; c < (v->w * v->h); c++) {
+		v->screen[c] = VTEMU_SCREEN_CELL_NONE;
+	}
 	pos = v->cell_head;
 	for (c = 0; c < v->cell_count; c++) {
-		vtemu_cell_draw(v, &v->cell[pos]);
+		vcell = &v->cell[pos];
+		if ((v->start_y <= vcell->y) &&
+		    (vcell->y < (v->start_y + v->h)) &&
+		    (vcell->x < v->w)) {
+			v->screen[(vcell->y - v->start_y) * v->w + vcell->x] = pos;
+		}
 		pos++;
 		if (pos == v->cell_len) {
 			pos = 0;
 		}
 	}
 
+	/* Redraw only lines having cells */
+	if (v->info->fbops->fb_sync) {
+		v->info->fbops->fb_sync(v->info);
+	}
+	for (l = 0; l < v->h; l++) {
+		dirty = FALSE;
+		for (c = 0; c < v->w; c++) {
+			if (v->screen[l * v->w + c] != VTEMU_SCREEN_CELL_NONE) {
+				dirty = TRUE;
+				break;
+			}
+		}
+		if (dirty) {
+			vtemu_redraw_line(v, l);
+		}
+	}
+
 	/* Draw cursor */
 	vtemu_cursor_draw(v);
 }
@@ -607,9 +767,6 @@ static int vtemu_putchar(struct vtemu *v, u8 ch)
 {
 	u32 i;
 
-	/* Erase cursor */
-	vtemu_cursor_erase(v);
-
 	switch (ch) {
 	case '\t':
 		/* Update location */
@@ -693,10 +850,6 @@ static int vtemu_putchar(struct vtemu *v, u8 ch)
 		break;
 	};
 
-	
-	/* Draw cursor */
-	vtemu_cursor_draw(v);
-
 	return VMM_OK;
 }
 
@@ -781,22 +934,16 @@ static int vtemu_putesc(struct vtemu *v, u8 ch)
 			tmp = v->esc_attrib[0];
 			tmp = (tmp) ? tmp : 1;
 
-			vtemu_cursor_erase(v);
-
 			while (v->x && tmp) {
 				v->x--;
 				tmp--;
 			}
 			v->esc_cmd_active = FALSE;
-
-			vtemu_cursor_draw(v);
 			break;
 		case 'C':		/* Move Right */
 			tmp = v->esc_attrib[0];
 			tmp = (tmp) ? tmp : 1;
 
-			vtemu_cursor_erase(v);
-
 			while (tmp) {
 				v->x++;
 				if (v->x == v->w) {
@@ -809,36 +956,26 @@ static int vtemu_putesc(struct vtemu *v, u8 ch)
 				tmp--;
 			}
 			v->esc_cmd_active = FALSE;
-
-			vtemu_cursor_draw(v);
 			break;
 		case 'B':		/* Move Down */
 			tmp = v->esc_attrib[0];
 			tmp = (tmp) ? tmp : 1;
 
-			vtemu_cursor_erase(v);
-
-			while ((v->y - v->start_y) < v->h) {
+			while (((v->y - v->start_y) < (v->h - 1)) && tmp) {
 				v->y++;
 				tmp--;
 			}
 			v->esc_cmd_active = FALSE;
-
-			vtemu_cursor_draw(v);
 			break;
 		case 'A':		/* Move Up */
 			tmp = v->esc_attrib[0];
 			tmp = (tmp) ? tmp : 1;
 
-			vtemu_cursor_erase(v);
-
 			while ((v->y - v->start_y) && tmp) {
 				v->y--;
 				tmp--;
 			}
 			v->esc_cmd_active = FALSE;
-
-			vtemu_cursor_draw(v);
 			break;
 		case 'm':		/* Set Display Attributes */
 			for(tmp = 0; tmp <= v->esc_attrib_count; tmp++) {
@@ -958,6 +1095,9 @@ static u32 vtemu_write(struct vmm_chardev *cdev,
 		return 0;
 	}
 
+	/* Cursor is erased and drawn once for whole write */
+	vtemu_cursor_erase(v);
+
 	for (i = 0; i < len; i++) {
 		if (v->esc_cmd_active) {
 			rc = vtemu_putesc(v, src[i]);
@@ -971,6 +1111,8 @@ static u32 vtemu_write(struct vmm_chardev *cdev,
 		}
 	}
 
+	vtemu_cursor_draw(v);
+
 	return i;
 }
 
@@ -1004,6 +1146,11 @@ static void vtemu_restore(struct fb_info *info, void *priv)
 		fb_set_cmap(&v->cmap, v->info);
 	}
 
+	/* Pixel values of glyph tiles might have changed */
+	if (v->glyph_tiles) {
+		vtemu_glyph_invalidate(v);
+	}
+
 	/* Redraw display */
 	vtemu_redraw_display(v);
 
@@ -1176,16 +1323,54 @@ struct vtemu *vtemu_create(const char *name,
 	if (!v->cursor_bkp) {
 		goto free_cells;
 	}
+	v->cursor_on = FALSE;
+	v->screen = vmm_malloc(v->w * v->h * sizeof(*v->screen));
+	if (!v->screen) {
+		goto free_cursor_bkp;
+	}
 	v->esc_cmd_active = FALSE;
 	v->esc_cmd_count = 0;
 	v->esc_attrib_count = 0;
 	v->esc_attrib[0] = 0;
 
+	/* Setup glyph tiles (only for byte aligned pixels) */
+	switch (v->info->var.bits_per_pixel) {
+	case 8:
+	case 16:
+	case 32:
+		v->glyph_Bpp = v->info->var.bits_per_pixel / 8;
+		break;
+	default:
+		v->glyph_Bpp = 0;
+		break;
+	};
+	if ((v->info->fix.visual == FB_VISUAL_TRUECOLOR ||
+	     v->info->fix.visual == FB_VISUAL_DIRECTCOLOR) &&
+	    !v->info->pseudo_palette) {
+		v->glyph_Bpp = 0;
+	}
+	if (!v->info->screen_base ||
+	    (v->info->flags & FBINFO_FOREIGN_ENDIAN)) {
+		v->glyph_Bpp = 0;
+	}
+	if (v->glyph_Bpp) {
+		v->glyph_pitch = v->font->width * v->glyph_Bpp;
+		v->glyph_tile_sz = v->glyph_pitch * v->font->height;
+		v->glyph_count = 1 << CONFIG_VTEMU_GLYPH_CACHE_ORDER;
+		v->glyph = vmm_malloc(v->glyph_count * sizeof(*v->glyph));
+		v->glyph_tiles = vmm_malloc(v->glyph_count * v->glyph_tile_sz);
+		v->line_buf = vmm_malloc(v->w * v->glyph_tile_sz);
+		if (!v->glyph || !v->glyph_tiles || !v->line_buf) {
+			goto free_glyphs;
+		}
+		vtemu_glyph_invalidate(v);
+	}
+
 	/* Setup input data */
 	v->in_key_flags = 0;
 	v->in_fifo = fifo_alloc(sizeof(u8), VTEMU_INBUF_SIZE);
 	if (!v->in_fifo) {
-		goto free_cursor_bkp;
+		goto free_glyphs;
 	}
 	INIT_COMPLETION(&v->in_done);
 
@@ -1197,6 +1382,17 @@ struct vtemu *vtemu_create(const char *name,
 
 	return v;
 
+free_glyphs:
+	if (v->line_buf) {
+		vmm_free(v->line_buf);
+	}
+	if (v->glyph_tiles) {
+		vmm_free(v->glyph_tiles);
+	}
+	if (v->glyph) {
+		vmm_free(v->glyph);
+	}
+	vmm_free(v->screen);
 free_cursor_bkp:
 	vmm_free(v->cursor_bkp);
 free_cells:
@@ -1233,6 +1429,12 @@ int vtemu_destroy(struct vtemu *v)
 
 	/* Free input FIFO and screen data */
 	fifo_free(v->in_fifo);
+	if (v->glyph_tiles) {
+		vmm_free(v->line_buf);
+		vmm_free(v->glyph_tiles);
+		vmm_free(v->glyph);
+	}
+	vmm_free(v->screen);
 	vmm_free(v->cursor_bkp);
 	vmm_free(v->cell);
 
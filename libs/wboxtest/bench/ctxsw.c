@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file ctxsw.c
+ * @author agent (agent@local)
+ * @brief context switch latency benchmark
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_scheduler.h>
+#include <vmm_threads.h>
+#include <vmm_completion.h>
+#include <vmm_modules.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"ctxsw benchmark"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			ctxsw_init
+#define	MODULE_EXIT			ctxsw_exit
+
+/* Number of ping-pong samples */
+#define NUM_SAMPLES			1024
+
+/* Global data */
+static struct vmm_thread *worker;
+static struct vmm_completion ping;
+static struct vmm_completion pong;
+static u64 samples[NUM_SAMPLES];
+
+static int ctxsw_worker_thread_main(void *data)
+{
+	while (1) {
+		vmm_completion_wait(&ping);
+		vmm_completion_complete(&pong);
+	}
+
+	return 0;
+}
+
+static int ctxsw_run(struct wboxtest *test, struct vmm_chardev *cdev,
+		     u32 test_hcpu)
+{
+	u32 i;
+	u64 tstamp;
+	u8 current_priority = vmm_scheduler_current_priority();
+
+	INIT_COMPLETION(&ping);
+	INIT_COMPLETION(&pong);
+
+	/* Worker runs on same host CPU so that each wakeup is a switch */
+	worker = vmm_threads_create("ctxsw_worker",
+				    ctxsw_worker_thread_main, NULL,
+				    current_priority,
+				    VMM_THREAD_DEF_TIME_SLICE);
+	if (!worker) {
+		return VMM_EFAIL;
+	}
+	vmm_threads_set_affinity(worker, vmm_cpumask_of(test_hcpu));
+	vmm_threads_start(worker);
+
+	/* Each sample is one round-trip hence two context switches */
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		tstamp = vmm_timer_timestamp();
+		vmm_completion_complete(&ping);
+		vmm_completion_wait(&pong);
+		samples[i] = (vmm_timer_timestamp() - tstamp) >> 1;
+	}
+
+	vmm_threads_stop(worker);
+	vmm_threads_destroy(worker);
+	worker = NULL;
+
+	wboxtest_bench_report(cdev, test, "switch_ns", samples, NUM_SAMPLES);
+
+	return VMM_OK;
+}
+
+static struct wboxtest ctxsw = {
+	.name = "ctxsw",
+	.run = ctxsw_run,
+};
+
+static int __init ctxsw_init(void)
+{
+	return wboxtest_register("bench", &ctxsw);
+}
+
+static void __exit ctxsw_exit(void)
+{
+	wboxtest_unregister(&ctxsw);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
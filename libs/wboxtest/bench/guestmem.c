@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file guestmem.c
+ * @author agent (agent@local)
+ * @brief guest memory read bandwidth benchmark
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_heap.h>
+#include <vmm_timer.h>
+#include <vmm_manager.h>
+#include <vmm_guest_aspace.h>
+#include <vmm_modules.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"guestmem benchmark"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			guestmem_init
+#define	MODULE_EXIT			guestmem_exit
+
+/* Size of each guest memory read */
+#define READ_SIZE			4096
+
+/* Total bytes read per sample */
+#define READ_TOTAL			(1024 * 1024)
+
+/* Number of bandwidth samples */
+#define NUM_SAMPLES			16
+
+/* Global data */
+static u64 samples[NUM_SAMPLES];
+
+struct guestmem_find_args {
+	struct vmm_guest *guest;
+	struct vmm_region *reg;
+};
+
+static void guestmem_find_region(struct vmm_guest *guest,
+				 struct vmm_region *reg, void *priv)
+{
+	struct guestmem_find_args *args = priv;
+
+	if (!args->reg && (READ_SIZE <= VMM_REGION_PHYS_SIZE(reg))) {
+		args->reg = reg;
+	}
+}
+
+static int guestmem_find_guest(struct vmm_guest *guest, void *priv)
+{
+	struct guestmem_find_args *args = priv;
+
+	if (!args->reg) {
+		vmm_guest_iterate_region(guest, VMM_REGION_REAL |
+					 VMM_REGION_MEMORY | VMM_REGION_ISRAM,
+					 guestmem_find_region, args);
+		if (args->reg) {
+			args->guest = guest;
+		}
+	}
+
+	return VMM_OK;
+}
+
+static int guestmem_run(struct wboxtest *test, struct vmm_chardev *cdev,
+			u32 test_hcpu)
+{
+	int rc = VMM_OK;
+	u32 i, done;
+	u64 tstamp;
+	void *buf;
+	physical_addr_t gpa;
+	struct guestmem_find_args args = { .guest = NULL, .reg = NULL };
+
+	vmm_manager_guest_iterate(guestmem_find_guest, &args);
+	if (!args.guest) {
+		vmm_cprintf(cdev, "wboxbench: test=%s skipped "
+			    "(no guest with RAM)\n", test->name);
+		return VMM_OK;
+	}
+
+	buf = vmm_malloc(READ_SIZE);
+	if (!buf) {
+		return VMM_ENOMEM;
+	}
+
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		gpa = args.reg->gphys_addr;
+		tstamp = vmm_timer_timestamp();
+		for (done = 0; done < READ_TOTAL; done += READ_SIZE) {
+			if (vmm_guest_memory_read(args.guest, gpa, buf,
+						  READ_SIZE, TRUE) != READ_SIZE) {
+				rc = VMM_EIO;
+				goto done;
+			}
+			gpa += READ_SIZE;
+			if (VMM_REGION_GPHYS_END(args.reg) < gpa + READ_SIZE) {
+				gpa = args.reg->gphys_addr;
+			}
+		}
+		samples[i] = vmm_timer_timestamp() - tstamp;
+	}
+
+	vmm_cprintf(cdev, "wboxbench: test=%s guest=%s "
+		    "region_size=%"PRIPSIZE"\n", test->name,
+		    args.guest->name, VMM_REGION_PHYS_SIZE(args.reg));
+	wboxtest_bench_report(cdev, test, "read_1MB_ns",
+			      samples, NUM_SAMPLES);
+
+done:
+	vmm_free(buf);
+	return rc;
+}
+
+static struct wboxtest guestmem = {
+	.name = "guestmem",
+	.run = guestmem_run,
+};
+
+static int __init guestmem_init(void)
+{
+	return wboxtest_register("bench", &guestmem);
+}
+
+static void __exit guestmem_exit(void)
+{
+	wboxtest_unregister(&guestmem);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
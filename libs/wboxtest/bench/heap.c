@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file heap.c
+ * @author agent (agent@local)
+ * @brief heap allocation throughput benchmark
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_heap.h>
+#include <vmm_macros.h>
+#include <vmm_timer.h>
+#include <vmm_modules.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"heap benchmark"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			heap_init
+#define	MODULE_EXIT			heap_exit
+
+/* Number of allocations per batch */
+#define NUM_ALLOCS			1024
+
+/* Global data */
+static void *ptrs[NUM_ALLOCS];
+static const u32 alloc_sizes[] = { 32, 256, 2048 };
+
+static int heap_run(struct wboxtest *test, struct vmm_chardev *cdev,
+		    u32 test_hcpu)
+{
+	int rc = VMM_OK;
+	u32 s, i;
+	u64 tstamp, alloc_nsecs, free_nsecs;
+	char metric[32];
+
+	for (s = 0; s < array_size(alloc_sizes); s++) {
+		tstamp = vmm_timer_timestamp();
+		for (i = 0; i < NUM_ALLOCS; i++) {
+			ptrs[i] = vmm_malloc(alloc_sizes[s]);
+		}
+		alloc_nsecs = vmm_timer_timestamp() - tstamp;
+
+		tstamp = vmm_timer_timestamp();
+		for (i = 0; i < NUM_ALLOCS; i++) {
+			if (!ptrs[i]) {
+				rc = VMM_ENOMEM;
+				continue;
+			}
+			vmm_free(ptrs[i]);
+			ptrs[i] = NULL;
+		}
+		free_nsecs = vmm_timer_timestamp() - tstamp;
+
+		if (rc) {
+			return rc;
+		}
+
+		vmm_snprintf(metric, sizeof(metric),
+			     "malloc_%d", alloc_sizes[s]);
+		wboxtest_bench_report_rate(cdev, test, metric,
+					   NUM_ALLOCS, alloc_nsecs);
+		vmm_snprintf(metric, sizeof(metric),
+			     "free_%d", alloc_sizes[s]);
+		wboxtest_bench_report_rate(cdev, test, metric,
+					   NUM_ALLOCS, free_nsecs);
+	}
+
+	return VMM_OK;
+}
+
+static struct wboxtest heap = {
+	.name = "heap",
+	.run = heap_run,
+};
+
+static int __init heap_init(void)
+{
+	return wboxtest_register("bench", &heap);
+}
+
+static void __exit heap_exit(void)
+{
+	wboxtest_unregister(&heap);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
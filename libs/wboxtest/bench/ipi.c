@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file ipi.c
+ * @author agent (agent@local)
+ * @brief IPI round-trip latency benchmark
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_smp.h>
+#include <vmm_cpumask.h>
+#include <vmm_modules.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"ipi benchmark"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			ipi_init
+#define	MODULE_EXIT			ipi_exit
+
+/* Number of IPI samples */
+#define NUM_SAMPLES			1024
+
+/* Timeout for each synchronous IPI call */
+#define IPI_TIMEOUT_MSECS		1000
+
+/* Global data */
+static u64 samples[NUM_SAMPLES];
+
+static void ipi_bench_func(void *arg0, void *arg1, void *arg2)
+{
+	/* Nothing to do here. */
+}
+
+static int ipi_run(struct wboxtest *test, struct vmm_chardev *cdev,
+		   u32 test_hcpu)
+{
+	int rc;
+	u32 i, cpu, target_hcpu = test_hcpu;
+	u64 tstamp;
+
+	for_each_online_cpu(cpu) {
+		if (cpu != test_hcpu) {
+			target_hcpu = cpu;
+			break;
+		}
+	}
+	if (target_hcpu == test_hcpu) {
+		vmm_cprintf(cdev, "wboxbench: test=%s skipped "
+			    "(no other online CPU)\n", test->name);
+		return VMM_OK;
+	}
+
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		tstamp = vmm_timer_timestamp();
+		rc = vmm_smp_ipi_sync_call(vmm_cpumask_of(target_hcpu),
+					   IPI_TIMEOUT_MSECS, ipi_bench_func,
+					   NULL, NULL, NULL);
+		if (rc) {
+			return rc;
+		}
+		samples[i] = vmm_timer_timestamp() - tstamp;
+	}
+
+	wboxtest_bench_report(cdev, test, "sync_call_ns",
+			      samples, NUM_SAMPLES);
+
+	return VMM_OK;
+}
+
+static struct wboxtest ipi = {
+	.name = "ipi",
+	.run = ipi_run,
+};
+
+static int __init ipi_init(void)
+{
+	return wboxtest_register("bench", &ipi);
+}
+
+static void __exit ipi_exit(void)
+{
+	wboxtest_unregister(&ipi);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file mbuf.c
+ * @author agent (agent@local)
+ * @brief mbuf allocation throughput benchmark
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_modules.h>
+#include <net/vmm_mbuf.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"mbuf benchmark"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			mbuf_init
+#define	MODULE_EXIT			mbuf_exit
+
+/* Number of mbufs per batch */
+#define NUM_MBUFS			256
+
+/* Size of external buffer attached to each mbuf */
+#define MBUF_EXT_SIZE			1536
+
+/* Global data */
+static struct vmm_mbuf *mbufs[NUM_MBUFS];
+
+static int mbuf_run(struct wboxtest *test, struct vmm_chardev *cdev,
+		    u32 test_hcpu)
+{
+	int rc = VMM_OK;
+	u32 i;
+	u64 tstamp, alloc_nsecs, free_nsecs;
+
+	tstamp = vmm_timer_timestamp();
+	for (i = 0; i < NUM_MBUFS; i++) {
+		MGETHDR(mbufs[i], 0, 0);
+		if (mbufs[i]) {
+			MEXTMALLOC(mbufs[i], MBUF_EXT_SIZE, 0);
+		}
+	}
+	alloc_nsecs = vmm_timer_timestamp() - tstamp;
+
+	tstamp = vmm_timer_timestamp();
+	for (i = 0; i < NUM_MBUFS; i++) {
+		if (!mbufs[i]) {
+			rc = VMM_ENOMEM;
+			continue;
+		}
+		m_freem(mbufs[i]);
+		mbufs[i] = NULL;
+	}
+	free_nsecs = vmm_timer_timestamp() - tstamp;
+
+	if (rc) {
+		return rc;
+	}
+
+	wboxtest_bench_report_rate(cdev, test, "alloc",
+				   NUM_MBUFS, alloc_nsecs);
+	wboxtest_bench_report_rate(cdev, test, "free",
+				   NUM_MBUFS, free_nsecs);
+
+	return VMM_OK;
+}
+
+static struct wboxtest mbuf = {
+	.name = "mbuf",
+	.run = mbuf_run,
+};
+
+static int __init mbuf_init(void)
+{
+	return wboxtest_register("bench", &mbuf);
+}
+
+static void __exit mbuf_exit(void)
+{
+	wboxtest_unregister(&mbuf);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file mempool.c
+ * @author agent (agent@local)
+ * @brief mempool allocation throughput benchmark
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_modules.h>
+#include <libs/mempool.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"mempool benchmark"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			mempool_init
+#define	MODULE_EXIT			mempool_exit
+
+/* Number of entities in mempool */
+#define NUM_ENTITIES			1024
+
+/* Size of each entity */
+#define ENTITY_SIZE			256
+
+/* Global data */
+static void *ptrs[NUM_ENTITIES];
+
+static int mempool_run(struct wboxtest *test, struct vmm_chardev *cdev,
+		       u32 test_hcpu)
+{
+	int rc = VMM_OK;
+	u32 i;
+	u64 tstamp, alloc_nsecs, free_nsecs;
+	struct mempool *mp;
+
+	mp = mempool_heap_create(ENTITY_SIZE, NUM_ENTITIES);
+	if (!mp) {
+		return VMM_ENOMEM;
+	}
+
+	tstamp = vmm_timer_timestamp();
+	for (i = 0; i < NUM_ENTITIES; i++) {
+		ptrs[i] = mempool_malloc(mp);
+	}
+	alloc_nsecs = vmm_timer_timestamp() - tstamp;
+
+	tstamp = vmm_timer_timestamp();
+	for (i = 0; i < NUM_ENTITIES; i++) {
+		if (!ptrs[i]) {
+			rc = VMM_ENOMEM;
+			continue;
+		}
+		mempool_free(mp, ptrs[i]);
+		ptrs[i] = NULL;
+	}
+	free_nsecs = vmm_timer_timestamp() - tstamp;
+
+	mempool_destroy(mp);
+
+	if (rc) {
+		return rc;
+	}
+
+	wboxtest_bench_report_rate(cdev, test, "malloc",
+				   NUM_ENTITIES, alloc_nsecs);
+	wboxtest_bench_report_rate(cdev, test, "free",
+				   NUM_ENTITIES, free_nsecs);
+
+	return VMM_OK;
+}
+
+static struct wboxtest mempool = {
+	.name = "mempool",
+	.run = mempool_run,
+};
+
+static int __init mempool_init(void)
+{
+	return wboxtest_register("bench", &mempool);
+}
+
+static void __exit mempool_exit(void)
+{
+	wboxtest_unregister(&mempool);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
@@ -0,0 +1,230 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file netswitch.c
+ * @author agent (agent@local)
+ * @brief netswitch packet rate benchmark
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_scheduler.h>
+#include <vmm_completion.h>
+#include <vmm_modules.h>
+#include <net/vmm_mbuf.h>
+#include <net/vmm_netswitch.h>
+#include <net/vmm_netport.h>
+#include <libs/stringlib.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"netswitch benchmark"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			netswitch_init
+#define	MODULE_EXIT			netswitch_exit
+
+/* Number of packets transferred */
+#define NUM_PACKETS			4096
+
+/* Size of each packet */
+#define PACKET_SIZE			64
+
+/* Local experimental ethertype used for benchmark packets */
+#define PACKET_ETHERTYPE		0x88B5
+
+/* Time to wait for all packets to arrive */
+#define RX_TIMEOUT_NSECS		(5000000000ULL)
+
+/* Global data */
+static struct vmm_netport *tx_port;
+static struct vmm_netport *rx_port;
+static struct vmm_completion rx_done;
+static u32 rx_count;
+static u32 rx_target;
+
+static int netswitch_bench_switch2port(struct vmm_netport *port,
+				       struct vmm_mbuf *mbuf)
+{
+	/* Note: called with port switch2port_xfer_lock held */
+	if ((port == rx_port) && (++rx_count == rx_target)) {
+		vmm_completion_complete(&rx_done);
+	}
+
+	m_freem(mbuf);
+
+	return VMM_OK;
+}
+
+static int netswitch_bench_port2switch(struct vmm_netswitch *nsw,
+				       struct vmm_netport *src,
+				       struct vmm_mbuf *mbuf)
+{
+	/* Private switch so only forward from transmit to receive port */
+	if (src == tx_port) {
+		vmm_switch2port_xfer_mbuf(nsw, rx_port, mbuf);
+	}
+
+	return VMM_OK;
+}
+
+static int netswitch_bench_xmit(struct vmm_netport *src,
+				struct vmm_netport *dst)
+{
+	u8 *buf;
+	struct vmm_mbuf *mbuf;
+
+	MGETHDR(mbuf, 0, 0);
+	if (!mbuf) {
+		return VMM_ENOMEM;
+	}
+	if (!m_ext_get(mbuf, PACKET_SIZE, VMM_MBUF_ALLOC_DEFAULT)) {
+		m_freem(mbuf);
+		return VMM_ENOMEM;
+	}
+
+	buf = mtod(mbuf, u8 *);
+	memset(buf, 0, PACKET_SIZE);
+	memcpy(&buf[0], vmm_netport_mac(dst), 6);
+	memcpy(&buf[6], vmm_netport_mac(src), 6);
+	buf[12] = (PACKET_ETHERTYPE >> 8) & 0xFF;
+	buf[13] = PACKET_ETHERTYPE & 0xFF;
+	mbuf->m_len = mbuf->m_pktlen = PACKET_SIZE;
+
+	return vmm_port2switch_xfer_mbuf(src, mbuf);
+}
+
+static struct vmm_netport *netswitch_bench_port(struct vmm_netswitch *nsw,
+						const char *name)
+{
+	char pname[VMM_FIELD_NAME_SIZE];
+	struct vmm_netport *port;
+
+	vmm_snprintf(pname, sizeof(pname), "%s", name);
+	port = vmm_netport_alloc(pname, VMM_NETPORT_DEF_QUEUE_SIZE);
+	if (!port) {
+		return NULL;
+	}
+	port->switch2port_xfer = netswitch_bench_switch2port;
+
+	if (vmm_netport_register(port)) {
+		vmm_netport_free(port);
+		return NULL;
+	}
+
+	if (vmm_netswitch_port_add(nsw, port)) {
+		vmm_netport_unregister(port);
+		vmm_netport_free(port);
+		return NULL;
+	}
+
+	return port;
+}
+
+static int netswitch_run(struct wboxtest *test, struct vmm_chardev *cdev,
+			 u32 test_hcpu)
+{
+	int rc = VMM_OK;
+	u32 sent;
+	u64 tstamp, timeout;
+	struct vmm_netswitch *nsw;
+
+	nsw = vmm_netswitch_alloc("wboxbench");
+	if (!nsw) {
+		return VMM_ENOMEM;
+	}
+	nsw->port2switch_xfer = netswitch_bench_port2switch;
+
+	rc = vmm_netswitch_register(nsw, NULL, NULL);
+	if (rc) {
+		vmm_netswitch_free(nsw);
+		return rc;
+	}
+
+	INIT_COMPLETION(&rx_done);
+	rx_count = 0;
+	rx_target = NUM_PACKETS;
+
+	tx_port = netswitch_bench_port(nsw, "wboxbench_tx");
+	rx_port = netswitch_bench_port(nsw, "wboxbench_rx");
+	if (!tx_port || !rx_port) {
+		rc = VMM_EFAIL;
+		goto done;
+	}
+
+	tstamp = vmm_timer_timestamp();
+	for (sent = 0; sent < NUM_PACKETS; ) {
+		if (netswitch_bench_xmit(tx_port, rx_port)) {
+			/* Transfer queue full so let the switch drain it */
+			vmm_scheduler_yield();
+			continue;
+		}
+		sent++;
+	}
+
+	timeout = RX_TIMEOUT_NSECS;
+	rc = vmm_completion_wait_timeout(&rx_done, &timeout);
+	if (rc) {
+		vmm_cprintf(cdev, "wboxbench: test=%s received %d of %d "
+			    "packets\n", test->name, rx_count, NUM_PACKETS);
+		goto done;
+	}
+
+	wboxtest_bench_report_rate(cdev, test, "packets", NUM_PACKETS,
+				   vmm_timer_timestamp() - tstamp);
+
+done:
+	if (rx_port) {
+		vmm_netport_unregister(rx_port);
+		vmm_netport_free(rx_port);
+		rx_port = NULL;
+	}
+	if (tx_port) {
+		vmm_netport_unregister(tx_port);
+		vmm_netport_free(tx_port);
+		tx_port = NULL;
+	}
+
+	vmm_netswitch_unregister(nsw);
+	vmm_netswitch_free(nsw);
+
+	return rc;
+}
+
+static struct wboxtest netswitch = {
+	.name = "netswitch",
+	.run = netswitch_run,
+};
+
+static int __init netswitch_init(void)
+{
+	return wboxtest_register("bench", &netswitch);
+}
+
+static void __exit netswitch_exit(void)
+{
+	wboxtest_unregister(&netswitch);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
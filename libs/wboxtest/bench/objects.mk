@@ -0,0 +1,33 @@
+#/**
+# Copyright (c) 2026 agent.
+# All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+#
+# @file objects.mk
+# @author agent (agent@local)
+# @brief list of benchmark test objects to be build
+# */
+
+libs-objs-$(CONFIG_WBOXTEST_BENCH) += wboxtest/bench/ctxsw.o
+libs-objs-$(CONFIG_WBOXTEST_BENCH) += wboxtest/bench/ipi.o
+libs-objs-$(CONFIG_WBOXTEST_BENCH) += wboxtest/bench/timer.o
+libs-objs-$(CONFIG_WBOXTEST_BENCH) += wboxtest/bench/heap.o
+libs-objs-$(CONFIG_WBOXTEST_BENCH) += wboxtest/bench/mempool.o
+libs-objs-$(CONFIG_WBOXTEST_BENCH) += wboxtest/bench/guestmem.o
+ifdef CONFIG_WBOXTEST_BENCH_NET
+libs-objs-$(CONFIG_WBOXTEST_BENCH) += wboxtest/bench/mbuf.o
+libs-objs-$(CONFIG_WBOXTEST_BENCH) += wboxtest/bench/netswitch.o
+endif
@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file timer.c
+ * @author agent (agent@local)
+ * @brief timer event latency benchmark
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_completion.h>
+#include <vmm_modules.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"timer benchmark"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			timer_init
+#define	MODULE_EXIT			timer_exit
+
+/* Number of timer event samples */
+#define NUM_SAMPLES			256
+
+/* Timer event duration */
+#define EVENT_NSECS			100000ULL
+
+/* Global data */
+static struct vmm_timer_event ev;
+static struct vmm_completion ev_done;
+static u64 ev_fired;
+static u64 arm_samples[NUM_SAMPLES];
+static u64 fire_samples[NUM_SAMPLES];
+
+static void timer_bench_event(struct vmm_timer_event *e)
+{
+	ev_fired = vmm_timer_timestamp();
+	vmm_completion_complete(&ev_done);
+}
+
+static int timer_run(struct wboxtest *test, struct vmm_chardev *cdev,
+		     u32 test_hcpu)
+{
+	int rc;
+	u32 i;
+	u64 tstamp, expiry;
+
+	INIT_TIMER_EVENT(&ev, timer_bench_event, NULL);
+	INIT_COMPLETION(&ev_done);
+
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		tstamp = vmm_timer_timestamp();
+		rc = vmm_timer_event_start(&ev, EVENT_NSECS);
+		if (rc) {
+			return rc;
+		}
+		arm_samples[i] = vmm_timer_timestamp() - tstamp;
+
+		/* Expiry timestamp is cleared when event fires */
+		expiry = tstamp + EVENT_NSECS;
+
+		vmm_completion_wait(&ev_done);
+
+		/* Firing latency is measured from the requested expiry */
+		fire_samples[i] = (ev_fired > expiry) ? (ev_fired - expiry) : 0;
+	}
+
+	wboxtest_bench_report(cdev, test, "arm_ns",
+			      arm_samples, NUM_SAMPLES);
+	wboxtest_bench_report(cdev, test, "fire_ns",
+			      fire_samples, NUM_SAMPLES);
+
+	return VMM_OK;
+}
+
+static struct wboxtest timer = {
+	.name = "timer",
+	.run = timer_run,
+};
+
+static int __init timer_init(void)
+{
+	return wboxtest_register("bench", &timer);
+}
+
+static void __exit timer_exit(void)
+{
+	wboxtest_unregister(&timer);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
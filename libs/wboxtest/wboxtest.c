@@ -29,6 +29,8 @@
 #include <vmm_mutex.h>
 #include <vmm_modules.h>
 #include <vmm_timer.h>
+#include <libs/libsort.h>
+#include <libs/mathlib.h>
 #include <libs/stringlib.h>
 #include <libs/wboxtest.h>
 
@@ -353,6 +355,71 @@ void wboxtest_run_all(struct vmm_chardev *cdev, u32 iterations)
 }
 VMM_EXPORT_SYMBOL(wboxtest_run_all);
 
+static int wboxtest_bench_cmp(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+static void wboxtest_bench_swap(void *a, void *b, int size)
+{
+	u64 t = *(u64 *)a;
+
+	*(u64 *)a = *(u64 *)b;
+	*(u64 *)b = t;
+}
+
+static u64 wboxtest_bench_percentile(u64 *samples, u32 count, u32 pct)
+{
+	u64 idx = udiv64((u64)count * pct, 100);
+
+	return samples[(idx < count) ? idx : (count - 1)];
+}
+
+void wboxtest_bench_report(struct vmm_chardev *cdev, struct wboxtest *test,
+			   const char *metric, u64 *samples, u32 count)
+{
+	u32 i;
+	u64 sum = 0;
+
+	if (!test || !metric || !samples || !count) {
+		return;
+	}
+
+	simple_sort(samples, count, sizeof(*samples),
+		    wboxtest_bench_cmp, wboxtest_bench_swap);
+	for (i = 0; i < count; i++) {
+		sum += samples[i];
+	}
+
+	vmm_cprintf(cdev, "wboxbench: test=%s metric=%s count=%d "
+		    "min=%"PRIu64" avg=%"PRIu64" p50=%"PRIu64" "
+		    "p90=%"PRIu64" p99=%"PRIu64" max=%"PRIu64"\n",
+		    test->name, metric, count, samples[0],
+		    udiv64(sum, count),
+		    wboxtest_bench_percentile(samples, count, 50),
+		    wboxtest_bench_percentile(samples, count, 90),
+		    wboxtest_bench_percentile(samples, count, 99),
+		    samples[count - 1]);
+}
+VMM_EXPORT_SYMBOL(wboxtest_bench_report);
+
+void wboxtest_bench_report_rate(struct vmm_chardev *cdev,
+				struct wboxtest *test, const char *metric,
+				u64 ops, u64 nsecs)
+{
+	if (!test || !metric) {
+		return;
+	}
+
+	vmm_cprintf(cdev, "wboxbench: test=%s metric=%s ops=%"PRIu64" "
+		    "nsecs=%"PRIu64" ops_per_sec=%"PRIu64"\n",
+		    test->name, metric, ops, nsecs,
+		    (nsecs) ? udiv64(ops * 1000000000ULL, nsecs) : 0);
+}
+VMM_EXPORT_SYMBOL(wboxtest_bench_report_rate);
+
 int wboxtest_register(const char *group_name, struct wboxtest *test)
 {
 	int rc;
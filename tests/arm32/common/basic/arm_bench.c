@@ -0,0 +1,407 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file arm_bench.c
+ * @author agent (agent@local)
+ * @brief Guest exit latency benchmarks
+ *
+ * Each benchmark repeatedly triggers one kind of guest exit and times
+ * it using the virtual counter, which is readable without trapping.
+ * Boards without virtualization extensions have no virtual counter so
+ * we fall back to the board timer and skip the sysreg and psci tests.
+ * Results are printed as a single parsable summary line followed by
+ * a log2 histogram of per-iteration latency in nanoseconds.
+ */
+
+#include <arm_io.h>
+#include <arm_irq.h>
+#include <arm_math.h>
+#include <arm_board.h>
+#include <arm_stdio.h>
+#include <arm_string.h>
+#include <arm_bench.h>
+
+#define PSCI_0_2_FN_PSCI_VERSION	0x84000000
+
+#define GIC_DIST_SOFTINT		0xf00
+#define GIC_SOFTINT_TARGET_SELF		(0x2 << 24)
+
+#define VIRTIO_MMIO_QUEUE_NOTIFY	0x050
+
+#define BENCH_PAGE_SIZE			0x1000
+#define BENCH_STAGE2_DEFAULT_SIZE	0x200000
+#define BENCH_SGI_TIMEOUT_NSECS		10000000ULL
+
+static volatile u64 bench_sink;
+
+static inline u32 bench_readl(virtual_addr_t addr)
+{
+	return *((volatile u32 *)addr);
+}
+
+static inline void bench_writel(u32 data, virtual_addr_t addr)
+{
+	*((volatile u32 *)addr) = data;
+}
+
+#if defined(ARM_ARCH_v7ve)
+
+u64 arm_bench_counter(void)
+{
+	u64 cval;
+
+	asm volatile(" isb\n\t"
+		     " mrrc     p15, 1, %Q0, %R0, c14\n\t"
+		     : "=r" (cval) : : "memory", "cc");
+
+	return cval;
+}
+
+u64 arm_bench_counter2ns(u64 ticks)
+{
+	u32 freq;
+
+	asm volatile(" mrc     p15, 0, %0, c14, c0, 0\n\t"
+		     : "=r" (freq) : : "memory", "cc");
+	if (!freq) {
+		return ticks;
+	}
+
+	return arm_udiv64(ticks * 1000000000ULL, freq);
+}
+
+#else
+
+u64 arm_bench_counter(void)
+{
+	return arm_board_timer_timestamp();
+}
+
+u64 arm_bench_counter2ns(u64 ticks)
+{
+	return ticks;
+}
+
+#endif
+
+void arm_bench_stat_init(struct arm_bench_stat *st, const char *name)
+{
+	int i;
+
+	st->name = name;
+	st->count = 0;
+	st->total = 0;
+	st->min = ~0ULL;
+	st->max = 0;
+	for (i = 0; i < ARM_BENCH_HIST_BUCKETS; i++) {
+		st->hist[i] = 0;
+	}
+}
+
+void arm_bench_stat_add(struct arm_bench_stat *st, u64 nsecs)
+{
+	int b = 0;
+	u64 v = nsecs;
+
+	st->count++;
+	st->total += nsecs;
+	if (nsecs < st->min) {
+		st->min = nsecs;
+	}
+	if (st->max < nsecs) {
+		st->max = nsecs;
+	}
+
+	while (v > 1 && b < (ARM_BENCH_HIST_BUCKETS - 1)) {
+		v >>= 1;
+		b++;
+	}
+	st->hist[b]++;
+}
+
+void arm_bench_stat_print(struct arm_bench_stat *st)
+{
+	int i;
+	u64 avg = 0;
+
+	if (!st->count) {
+		arm_printf("exitbench: test=%s count=0\n", st->name);
+		return;
+	}
+
+	avg = arm_udiv64(st->total, st->count);
+	arm_printf("exitbench: test=%s count=%llu min=%llu avg=%llu max=%llu "
+		   "(nsecs)\n", st->name, st->count, st->min, avg, st->max);
+
+	for (i = 0; i < ARM_BENCH_HIST_BUCKETS; i++) {
+		if (!st->hist[i]) {
+			continue;
+		}
+		arm_printf("  [%llu, %llu) : %d\n",
+			   (i) ? (1ULL << i) : 0ULL, 1ULL << (i + 1),
+			   st->hist[i]);
+	}
+}
+
+static int bench_iters(int argc, char **argv, int pos)
+{
+	int iters = ARM_BENCH_DEFAULT_ITERS;
+
+	if (pos < argc) {
+		iters = arm_str2int(argv[pos]);
+	}
+
+	return (iters > 0) ? iters : ARM_BENCH_DEFAULT_ITERS;
+}
+
+static void bench_mmio(virtual_addr_t addr, int iters)
+{
+	int i;
+	u32 val;
+	u64 t;
+	struct arm_bench_stat rd, wr;
+
+	arm_bench_stat_init(&rd, "mmio_read");
+	arm_bench_stat_init(&wr, "mmio_write");
+
+	for (i = 0; i < iters; i++) {
+		t = arm_bench_counter();
+		val = bench_readl(addr);
+		arm_bench_stat_add(&rd,
+			arm_bench_counter2ns(arm_bench_counter() - t));
+
+		t = arm_bench_counter();
+		bench_writel(val, addr);
+		arm_bench_stat_add(&wr,
+			arm_bench_counter2ns(arm_bench_counter() - t));
+	}
+
+	arm_bench_stat_print(&rd);
+	arm_bench_stat_print(&wr);
+}
+
+static void bench_virtio(virtual_addr_t addr, int iters)
+{
+	int i;
+	u64 t;
+	struct arm_bench_stat st;
+
+	arm_bench_stat_init(&st, "virtio_notify");
+
+	for (i = 0; i < iters; i++) {
+		t = arm_bench_counter();
+		bench_writel(0, addr + VIRTIO_MMIO_QUEUE_NOTIFY);
+		arm_bench_stat_add(&st,
+			arm_bench_counter2ns(arm_bench_counter() - t));
+	}
+
+	arm_bench_stat_print(&st);
+}
+
+#if defined(ARM_ARCH_v7ve)
+
+static void bench_sysreg(int iters)
+{
+	int i;
+	u32 val;
+	u64 t;
+	struct arm_bench_stat st;
+
+	arm_bench_stat_init(&st, "sysreg");
+
+	/* ACTLR accesses are trapped by hypervisor (HCR.TAC) */
+	for (i = 0; i < iters; i++) {
+		t = arm_bench_counter();
+		asm volatile(" mrc     p15, 0, %0, c1, c0, 1\n\t"
+			     : "=r" (val) : : "memory", "cc");
+		bench_sink = val;
+		arm_bench_stat_add(&st,
+			arm_bench_counter2ns(arm_bench_counter() - t));
+	}
+
+	arm_bench_stat_print(&st);
+}
+
+static u32 bench_psci_call(u32 fn)
+{
+	register u32 r0 asm("r0") = fn;
+
+	asm volatile(".arch_extension sec\n\t"
+		     "smc #0"
+		     : "+r" (r0)
+		     :
+		     : "r1", "r2", "r3", "memory");
+
+	return r0;
+}
+
+static void bench_psci(int iters)
+{
+	int i;
+	u64 t;
+	struct arm_bench_stat st;
+
+	arm_bench_stat_init(&st, "psci");
+
+	for (i = 0; i < iters; i++) {
+		t = arm_bench_counter();
+		bench_psci_call(PSCI_0_2_FN_PSCI_VERSION);
+		arm_bench_stat_add(&st,
+			arm_bench_counter2ns(arm_bench_counter() - t));
+	}
+
+	arm_bench_stat_print(&st);
+}
+
+#else
+
+static void bench_sysreg(int iters)
+{
+	arm_puts("exitbench: sysreg: requires virtualization extensions\n");
+}
+
+static void bench_psci(int iters)
+{
+	arm_puts("exitbench: psci: requires virtualization extensions\n");
+}
+
+#endif
+
+static volatile u64 bench_sgi_stamp;
+static volatile u32 bench_sgi_fired;
+
+static int bench_sgi_handler(u32 irq_no, struct pt_regs *regs)
+{
+	bench_sgi_stamp = arm_bench_counter();
+	bench_sgi_fired = 1;
+	return 0;
+}
+
+static void bench_sgi(virtual_addr_t gicd, u32 sgi, int iters)
+{
+	int i;
+	u64 t, tout;
+	struct arm_bench_stat st;
+
+	arm_bench_stat_init(&st, "sgi");
+	arm_irq_register(sgi, bench_sgi_handler);
+
+	for (i = 0; i < iters; i++) {
+		bench_sgi_fired = 0;
+		t = arm_bench_counter();
+		bench_writel(GIC_SOFTINT_TARGET_SELF | sgi,
+			     gicd + GIC_DIST_SOFTINT);
+		tout = arm_board_timer_timestamp() + BENCH_SGI_TIMEOUT_NSECS;
+		while (!bench_sgi_fired) {
+			if (tout < arm_board_timer_timestamp()) {
+				break;
+			}
+		}
+		if (!bench_sgi_fired) {
+			arm_printf("exitbench: sgi%d timeout at iteration %d\n",
+				   sgi, i);
+			break;
+		}
+		arm_bench_stat_add(&st,
+			arm_bench_counter2ns(bench_sgi_stamp - t));
+	}
+
+	arm_irq_register(sgi, NULL);
+	arm_bench_stat_print(&st);
+}
+
+static void bench_stage2(virtual_addr_t addr, virtual_size_t size)
+{
+	u64 t;
+	virtual_addr_t va;
+	struct arm_bench_stat first, retouch;
+
+	arm_bench_stat_init(&first, "stage2_first_touch");
+	arm_bench_stat_init(&retouch, "stage2_retouch");
+
+	/* First pass takes a stage2 fault on each unmapped page */
+	for (va = addr; va < (addr + size); va += BENCH_PAGE_SIZE) {
+		t = arm_bench_counter();
+		bench_readl(va);
+		arm_bench_stat_add(&first,
+			arm_bench_counter2ns(arm_bench_counter() - t));
+	}
+
+	/* Second pass is the no-exit baseline */
+	for (va = addr; va < (addr + size); va += BENCH_PAGE_SIZE) {
+		t = arm_bench_counter();
+		bench_readl(va);
+		arm_bench_stat_add(&retouch,
+			arm_bench_counter2ns(arm_bench_counter() - t));
+	}
+
+	arm_bench_stat_print(&first);
+	arm_bench_stat_print(&retouch);
+}
+
+void arm_cmd_exitbench(int argc, char **argv)
+{
+	u32 sgi;
+	virtual_addr_t addr;
+	virtual_size_t size;
+
+	if (argc < 2) {
+		arm_puts("exitbench: must provide <test>\n");
+		return;
+	}
+
+	if (arm_strcmp(argv[1], "mmio") == 0) {
+		if (argc < 3) {
+			arm_puts("exitbench: mmio: must provide <addr>\n");
+			return;
+		}
+		addr = (virtual_addr_t)arm_hexstr2uint(argv[2]);
+		bench_mmio(addr, bench_iters(argc, argv, 3));
+	} else if (arm_strcmp(argv[1], "virtio") == 0) {
+		if (argc < 3) {
+			arm_puts("exitbench: virtio: must provide <addr>\n");
+			return;
+		}
+		addr = (virtual_addr_t)arm_hexstr2uint(argv[2]);
+		bench_virtio(addr, bench_iters(argc, argv, 3));
+	} else if (arm_strcmp(argv[1], "sysreg") == 0) {
+		bench_sysreg(bench_iters(argc, argv, 2));
+	} else if (arm_strcmp(argv[1], "psci") == 0) {
+		bench_psci(bench_iters(argc, argv, 2));
+	} else if (arm_strcmp(argv[1], "sgi") == 0) {
+		if (argc < 3) {
+			arm_puts("exitbench: sgi: must provide <gicd_addr>\n");
+			return;
+		}
+		addr = (virtual_addr_t)arm_hexstr2uint(argv[2]);
+		sgi = (argc > 4) ? (arm_str2int(argv[4]) & 0xf) : 1;
+		bench_sgi(addr, sgi, bench_iters(argc, argv, 3));
+	} else if (arm_strcmp(argv[1], "stage2") == 0) {
+		if (argc > 3) {
+			addr = (virtual_addr_t)arm_hexstr2uint(argv[2]);
+			size = (virtual_size_t)arm_hexstr2uint(argv[3]);
+		} else {
+			size = BENCH_STAGE2_DEFAULT_SIZE;
+			addr = arm_board_ram_start() +
+				arm_board_ram_size() - size;
+		}
+		bench_stage2(addr, size);
+	} else {
+		arm_puts("exitbench: unknown test\n");
+	}
+}
@@ -31,6 +31,7 @@
 #include <arm_string.h>
 #include <arm_stdio.h>
 #include <arm_board.h>
+#include <arm_bench.h>
 #include <libfdt/libfdt.h>
 #include <libfdt/fdt_support.h>
 #include <dhry.h>
@@ -71,6 +72,18 @@ void arm_cmd_help(int argc, char **argv)
 	arm_puts("            Usage: wfi_test [<msecs>]\n");
 	arm_puts("            <msecs>  = delay in milliseconds to wait for\n");
 	arm_puts("\n");
+	arm_puts("exitbench   - Measure guest exit latency\n");
+	arm_puts("            Usage: exitbench mmio <addr> [<iters>]\n");
+	arm_puts("            Usage: exitbench virtio <addr> [<iters>]\n");
+	arm_puts("            Usage: exitbench sysreg [<iters>]\n");
+	arm_puts("            Usage: exitbench psci [<iters>]\n");
+	arm_puts("            Usage: exitbench sgi <gicd_addr> [<iters>] [<sgi>]\n");
+	arm_puts("            Usage: exitbench stage2 [<addr> <size>]\n");
+	arm_puts("            <addr>       = MMIO or RAM address in hex\n");
+	arm_puts("            <gicd_addr>  = GIC distributor address in hex\n");
+	arm_puts("            <size>       = RAM size in hex\n");
+	arm_puts("            <iters>      = iteration count\n");
+	arm_puts("\n");
 	arm_puts("mmu_setup   - Setup MMU for basic firmware\n");
 	arm_puts("\n");
 	arm_puts("mmu_state   - MMU is enabled/disabled for basic firmware\n");
@@ -838,6 +851,8 @@ void arm_exec(char *line)
 			arm_cmd_hello(argc, argv);
 		} else if (arm_strcmp(argv[0], "wfi_test") == 0) {
 			arm_cmd_wfi_test(argc, argv);
+		} else if (arm_strcmp(argv[0], "exitbench") == 0) {
+			arm_cmd_exitbench(argc, argv);
 		} else if (arm_strcmp(argv[0], "mmu_setup") == 0) {
 			arm_cmd_mmu_setup(argc, argv);
 		} else if (arm_strcmp(argv[0], "mmu_state") == 0) {
@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file arm_bench.h
+ * @author agent (agent@local)
+ * @brief Header file for guest exit latency benchmarks
+ */
+
+#ifndef __ARM_BENCH_H_
+#define __ARM_BENCH_H_
+
+#include <arm_types.h>
+
+/** Number of log2 buckets in latency histogram */
+#define ARM_BENCH_HIST_BUCKETS		32
+
+/** Default iteration count of exit latency benchmarks */
+#define ARM_BENCH_DEFAULT_ITERS		1000
+
+struct arm_bench_stat {
+	const char *name;
+	u64 count;
+	u64 total;
+	u64 min;
+	u64 max;
+	u32 hist[ARM_BENCH_HIST_BUCKETS];
+};
+
+void arm_bench_stat_init(struct arm_bench_stat *st, const char *name);
+void arm_bench_stat_add(struct arm_bench_stat *st, u64 nsecs);
+void arm_bench_stat_print(struct arm_bench_stat *st);
+
+u64 arm_bench_counter(void);
+u64 arm_bench_counter2ns(u64 ticks);
+
+void arm_cmd_exitbench(int argc, char **argv);
+
+#endif /* __ARM_BENCH_H_ */